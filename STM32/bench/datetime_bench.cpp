@@ -0,0 +1,344 @@
+/**
+    \file datetime_bench.cpp
+    \brief Host exhaustive test and benchmark of the date conversions (datetime.cpp)
+
+    - Every day from 1970-01-01 to the end of the 32-bit range (2106-02-07T06:28:15), at a random second of the day,
+      and the first and last second of each day: the date, time of day and weekday must match gmtime(), the epoch
+      must round trip through computeEpochFromDateTime(), toISO8601() must match strftime(), and fromISO8601() must
+      give the epoch back.
+      The number of days of each month (daysInMonth()) must match too.
+    - 64-bit epochs every 13 days from year 0 to 65535: the date must match gmtime() and round trip; isLeapYear()
+      must match the length of every year.
+    - ISO-8601 strings with milliseconds, UTC offsets, 24:00:00 and leap seconds are parsed; malformed ones and the
+      dates out of the 32-bit range are rejected.
+
+    Then the time per conversion is measured, against gmtime_r() and timegm().
+
+    Usage: datetime_bench
+
+    Returns 1 on a failed check. Build and run with run.sh.
+**/
+#include "datetime.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace
+{
+    /**
+        \brief Random numbers, the same on every host (xorshift32)
+    **/
+    class Random
+    {
+        public:
+            Random(uint32_t seed): m_state(seed) {}
+
+            uint32_t next()
+            {
+                m_state ^= m_state << 13;
+                m_state ^= m_state >> 17;
+                m_state ^= m_state << 5;
+                return m_state;
+            }
+
+            // Uniform in [0, n)
+            uint32_t below(uint32_t n)
+            {
+                return next() % n;
+            }
+
+        private:
+            uint32_t m_state;
+    };
+
+    uint64_t nanos()
+    {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+    }
+
+    constexpr uint32_t DAY = 86400;
+
+    /**
+        \brief Check a 32-bit epoch against gmtime()
+        \returns \c true on a mismatch, \c false otherwise
+    **/
+    bool check(uint32_t e)
+    {
+        const time_t t = e;
+        struct tm tm;
+        gmtime_r(&t, &tm);
+
+        const DateTime dt(e);
+        const DateTime::Date date = dt.getDate();
+        const DateTime::Time time = dt.getTime();
+
+        char iso[32], expected[32];
+        strftime(expected, sizeof(expected), "%Y-%m-%dT%H:%M:%SZ", &tm);
+
+        DateTime parsed;
+        const bool invalid =
+            date.y != tm.tm_year + 1900 || date.m != tm.tm_mon + 1 || date.d != tm.tm_mday ||
+            time.h != tm.tm_hour || time.m != tm.tm_min || time.s != tm.tm_sec ||
+            dt.getDayOfWeek() != (tm.tm_wday + 6) % 7 + 1 ||
+            DateTime::computeEpochFromDateTime(date, time) != e ||
+            dt.toISO8601(iso, sizeof(iso)) != strlen(expected) || strcmp(iso, expected) ||
+            DateTime::fromISO8601(iso, parsed) || parsed.getEpoch() != e ||
+            date.d > DateTime::daysInMonth(date.m, date.y);
+
+        if(invalid)
+            printf("Epoch %lu: %s, weekday %u, gmtime() gives %s, weekday %u\n", (unsigned long)(e), iso,
+                   dt.getDayOfWeek(), expected, (tm.tm_wday + 6) % 7 + 1);
+
+        return invalid;
+    }
+
+    uint32_t checkAllDays(uint32_t& days)
+    {
+        Random random(0xDA7E);
+        uint32_t failures = 0;
+        days = 0;
+
+        for(uint64_t day = 0; day*DAY <= UINT32_MAX; ++day, ++days)
+        {
+            const uint32_t start    = day*DAY;
+            const uint32_t last     = (UINT32_MAX - start < DAY - 1) ? UINT32_MAX : start + DAY - 1;
+
+            failures += check(start) || check(start + random.below(last - start + 1)) || check(last);
+
+            // Month lengths: the last day of a month is followed by the 1st
+            const time_t next = (time_t)(start) + DAY;
+            struct tm tm;
+            gmtime_r(&next, &tm);
+
+            const DateTime::Date date = DateTime::computeDateFromEpoch(start);
+            if(tm.tm_mday == 1 && DateTime::daysInMonth(date.m, date.y) != date.d)
+            {
+                printf("%04u-%02u has %u days, not %u\n", date.y, date.m, DateTime::daysInMonth(date.m, date.y),
+                       date.d);
+                failures++;
+            }
+
+            if(failures > 10)
+                break;
+        }
+
+        return failures;
+    }
+
+    uint32_t check64()
+    {
+        const int64_t first = (int64_t)(DateTime::daysFromCivil(DateTime::Date(1, 1, 0)));
+        const int64_t end   = (int64_t)(DateTime::daysFromCivil(DateTime::Date(31, 12, 65535)));
+        uint32_t failures   = 0;
+
+        for(uint32_t y = 0; y < 65535; ++y)
+        {
+            const int32_t length =  DateTime::daysFromCivil(DateTime::Date(1, 1, y + 1)) -
+                                    DateTime::daysFromCivil(DateTime::Date(1, 1, y));
+
+            if(DateTime::isLeapYear(y) != (length == 366))
+            {
+                printf("Year %lu: %ld days, isLeapYear() gives %d\n", (unsigned long)(y), (long)(length),
+                       DateTime::isLeapYear(y));
+                failures++;
+                break;
+            }
+        }
+
+        for(int64_t day = first; day <= end && failures < 10; day += 13)
+        {
+            const int64_t e = day*DAY + (day & 0xFFFF);
+            const time_t t  = e;
+            struct tm tm;
+
+            const DateTime::Date date = DateTime::computeDateFromEpoch64(e);
+            const DateTime::Time time = DateTime::computeTimeFromEpoch64(e);
+
+            if(!gmtime_r(&t, &tm) || date.y != tm.tm_year + 1900 || date.m != tm.tm_mon + 1 ||
+               date.d != tm.tm_mday || time.h != tm.tm_hour || time.m != tm.tm_min || time.s != tm.tm_sec ||
+               DateTime::computeEpoch64FromDateTime(date, time) != e ||
+               DateTime::dayOfWeek(day) != (tm.tm_wday + 6) % 7 + 1)
+            {
+                printf("64-bit epoch %lld: %04u-%02u-%02u, gmtime() gives %04d-%02d-%02d\n", (long long)(e), date.y,
+                       date.m, date.d, tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+                failures++;
+            }
+        }
+
+        return failures;
+    }
+
+    uint32_t checkISO8601()
+    {
+        struct Valid
+        {
+            const char* s;
+            int64_t     e;
+            uint16_t    ms;
+        };
+
+        const Valid valid[] =
+        {
+            {"1970-01-01",                      0,              0},
+            {"2017-08-22T12:00:00Z",            1503403200,     0},
+            {"2017-08-22 12:00",                1503403200,     0},
+            {"2017-08-22T12:00:00.5Z",          1503403200,     500},
+            {"2017-08-22T12:00:00,123456Z",     1503403200,     123},
+            {"2017-08-22T14:00:00+02:00",       1503403200,     0},
+            {"2017-08-22T14:30:00+0230",        1503403200,     0},
+            {"2017-08-22T07:00:00-05",          1503403200,     0},
+            {"2016-12-31T23:59:60Z",            1483228800,     0},
+            {"2017-08-21T24:00:00Z",            1503360000,     0},
+            {"2000-02-29T00:00:00Z",            951782400,      0},
+            {"1969-12-31T23:59:59Z",            -1,             0},
+            {"0000-01-01T00:00:00Z",            -62167219200,   0}
+        };
+
+        const char* invalid[] =
+        {
+            "", "2017", "2017-8-22", "2017-08-22T", "2017-08-22T12", "2017-08-22T12:00:", "2017-08-22T12:00:00.",
+            "2017-13-01", "2017-00-01", "2017-02-29", "2017-04-31", "2017-08-32", "2017-08-22T25:00",
+            "2017-08-22T24:00:01", "2017-08-22T12:60", "2017-08-22T12:00:61", "2017-08-22T12:00+24",
+            "2017-08-22T12:00+02:60", "2017-08-22T12:00+02:", "2017-08-22T12:00:00Zx", "2017-08-22x"
+        };
+
+        uint32_t failures = 0;
+
+        for(const Valid& v: valid)
+        {
+            int64_t e;
+            uint16_t ms;
+
+            if(DateTime::parseISO8601(v.s, e, &ms) || e != v.e || ms != v.ms)
+            {
+                printf("ISO-8601: \"%s\" not parsed as %lld.%03u\n", v.s, (long long)(v.e), v.ms);
+                failures++;
+            }
+        }
+
+        for(const char* s: invalid)
+        {
+            int64_t e;
+
+            if(!DateTime::parseISO8601(s, e))
+            {
+                printf("ISO-8601: \"%s\" accepted\n", s);
+                failures++;
+            }
+        }
+
+        // Out of the 32-bit range, for DateTime
+        DateTime dt;
+        if(!DateTime::fromISO8601("1969-12-31T23:59:59Z", dt) || !DateTime::fromISO8601("2106-02-07T06:28:16Z", dt) ||
+           DateTime::fromISO8601("2106-02-07T06:28:15Z", dt) || dt.getEpoch() != UINT32_MAX)
+        {
+            printf("ISO-8601: the 32-bit range is not enforced\n");
+            failures++;
+        }
+
+        // Formatting with milliseconds, after year 9999
+        char buffer[32];
+        if(DateTime::formatISO8601(1503403200, buffer, sizeof(buffer), 7) != 24 ||
+           strcmp(buffer, "2017-08-22T12:00:00.007Z") ||
+           DateTime::formatISO8601(253402300800, buffer, sizeof(buffer)) != 21 ||
+           strcmp(buffer, "10000-01-01T00:00:00Z") || DateTime::formatISO8601(0, buffer, 20) != 0)
+        {
+            printf("ISO-8601: formatting failed (%s)\n", buffer);
+            failures++;
+        }
+
+        return failures;
+    }
+
+    volatile uint64_t sink;
+
+    template<typename F>
+    void measure(const char* name, F conversion)
+    {
+        constexpr uint32_t COUNT = 2000000;
+        Random random(1);
+        uint64_t total = 0;
+        const uint64_t start = nanos();
+
+        for(uint32_t i = 0; i < COUNT; ++i)
+            total += conversion(random.next());
+
+        const double elapsed = (double)(nanos() - start)/COUNT;
+        sink = total;
+
+        printf("%-28s %8.1f\n", name, elapsed);
+    }
+
+    void benchmark()
+    {
+        printf("%-28s %8s\n", "conversion", "ns");
+
+        measure("date from epoch", [](uint32_t e) { return DateTime::computeDateFromEpoch(e).d; });
+        measure("epoch from date", [](uint32_t e)
+                {
+                    return DateTime::computeEpochFromDateTime(DateTime::Date(1 + e % 28, 1 + (e >> 8) % 12,
+                                                              1970 + (e >> 16) % 136));
+                });
+        measure("round trip", [](uint32_t e)
+                {
+                    return DateTime::computeEpochFromDateTime(DateTime::computeDateFromEpoch(e),
+                                                              DateTime::computeTimeFromEpoch(e));
+                });
+        measure("round trip, 64-bit", [](uint32_t e)
+                {
+                    const int64_t e64 = (int64_t)(e)*300 - 100000000000LL;
+                    return DateTime::computeEpoch64FromDateTime(DateTime::computeDateFromEpoch64(e64),
+                                                                DateTime::computeTimeFromEpoch64(e64));
+                });
+        measure("gmtime_r() and timegm()", [](uint32_t e)
+                {
+                    const time_t t = e;
+                    struct tm tm;
+                    gmtime_r(&t, &tm);
+                    return (uint64_t)(timegm(&tm));
+                });
+        measure("formatISO8601()", [](uint32_t e)
+                {
+                    char buffer[32];
+                    return DateTime::formatISO8601(e, buffer, sizeof(buffer)) + buffer[9];
+                });
+        measure("parseISO8601()", [](uint32_t e)
+                {
+                    char buffer[32] = "2017-08-22T12:00:00.000Z";
+                    buffer[18] = '0' + e % 10;
+                    buffer[21] = '0' + (e >> 8) % 10;
+
+                    int64_t parsed;
+                    uint16_t ms;
+                    DateTime::parseISO8601(buffer, parsed, &ms);
+                    return (uint64_t)(parsed) + ms;
+                });
+    }
+}
+
+int main(int argc, char**)
+{
+    if(argc > 1)
+    {
+        fprintf(stderr, "Usage: datetime_bench\n");
+        return 2;
+    }
+
+    uint32_t days;
+    uint32_t failures = checkAllDays(days);
+    failures += check64();
+    failures += checkISO8601();
+
+    printf("%lu days from 1970 to 2106, 64-bit epochs from year 0 to 65535, ISO-8601 checks: %s\n",
+           (unsigned long)(days), failures ? "FAILED" : "ok");
+
+    if(failures)
+        return 1;
+
+    benchmark();
+
+    return 0;
+}
@@ -0,0 +1,1030 @@
+/**
+    \file display_bench.cpp
+    \brief Host regression tests and span benchmark of the Display primitives (display.cpp)
+
+    Display clips its primitives once against the screen and sends spans to the driver. The checks:
+    - random scenes (lines, rectangles, circles, rounded rectangles, triangles, compressed glyphs), most of them
+      partly off screen, are drawn with Display and with a reference: the per-pixel algorithms Display used before
+      clipping (Adafruit_GFX), each pixel clipped on its own. The images must be identical;
+    - Display must never send a pixel or a span outside the screen to the driver;
+    - the anti-aliased primitives and glyphs, which have no per-pixel reference, are compared with their snapshots
+      (display_snapshots.txt).
+
+    Then the random scenes are measured with Display and with the reference: driver calls, single pixel calls,
+    pixels, and spans (driver calls) and pixels per second.
+
+    Usage: display_bench [-s snapshots] [-u] [-o directory] [-n scenes]
+    - -s: snapshot file (default: display_snapshots.txt)
+    - -u: replace the snapshots with the current images
+    - -o: write the snapshot images to a directory, as PPM files
+    - -n: number of random scenes (default: 3000)
+
+    Returns 1 on a failed check. Build and run with run.sh.
+**/
+#define PROGMEM
+
+#include "display.h"
+#include "fonts/FreeSans9pt7b.h"
+#include "fonts/FreeSans18pt7b.h"
+
+#include "snapshot.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    constexpr int16_t SCREEN_WIDTH  = 320;
+    constexpr int16_t SCREEN_HEIGHT = 240;
+    constexpr int32_t PIXEL_COUNT   = SCREEN_WIDTH*SCREEN_HEIGHT;
+
+    /**
+        \brief Driver calls, as sent to a display
+    **/
+    struct Counters
+    {
+        uint64_t calls          = 0;
+        uint64_t pixelCalls     = 0;    // Calls for a single pixel
+        uint64_t pixels         = 0;
+        uint64_t outside        = 0;    // Calls (partly) outside the screen
+
+        void count(int32_t x, int32_t y, int32_t w, int32_t h)
+        {
+            calls++;
+            pixelCalls += (w == 1 && h == 1);
+            pixels     += (w > 0 && h > 0) ? (uint64_t)(w)*h : 0;
+            outside    += (x < 0 || y < 0 || x + w > SCREEN_WIDTH || y + h > SCREEN_HEIGHT);
+        }
+    };
+
+    void fill(uint16_t* pixels, int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color)
+    {
+        const int32_t x0 = std::max<int32_t>(x, 0);
+        const int32_t y0 = std::max<int32_t>(y, 0);
+        const int32_t x1 = std::min<int32_t>(x + w, SCREEN_WIDTH);
+        const int32_t y1 = std::min<int32_t>(y + h, SCREEN_HEIGHT);
+
+        for(int32_t j = y0; j < y1; ++j)
+            for(int32_t i = x0; i < x1; ++i)
+                pixels[j*SCREEN_WIDTH + i] = color;
+    }
+
+    /**
+        \brief Display drawing into memory, counting the driver calls
+    **/
+    class Canvas: public Display
+    {
+        public:
+            Canvas(uint16_t* pixels): Display(SCREEN_WIDTH, SCREEN_HEIGHT), m_pixels(pixels) {}
+
+            virtual bool init(Orientation)
+            {
+                return false;
+            }
+
+            virtual void writePixel(int16_t x, int16_t y, uint16_t color)
+            {
+                counters.count(x, y, 1, 1);
+                fill(m_pixels, x, y, 1, 1, color);
+            }
+
+            virtual void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+            {
+                counters.count(x, y, w, h);
+                fill(m_pixels, x, y, w, h, color);
+            }
+
+            virtual void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+            {
+                writeFillRect(x, y, w, 1, color);
+            }
+
+            virtual void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+            {
+                writeFillRect(x, y, 1, h, color);
+            }
+
+            // Entry points that drivers clip themselves (Adafruit_GFX convention), like FrameBuffer
+            virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+            {
+                fillRect(x, y, 1, h, color);
+            }
+
+            virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+            {
+                fillRect(x, y, w, 1, color);
+            }
+
+            virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+            {
+                writeClippedRect(x, y, x + w - 1, y + h - 1, color);
+            }
+
+            Counters counters;
+
+        private:
+            uint16_t* m_pixels;
+    };
+
+    /**
+        \brief The primitives of Display before clipping (Adafruit_GFX), each pixel is clipped on its own
+
+        Only the calls to the driver changed: they are counted, then the visible pixels are written.
+    **/
+    class Reference
+    {
+        public:
+            Reference(uint16_t* pixels): m_pixels(pixels) {}
+
+            void writePixel(int16_t x, int16_t y, uint16_t color)
+            {
+                counters.count(x, y, 1, 1);
+                fill(m_pixels, x, y, 1, 1, color);
+            }
+
+            void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+            {
+                if(w <= 0 || h <= 0)
+                    return;
+
+                counters.count(x, y, w, h);
+                fill(m_pixels, x, y, w, h, color);
+            }
+
+            void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+            {
+                writeFillRect(x, y, w, h, color);
+            }
+
+            void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+            {
+                writeFillRect(x, y, 1, h, color);
+            }
+
+            void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+            {
+                writeFillRect(x, y, w, 1, color);
+            }
+
+            void writeLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
+            {
+                int16_t steep = std::abs(y1 - y0) > std::abs(x1 - x0);
+                if (steep)
+                {
+                    std::swap(x0, y0);
+                    std::swap(x1, y1);
+                }
+
+                if (x0 > x1)
+                {
+                    std::swap(x0, x1);
+                    std::swap(y0, y1);
+                }
+
+                int16_t dx, dy;
+                dx = x1 - x0;
+                dy = std::abs(y1 - y0);
+
+                int16_t err = dx / 2;
+                int16_t ystep = (y0 < y1)?1:-1;
+
+                for (; x0<=x1; ++x0)
+                {
+                    if (steep)
+                        writePixel(y0, x0, color);
+                    else
+                        writePixel(x0, y0, color);
+
+                    err -= dy;
+                    if (err < 0)
+                    {
+                        y0 += ystep;
+                        err += dx;
+                    }
+                }
+            }
+
+            void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
+            {
+                if(x0 == x1)
+                {
+                    if(y0 > y1)
+                        std::swap(y0, y1);
+
+                    writeFastVLine(x0, y0, y1 - y0 + 1, color);
+                }
+                else if(y0 == y1)
+                {
+                    if(x0 > x1)
+                        std::swap(x0, x1);
+
+                    writeFastHLine(x0, y0, x1 - x0 + 1, color);
+                }
+                else
+                    writeLine(x0, y0, x1, y1, color);
+            }
+
+            void drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color)
+            {
+                int16_t f = 1 - r;
+                int16_t ddF_x = 1;
+                int16_t ddF_y = -2 * r;
+                int16_t x = 0;
+                int16_t y = r;
+
+                writePixel(x0  , y0+r, color);
+                writePixel(x0  , y0-r, color);
+                writePixel(x0+r, y0  , color);
+                writePixel(x0-r, y0  , color);
+
+                while (x<y)
+                {
+                    if (f >= 0)
+                    {
+                        --y;
+                        ddF_y += 2;
+                        f += ddF_y;
+                    }
+                    ++x;
+                    ddF_x += 2;
+                    f += ddF_x;
+
+                    writePixel(x0 + x, y0 + y, color);
+                    writePixel(x0 - x, y0 + y, color);
+                    writePixel(x0 + x, y0 - y, color);
+                    writePixel(x0 - x, y0 - y, color);
+                    writePixel(x0 + y, y0 + x, color);
+                    writePixel(x0 - y, y0 + x, color);
+                    writePixel(x0 + y, y0 - x, color);
+                    writePixel(x0 - y, y0 - x, color);
+                }
+            }
+
+            void drawCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t cornername, uint16_t color)
+            {
+                int16_t f     = 1 - r;
+                int16_t ddF_x = 1;
+                int16_t ddF_y = -2 * r;
+                int16_t x     = 0;
+                int16_t y     = r;
+
+                while (x<y)
+                {
+                    if (f >= 0)
+                    {
+                        --y;
+                        ddF_y += 2;
+                        f     += ddF_y;
+                    }
+                    ++x;
+                    ddF_x += 2;
+                    f     += ddF_x;
+
+                    if (cornername & 0x4)
+                    {
+                        writePixel(x0 + x, y0 + y, color);
+                        writePixel(x0 + y, y0 + x, color);
+                    }
+                    if (cornername & 0x2)
+                    {
+                        writePixel(x0 + x, y0 - y, color);
+                        writePixel(x0 + y, y0 - x, color);
+                    }
+                    if (cornername & 0x8)
+                    {
+                        writePixel(x0 - y, y0 + x, color);
+                        writePixel(x0 - x, y0 + y, color);
+                    }
+                    if (cornername & 0x1)
+                    {
+                        writePixel(x0 - y, y0 - x, color);
+                        writePixel(x0 - x, y0 - y, color);
+                    }
+                }
+            }
+
+            void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color)
+            {
+                writeFastVLine(x0, y0-r, 2*r+1, color);
+                fillCircleHelper(x0, y0, r, 3, 0, color);
+            }
+
+            void fillCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t cornername, int16_t delta, uint16_t color)
+            {
+                int16_t f     = 1 - r;
+                int16_t ddF_x = 1;
+                int16_t ddF_y = -2 * r;
+                int16_t x     = 0;
+                int16_t y     = r;
+
+                while (x<y)
+                {
+                    if (f >= 0)
+                    {
+                        --y;
+                        ddF_y += 2;
+                        f     += ddF_y;
+                    }
+                    ++x;
+                    ddF_x += 2;
+                    f     += ddF_x;
+
+                    if (cornername & 0x1)
+                    {
+                        writeFastVLine(x0+x, y0-y, 2*y+1+delta, color);
+                        writeFastVLine(x0+y, y0-x, 2*x+1+delta, color);
+                    }
+                    if (cornername & 0x2)
+                    {
+                        writeFastVLine(x0-x, y0-y, 2*y+1+delta, color);
+                        writeFastVLine(x0-y, y0-x, 2*x+1+delta, color);
+                    }
+                }
+            }
+
+            void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+            {
+                writeFastHLine(x, y, w, color);
+                writeFastHLine(x, y+h-1, w, color);
+                writeFastVLine(x, y, h, color);
+                writeFastVLine(x+w-1, y, h, color);
+            }
+
+            void drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint16_t color)
+            {
+                writeFastHLine(x+r  , y    , w-2*r, color); // Top
+                writeFastHLine(x+r  , y+h-1, w-2*r, color); // Bottom
+                writeFastVLine(x    , y+r  , h-2*r, color); // Left
+                writeFastVLine(x+w-1, y+r  , h-2*r, color); // Right
+                // draw four corners
+                drawCircleHelper(x+r    , y+r    , r, 1, color);
+                drawCircleHelper(x+w-r-1, y+r    , r, 2, color);
+                drawCircleHelper(x+w-r-1, y+h-r-1, r, 4, color);
+                drawCircleHelper(x+r    , y+h-r-1, r, 8, color);
+            }
+
+            void fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint16_t color)
+            {
+                writeFillRect(x+r, y, w-2*r, h, color);
+
+                // draw four corners
+                fillCircleHelper(x+w-r-1, y+r, r, 1, h-2*r-1, color);
+                fillCircleHelper(x+r    , y+r, r, 2, h-2*r-1, color);
+            }
+
+            void drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color)
+            {
+                drawLine(x0, y0, x1, y1, color);
+                drawLine(x1, y1, x2, y2, color);
+                drawLine(x2, y2, x0, y0, color);
+            }
+
+            void fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color)
+            {
+                int16_t a, b, y, last;
+
+                // Sort coordinates by Y order (y2 >= y1 >= y0)
+                if (y0 > y1)
+                {
+                    std::swap(y0, y1);
+                    std::swap(x0, x1);
+                }
+                if (y1 > y2)
+                {
+                    std::swap(y2, y1);
+                    std::swap(x2, x1);
+                }
+                if (y0 > y1)
+                {
+                    std::swap(y0, y1);
+                    std::swap(x0, x1);
+                }
+
+                if(y0 == y2)
+                { // Handle awkward all-on-same-line case as its own thing
+                    a = b = x0;
+                    if(x1 < a)
+                        a = x1;
+                    else if(x1 > b)
+                        b = x1;
+
+                    if(x2 < a)
+                        a = x2;
+                    else if(x2 > b)
+                        b = x2;
+                    writeFastHLine(a, y0, b-a+1, color);
+                    return;
+                }
+
+                int16_t dx01 = x1 - x0;
+                int16_t dy01 = y1 - y0;
+                int16_t dx02 = x2 - x0;
+                int16_t dy02 = y2 - y0;
+                int16_t dx12 = x2 - x1;
+                int16_t dy12 = y2 - y1;
+                int32_t sa   = 0;
+                int32_t sb   = 0;
+
+                if(y1 == y2)
+                    last = y1;   // Include y1 scanline
+                else
+                    last = y1-1; // Skip it
+
+                for(y=y0; y<=last; ++y)
+                {
+                    a   = x0 + sa / dy01;
+                    b   = x0 + sb / dy02;
+                    sa += dx01;
+                    sb += dx02;
+                    if(a > b)
+                        std::swap(a,b);
+
+                    writeFastHLine(a, y, b-a+1, color);
+                }
+
+                sa = dx12 * (y - y1);
+                sb = dx02 * (y - y0);
+                for(; y<=y2; ++y)
+                {
+                    a   = x1 + sa / dy12;
+                    b   = x0 + sb / dy02;
+                    sa += dx12;
+                    sb += dx02;
+                    if(a > b)
+                        std::swap(a,b);
+
+                    writeFastHLine(a, y, b-a+1, color);
+                }
+            }
+
+            // Glyph of a compressed font, decoded pixel by pixel (see rlefont.h)
+            void drawGlyph(const RLEFont* font, int16_t x, int16_t y, uint32_t codePoint, uint16_t color,
+                           uint16_t bg, uint8_t size)
+            {
+                const RLEGlyph* glyph = nullptr;
+
+                for(uint16_t i = 0; i < font->rangeCount && !glyph; ++i)
+                {
+                    const RLERange& range = font->range[i];
+                    if(codePoint >= range.first && codePoint - range.first < range.count)
+                        glyph = font->glyph + range.glyph + (codePoint - range.first);
+                }
+
+                if(!glyph)
+                    return;
+
+                const uint8_t* data = font->bitmap + glyph->bitmapOffset;
+                const uint8_t  max  = (1 << font->bpp) - 1;
+                const uint32_t n    = (uint32_t)(glyph->width)*glyph->height;
+                std::vector<uint8_t> levels;
+
+                while(levels.size() < n)
+                {
+                    const uint8_t op     = *(data++);
+                    const uint32_t count = (op & 0x3F) + 1;
+
+                    if(op >> 7)
+                    {
+                        for(uint32_t i = 0; i < count; ++i)
+                        {
+                            const uint32_t bit = i*font->bpp;
+                            levels.push_back((data[bit/8] >> (8 - font->bpp - bit%8)) & max);
+                        }
+
+                        data += (count*font->bpp + 7)/8;
+                    }
+                    else
+                        levels.insert(levels.end(), count, (op & 0x40) ? max : 0);
+                }
+
+                for(uint32_t i = 0; i < n; ++i)
+                {
+                    const uint8_t level = levels[i];
+                    uint16_t c = color;
+
+                    if(level == 0 || (bg == color && level < (max+1)/2))
+                        continue;
+                    else if(level != max && bg != color)
+                        c = Color16::blend(color, bg, level*(0xFF/max));
+
+                    const int16_t px = x + (glyph->xOffset + (int16_t)(i % glyph->width))*size;
+                    const int16_t py = y + (glyph->yOffset + (int16_t)(i / glyph->width))*size;
+
+                    if(size == 1)
+                        writePixel(px, py, c);
+                    else
+                        writeFillRect(px, py, size, size, c);
+                }
+            }
+
+            Counters counters;
+
+        private:
+            uint16_t* m_pixels;
+    };
+
+    /**
+        \brief Compressed font built from a GFXfont, each glyph downsampled by 'factor' (anti-aliasing)
+    **/
+    class CompressedFont
+    {
+        public:
+            CompressedFont(const GFXfont& source, uint8_t bpp, uint8_t factor)
+            {
+                const uint8_t max = (1 << bpp) - 1;
+
+                for(uint16_t c = source.first; c <= source.last; ++c)
+                {
+                    const GFXglyph& g = source.glyph[c - source.first];
+                    RLEGlyph glyph;
+
+                    glyph.bitmapOffset  = m_bitmap.size();
+                    glyph.width         = (g.width + factor - 1)/factor;
+                    glyph.height        = (g.height + factor - 1)/factor;
+                    glyph.xAdvance      = (g.xAdvance + factor - 1)/factor;
+                    glyph.xOffset       = g.xOffset/factor;
+                    glyph.yOffset       = g.yOffset/factor;
+
+                    std::vector<uint8_t> levels;
+
+                    for(int32_t y = 0; y < glyph.height; ++y)
+                    {
+                        for(int32_t x = 0; x < glyph.width; ++x)
+                        {
+                            uint32_t set = 0;
+
+                            for(int32_t j = y*factor; j < (y + 1)*factor && j < g.height; ++j)
+                            {
+                                for(int32_t i = x*factor; i < (x + 1)*factor && i < g.width; ++i)
+                                {
+                                    const uint32_t bit = g.bitmapOffset*8 + j*g.width + i;
+                                    set += (source.bitmap[bit/8] >> (7 - bit%8)) & 1;
+                                }
+                            }
+
+                            levels.push_back((set*max + factor*factor/2)/(factor*factor));
+                        }
+                    }
+
+                    encode(levels, bpp);
+                    m_glyphs.push_back(glyph);
+                }
+
+                m_range.first   = source.first;
+                m_range.count   = source.last - source.first + 1;
+                m_range.glyph   = 0;
+
+                m_font.bitmap       = m_bitmap.data();
+                m_font.glyph        = m_glyphs.data();
+                m_font.range        = &m_range;
+                m_font.rangeCount   = 1;
+                m_font.yAdvance     = (source.yAdvance + factor - 1)/factor;
+                m_font.bpp          = bpp;
+            }
+
+            const RLEFont* font() const
+            {
+                return &m_font;
+            }
+
+        private:
+            // Runs of transparent or opaque pixels (2 or more), literals for the rest
+            void encode(const std::vector<uint8_t>& levels, uint8_t bpp)
+            {
+                const uint8_t max = (1 << bpp) - 1;
+                size_t i = 0;
+
+                while(i < levels.size())
+                {
+                    size_t run = 1;
+                    while(i + run < levels.size() && run < 64 && levels[i + run] == levels[i])
+                        run++;
+
+                    if((levels[i] == 0 || levels[i] == max) && (run > 1 || bpp == 1))
+                    {
+                        m_bitmap.push_back((levels[i] ? 0x40 : 0x00) | (run - 1));
+                        i += run;
+                        continue;
+                    }
+
+                    // Literal pixels, up to the next run
+                    size_t count = 1;
+                    while(i + count < levels.size() && count < 64 &&
+                          !((levels[i + count] == 0 || levels[i + count] == max) &&
+                            i + count + 1 < levels.size() && levels[i + count + 1] == levels[i + count]))
+                        count++;
+
+                    m_bitmap.push_back(0x80 | (count - 1));
+
+                    uint32_t bits = 0;
+                    uint8_t used  = 0;
+
+                    for(size_t k = i; k < i + count; ++k)
+                    {
+                        bits  = (bits << bpp) | levels[k];
+                        used += bpp;
+
+                        if(used == 8)
+                        {
+                            m_bitmap.push_back(bits);
+                            bits = used = 0;
+                        }
+                    }
+
+                    if(used)
+                        m_bitmap.push_back(bits << (8 - used));
+
+                    i += count;
+                }
+            }
+
+            std::vector<uint8_t>    m_bitmap;
+            std::vector<RLEGlyph>   m_glyphs;
+            RLERange                m_range;
+            RLEFont                 m_font;
+    };
+
+    /**
+        \brief Random numbers, the same on every host (xorshift32)
+    **/
+    class Random
+    {
+        public:
+            Random(uint32_t seed): m_state(seed) {}
+
+            uint32_t next()
+            {
+                m_state ^= m_state << 13;
+                m_state ^= m_state >> 17;
+                m_state ^= m_state << 5;
+                return m_state;
+            }
+
+            // Uniform in [min, max]
+            int16_t range(int32_t min, int32_t max)
+            {
+                return min + (int32_t)(next() % (uint32_t)(max - min + 1));
+            }
+
+        private:
+            uint32_t m_state;
+    };
+
+    enum Primitive
+    {
+        LINE,
+        AXIS_LINE,
+        RECT,
+        FILL_RECT,
+        CIRCLE,
+        FILL_CIRCLE,
+        CIRCLE_HELPER,
+        FILL_CIRCLE_HELPER,
+        ROUND_RECT,
+        FILL_ROUND_RECT,
+        TRIANGLE,
+        FILL_TRIANGLE,
+        GLYPH,
+        PRIMITIVE_COUNT
+    };
+
+    const char* const PRIMITIVE_NAMES[PRIMITIVE_COUNT] =
+    {
+        "line", "h/v line", "rect", "fillRect", "circle", "fillCircle", "circleHelper", "fillCircleHelper",
+        "roundRect", "fillRoundRect", "triangle", "fillTriangle", "glyph"
+    };
+
+    /**
+        \brief A random primitive: coordinates from half a screen before to half a screen after the screen
+    **/
+    struct Shape
+    {
+        Primitive   primitive;
+        int16_t     x[3];
+        int16_t     y[3];
+        int16_t     w;
+        int16_t     h;
+        int16_t     r;
+        uint8_t     corners;
+        uint8_t     size;
+        uint16_t    color;
+        uint16_t    bg;
+        uint32_t    codePoint;
+
+        Shape(Random& random, Primitive p): primitive(p)
+        {
+            for(uint8_t i = 0; i < 3; ++i)
+            {
+                x[i] = random.range(-SCREEN_WIDTH/2, SCREEN_WIDTH*3/2);
+                y[i] = random.range(-SCREEN_HEIGHT/2, SCREEN_HEIGHT*3/2);
+            }
+
+            w       = random.range(1, SCREEN_WIDTH);
+            h       = random.range(1, SCREEN_HEIGHT);
+            // Display clamps the radius of rounded rectangles to half their smallest side, Adafruit_GFX did not
+            r       = random.range(0, std::min(w, h)/2);
+            corners = random.range(1, 15);
+            size    = random.range(1, 4);
+            color   = random.next();
+            bg      = (random.next() & 1) ? color : (uint16_t)(random.next());
+            codePoint = random.range(0x20, 0x7E);
+
+            // The circle helpers are called with a radius of 2 or more: for r == 1, fillCircleHelper() used to
+            // draw the center column
+            if(primitive == CIRCLE || primitive == FILL_CIRCLE)
+                r = random.range(0, SCREEN_HEIGHT);
+            else if(primitive == CIRCLE_HELPER || primitive == FILL_CIRCLE_HELPER)
+                r = random.range(2, SCREEN_HEIGHT);
+        }
+
+        template<class D> void draw(D& d, const RLEFont* font) const
+        {
+            switch(primitive)
+            {
+                case LINE:                  d.drawLine(x[0], y[0], x[1], y[1], color);                           break;
+                case AXIS_LINE:             d.drawLine(x[0], y[0], (corners & 1) ? x[0] : x[1],
+                                                       (corners & 1) ? y[1] : y[0], color);                     break;
+                case RECT:                  d.drawRect(x[0], y[0], w, h, color);                                 break;
+                case FILL_RECT:             d.fillRect(x[0], y[0], w, h, color);                                 break;
+                case CIRCLE:                d.drawCircle(x[0], y[0], r, color);                                  break;
+                case FILL_CIRCLE:           d.fillCircle(x[0], y[0], r, color);                                  break;
+                case CIRCLE_HELPER:         d.drawCircleHelper(x[0], y[0], r, corners, color);                   break;
+                case FILL_CIRCLE_HELPER:    d.fillCircleHelper(x[0], y[0], r, corners & 3, h/4, color);          break;
+                case ROUND_RECT:            d.drawRoundRect(x[0], y[0], w, h, r, color);                         break;
+                case FILL_ROUND_RECT:       d.fillRoundRect(x[0], y[0], w, h, r, color);                         break;
+                case TRIANGLE:              d.drawTriangle(x[0], y[0], x[1], y[1], x[2], y[2], color);           break;
+                case FILL_TRIANGLE:         d.fillTriangle(x[0], y[0], x[1], y[1], x[2], y[2], color);           break;
+                case GLYPH:                 glyph(d, font);                                                      break;
+                default:                                                                                        break;
+            }
+        }
+
+        // Glyphs are small: most of them near the edges of the screen
+        void glyph(Canvas& canvas, const RLEFont* font) const
+        {
+            canvas.setCompressedFont(font);
+            canvas.drawGlyph(glyphX(), glyphY(), codePoint, color, bg, size);
+        }
+
+        void glyph(Reference& reference, const RLEFont* font) const
+        {
+            reference.drawGlyph(font, glyphX(), glyphY(), codePoint, color, bg, size);
+        }
+
+        int16_t glyphX() const
+        {
+            return (x[2] & 1) ? x[0] % 40 - 20 : SCREEN_WIDTH - 20 + x[0] % 40;
+        }
+
+        int16_t glyphY() const
+        {
+            return (y[2] & 1) ? y[0] % 60 - 10 : SCREEN_HEIGHT - 20 + y[0] % 60;
+        }
+    };
+
+    uint64_t micros()
+    {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+    }
+
+    uint16_t displayPixels[PIXEL_COUNT];
+    uint16_t referencePixels[PIXEL_COUNT];
+
+    constexpr uint32_t SHAPES_PER_SCENE = 8;
+
+    /**
+        \brief Random scenes drawn with Display and with the reference
+        \returns Number of mismatching scenes
+    **/
+    uint32_t checkScenes(uint32_t scenes, const std::vector<const RLEFont*>& fonts, Snapshots& snapshots)
+    {
+        Canvas canvas(displayPixels);
+        Reference reference(referencePixels);
+        Random random(0x2545F491);
+        uint32_t failures = 0;
+
+        for(uint32_t scene = 0; scene < scenes; ++scene)
+        {
+            memset(displayPixels, 0, sizeof(displayPixels));
+            memset(referencePixels, 0, sizeof(referencePixels));
+            std::vector<Shape> shapes;
+
+            for(uint32_t i = 0; i < SHAPES_PER_SCENE; ++i)
+            {
+                shapes.push_back(Shape(random, (Primitive)(random.range(0, PRIMITIVE_COUNT - 1))));
+
+                const RLEFont* font = fonts[random.next() % fonts.size()];
+                shapes.back().draw(canvas, font);
+                shapes.back().draw(reference, font);
+            }
+
+            const uint16_t* mismatch = std::mismatch(displayPixels, displayPixels + PIXEL_COUNT, referencePixels).first;
+
+            if(mismatch != displayPixels + PIXEL_COUNT)
+            {
+                const int32_t i = mismatch - displayPixels;
+
+                if(failures++ < 10)
+                {
+                    printf("Scene %lu differs from the reference at (%ld, %ld), shapes:", (unsigned long)(scene),
+                           (long)(i % SCREEN_WIDTH), (long)(i / SCREEN_WIDTH));
+
+                    for(const Shape& shape: shapes)
+                        printf(" %s", PRIMITIVE_NAMES[shape.primitive]);
+
+                    printf("\n");
+                }
+            }
+
+            // The last scene is kept as a snapshot too
+            if(scene + 1 == scenes)
+                failures += snapshots.check("random-scene", displayPixels, SCREEN_WIDTH, SCREEN_HEIGHT);
+        }
+
+        if(canvas.counters.outside)
+        {
+            printf("%llu driver calls outside the screen\n", (unsigned long long)(canvas.counters.outside));
+            failures++;
+        }
+
+        return failures;
+    }
+
+    /**
+        \brief Anti-aliased lines and circles, glyphs, classic font: compared with their snapshots
+    **/
+    uint32_t checkSnapshots(const std::vector<const RLEFont*>& fonts, Snapshots& snapshots)
+    {
+        Canvas canvas(displayPixels);
+        uint32_t failures = 0;
+        const uint16_t bg = Color16(0, 0, 64);
+
+        // Star of lines, some crossing the edges
+        canvas.fillScreen(bg);
+        for(int32_t angle = 0; angle < 360; angle += 15)
+        {
+            const int16_t dx = (int16_t)(400*std::cos(angle*M_PI/180));
+            const int16_t dy = (int16_t)(400*std::sin(angle*M_PI/180));
+            canvas.drawLineAA(SCREEN_WIDTH/2, SCREEN_HEIGHT/2, SCREEN_WIDTH/2 + dx/(1 + angle % 2), SCREEN_HEIGHT/2 + dy,
+                              Color16::White, bg);
+        }
+        failures += snapshots.check("aa-lines", displayPixels, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+        // Concentric circles, and circles across the edges
+        canvas.fillScreen(bg);
+        for(int16_t r = 0; r < 120; r += 7)
+            canvas.drawCircleAA(SCREEN_WIDTH/2, SCREEN_HEIGHT/2, r, Color16::Green, bg);
+        canvas.drawCircleAA(0, 0, 50, Color16::Red, bg);
+        canvas.drawCircleAA(SCREEN_WIDTH, SCREEN_HEIGHT - 10, 80, Color16::Red, bg);
+        canvas.drawCircleAA(-100, 100, 120, Color16::White, bg);
+        failures += snapshots.check("aa-circles", displayPixels, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+        // Text in every font, size and background mode, across the edges
+        const char* text = "Glyphs 0123 AaBbQq,;@";
+        const char* names[] = {"glyphs-1bpp", "glyphs-4bpp"};
+
+        for(size_t f = 0; f < fonts.size(); ++f)
+        {
+            canvas.fillScreen(bg);
+            canvas.setCompressedFont(fonts[f]);
+            canvas.setTextWrap(false);
+
+            int16_t y = -4;
+            for(uint8_t size = 1; size <= 3; ++size)
+            {
+                for(uint8_t transparent = 0; transparent < 2; ++transparent)
+                {
+                    y += fonts[f]->yAdvance*size;
+                    canvas.setTextSize(size);
+                    canvas.setTextColor(Color16::White, transparent ? (uint16_t)(Color16::White) : bg);
+                    canvas.setCursor(-8*size + y % 17, y);
+                    canvas.write(text);
+                }
+            }
+            failures += snapshots.check(names[f], displayPixels, SCREEN_WIDTH, SCREEN_HEIGHT);
+        }
+
+        // Classic font, on screen (drawChar() only rejects characters fully off screen)
+        canvas.fillScreen(bg);
+        canvas.setCompressedFont(nullptr);
+        canvas.setFont(nullptr);
+        canvas.setTextWrap(true);
+        canvas.setTextColor(Color16::Green, Color16::Black);
+        for(uint8_t size = 1; size <= 3; ++size)
+        {
+            canvas.setTextSize(size);
+            canvas.write("Classic font 0123456789 ");
+        }
+        failures += snapshots.check("classic-font", displayPixels, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+        if(canvas.counters.outside)
+        {
+            printf("%llu driver calls outside the screen\n", (unsigned long long)(canvas.counters.outside));
+            failures++;
+        }
+
+        return failures;
+    }
+
+    template<class D> void measure(const char* name, D& d, uint32_t scenes, const std::vector<const RLEFont*>& fonts)
+    {
+        Random random(0x9E3779B9);
+        uint64_t elapsed = 0;
+
+        for(uint32_t scene = 0; scene < scenes; ++scene)
+        {
+            std::vector<std::pair<Shape, const RLEFont*>> shapes;
+
+            for(uint32_t i = 0; i < SHAPES_PER_SCENE; ++i)
+            {
+                shapes.push_back(std::make_pair(Shape(random, (Primitive)(random.range(0, PRIMITIVE_COUNT - 1))),
+                                                fonts[random.next() % fonts.size()]));
+            }
+
+            const uint64_t start = micros();
+            for(const auto& shape: shapes)
+                shape.first.draw(d, shape.second);
+            elapsed += micros() - start;
+        }
+
+        const Counters& c = d.counters;
+        const double seconds = elapsed ? elapsed/1e6 : 1e-6;
+
+        printf("%-10s %12llu %12llu %14llu %12.2f %12.2f\n", name, (unsigned long long)(c.calls),
+               (unsigned long long)(c.pixelCalls), (unsigned long long)(c.pixels), c.calls/seconds/1e6,
+               c.pixels/seconds/1e6);
+    }
+
+    void usage()
+    {
+        fprintf(stderr, "Usage: display_bench [-s snapshots] [-u] [-o directory] [-n scenes]\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* snapshotFile    = "display_snapshots.txt";
+    const char* imageDirectory  = nullptr;
+    bool update                 = false;
+    uint32_t scenes             = 3000;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(!strcmp(argv[i], "-s") && i + 1 < argc)
+            snapshotFile = argv[++i];
+        else if(!strcmp(argv[i], "-o") && i + 1 < argc)
+            imageDirectory = argv[++i];
+        else if(!strcmp(argv[i], "-n") && i + 1 < argc)
+            scenes = strtoul(argv[++i], nullptr, 0);
+        else if(!strcmp(argv[i], "-u"))
+            update = true;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    if(!scenes)
+    {
+        usage();
+        return 2;
+    }
+
+    Snapshots snapshots(snapshotFile, update, imageDirectory);
+    const CompressedFont sans(FreeSans9pt7b, 1, 1);
+    const CompressedFont sansAA(FreeSans18pt7b, 4, 2);
+    const std::vector<const RLEFont*> fonts = {sans.font(), sansAA.font()};
+    uint32_t failures = 0;
+
+    failures += checkScenes(scenes, fonts, snapshots);
+    failures += checkSnapshots(fonts, snapshots);
+
+    if(snapshots.save())
+    {
+        fprintf(stderr, "Can not write %s\n", snapshotFile);
+        return 1;
+    }
+
+    printf("%lu random scenes against the reference, snapshots: %s\n", (unsigned long)(scenes),
+           failures ? "FAILED" : "ok");
+
+    if(failures)
+        return 1;
+
+    static uint16_t pixels[PIXEL_COUNT];
+    Canvas canvas(pixels);
+    Reference reference(pixels);
+
+    printf("%-10s %12s %12s %14s %12s %12s\n", "", "calls", "pixel calls", "pixels", "Mcalls/s", "Mpixels/s");
+    measure("reference", reference, scenes, fonts);
+    measure("Display", canvas, scenes, fonts);
+
+    return 0;
+}
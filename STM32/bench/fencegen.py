@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+"""
+Random geofence set generator, for the geofence benchmark (geofence_bench.cpp).
+
+    fencegen.py fences.geojson
+    fencegen.py fences.geojson --count 10000 --seed 1
+
+Star-shaped polygons of 8 to 64 vertices, 50 m to 2 km wide, are spread over an
+area of about 100 x 130 km; some overlap. The output is GeoJSON, to be converted
+by geofence/fenceconvert.py. The same seed gives the same file on every host.
+"""
+
+import argparse
+import json
+import math
+import random
+
+ORIGIN      = (48.0, 2.0)   # South-west corner of the area, in degrees
+HEIGHT      = 0.9           # Degrees of latitude (100 km)
+WIDTH       = 1.75          # Degrees of longitude (130 km at 48 degrees)
+METERS      = 111320.0      # Per degree of latitude
+
+
+def fence(rng, index):
+    lat = ORIGIN[0] + rng.uniform(0, HEIGHT)
+    lon = ORIGIN[1] + rng.uniform(0, WIDTH)
+    radius = math.exp(rng.uniform(math.log(25), math.log(1000)))
+    vertices = rng.randint(8, 64)
+    scale = math.cos(math.radians(lat))
+
+    ring = []
+    for i in range(vertices):
+        angle = 2*math.pi*(i + rng.uniform(-0.3, 0.3))/vertices
+        r = radius*rng.uniform(0.5, 1.0)
+        ring.append([round(lon + r*math.sin(angle)/(METERS*scale), 7), round(lat + r*math.cos(angle)/METERS, 7)])
+    ring.append(ring[0])
+
+    return {
+        'type': 'Feature',
+        'properties': {'id': index},
+        'geometry': {'type': 'Polygon', 'coordinates': [ring]}
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Random geofence set generator')
+    parser.add_argument('output', help='GeoJSON file')
+    parser.add_argument('--count', type=int, default=10000, help='Number of fences')
+    parser.add_argument('--seed', type=int, default=1, help='Random seed')
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    features = [fence(rng, i) for i in range(args.count)]
+
+    with open(args.output, 'w') as f:
+        json.dump({'type': 'FeatureCollection', 'features': features}, f)
+
+
+if __name__ == '__main__':
+    main()
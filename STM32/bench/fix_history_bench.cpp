@@ -0,0 +1,481 @@
+/**
+    \file fix_history_bench.cpp
+    \brief Host accuracy test and benchmark of the fix history (fix_history.cpp)
+
+    The epochs are generated from known trajectories, rounded as the receivers report them (1e-7 degrees, mm/s),
+    and the positions and velocities returned by FixHistory are compared with the trajectory, in double precision:
+    - a 200 m circle at 10 m/s with 1 Hz epochs, queried every 10 ms: with velocities (GGA+RMC, cubic Hermite
+      spline) the position error must stay within 2 cm, the velocity error within 0.1 m/s, and the UTC time must
+      follow the tick; without velocities (GGA only, linear), the position error is the gap between the circle and
+      its chords (6 cm, plus the rounding), and the velocity estimated by finite differences must stay within 0.3 m/s;
+    - a straight line, GGA only: the finite differences must give the velocity within 2 cm/s, between the epochs
+      and when extrapolating after the latest one (where the UTC time must follow the tick too);
+    - a straight line across the antimeridian, with and without velocities: the longitudes must stay in
+      [-180, 180] degrees and the position error within 5 cm;
+    - local ticks: the history must keep working across the 32-bit overflow of the tick, an epoch with the same
+      tick must replace the latest one, an older tick must clear the history, the oldest epoch must be dropped
+      when full, and the queries out of the history must fail;
+    - dead reckoning: 10 m/s to the north then 2 m/s^2 of forward acceleration after the latest epoch, with a
+      0.1 g mounting tilt on the accelerometer axis: 1.5 s after the latest epoch, the corrected position must be
+      within 0.5 m of the 17.25 m travelled (15 m at constant velocity), and the speed within 0.75 m/s of 13 m/s
+      (the gravity filter absorbs part of a lasting acceleration); no correction is applied below the minimum speed.
+
+    Then the time per interpolate() is measured.
+
+    Usage: fix_history_bench
+
+    Returns 1 on a failed check. Build and run with run.sh.
+**/
+#include "fix_history.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <initializer_list>
+
+namespace
+{
+    constexpr double PI             = 3.14159265358979323846;
+    constexpr double MM_PER_UNIT    = 11.1194927;       ///< Millimeters per 1e-7 degree of latitude
+    constexpr double UNITS          = 1e7;              ///< 1e-7 degrees per degree
+    constexpr uint32_t START_TIME   = 1711195200;       ///< 2024-03-23T12:00:00Z
+    constexpr int16_t TILT          = 100;              ///< Mounting tilt on the forward axis, in mG (0.1 g)
+    constexpr double ACCELERATION   = 2;                ///< Forward acceleration after the latest epoch, in m/s^2
+
+    uint64_t nanos()
+    {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+    }
+
+    /**
+        \brief Position and velocity of a trajectory, in double precision
+    **/
+    struct State
+    {
+        double latitude;    ///< degrees
+        double longitude;   ///< degrees, in [-180, 180]
+        double north;       ///< North velocity, in mm/s
+        double east;        ///< East velocity, in mm/s
+    };
+
+    double wrap(double longitude)
+    {
+        if(longitude > 180)
+            return longitude - 360;
+        if(longitude < -180)
+            return longitude + 360;
+        return longitude;
+    }
+
+    /**
+        \brief Move from a position by a distance in the plane tangent at this position
+    **/
+    State move(double latitude, double longitude, double north, double east)
+    {
+        State s;
+        s.latitude  = latitude + north/(MM_PER_UNIT*UNITS);
+        s.longitude = wrap(longitude + east/(MM_PER_UNIT*UNITS*std::cos(latitude*PI/180)));
+        s.north     = 0;
+        s.east      = 0;
+        return s;
+    }
+
+    /**
+        \brief 200 m circle at 10 m/s, starting to the north
+        \param t Time, in s
+    **/
+    State circle(double t)
+    {
+        constexpr double RADIUS = 200e3, SPEED = 10e3;
+        const double a = SPEED/RADIUS*t;
+
+        State s     = move(48.1173, 11.5167, RADIUS*std::sin(a), RADIUS*(1 - std::cos(a)));
+        s.north     = SPEED*std::cos(a);
+        s.east      = SPEED*std::sin(a);
+        return s;
+    }
+
+    /**
+        \brief Straight line at constant velocity (a rhumb line, short enough to be straight in the tangent plane)
+    **/
+    struct Line
+    {
+        double latitude, longitude, north, east;
+
+        State operator()(double t) const
+        {
+            State s = move(latitude, longitude, north*t, east*t);
+            s.north = north;
+            s.east  = east;
+            return s;
+        }
+    };
+
+    /**
+        \brief Epoch received at \c tick, for the trajectory at time \c t, rounded as a receiver reports it
+    **/
+    FixHistory::Epoch epoch(const State& s, uint32_t tick, double t, bool velocity)
+    {
+        FixHistory::Epoch e;
+        e.tick          = tick;
+        e.time          = START_TIME + (uint32_t)(t);
+        e.milliseconds  = std::lround((t - std::floor(t))*1000);
+        e.flags         = FixHistory::HAS_TIME | FixHistory::HAS_ALTITUDE;
+        e.latitude      = std::lround(s.latitude*UNITS);
+        e.longitude     = std::lround(s.longitude*UNITS);
+        e.altitude      = 545400;
+        e.accuracy      = 2500;
+
+        if(velocity)
+        {
+            e.flags         |= FixHistory::HAS_VELOCITY;
+            e.velocityNorth = std::lround(s.north);
+            e.velocityEast  = std::lround(s.east);
+        }
+
+        return e;
+    }
+
+    /**
+        \returns Distance between an epoch and a position of the trajectory, in mm
+    **/
+    double error(const FixHistory::Epoch& e, const State& s)
+    {
+        const double north  = (e.latitude/UNITS - s.latitude)*MM_PER_UNIT*UNITS;
+        const double east   = wrap(e.longitude/UNITS - s.longitude)*MM_PER_UNIT*UNITS*std::cos(s.latitude*PI/180);
+        return std::hypot(north, east);
+    }
+
+    double velocityError(const FixHistory::Epoch& e, const State& s)
+    {
+        return std::hypot(e.velocityNorth - s.north, e.velocityEast - s.east);
+    }
+
+    /**
+        \brief Error statistics of a series of queries
+    **/
+    struct Errors
+    {
+        uint32_t    queries     = 0;
+        uint32_t    failures    = 0;    ///< Failed queries, and wrong flags or times
+        double      sum         = 0;
+        double      max         = 0;
+        double      velocity    = 0;    ///< Maximum velocity error, in mm/s
+
+        void add(const FixHistory::Epoch& e, const State& s)
+        {
+            const double d = error(e, s);
+            sum         += d;
+            max         = std::max(max, d);
+            velocity    = std::max(velocity, velocityError(e, s));
+            ++queries;
+        }
+
+        double mean() const
+        {
+            return queries ? sum/queries : 0;
+        }
+    };
+
+    /**
+        \brief Push 1 Hz epochs of a trajectory, received 40 ms after the measurement, and query every 10 ms between
+        the first and the latest one
+        \param first Tick of the first epoch
+    **/
+    template<typename Trajectory>
+    Errors replay(const Trajectory& trajectory, uint32_t seconds, bool velocity, uint32_t first = 40)
+    {
+        FixHistory history(8);
+
+        for(uint32_t k = 0; k <= seconds; ++k)
+            history.push(epoch(trajectory(k), first + 1000*k, k, velocity));
+
+        Errors errors;
+
+        // The history only covers the latest 8 epochs
+        for(uint32_t ms = 1000*(seconds - 7); ms < 1000*seconds; ms += 10)
+        {
+            const uint32_t tick = first + ms;
+            const double t = ms*1e-3;
+
+            FixHistory::Epoch e;
+            if(history.interpolate(tick, e) || !(e.flags & FixHistory::INTERPOLATED) ||
+               !(e.flags & FixHistory::HAS_VELOCITY) || e.longitude > 1800000000 || e.longitude < -1800000000 ||
+               e.time != START_TIME + ms/1000 || e.milliseconds != ms % 1000)
+            {
+                ++errors.failures;
+                continue;
+            }
+
+            errors.add(e, trajectory(t));
+        }
+
+        return errors;
+    }
+
+    uint32_t report(const char* name, const Errors& errors, double maxError, double maxVelocityError)
+    {
+        const bool failed = errors.failures || errors.max > maxError || errors.velocity > maxVelocityError;
+
+        printf("%-32s %6lu queries, position error mean %6.1f mm, max %6.1f mm, velocity error max %6.1f mm/s%s\n",
+               name, (unsigned long)(errors.queries), errors.mean(), errors.max, errors.velocity,
+               failed ? "  FAILED" : "");
+
+        return failed;
+    }
+
+    uint32_t checkCircle()
+    {
+        uint32_t failures = 0;
+
+        failures += report("circle, GGA+RMC (Hermite)", replay(circle, 60, true), 20, 100);
+        failures += report("circle, GGA only (linear)", replay(circle, 60, false), 75, 300);
+
+        return failures;
+    }
+
+    uint32_t checkFiniteDifferences()
+    {
+        const Line line = {48.1173, 11.5167, 6000, -8000};
+        uint32_t failures = report("line, GGA only", replay(line, 10, false), 15, 20);
+
+        // Extrapolated velocity, from the latest two epochs
+        FixHistory history(4);
+        for(uint32_t k = 0; k <= 3; ++k)
+            history.push(epoch(line(k), 1000*k, k, false));
+
+        Errors errors;
+        for(uint32_t dt = 0; dt <= FixHistory::MAX_EXTRAPOLATION; dt += 100)
+        {
+            FixHistory::Epoch e;
+            int32_t north, east;
+            if(history.interpolate(3000 + dt, e) || !(e.flags & FixHistory::EXTRAPOLATED) ||
+               history.velocity(3000 + dt, north, east) || north != e.velocityNorth || east != e.velocityEast ||
+               e.time != START_TIME + 3 + dt/1000 || e.milliseconds != dt % 1000)
+            {
+                ++errors.failures;
+                continue;
+            }
+
+            errors.add(e, line(3 + dt*1e-3));
+        }
+
+        failures += report("line, GGA only, extrapolated", errors, 50, 20);
+
+        return failures;
+    }
+
+    uint32_t checkAntimeridian()
+    {
+        // 250 m/s to the east-north-east, crossing 180 degrees after about 4 s
+        const Line line = {-17.5, 179.99, 50e3, 245e3};
+        uint32_t failures = 0;
+
+        failures += report("antimeridian, with velocity", replay(line, 10, true), 50, 100);
+        failures += report("antimeridian, GGA only", replay(line, 10, false), 50, 100);
+
+        FixHistory history(2);
+        history.push(epoch(line(3), 3000, 3, true));
+
+        Errors errors;
+        for(uint32_t dt = 0; dt <= FixHistory::MAX_EXTRAPOLATION; dt += 100)
+        {
+            FixHistory::Epoch e;
+            if(history.interpolate(3000 + dt, e) || e.longitude > 1800000000 || e.longitude < -1800000000)
+            {
+                ++errors.failures;
+                continue;
+            }
+
+            errors.add(e, line(3 + dt*1e-3));
+        }
+
+        failures += report("antimeridian, extrapolated", errors, 50, 100);
+
+        return failures;
+    }
+
+    uint32_t checkTicks()
+    {
+        uint32_t failures = 0;
+
+        // Across the overflow of the 32-bit tick
+        failures += report("circle, tick overflow", replay(circle, 60, true, 0xFFFFFFFF - 57000), 20, 100);
+
+        FixHistory history(4);
+        FixHistory::Epoch e;
+
+        int32_t north, east;
+        const bool empty = history.size() == 0 && history.interpolate(0, e) && history.velocity(0, north, east);
+        if(!empty)
+        {
+            fprintf(stderr, "An empty history gives a position\n");
+            ++failures;
+        }
+
+        // A single epoch without velocity cannot be extrapolated
+        history.push(epoch(circle(0), 1000, 0, false));
+        if(!history.interpolate(1500, e))
+        {
+            fprintf(stderr, "Extrapolation without velocity\n");
+            ++failures;
+        }
+
+        for(uint32_t k = 1; k <= 6; ++k)
+            history.push(epoch(circle(k), 1000 + 1000*k, k, true));
+
+        if(history.size() != 4 || history[0].tick != 7000 || history[3].tick != 4000)
+        {
+            fprintf(stderr, "Oldest epoch not dropped: %u epochs, %lu to %lu\n", history.size(),
+                    (unsigned long)(history[3].tick), (unsigned long)(history[0].tick));
+            ++failures;
+        }
+
+        if(!history.interpolate(3999, e) || history.interpolate(4000, e) ||
+           history.interpolate(7000 + FixHistory::MAX_EXTRAPOLATION, e) ||
+           !history.interpolate(7001 + FixHistory::MAX_EXTRAPOLATION, e))
+        {
+            fprintf(stderr, "Wrong bounds of the history\n");
+            ++failures;
+        }
+
+        // Same tick: replaces the latest epoch
+        FixHistory::Epoch replacement = epoch(circle(6.5), 7000, 6.5, true);
+        history.push(replacement);
+        if(history.size() != 4 || history[0].latitude != replacement.latitude ||
+           history.interpolate(7000, e) || e.latitude != replacement.latitude)
+        {
+            fprintf(stderr, "Epoch with the same tick not replaced\n");
+            ++failures;
+        }
+
+        // Older tick (e.g. the tick restarted): the history only holds the new epoch
+        const FixHistory::Epoch restarted = epoch(circle(7), 500, 7, true);
+        history.push(restarted);
+        if(history.size() != 1 || history[0].tick != 500 || !history.interpolate(499, e) ||
+           history.interpolate(500, e) || e.latitude != restarted.latitude || !history.interpolate(6000, e))
+        {
+            fprintf(stderr, "History not cleared by an older tick: %u epochs\n", history.size());
+            ++failures;
+        }
+
+        printf("%-32s %s\n", "ticks and capacity", failures ? "FAILED" : "ok");
+        return failures;
+    }
+
+    /**
+        \brief Dead reckoning along a line to the north
+        \param speed Speed at the epochs, in mm/s
+        \param travelled Distance travelled after the latest epoch, at 3500 ms, in m
+        \param distance Distance from the latest epoch to the extrapolated position, in m
+        \param result Extrapolated epoch, at 3500 ms
+    **/
+    void deadReckoning(double speed, double& travelled, double& distance, FixHistory::Epoch& result)
+    {
+        const Line line = {48.1173, 11.5167, speed, 0};
+
+        FixHistory history(4);
+        history.setForwardAxis(1, true);
+
+        for(uint32_t tick = 0; tick <= 3500; tick += 10)
+        {
+            if(tick % 1000 == 0 && tick <= 2000)
+                history.push(epoch(line(tick*1e-3), tick, tick*1e-3, true));
+
+            // Y axis pointing backward, Z up
+            const int16_t forward = TILT + (tick > 2000 ? std::lround(ACCELERATION/9.80665e-3) : 0);
+            history.addAcceleration(tick, 3, -forward, 995);
+        }
+
+        history.interpolate(3500, result);
+
+        const double dt = 1.5;
+        travelled   = (speed*1e-3 + 0.5*ACCELERATION*dt)*dt;
+        distance    = (result.latitude - history[0].latitude)*MM_PER_UNIT*1e-3;
+    }
+
+    uint32_t checkDeadReckoning()
+    {
+        uint32_t failures = 0;
+
+        double travelled, distance;
+        FixHistory::Epoch e;
+        deadReckoning(10000, travelled, distance, e);
+
+        const double speed  = e.velocityNorth*1e-3;
+        const double truth  = 10 + ACCELERATION*1.5;
+
+        if(!(e.flags & FixHistory::DEAD_RECKONING) || std::fabs(distance - travelled) > 0.5 ||
+           std::fabs(speed - truth) > 0.75 || e.velocityEast != 0)
+            ++failures;
+
+        printf("%-32s %.2f m after 1.5 s for %.2f m travelled (15.00 m at constant velocity), %.2f m/s for %.2f m/s"
+               "%s\n", "dead reckoning", distance, travelled, speed, truth, failures ? "  FAILED" : "");
+
+        // Too slow for a course: no correction
+        deadReckoning(300, travelled, distance, e);
+        if(e.flags & FixHistory::DEAD_RECKONING || e.velocityNorth != 300)
+        {
+            fprintf(stderr, "Dead reckoning below the minimum speed\n");
+            ++failures;
+        }
+
+        return failures;
+    }
+
+    volatile int32_t sink;
+
+    void benchmark()
+    {
+        constexpr uint32_t COUNT = 1000000;
+
+        for(bool velocity: {true, false})
+        {
+            FixHistory history(8);
+            for(uint32_t k = 0; k < 8; ++k)
+                history.push(epoch(circle(k), 1000*k, k, velocity));
+
+            int32_t total = 0;
+            const uint64_t start = nanos();
+
+            // Over the whole history and the extrapolation after it
+            for(uint32_t i = 0; i < COUNT; ++i)
+            {
+                FixHistory::Epoch e;
+                history.interpolate(i % 9000, e);
+                total += e.latitude;
+            }
+
+            const double elapsed = (double)(nanos() - start)/COUNT;
+            sink = total;
+
+            printf("interpolate(), %-17s %8.1f ns\n", velocity ? "GGA+RMC" : "GGA only", elapsed);
+        }
+    }
+}
+
+int main(int argc, char**)
+{
+    if(argc > 1)
+    {
+        fprintf(stderr, "Usage: fix_history_bench\n");
+        return 2;
+    }
+
+    uint32_t failures = checkCircle();
+    failures += checkFiniteDifferences();
+    failures += checkAntimeridian();
+    failures += checkTicks();
+    failures += checkDeadReckoning();
+
+    printf("Fix history checks: %s\n", failures ? "FAILED" : "ok");
+
+    if(failures)
+        return 1;
+
+    benchmark();
+
+    return 0;
+}
@@ -0,0 +1,442 @@
+/**
+    \file geodesy_bench.cpp
+    \brief Host accuracy and speed comparison of the distance methods (geodesy.cpp) against double precision
+
+    - Vincenty must reproduce the Flinders Peak - Buninyong test line of the Vincenty paper, and be symmetric.
+    - The tables of Geodesy::scales() are compared with the WGS84 radii of curvature, computed in double precision,
+      at every 0.01 degree of latitude.
+    - Random point pairs are drawn at several ranges, from 100 m to 1000 km: the float methods (equirectangular,
+      haversine, distance()) and the fixed-point one are compared with Vincenty, and their error must stay within
+      the model error (spherical Earth, flat Earth) plus the rounding of their inputs; the float haversine is also
+      compared with a double precision haversine, which isolates the rounding error.
+    - The batched functions must agree with the single ones: nearest() with the smallest of distances(), length()
+      with the sum of distance().
+
+    Then the time per distance of each method is measured, for each range.
+
+    Usage: geodesy_bench [-n pairs]
+    - -n: number of point pairs per range (default: 20000)
+
+    Returns 1 on a failed check. Build and run with run.sh.
+**/
+#include "geodesy.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    constexpr double DEG_TO_RAD = 0.017453292519943295;
+
+    /**
+        \brief Random numbers, the same on every host (xorshift32)
+    **/
+    class Random
+    {
+        public:
+            Random(uint32_t seed): m_state(seed) {}
+
+            uint32_t next()
+            {
+                m_state ^= m_state << 13;
+                m_state ^= m_state >> 17;
+                m_state ^= m_state << 5;
+                return m_state;
+            }
+
+            // Uniform in [min, max)
+            double range(double min, double max)
+            {
+                return min + (max - min)*(next()/4294967296.0);
+            }
+
+        private:
+            uint32_t m_state;
+    };
+
+    uint64_t micros()
+    {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+    }
+
+    struct Pair
+    {
+        Geodesy::Coordinate a;
+        Geodesy::Coordinate b;
+        double              reference;  // Vincenty, in meters
+    };
+
+    struct Range
+    {
+        const char* name;
+        double      meters;
+        double      tolerance;  // Relative error allowed to the float methods, on top of the rounding
+        double      fixed;      // Relative error allowed to the fixed-point method
+    };
+
+    /**
+        The spherical methods are off by up to 0.56% (flattening); the flat Earth approximations also lose the
+        curvature beyond 100 km, up to 1% at 1000 km below 60 degrees (converging meridians). The float inputs are
+        rounded to ~1 m (24 bits for 180 degrees), which dominates at short range and is allowed separately.
+    **/
+    const Range s_ranges[] =
+    {
+        {"100 m",     100,    0.006,  0.0002},
+        {"1 km",      1e3,    0.006,  0.0002},
+        {"10 km",     1e4,    0.006,  0.0002},
+        {"100 km",    1e5,    0.006,  0.0005},
+        {"1000 km",   1e6,    0.012,  0.015}
+    };
+
+    double degrees(int32_t coordinate)
+    {
+        return coordinate*1e-7;
+    }
+
+    int32_t coordinate(double degrees)
+    {
+        return (int32_t)(std::lround(degrees*1e7));
+    }
+
+    double haversine(double lat1, double lon1, double lat2, double lon2)
+    {
+        const double sinLat = std::sin((lat2 - lat1)*DEG_TO_RAD/2);
+        const double sinLon = std::sin((lon2 - lon1)*DEG_TO_RAD/2);
+        const double a      = sinLat*sinLat + std::cos(lat1*DEG_TO_RAD)*std::cos(lat2*DEG_TO_RAD)*sinLon*sinLon;
+
+        return 2*Geodesy::EARTH_RADIUS*std::asin(std::sqrt(a < 1 ? a : 1));
+    }
+
+    /**
+        \brief Random pairs about \c meters apart (half to full range, any bearing), up to 60 degrees of latitude
+    **/
+    std::vector<Pair> generate(Random& random, double meters, uint32_t count)
+    {
+        std::vector<Pair> pairs;
+
+        while(pairs.size() < count)
+        {
+            const double lat        = random.range(-60, 60);
+            const double lon        = random.range(-180, 180);
+            const double d          = random.range(meters/2, meters);
+            const double bearing    = random.range(0, 360)*DEG_TO_RAD;
+            const double lat2       = lat + d*std::cos(bearing)/111320;
+
+            double lon2             = lon + d*std::sin(bearing)/(111320*std::cos(lat*DEG_TO_RAD));
+
+            if(lon2 >= 180)
+                lon2 -= 360;
+            else if(lon2 < -180)
+                lon2 += 360;
+
+            Pair p;
+            p.a = {coordinate(lat), coordinate(lon)};
+            p.b = {coordinate(lat2), coordinate(lon2)};
+
+            if(Geodesy::vincenty(degrees(p.a.latitude), degrees(p.a.longitude), degrees(p.b.latitude),
+                                 degrees(p.b.longitude), p.reference))
+                continue;
+
+            pairs.push_back(p);
+        }
+
+        return pairs;
+    }
+
+    uint32_t checkVincenty()
+    {
+        // Vincenty (1975), test line (a) on the Bessel ellipsoid, recomputed on WGS84 (Geoscience Australia)
+        const double lat1 = -(37 + 57/60.0 + 3.72030/3600), lon1 = 144 + 25/60.0 + 29.52440/3600;
+        const double lat2 = -(37 + 39/60.0 + 10.15610/3600), lon2 = 143 + 55/60.0 + 35.38390/3600;
+        const double expectedAzimuth = 306 + 52/60.0 + 5.37/3600;
+
+        double distance, azimuth, back;
+        uint32_t failures = 0;
+
+        if(Geodesy::vincenty(lat1, lon1, lat2, lon2, distance, &azimuth) ||
+           std::fabs(distance - 54972.271) > 0.001 || std::fabs(azimuth - expectedAzimuth) > 1e-5)
+        {
+            printf("Vincenty: Flinders Peak - Buninyong gives %.4f m, azimuth %.6f, expected 54972.271 m, %.6f\n",
+                   distance, azimuth, expectedAzimuth);
+            failures++;
+        }
+
+        if(Geodesy::vincenty(lat2, lon2, lat1, lon1, back) || std::fabs(back - distance) > 1e-6)
+        {
+            printf("Vincenty: %.6f m back, %.6f m forth\n", back, distance);
+            failures++;
+        }
+
+        return failures;
+    }
+
+    /**
+        \brief Geodesy::scales() against the WGS84 radii of curvature
+    **/
+    uint32_t checkScales(double& northError, double& eastError)
+    {
+        constexpr double a  = 6378137.0;
+        constexpr double f  = 1/298.257223563;
+        constexpr double e2 = f*(2 - f);
+
+        northError = eastError = 0;
+
+        for(int32_t l = -9000; l <= 9000; ++l)
+        {
+            const double phi    = l*0.01*DEG_TO_RAD;
+            const double w      = 1 - e2*std::sin(phi)*std::sin(phi);
+            const double M      = a*(1 - e2)/(w*std::sqrt(w));      // Meridional radius
+            const double N      = a/std::sqrt(w);                   // Prime vertical radius
+
+            // Millimeters per 1e-7 degree
+            const double north  = M*1e-4*DEG_TO_RAD;
+            const double east   = N*std::cos(phi)*1e-4*DEG_TO_RAD;
+
+            uint32_t n, e;
+            Geodesy::scales(l*100000, n, e);
+
+            northError  = std::fmax(northError, std::fabs(n/65536.0 - north)/north);
+            // Relative to a degree of latitude: the table steps are 16 bits of the equator scale
+            eastError   = std::fmax(eastError, std::fabs(e/65536.0 - east)/north);
+        }
+
+        if(northError > 1e-5 || eastError > 5e-5)
+        {
+            printf("Scales: relative errors of %.2e (north) and %.2e (east)\n", northError, eastError);
+            return 1;
+        }
+
+        return 0;
+    }
+
+    struct Errors
+    {
+        double equirectangular  = 0;    // Largest relative errors
+        double haversine        = 0;
+        double distance         = 0;
+        double fixed            = 0;
+        double rounding         = 0;    // Largest error of the float haversine p/r the double one, in meters
+    };
+
+    void update(double& error, double value, double reference)
+    {
+        error = std::fmax(error, std::fabs(value - reference)/reference);
+    }
+
+    uint32_t checkAccuracy(const Range& range, const std::vector<Pair>& pairs, Errors& errors)
+    {
+        uint32_t failures = 0;
+
+        for(const Pair& p: pairs)
+        {
+            const float lat1 = degrees(p.a.latitude), lon1 = degrees(p.a.longitude);
+            const float lat2 = degrees(p.b.latitude), lon2 = degrees(p.b.longitude);
+
+            const double equirectangular    = Geodesy::equirectangular(lat1, lon1, lat2, lon2);
+            const double haversine          = Geodesy::haversine(lat1, lon1, lat2, lon2);
+            const double distance           = Geodesy::distance(lat1, lon1, lat2, lon2);
+            const double fixed              = Geodesy::distance(p.a, p.b)*1e-3;
+            const double exact              = ::haversine(degrees(p.a.latitude), degrees(p.a.longitude),
+                                                          degrees(p.b.latitude), degrees(p.b.longitude));
+
+            update(errors.equirectangular, equirectangular, p.reference);
+            update(errors.haversine, haversine, p.reference);
+            update(errors.distance, distance, p.reference);
+            update(errors.fixed, fixed, p.reference);
+            errors.rounding = std::fmax(errors.rounding, std::fabs(haversine - exact));
+
+            // Inputs rounded to half a float step (~1 m at 180 degrees), single precision sine near 0
+            const double rounding = 3 + exact*2e-6;
+
+            if(std::fabs(distance - p.reference) > range.tolerance*p.reference + rounding ||
+               std::fabs(fixed - p.reference) > range.fixed*p.reference + 0.01)
+            {
+                printf("%s: (%.7f, %.7f) - (%.7f, %.7f): %.3f m (distance()) and %.3f m (fixed point), "
+                       "Vincenty gives %.3f m\n", range.name, degrees(p.a.latitude), degrees(p.a.longitude),
+                       degrees(p.b.latitude), degrees(p.b.longitude), distance, fixed, p.reference);
+                failures++;
+                break;
+            }
+        }
+
+        return failures;
+    }
+
+    /**
+        \brief nearest() and distances() from the first point of each group of 64, length() of the whole set
+    **/
+    uint32_t checkBatched(const std::vector<Pair>& pairs)
+    {
+        uint32_t failures = 0;
+
+        std::vector<Geodesy::Coordinate> points;
+        for(const Pair& p: pairs)
+            points.push_back(p.b);
+
+        for(size_t group = 0; group + 64 <= points.size(); group += 64)
+        {
+            const Geodesy::Coordinate& from = pairs[group].a;
+            uint32_t distances[64];
+            Geodesy::distances(from, &points[group], 64, distances);
+
+            size_t best = 0;
+            for(size_t i = 1; i < 64; ++i)
+                if(distances[i] < distances[best])
+                    best = i;
+
+            uint32_t distance;
+            const size_t nearest = Geodesy::nearest(from, &points[group], 64, &distance);
+
+            if(distances[nearest] != distances[best] || distance != distances[best])
+            {
+                printf("Batched: nearest() gives %lu (%lu mm), distances() %lu (%lu mm)\n", (unsigned long)(nearest),
+                       (unsigned long)(distance), (unsigned long)(best), (unsigned long)(distances[best]));
+                failures++;
+                break;
+            }
+        }
+
+        uint64_t sum = 0;
+        for(size_t i = 1; i < points.size(); ++i)
+            sum += Geodesy::distance(points[i - 1], points[i]);
+
+        if(Geodesy::length(points.data(), points.size()) != sum)
+        {
+            printf("Batched: length() differs from the sum of the distances\n");
+            failures++;
+        }
+
+        return failures;
+    }
+
+    volatile double sink;
+
+    template<typename F>
+    double measure(const std::vector<Pair>& pairs, uint32_t rounds, F method)
+    {
+        double total = 0;
+        const uint64_t start = micros();
+
+        for(uint32_t r = 0; r < rounds; ++r)
+            for(const Pair& p: pairs)
+                total += method(p);
+
+        const uint64_t elapsed = micros() - start;
+        sink = total;
+
+        return elapsed*1e3/((double)(rounds)*pairs.size());
+    }
+
+    void benchmark(const Range& range, const std::vector<Pair>& pairs)
+    {
+        // Float inputs converted once, as the callers hold them
+        std::vector<float> coordinates;
+        for(const Pair& p: pairs)
+            for(int32_t c: {p.a.latitude, p.a.longitude, p.b.latitude, p.b.longitude})
+                coordinates.push_back(degrees(c));
+
+        const float* c = coordinates.data();
+        const Pair* first = pairs.data();
+        auto floats = [c, first](const Pair& p) { return c + 4*(&p - first); };
+
+        const double equirectangular = measure(pairs, 20, [floats](const Pair& p)
+                                        {
+                                            const float* f = floats(p);
+                                            return Geodesy::equirectangular(f[0], f[1], f[2], f[3]);
+                                        });
+        const double haversine = measure(pairs, 20, [floats](const Pair& p)
+                                        {
+                                            const float* f = floats(p);
+                                            return Geodesy::haversine(f[0], f[1], f[2], f[3]);
+                                        });
+        const double fixed = measure(pairs, 20, [](const Pair& p) { return Geodesy::distance(p.a, p.b); });
+        const double vincenty = measure(pairs, 2, [](const Pair& p)
+                                        {
+                                            double d;
+                                            Geodesy::vincenty(degrees(p.a.latitude), degrees(p.a.longitude),
+                                                              degrees(p.b.latitude), degrees(p.b.longitude), d);
+                                            return d;
+                                        });
+
+        // One origin, all the other points
+        std::vector<Geodesy::Coordinate> points;
+        for(const Pair& p: pairs)
+            points.push_back(p.b);
+
+        std::vector<uint32_t> distances(points.size());
+        const uint64_t start = micros();
+
+        for(uint32_t r = 0; r < 20; ++r)
+            Geodesy::distances(pairs[r].a, points.data(), points.size(), distances.data());
+
+        const double batched = (micros() - start)*1e3/(20.0*points.size());
+        sink = distances[0];
+
+        printf("%-8s %10.1f %10.1f %10.1f %10.1f %10.1f\n", range.name, equirectangular, haversine, vincenty, fixed,
+               batched);
+    }
+
+    void usage()
+    {
+        fprintf(stderr, "Usage: geodesy_bench [-n pairs]\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t count = 20000;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(!strcmp(argv[i], "-n") && i + 1 < argc)
+            count = strtoul(argv[++i], nullptr, 0);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    if(count < 64)
+        count = 64;
+
+    uint32_t failures = checkVincenty();
+
+    double northError, eastError;
+    failures += checkScales(northError, eastError);
+
+    Random random(0x9E3779B9);
+    std::vector<std::vector<Pair>> pairs;
+
+    printf("%-8s %10s %10s %10s %10s %12s\n", "range", "equirect", "haversine", "distance()", "fixed", "rounding (m)");
+
+    for(const Range& range: s_ranges)
+    {
+        pairs.push_back(generate(random, range.meters, count));
+
+        Errors errors;
+        failures += checkAccuracy(range, pairs.back(), errors);
+        failures += checkBatched(pairs.back());
+
+        printf("%-8s %9.4f%% %9.4f%% %9.4f%% %9.4f%% %12.3f\n", range.name, errors.equirectangular*100,
+               errors.haversine*100, errors.distance*100, errors.fixed*100, errors.rounding);
+    }
+
+    printf("Largest errors p/r Vincenty; scales p/r WGS84: %.1e (north), %.1e (east)\n", northError, eastError);
+    printf("Vincenty, scales, accuracy and batched checks: %s\n", failures ? "FAILED" : "ok");
+
+    if(failures)
+        return 1;
+
+    printf("%-8s %10s %10s %10s %10s %10s\n", "ns", "equirect", "haversine", "vincenty", "fixed", "distances()");
+
+    for(size_t i = 0; i < pairs.size(); ++i)
+        benchmark(s_ranges[i], pairs[i]);
+
+    return 0;
+}
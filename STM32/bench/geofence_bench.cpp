@@ -0,0 +1,383 @@
+/**
+    \file geofence_bench.cpp
+    \brief Host test and benchmark of the geofencing engine (geofence/geofence.cpp) on a large fence set
+
+    The fence set is generated by fencegen.py and converted by geofence/fenceconvert.py (run.sh does both), then
+    read through Geofences::MemorySource, as from flash:
+    - the fences are decoded from the file by a separate reader of the format (geofence.h), and random fixes (over
+      the whole area, and near the fences) are tested by brute force against every polygon: without hysteresis,
+      the fences update() reports the fix in must be the same;
+    - a fix walking along the boundary of fences with +-2 m of noise must give many events without hysteresis, and
+      none with a 5 m hysteresis.
+
+    Then the time per update() is measured, with the number of fences tested, and compared with a linear scan of
+    the fence centers (Geodesy::distances()).
+
+    Usage: geofence_bench [-n fixes] fences.gfn
+
+    Returns 1 on a failed check. Build and run with run.sh.
+**/
+#include "geofence/geofence.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    /**
+        \brief Random numbers, the same on every host (xorshift32)
+    **/
+    class Random
+    {
+        public:
+            Random(uint32_t seed): m_state(seed) {}
+
+            uint32_t next()
+            {
+                m_state ^= m_state << 13;
+                m_state ^= m_state >> 17;
+                m_state ^= m_state << 5;
+                return m_state;
+            }
+
+            // Uniform in [min, max]
+            int32_t range(int32_t min, int32_t max)
+            {
+                return min + (int32_t)(next() % ((uint32_t)(max - min) + 1));
+            }
+
+        private:
+            uint32_t m_state;
+    };
+
+    uint64_t micros()
+    {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+    }
+
+    /**
+        \brief Fence decoded from the file, for the brute-force reference
+    **/
+    struct Polygon
+    {
+        uint32_t                            id;
+        Geodesy::Coordinate                 min;
+        Geodesy::Coordinate                 max;
+        std::vector<Geodesy::Coordinate>    vertices;
+    };
+
+    uint32_t readU32(const uint8_t* p)
+    {
+        return p[0] | ((uint32_t)(p[1]) << 8) | ((uint32_t)(p[2]) << 16) | ((uint32_t)(p[3]) << 24);
+    }
+
+    /**
+        \brief Decode every fence (see the format in geofence.h)
+        \returns \c true on error, \c false otherwise
+    **/
+    bool decode(const std::vector<uint8_t>& file, std::vector<Polygon>& polygons)
+    {
+        if(file.size() < 40 || memcmp(file.data(), "GFNC", 4))
+            return true;
+
+        const uint32_t count    = readU32(&file[8]);
+        const uint32_t fences   = readU32(&file[36]);
+
+        for(uint32_t i = 0; i < count; ++i)
+        {
+            const uint8_t* r = &file[fences + 32*i];
+            Polygon p;
+            p.id    = readU32(r);
+            p.min   = {(int32_t)(readU32(r + 4)), (int32_t)(readU32(r + 8))};
+            p.max   = {(int32_t)(readU32(r + 12)), (int32_t)(readU32(r + 16))};
+
+            size_t offset           = readU32(r + 20);
+            const uint16_t vertices = r[28] | (r[29] << 8);
+            int32_t previous[2]     = {p.min.latitude, p.min.longitude};
+
+            for(uint16_t v = 0; v < vertices; ++v)
+            {
+                for(int32_t& c: previous)
+                {
+                    uint32_t value = 0;
+                    for(uint8_t shift = 0; offset < file.size(); shift += 7)
+                    {
+                        value |= (uint32_t)(file[offset] & 0x7F) << shift;
+                        if(!(file[offset++] & 0x80))
+                            break;
+                    }
+
+                    c += (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+                }
+
+                p.vertices.push_back({previous[0], previous[1]});
+            }
+
+            polygons.push_back(p);
+        }
+
+        return false;
+    }
+
+    /**
+        \brief Even-odd rule, in double precision (the coordinate differences are exact)
+    **/
+    bool contains(const Polygon& polygon, const Geodesy::Coordinate& p)
+    {
+        bool inside = false;
+        const std::vector<Geodesy::Coordinate>& v = polygon.vertices;
+
+        for(size_t i = 0, j = v.size() - 1; i < v.size(); j = i++)
+        {
+            const double ay = (double)(v[i].latitude) - p.latitude, ax = (double)(v[i].longitude) - p.longitude;
+            const double by = (double)(v[j].latitude) - p.latitude, bx = (double)(v[j].longitude) - p.longitude;
+
+            if((ay > 0) != (by > 0) && (ax*(by - ay) - ay*(bx - ax) > 0) == (by > ay))
+                inside = !inside;
+        }
+
+        return inside;
+    }
+
+    /**
+        \brief Random fixes: half over the whole area, half within the bounding box of a random fence
+    **/
+    std::vector<Geodesy::Coordinate> fixes(Random& random, const std::vector<Polygon>& polygons, uint32_t count)
+    {
+        Geodesy::Coordinate min = polygons[0].min, max = polygons[0].max;
+        for(const Polygon& p: polygons)
+        {
+            min = {std::min(min.latitude, p.min.latitude), std::min(min.longitude, p.min.longitude)};
+            max = {std::max(max.latitude, p.max.latitude), std::max(max.longitude, p.max.longitude)};
+        }
+
+        std::vector<Geodesy::Coordinate> result;
+        for(uint32_t i = 0; i < count; ++i)
+        {
+            const Polygon& p = (i & 1) ? polygons[random.next() % polygons.size()] : polygons[0];
+            const Geodesy::Coordinate& a = (i & 1) ? p.min : min;
+            const Geodesy::Coordinate& b = (i & 1) ? p.max : max;
+
+            result.push_back({random.range(a.latitude, b.latitude), random.range(a.longitude, b.longitude)});
+        }
+
+        return result;
+    }
+
+    uint32_t checkBruteForce(Geofences& geofences, const std::vector<Polygon>& polygons,
+                             const std::vector<Geodesy::Coordinate>& fixes, uint32_t& insides)
+    {
+        Geofences::Event events[Geofences::MAX_INSIDE];
+        geofences.setHysteresis(0);
+        geofences.reset();
+        insides = 0;
+
+        for(const Geodesy::Coordinate& fix: fixes)
+        {
+            geofences.update(fix, events, Geofences::MAX_INSIDE);
+
+            uint32_t ids[Geofences::MAX_INSIDE];
+            std::vector<uint32_t> found(ids, ids + geofences.inside(ids));
+            std::vector<uint32_t> expected;
+
+            for(const Polygon& p: polygons)
+                if(fix.latitude >= p.min.latitude && fix.latitude <= p.max.latitude &&
+                   fix.longitude >= p.min.longitude && fix.longitude <= p.max.longitude && contains(p, fix))
+                    expected.push_back(p.id);
+
+            std::sort(found.begin(), found.end());
+            std::sort(expected.begin(), expected.end());
+            insides += expected.size();
+
+            if(found != expected)
+            {
+                printf("Fix (%.7f, %.7f): in %lu fences, %lu expected\n", fix.latitude*1e-7, fix.longitude*1e-7,
+                       (unsigned long)(found.size()), (unsigned long)(expected.size()));
+                return 1;
+            }
+        }
+
+        return 0;
+    }
+
+    /**
+        \brief Walk along the boundary of the first fences, with noise
+        \returns Number of events
+    **/
+    uint32_t walkBoundaries(Geofences& geofences, const std::vector<Polygon>& polygons, uint32_t hysteresis)
+    {
+        Random random(42);
+        Geofences::Event events[Geofences::MAX_INSIDE];
+        uint32_t count = 0;
+
+        geofences.setHysteresis(hysteresis);
+
+        for(size_t f = 0; f < 20; ++f)
+        {
+            const Polygon& p = polygons[f];
+            const std::vector<Geodesy::Coordinate>& v = p.vertices;
+
+            uint32_t north, east;
+            Geodesy::scales(v[0].latitude, north, east);
+
+            // +-2 m, in 1e-7 degrees
+            const int32_t noiseLatitude  = (int32_t)(2000*65536.0/north);
+            const int32_t noiseLongitude = (int32_t)(2000*65536.0/east);
+
+            geofences.reset();
+
+            for(size_t i = 0; i < v.size(); ++i)
+            {
+                const Geodesy::Coordinate& a = v[i];
+                const Geodesy::Coordinate& b = v[(i + 1) % v.size()];
+
+                for(int32_t t = 0; t < 16; ++t)
+                {
+                    const Geodesy::Coordinate fix =
+                    {
+                        a.latitude  + (int32_t)((int64_t)(b.latitude  - a.latitude)*t/16) +
+                            random.range(-noiseLatitude, noiseLatitude)/2,
+                        a.longitude + (int32_t)((int64_t)(b.longitude - a.longitude)*t/16) +
+                            random.range(-noiseLongitude, noiseLongitude)/2
+                    };
+
+                    const uint8_t n = geofences.update(fix, events, Geofences::MAX_INSIDE);
+                    for(uint8_t e = 0; e < n; ++e)
+                        count += events[e].id == p.id;
+                }
+            }
+        }
+
+        return count;
+    }
+
+    void benchmark(Geofences& geofences, const std::vector<Polygon>& polygons,
+                   const std::vector<Geodesy::Coordinate>& fixes)
+    {
+        Geofences::Event events[Geofences::MAX_INSIDE];
+        geofences.setHysteresis(5000);
+        geofences.reset();
+
+        uint64_t tested = 0;
+        uint16_t maxTested = 0;
+        const uint64_t start = micros();
+
+        for(const Geodesy::Coordinate& fix: fixes)
+        {
+            geofences.update(fix, events, Geofences::MAX_INSIDE);
+            tested += geofences.tested();
+            maxTested = std::max(maxTested, geofences.tested());
+        }
+
+        const double update = (double)(micros() - start)/fixes.size();
+
+        // Circular fences: distance to every center
+        std::vector<Geodesy::Coordinate> centers;
+        for(const Polygon& p: polygons)
+            centers.push_back({(int32_t)(((int64_t)(p.min.latitude) + p.max.latitude)/2),
+                               (int32_t)(((int64_t)(p.min.longitude) + p.max.longitude)/2)});
+
+        std::vector<uint32_t> distances(centers.size());
+        const uint32_t scans = std::min<size_t>(fixes.size(), 1000);
+        const uint64_t scanStart = micros();
+
+        for(uint32_t i = 0; i < scans; ++i)
+            Geodesy::distances(fixes[i], centers.data(), centers.size(), distances.data());
+
+        const double scan = (double)(micros() - scanStart)/scans;
+
+        printf("update(): %.2f us per fix, %.1f fences tested (max %u); linear scan of %lu centers: %.0f us\n",
+               update, (double)(tested)/fixes.size(), maxTested, (unsigned long)(centers.size()), scan);
+    }
+
+    bool load(const char* path, std::vector<uint8_t>& bytes)
+    {
+        FILE* file = fopen(path, "rb");
+        if(!file)
+            return true;
+
+        uint8_t block[4096];
+        size_t n;
+        while((n = fread(block, 1, sizeof(block), file)) > 0)
+            bytes.insert(bytes.end(), block, block + n);
+
+        fclose(file);
+        return false;
+    }
+
+    void usage()
+    {
+        fprintf(stderr, "Usage: geofence_bench [-n fixes] fences.gfn\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t count      = 20000;
+    const char* path    = nullptr;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(!strcmp(argv[i], "-n") && i + 1 < argc)
+            count = strtoul(argv[++i], nullptr, 0);
+        else if(argv[i][0] != '-' && !path)
+            path = argv[i];
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    std::vector<uint8_t> file;
+    std::vector<Polygon> polygons;
+
+    if(!path || load(path, file) || decode(file, polygons) || polygons.size() < 20)
+    {
+        fprintf(stderr, "Can not read a fence set from %s\n", path ? path : "(none)");
+        return path ? 1 : 2;
+    }
+
+    Geofences::MemorySource source(file.data(), file.size());
+    Geofences geofences(source);
+
+    if(geofences.open() || geofences.count() != polygons.size())
+    {
+        fprintf(stderr, "Geofences::open() failed on %s\n", path);
+        return 1;
+    }
+
+    Random random(0x2545F491);
+    const std::vector<Geodesy::Coordinate> points = fixes(random, polygons, count);
+
+    uint32_t insides;
+    uint32_t failures = checkBruteForce(geofences, polygons, points, insides);
+
+    const uint32_t noisy    = walkBoundaries(geofences, polygons, 0);
+    const uint32_t filtered = walkBoundaries(geofences, polygons, 5000);
+
+    if(noisy < 20 || filtered)
+    {
+        printf("Boundary walk: %lu events without hysteresis, %lu with 5 m\n", (unsigned long)(noisy),
+               (unsigned long)(filtered));
+        failures++;
+    }
+
+    printf("%lu fences, %lu fixes (%lu in a fence), boundary walk: %lu events, %lu with a 5 m hysteresis\n",
+           (unsigned long)(polygons.size()), (unsigned long)(points.size()), (unsigned long)(insides),
+           (unsigned long)(noisy), (unsigned long)(filtered));
+    printf("Brute-force and hysteresis checks: %s\n", failures ? "FAILED" : "ok");
+
+    if(failures)
+        return 1;
+
+    benchmark(geofences, polygons, points);
+
+    return 0;
+}
@@ -0,0 +1,486 @@
+/**
+    \file kv_store_bench.cpp
+    \brief Host test and benchmark of the key/value store (kv_store.cpp) on the simulated flash (simulated_flash.cpp)
+
+    - Model check: 200000 random set() and remove() on 16 sectors, against a std::map, with a remount every 5000
+      operations. Values, sizes and missing keys must match, the write amplification (bytes programmed / record
+      bytes) must stay under 1.1 and the erase counts of the sectors within 2 of each other.
+    - Hot key: 100 cold keys, then 100000 updates of a single key on 32 sectors. The sectors holding the cold keys
+      must be compacted too: the erase counts stay within 2 of each other.
+    - Power loss: a workload of 400 operations with compactions is cut every 7 bytes programmed or erased, until it
+      runs to the end. After each cut, the store must mount with the state before or after the interrupted
+      operation, then keep working across a remount. No bit may be programmed from 0 to 1.
+    - Single key (maxKeys = 1): lookups of missing keys must end, the second key is refused until the first one is
+      removed.
+    - Lookups: a get() of 1000 keys reads the flash twice (slot hit, then value).
+
+    Then the time per set() and get() is measured.
+
+    Usage: kv_store_bench
+
+    Returns 1 on a failed check. Build and run with run.sh.
+**/
+#include "kv_store.h"
+#include "simulated_flash.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+    /**
+        \brief Random numbers, the same on every host (xorshift32)
+    **/
+    class Random
+    {
+        public:
+            Random(uint32_t seed): m_state(seed) {}
+
+            uint32_t next()
+            {
+                m_state ^= m_state << 13;
+                m_state ^= m_state >> 17;
+                m_state ^= m_state << 5;
+                return m_state;
+            }
+
+            // Uniform in [0, n)
+            uint32_t below(uint32_t n)
+            {
+                return next() % n;
+            }
+
+        private:
+            uint32_t m_state;
+    };
+
+    typedef std::map<std::string, std::vector<uint8_t>> Model;
+
+    uint64_t micros()
+    {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+    }
+
+    std::string keyName(uint32_t index)
+    {
+        char key[16];
+        snprintf(key, sizeof(key), "key%lu", (unsigned long)(index));
+        return key;
+    }
+
+    std::vector<uint8_t> randomValue(Random& random, uint32_t maxSize)
+    {
+        std::vector<uint8_t> value(random.below(maxSize + 1));
+
+        for(uint8_t& byte: value)
+            byte = random.next();
+
+        return value;
+    }
+
+    /**
+        \brief Compare the store with the model
+        \param keys Key indexes to look up, including the missing ones
+        \returns \c true if the store holds the keys and values of the model, \c false otherwise
+    **/
+    bool matches(const KVStore& kv, const Model& model, uint32_t keys)
+    {
+        if(kv.count() != model.size())
+            return false;
+
+        for(uint32_t i = 0; i < keys; ++i)
+        {
+            const std::string key = keyName(i);
+            const auto entry = model.find(key);
+            uint8_t value[KVStore::MAX_VALUE_SIZE];
+            uint16_t size = 0;
+
+            const bool missing = kv.get(key.c_str(), value, sizeof(value), size);
+
+            if(missing != (entry == model.end()) || kv.contains(key.c_str()) == missing)
+                return false;
+
+            if(!missing && (size != entry->second.size() || memcmp(value, entry->second.data(), size)))
+                return false;
+        }
+
+        return true;
+    }
+
+    /**
+        \brief Apply an operation to the store and to the model
+        \returns \c true on error, \c false otherwise
+    **/
+    bool apply(KVStore& kv, Model& model, const std::string& key, const std::vector<uint8_t>* value)
+    {
+        if(!value)
+        {
+            if(kv.remove(key.c_str()))
+                return true;
+
+            model.erase(key);
+            return false;
+        }
+
+        if(kv.set(key.c_str(), value->data(), value->size()))
+            return true;
+
+        model[key] = *value;
+        return false;
+    }
+
+    uint32_t checkModel()
+    {
+        constexpr uint32_t SECTORS = 16, KEYS = 80, MAX_KEYS = 64, OPERATIONS = 200000, REMOUNT = 5000;
+
+        SimulatedFlash flash(SECTORS * SimulatedFlash::DEFAULT_SECTOR_SIZE);
+        KVStore kv(flash, MAX_KEYS);
+        Model model;
+        Random random(1);
+        uint64_t userBytes = 0;
+        uint32_t failures = 0, refused = 0;
+
+        if(kv.format())
+        {
+            printf("Model: format failed\n");
+            return 1;
+        }
+
+        for(uint32_t i = 0; i < OPERATIONS; ++i)
+        {
+            const std::string key = keyName(random.below(KEYS));
+            const bool remove = random.below(5) == 0;
+            const std::vector<uint8_t> value = randomValue(random, 120);
+
+            // Only new keys are refused, once maxKeys are stored
+            if(apply(kv, model, key, remove ? nullptr : &value))
+            {
+                if(!remove && model.size() == MAX_KEYS && !model.count(key))
+                    refused++;
+                else if(failures++ < 5)
+                    printf("Model: operation %lu on %s failed\n", (unsigned long)(i), key.c_str());
+            }
+
+            if((i + 1) % REMOUNT == 0)
+            {
+                userBytes += kv.stats().userBytes;
+
+                if(kv.mount() || !matches(kv, model, KEYS))
+                {
+                    if(failures++ < 5)
+                        printf("Model: mismatch after remount at operation %lu\n", (unsigned long)(i));
+                }
+            }
+        }
+
+        uint32_t minErase, maxErase;
+        kv.eraseCounts(minErase, maxErase);
+
+        const double amplification = (double)(flash.stats().bytesProgrammed) / userBytes;
+        const uint32_t violations = flash.stats().violations;
+
+        printf("Model: %lu operations (%lu new keys refused, store full), %lu keys, write amplification %.3f, "
+               "erase counts %lu-%lu, %lu NOR violations\n", (unsigned long)(OPERATIONS), (unsigned long)(refused),
+               (unsigned long)(model.size()), amplification, (unsigned long)(minErase), (unsigned long)(maxErase),
+               (unsigned long)(violations));
+
+        if(amplification > 1.1 || maxErase - minErase > 2 || !minErase || violations)
+            failures++;
+
+        return failures;
+    }
+
+    uint32_t checkHotKey()
+    {
+        constexpr uint32_t SECTORS = 32, COLD = 100, UPDATES = 100000;
+
+        SimulatedFlash flash(SECTORS * SimulatedFlash::DEFAULT_SECTOR_SIZE);
+        KVStore kv(flash, COLD + 1);
+        Model model;
+        Random random(2);
+        uint32_t failures = 0;
+
+        if(kv.format())
+        {
+            printf("Hot key: format failed\n");
+            return 1;
+        }
+
+        for(uint32_t i = 0; i < COLD; ++i)
+        {
+            const std::vector<uint8_t> value = randomValue(random, 64);
+            failures += apply(kv, model, keyName(i), &value);
+        }
+
+        uint64_t userBytes = kv.stats().userBytes;
+        const uint32_t programmed = flash.stats().bytesProgrammed;
+
+        kv.resetStats();
+
+        for(uint32_t i = 0; i < UPDATES; ++i)
+        {
+            const std::vector<uint8_t> value(reinterpret_cast<const uint8_t*>(&i),
+                                             reinterpret_cast<const uint8_t*>(&i) + sizeof(i));
+            failures += apply(kv, model, "hot", &value);
+        }
+
+        userBytes += kv.stats().userBytes;
+
+        // The hot key is not in the checked key range: compared alone
+        uint32_t hot = 0;
+
+        if(kv.mount() || kv.get("hot", hot) || hot != UPDATES - 1)
+            failures++;
+
+        model.erase("hot");
+
+        if(kv.remove("hot") || !matches(kv, model, COLD))
+            failures++;
+
+        uint32_t minErase, maxErase;
+        kv.eraseCounts(minErase, maxErase);
+
+        const double amplification = (double)(flash.stats().bytesProgrammed) / userBytes;
+
+        printf("Hot key: %lu cold keys, %lu updates, write amplification %.3f (%lu bytes for the cold keys), "
+               "erase counts %lu-%lu\n", (unsigned long)(COLD), (unsigned long)(UPDATES), amplification,
+               (unsigned long)(programmed), (unsigned long)(minErase), (unsigned long)(maxErase));
+
+        if(amplification > 1.1 || maxErase - minErase > 2 || !minErase || flash.stats().violations)
+            failures++;
+
+        return failures;
+    }
+
+    /**
+        \brief Workload of the power loss test: sets and removes on a few keys, with compactions on 4 sectors
+    **/
+    struct Operation
+    {
+        std::string             key;
+        std::vector<uint8_t>    value;
+        bool                    remove;
+    };
+
+    uint32_t checkPowerLoss()
+    {
+        constexpr uint32_t SECTORS = 4, KEYS = 12, OPERATIONS = 400, STEP = 7;
+
+        std::vector<Operation> workload;
+        Random random(3);
+
+        for(uint32_t i = 0; i < OPERATIONS; ++i)
+        {
+            Operation operation;
+            operation.key       = keyName(random.below(KEYS));
+            operation.remove    = random.below(6) == 0;
+            operation.value     = randomValue(random, 400);
+            workload.push_back(operation);
+        }
+
+        uint32_t failures = 0, cuts = 0, violations = 0, interrupted[2] = {0, 0};
+
+        for(uint32_t cut = 0;; cut += STEP)
+        {
+            SimulatedFlash flash(SECTORS * SimulatedFlash::DEFAULT_SECTOR_SIZE);
+            Model model, after;
+            bool failed = false;
+
+            {
+                KVStore kv(flash, KEYS);
+
+                if(kv.format())
+                    return failures + 1;
+
+                flash.failAfter(cut);
+
+                for(const Operation& operation: workload)
+                {
+                    if(apply(kv, model, operation.key, operation.remove ? nullptr : &operation.value))
+                    {
+                        // The model is left before the operation
+                        after = model;
+
+                        if(operation.remove)
+                            after.erase(operation.key);
+                        else
+                            after[operation.key] = operation.value;
+
+                        failed = true;
+                        break;
+                    }
+                }
+            }
+
+            // The workload ran to the end: every part of it was cut once
+            if(!failed)
+                break;
+
+            cuts++;
+
+            if(!flash.failed())
+            {
+                if(failures++ < 5)
+                    printf("Power loss: operation failed without a power loss, cut at %lu\n", (unsigned long)(cut));
+                continue;
+            }
+
+            flash.powerCycle();
+
+            KVStore kv(flash, KEYS);
+            bool valid = !kv.mount();
+            const bool old = valid && matches(kv, model, KEYS);
+
+            valid = valid && (old || matches(kv, after, KEYS));
+            interrupted[old]++;
+
+            // Still working: a few more operations, and a remount
+            Model& state = old ? model : after;
+
+            for(uint32_t i = 0; valid && i < 8; ++i)
+                valid = !apply(kv, state, workload[i].key, workload[i].remove ? nullptr : &workload[i].value);
+
+            valid = valid && !kv.mount() && matches(kv, state, KEYS);
+            violations += flash.stats().violations;
+
+            if(!valid && failures++ < 5)
+                printf("Power loss: invalid store after a cut at %lu bytes\n", (unsigned long)(cut));
+        }
+
+        printf("Power loss: %lu cuts every %lu bytes, interrupted operation lost %lu times, done %lu times, "
+               "%lu NOR violations\n", (unsigned long)(cuts), (unsigned long)(STEP), (unsigned long)(interrupted[1]),
+               (unsigned long)(interrupted[0]), (unsigned long)(violations));
+
+        // The cuts must reach the compactions and the erases
+        if(cuts < 1000 || violations)
+            failures++;
+
+        return failures;
+    }
+
+    uint32_t checkSingleKey()
+    {
+        SimulatedFlash flash(8 * SimulatedFlash::DEFAULT_SECTOR_SIZE);
+        KVStore kv(flash, 1);
+        uint32_t failures = 0;
+        uint8_t value = 0;
+
+        // Missing keys with the table holding its single key: the probes must stop
+        failures += kv.format();
+        failures += kv.set("a", (uint8_t)(1));
+        failures += kv.contains("b");
+        failures += !kv.get("b", value);
+        failures += kv.remove("b");
+        failures += !kv.set("b", (uint8_t)(2));
+
+        failures += kv.remove("a");
+        failures += kv.set("b", (uint8_t)(3));
+        failures += kv.mount();
+        failures += kv.contains("a") || kv.count() != 1 || kv.get("b", value) || value != 3;
+
+        printf("Single key: %s\n", failures ? "FAILED" : "ok");
+        return failures;
+    }
+
+    uint32_t checkLookups()
+    {
+        constexpr uint32_t KEYS = 1000;
+
+        SimulatedFlash flash(64 * SimulatedFlash::DEFAULT_SECTOR_SIZE);
+        KVStore kv(flash, KEYS);
+        uint32_t failures = kv.format();
+
+        for(uint32_t i = 0; i < KEYS; ++i)
+            failures += kv.set(keyName(i).c_str(), i);
+
+        flash.resetStats();
+        failures += kv.mount();
+
+        const uint32_t mountReads = flash.stats().reads;
+
+        flash.resetStats();
+
+        for(uint32_t i = 0; i < KEYS; ++i)
+        {
+            uint32_t value = 0;
+            failures += kv.get(keyName(i).c_str(), value) || value != i;
+        }
+
+        const double reads = (double)(flash.stats().reads) / KEYS;
+
+        printf("Lookups: %lu keys, mount %lu reads, %.2f reads per get\n", (unsigned long)(KEYS),
+               (unsigned long)(mountReads), reads);
+
+        if(reads > 2.1)
+            failures++;
+
+        return failures;
+    }
+
+    void benchmark()
+    {
+        constexpr uint32_t KEYS = 200, OPERATIONS = 100000;
+
+        SimulatedFlash flash(32 * SimulatedFlash::DEFAULT_SECTOR_SIZE);
+        KVStore kv(flash, KEYS);
+        std::vector<std::string> keys;
+        uint32_t sum = 0;
+
+        kv.format();
+
+        for(uint32_t i = 0; i < KEYS; ++i)
+            keys.push_back(keyName(i));
+
+        uint64_t start = micros();
+
+        for(uint32_t i = 0; i < OPERATIONS; ++i)
+            kv.set(keys[i % KEYS].c_str(), i);
+
+        const uint64_t set = micros() - start;
+
+        start = micros();
+
+        for(uint32_t i = 0; i < OPERATIONS; ++i)
+        {
+            uint32_t value = 0;
+            kv.get(keys[i % KEYS].c_str(), value);
+            sum += value;
+        }
+
+        const uint64_t get = micros() - start;
+
+        printf("%lu keys: set %.3f us, get %.3f us (%lu compactions, checksum %lu)\n", (unsigned long)(KEYS),
+               (double)(set) / OPERATIONS, (double)(get) / OPERATIONS, (unsigned long)(kv.stats().compactions),
+               (unsigned long)(sum));
+    }
+}
+
+int main(int argc, char**)
+{
+    if(argc > 1)
+    {
+        fprintf(stderr, "Usage: kv_store_bench\n");
+        return 2;
+    }
+
+    uint32_t failures = checkSingleKey();
+    failures += checkModel();
+    failures += checkHotKey();
+    failures += checkPowerLoss();
+    failures += checkLookups();
+
+    if(failures)
+    {
+        printf("%lu checks FAILED\n", (unsigned long)(failures));
+        return 1;
+    }
+
+    benchmark();
+
+    return 0;
+}
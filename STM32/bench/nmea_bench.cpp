@@ -0,0 +1,440 @@
+/**
+    \file nmea_bench.cpp
+    \brief Host replay test and benchmark of the streaming NMEA parser (nmea.cpp)
+
+    A receiver output is generated: one epoch per second along a track, with RMC, GGA, GSA and GSV sentences of
+    several constellations, and faults as on a real serial line: corrupted bytes, sentences cut short by the next
+    one, noise between sentences. It is replayed through NMEAParser, which decodes RMC and GGA as GPS does:
+    - every intact sentence must be accepted, every faulty one dropped (and counted as an error);
+    - the decoded time, date, position, speed and altitude must match the track;
+    - the replay must not allocate memory.
+
+    A recorded log can be replayed instead (-f): the sentences and errors are counted, and the speed measured.
+
+    Usage: nmea_bench [-n epochs] [-f file]
+    - -n: number of generated epochs (default: 20000)
+    - -f: replay a recorded NMEA log instead
+
+    Returns 1 on a failed check. Build and run with run.sh.
+**/
+#include "nmea.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace
+{
+    uint64_t allocations = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    ++allocations;
+
+    if(void* p = malloc(size))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    free(p);
+}
+
+namespace
+{
+    /**
+        \brief Random numbers, the same on every host (xorshift32)
+    **/
+    class Random
+    {
+        public:
+            Random(uint32_t seed): m_state(seed) {}
+
+            uint32_t next()
+            {
+                m_state ^= m_state << 13;
+                m_state ^= m_state >> 17;
+                m_state ^= m_state << 5;
+                return m_state;
+            }
+
+            // Uniform in [0, n)
+            uint32_t below(uint32_t n)
+            {
+                return next() % n;
+            }
+
+        private:
+            uint32_t m_state;
+    };
+
+    /**
+        \brief Position and motion of the receiver at an epoch, as sent in RMC and GGA
+    **/
+    struct Epoch
+    {
+        uint32_t    timestamp;      // Unix time
+        int32_t     latitude;       // 1e-5 minutes
+        int32_t     longitude;      // 1e-5 minutes
+        int32_t     speed;          // 0.01 knots
+        int32_t     altitude;       // 0.1 m
+    };
+
+    /**
+        \brief What the parser should find in an accepted RMC or GGA sentence
+    **/
+    struct Expected
+    {
+        uint32_t    type;
+        uint32_t    epoch;          // Index of the epoch
+    };
+
+    /**
+        \brief Decoded by the replay, as GPS does
+    **/
+    struct Decoded
+    {
+        uint32_t        type;
+        uint32_t        milliseconds;
+        DateTime::Date  date;
+        int32_t         latitude;   // 1e-7 degrees
+        int32_t         longitude;
+        int32_t         speed;      // 0.01 knots
+        int32_t         altitude;   // 0.1 m
+        bool            error;
+    };
+
+    constexpr uint32_t RMC = NMEAParser::sentenceType("RMC");
+    constexpr uint32_t GGA = NMEAParser::sentenceType("GGA");
+
+    std::string coordinate(int32_t minutes, uint8_t degreeDigits, char positive, char negative)
+    {
+        const uint32_t v = std::abs(minutes);
+        char text[32];
+
+        snprintf(text, sizeof(text), "%0*lu%02lu.%05lu,%c", degreeDigits, (unsigned long)(v/6000000),
+                 (unsigned long)(v/100000 % 60), (unsigned long)(v % 100000), minutes < 0 ? negative : positive);
+        return text;
+    }
+
+    std::string sentence(const std::string& body)
+    {
+        uint8_t checksum = 0;
+        for(char c: body)
+            checksum ^= c;
+
+        char tail[8];
+        snprintf(tail, sizeof(tail), "*%02X\r\n", checksum);
+        return "$" + body + tail;
+    }
+
+    /**
+        \brief Generated receiver output
+    **/
+    struct Stream
+    {
+        std::vector<uint8_t>    bytes;
+        std::vector<Epoch>      epochs;
+        std::vector<Expected>   expected;       // Accepted RMC and GGA sentences, in order
+        uint32_t                sentences   = 0;    // Intact sentences
+        uint32_t                faults      = 0;    // Corrupted or cut sentences
+    };
+
+    void generate(Stream& stream, uint32_t count)
+    {
+        Random random(0x12345678);
+        Epoch epoch = {1709251200, 48*6000000 + 703800, -(11*6000000 + 3100200), 0, 5454};   // 2024-03-01
+
+        for(uint32_t e = 0; e < count; ++e)
+        {
+            const DateTime dt(epoch.timestamp);
+            const DateTime::Date date = dt.getDate();
+            const DateTime::Time time = dt.getTime();
+            char text[96];
+
+            snprintf(text, sizeof(text), "%02u%02u%02u.%02u", time.h, time.m, time.s, e % 100);
+            const std::string hms(text);
+
+            snprintf(text, sizeof(text), "%02u%02u%02u", date.d, date.m, date.y % 100);
+            const std::string dmy(text);
+
+            const std::string position = coordinate(epoch.latitude, 2, 'N', 'S') + "," +
+                                         coordinate(epoch.longitude, 3, 'E', 'W');
+
+            std::vector<std::string> bodies;
+            std::vector<uint32_t> types;
+
+            snprintf(text, sizeof(text), ",A,%s,%ld.%02ld,%ld.%ld,%s,,,A", position.c_str(),
+                     (long)(epoch.speed/100), (long)(epoch.speed%100), (long)(e*7 % 3600/10), (long)(e*7 % 10),
+                     dmy.c_str());
+            bodies.push_back((e % 2 ? "GNRMC," : "GPRMC,") + hms + text);
+            types.push_back(RMC);
+
+            snprintf(text, sizeof(text), ",%s,1,%02lu,0.%lu,%ld.%ld,M,46.9,M,,", position.c_str(),
+                     (unsigned long)(6 + e % 8), (unsigned long)(5 + e % 5), (long)(epoch.altitude/10),
+                     (long)(epoch.altitude%10));
+            bodies.push_back("GNGGA," + hms + text);
+            types.push_back(GGA);
+
+            bodies.push_back("GNGSA,A,3,04,05,09,12,16,,,,,,,,1.50,0.75,1.30,1");
+            bodies.push_back("GNGSA,A,3,65,71,72,,,,,,,,,,1.50,0.75,1.30,2");
+            bodies.push_back("GPGSV,2,1,06,04,40,083,46,05,17,308,41,09,07,344,39,12,22,228,,1");
+            bodies.push_back("GPGSV,2,2,06,16,10,100,30,21,11,111,31,1");
+            bodies.push_back("GLGSV,1,1,03,65,50,010,35,71,60,020,36,72,12,250,28,1");
+            bodies.push_back("GAGSV,1,1,01,01,30,030,33,7");
+            types.resize(bodies.size(), 0);
+
+            for(size_t i = 0; i < bodies.size(); ++i)
+            {
+                std::string s = sentence(bodies[i]);
+                const uint32_t fault = random.below(100);
+
+                if(fault == 0)
+                { // Corrupted digit: bad checksum
+                    size_t p;
+                    do
+                        p = 1 + random.below(s.size() - 6);
+                    while(s[p] < '0' || s[p] > '9');
+
+                    s[p] = '0' + (s[p] - '0' + 1 + random.below(9)) % 10;
+                    stream.faults++;
+                }
+                else if(fault == 1)
+                { // Cut short by the next sentence
+                    s.resize(1 + random.below(s.size() - 3));
+                    stream.faults++;
+                }
+                else
+                {
+                    stream.sentences++;
+
+                    if(types[i])
+                        stream.expected.push_back({types[i], e});
+                }
+
+                stream.bytes.insert(stream.bytes.end(), s.begin(), s.end());
+
+                // Noise between sentences (no '$'), not after a cut one: it would be taken as its end
+                if(fault != 1 && random.below(50) == 0)
+                {
+                    for(uint32_t n = random.below(20); n; --n)
+                    {
+                        const uint8_t c = random.next();
+                        stream.bytes.push_back(c == '$' ? '#' : c);
+                    }
+                }
+            }
+
+            stream.epochs.push_back(epoch);
+
+            epoch.timestamp++;
+            epoch.latitude  += (int32_t)(random.below(2001)) - 1000;
+            epoch.longitude += (int32_t)(random.below(2001)) - 1000;
+            epoch.speed      = random.below(5000);
+            epoch.altitude  += (int32_t)(random.below(21)) - 10;
+        }
+
+        // A sentence cut at the end of the stream is not complete either: the parser counts it when a '$' arrives
+        stream.bytes.push_back('$');
+    }
+
+    uint64_t micros()
+    {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+    }
+
+    /**
+        \brief Feed the stream to the parser, decode RMC and GGA
+        \returns Number of accepted sentences
+    **/
+    uint32_t replay(const std::vector<uint8_t>& bytes, NMEAParser& parser, std::vector<Decoded>& decoded)
+    {
+        uint32_t accepted = 0;
+
+        for(uint8_t c: bytes)
+        {
+            if(!parser.parse(c))
+                continue;
+
+            ++accepted;
+
+            if(parser.type() == RMC && decoded.size() < decoded.capacity())
+            {
+                Decoded d = {};
+                d.type  = RMC;
+                d.error = NMEAParser::parseTime(parser.field(1), d.milliseconds) ||
+                          NMEAParser::parseCoordinate(parser.field(3), parser.field(4), d.latitude) ||
+                          NMEAParser::parseCoordinate(parser.field(5), parser.field(6), d.longitude) ||
+                          NMEAParser::parseDecimal(parser.field(7), 2, d.speed) ||
+                          NMEAParser::parseDate(parser.field(9), d.date);
+                decoded.push_back(d);
+            }
+            else if(parser.type() == GGA && decoded.size() < decoded.capacity())
+            {
+                Decoded d = {};
+                d.type  = GGA;
+                d.error = NMEAParser::parseTime(parser.field(1), d.milliseconds) ||
+                          NMEAParser::parseCoordinate(parser.field(2), parser.field(3), d.latitude) ||
+                          NMEAParser::parseCoordinate(parser.field(4), parser.field(5), d.longitude) ||
+                          NMEAParser::parseDecimal(parser.field(9), 1, d.altitude);
+                decoded.push_back(d);
+            }
+        }
+
+        return accepted;
+    }
+
+    // Coordinate of the track in 1e-7 degrees, rounded
+    int32_t degrees(int32_t minutes)
+    {
+        return (int32_t)(std::lround(minutes/60.0*100));
+    }
+
+    uint32_t check(const Stream& stream, const std::vector<Decoded>& decoded)
+    {
+        uint32_t failures = 0;
+
+        if(decoded.size() != stream.expected.size())
+        {
+            printf("%lu RMC/GGA sentences decoded, %lu expected\n", (unsigned long)(decoded.size()),
+                   (unsigned long)(stream.expected.size()));
+            return 1;
+        }
+
+        for(size_t i = 0; i < decoded.size(); ++i)
+        {
+            const Decoded& d = decoded[i];
+            const uint32_t e = stream.expected[i].epoch;
+            const Epoch& epoch = stream.epochs[e];
+            const DateTime dt(epoch.timestamp);
+            const DateTime::Time time = dt.getTime();
+            const uint32_t milliseconds = ((time.h*60 + time.m)*60 + time.s)*1000 + e % 100 * 10;
+
+            bool ok = !d.error && d.type == stream.expected[i].type && d.milliseconds == milliseconds &&
+                      std::abs(d.latitude - degrees(epoch.latitude)) <= 1 &&
+                      std::abs(d.longitude - degrees(epoch.longitude)) <= 1;
+
+            if(d.type == RMC)
+            {
+                const DateTime::Date date = dt.getDate();
+                ok = ok && d.speed == epoch.speed && d.date.d == date.d && d.date.m == date.m && d.date.y == date.y;
+            }
+            else
+                ok = ok && d.altitude == epoch.altitude;
+
+            if(!ok && failures++ < 10)
+                printf("Epoch %lu: %s decoded wrong\n", (unsigned long)(e), d.type == RMC ? "RMC" : "GGA");
+        }
+
+        return failures;
+    }
+
+    bool load(const char* path, std::vector<uint8_t>& bytes)
+    {
+        FILE* file = fopen(path, "rb");
+        if(!file)
+            return true;
+
+        uint8_t block[4096];
+        size_t n;
+
+        while((n = fread(block, 1, sizeof(block), file)) > 0)
+            bytes.insert(bytes.end(), block, block + n);
+
+        fclose(file);
+        return false;
+    }
+
+    void usage()
+    {
+        fprintf(stderr, "Usage: nmea_bench [-n epochs] [-f file]\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t epochs     = 20000;
+    const char* path    = nullptr;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(!strcmp(argv[i], "-n") && i + 1 < argc)
+            epochs = strtoul(argv[++i], nullptr, 0);
+        else if(!strcmp(argv[i], "-f") && i + 1 < argc)
+            path = argv[++i];
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    Stream stream;
+
+    if(path)
+    {
+        if(load(path, stream.bytes))
+        {
+            fprintf(stderr, "Can not read %s\n", path);
+            return 1;
+        }
+    }
+    else
+        generate(stream, epochs);
+
+    NMEAParser parser;
+    std::vector<Decoded> decoded;
+    decoded.reserve(path ? stream.bytes.size()/32 : stream.expected.size());
+
+    const uint64_t allocated    = allocations;
+    const uint64_t start        = micros();
+    const uint32_t accepted     = replay(stream.bytes, parser, decoded);
+    const uint64_t elapsed      = micros() - start;
+    const uint64_t replayAllocations = allocations - allocated;
+    const double seconds        = elapsed ? elapsed/1e6 : 1e-6;
+
+    uint32_t failures = 0;
+
+    if(!path)
+    {
+        if(accepted != stream.sentences || parser.errors() != stream.faults)
+        {
+            printf("%lu sentences accepted and %lu errors, %lu and %lu expected\n", (unsigned long)(accepted),
+                   (unsigned long)(parser.errors()), (unsigned long)(stream.sentences),
+                   (unsigned long)(stream.faults));
+            failures++;
+        }
+
+        failures += check(stream, decoded);
+    }
+
+    if(replayAllocations)
+    {
+        printf("%llu allocations during the replay\n", (unsigned long long)(replayAllocations));
+        failures++;
+    }
+
+    if(!path)
+        printf("%lu epochs, %lu faulty sentences: %s\n", (unsigned long)(epochs), (unsigned long)(stream.faults),
+               failures ? "FAILED" : "ok");
+
+    printf("%.1f MB, %lu sentences, %lu errors in %.3f s: %.0f sentences/s, %.1f MB/s, %.0f ns/byte\n",
+           stream.bytes.size()/1e6, (unsigned long)(accepted), (unsigned long)(parser.errors()), seconds,
+           accepted/seconds, stream.bytes.size()/seconds/1e6, seconds*1e9/stream.bytes.size());
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,86 @@
+#!/bin/sh
+# Build and run the host tests and benchmarks of the modules that do not depend on the HAL: each program checks its
+# results (snapshots, reference implementations) and returns an error on a mismatch, then prints its measures.
+#
+# Usage: run.sh [-u] [program...]
+#   -u: replace the snapshots (*_snapshots.txt) with the current images, after a deliberate change of the output
+#   program: programs to build and run (default: all)
+#
+# Environment: CC, CXX (default gcc, g++), PYTHON (default python3), BUILD (build directory, default /tmp/stm32_bench)
+
+set -e
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+ROOT=$HERE/..
+
+CC=${CC:-gcc}
+CXX=${CXX:-g++}
+PYTHON=${PYTHON:-python3}
+BUILD=${BUILD:-/tmp/stm32_bench}
+UPDATE=
+
+while getopts "u" option; do
+    case $option in
+        u) UPDATE=-u ;;
+        *) sed -n '5,7p' "$0"; exit 2 ;;
+    esac
+done
+
+shift $((OPTIND - 1))
+
+FLAGS="-O2 -Wall -Wextra -I$ROOT"
+
+# name|sources, from the STM32 directory|arguments
+PROGRAMS="
+ui_bench|bench/ui_bench.cpp ui/framebuffer.cpp ui/widget.cpp ui/widgets.cpp ui/stripchart.cpp display.cpp color.cpp point2d.cpp touch.cpp glcdfont.c|-s $HERE/ui_snapshots.txt
+display_bench|bench/display_bench.cpp display.cpp color.cpp point2d.cpp glcdfont.c|-s $HERE/display_snapshots.txt
+nmea_bench|bench/nmea_bench.cpp nmea.cpp datetime.cpp|
+ubx_bench|bench/ubx_bench.cpp ubx.cpp nmea.cpp datetime.cpp|
+satellite_status_bench|bench/satellite_status_bench.cpp satellite_status.cpp nmea.cpp ubx.cpp datetime.cpp|
+geodesy_bench|bench/geodesy_bench.cpp geodesy.cpp|
+geofence_bench|bench/geofence_bench.cpp geofence/geofence.cpp geodesy.cpp|$BUILD/fences.gfn
+datetime_bench|bench/datetime_bench.cpp datetime.cpp|
+kv_store_bench|bench/kv_store_bench.cpp kv_store.cpp simulated_flash.cpp|
+fix_history_bench|bench/fix_history_bench.cpp fix_history.cpp|
+"
+
+mkdir -p "$BUILD"
+
+echo "$PROGRAMS" | while IFS='|' read -r name sources arguments; do
+    [ -n "$name" ] || continue
+
+    if [ $# -gt 0 ]; then
+        case " $* " in
+            *" $name "*) ;;
+            *) continue ;;
+        esac
+    fi
+
+    # 10000 generated fences, converted as a real fence set
+    if [ "$name" = geofence_bench ]; then
+        "$PYTHON" "$HERE/fencegen.py" "$BUILD/fences.geojson" --count 10000
+        "$PYTHON" "$ROOT/geofence/fenceconvert.py" "$BUILD/fences.geojson" "$BUILD/fences.gfn" --id-property id
+    fi
+
+    dir=$BUILD/$name
+    mkdir -p "$dir"
+    objects=
+
+    for source in $sources; do
+        object=$dir/$(basename "$source").o
+
+        case $source in
+            *.c) $CC $FLAGS -c "$ROOT/$source" -o "$object" ;;
+            *) $CXX $FLAGS -std=c++14 -c "$ROOT/$source" -o "$object" ;;
+        esac
+
+        objects="$objects $object"
+    done
+
+    # shellcheck disable=SC2086
+    $CXX -o "$dir/$name" $objects -lm -lpthread
+
+    echo "== $name"
+    # shellcheck disable=SC2086
+    "$dir/$name" $UPDATE $arguments
+done
@@ -0,0 +1,519 @@
+/**
+    \file satellite_status_bench.cpp
+    \brief Host test and benchmark of the satellite table and fix quality (satellite_status.cpp)
+
+    Receiver outputs are replayed through NMEAParser into SatelliteStatus, as GPS does, and the satellite table
+    (constellation, ID, elevation, azimuth, SNR, used flag), the used satellites per constellation and the DOP
+    are compared with the expected ones:
+    - a GN/GP/GL/GA stream in the NMEA 4.10 layout of u-blox receivers: one GNGSA per constellation, identified
+      by its system ID (Galileo IDs overlap the GPS ones), and GSV cycles of two signals per constellation: the
+      first signal gives the satellite list, the second one only raises the SNR. The next epoch loses a GPS
+      satellite: the GPS list is rebuilt, the others are kept;
+    - the same constellations in the NMEA 4.0 layout (no system ID nor signal ID): the GNGSA sentences are
+      attributed by the range of their satellite IDs;
+    - GNGSV sentences mixing the constellations (attributed by ID range), and a GPS-only receiver (NMEA 2.3);
+    - more satellites than the table holds: the table is full, and the next GSV cycle frees the space;
+    - UBX NAV-SAT messages, which replace the whole table.
+
+    Then the time per GSA and GSV sentence (parsing included) is measured.
+
+    Usage: satellite_status_bench
+
+    Returns 1 on a failed check. Build and run with run.sh.
+**/
+#include "satellite_status.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using Constellation = SatelliteStatus::Constellation;
+    using Satellite     = SatelliteStatus::Satellite;
+
+    constexpr Constellation GPS     = Constellation::GPS;
+    constexpr Constellation GLONASS = Constellation::GLONASS;
+    constexpr Constellation GALILEO = Constellation::GALILEO;
+    constexpr Constellation BEIDOU  = Constellation::BEIDOU;
+    constexpr Constellation QZSS    = Constellation::QZSS;
+
+    const char* const s_names[] = {"GPS", "GLONASS", "Galileo", "BeiDou", "QZSS"};
+
+    uint64_t nanos()
+    {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+    }
+
+    /**
+        \brief Complete sentences: '$', checksum and line end added to the sentence bodies
+    **/
+    std::string sentences(const std::vector<const char*>& bodies)
+    {
+        std::string stream;
+
+        for(const char* body: bodies)
+        {
+            uint8_t checksum = 0;
+            for(const char* c = body; *c; ++c)
+                checksum ^= (uint8_t)(*c);
+
+            char end[8];
+            snprintf(end, sizeof(end), "*%02X\r\n", checksum);
+            stream += std::string("$") + body + end;
+        }
+
+        return stream;
+    }
+
+    /**
+        \brief Parse a stream and dispatch the GSA and GSV sentences, as GPS does
+        \returns Number of sentences dispatched
+    **/
+    uint32_t replay(const std::string& stream, NMEAParser& parser, SatelliteStatus& status)
+    {
+        uint32_t dispatched = 0;
+
+        for(char c: stream)
+        {
+            if(!parser.parse(c))
+                continue;
+
+            if(parser.type() == NMEAParser::sentenceType("GSA"))
+                status.processGSA(parser);
+            else if(parser.type() == NMEAParser::sentenceType("GSV"))
+                status.processGSV(parser);
+            else
+                continue;
+
+            ++dispatched;
+        }
+
+        return dispatched;
+    }
+
+    uint32_t replay(const std::vector<const char*>& bodies, SatelliteStatus& status)
+    {
+        NMEAParser parser;
+        const uint32_t dispatched = replay(sentences(bodies), parser, status);
+
+        if(dispatched != bodies.size())
+        {
+            printf("%lu sentences out of %lu dispatched\n", (unsigned long)(dispatched),
+                   (unsigned long)(bodies.size()));
+            return 1;
+        }
+
+        return 0;
+    }
+
+    /**
+        \brief Compare the satellite table with the expected one (in the same order)
+    **/
+    uint32_t checkTable(const char* name, const SatelliteStatus& status, const std::vector<Satellite>& expected)
+    {
+        Satellite table[SatelliteStatus::MAX_SATELLITES + 1];
+        const uint8_t count = status.getSatellites(table, sizeof(table)/sizeof(table[0]));
+
+        if(count != expected.size())
+        {
+            printf("%s: %u satellites instead of %lu\n", name, count, (unsigned long)(expected.size()));
+            return 1;
+        }
+
+        for(uint8_t i = 0; i < count; ++i)
+        {
+            const Satellite& s = table[i];
+            const Satellite& e = expected[i];
+
+            if( s.constellation != e.constellation || s.id != e.id || s.elevation != e.elevation ||
+                s.azimuth != e.azimuth || s.snr != e.snr || s.used != e.used)
+            {
+                printf("%s: satellite %u is %s %u (elevation %d, azimuth %u, SNR %u, used %d), expected %s %u "
+                       "(%d, %u, %u, %d)\n", name, i, s_names[(int)(s.constellation)], s.id, s.elevation,
+                       s.azimuth, s.snr, s.used, s_names[(int)(e.constellation)], e.id, e.elevation, e.azimuth,
+                       e.snr, e.used);
+                return 1;
+            }
+        }
+
+        return 0;
+    }
+
+    /**
+        \brief Compare the satellites used per constellation (GPS, GLONASS, Galileo, BeiDou, QZSS)
+    **/
+    uint32_t checkUsed(const char* name, const SatelliteStatus& status, const std::vector<uint8_t>& expected)
+    {
+        for(uint8_t c = 0; c < expected.size(); ++c)
+        {
+            const uint8_t used = status.satellitesUsed(static_cast<Constellation>(c));
+            if(used != expected[c])
+            {
+                printf("%s: %u %s satellites used instead of %u\n", name, used, s_names[c], expected[c]);
+                return 1;
+            }
+        }
+
+        return 0;
+    }
+
+    uint32_t checkQuality(const char* name, const SatelliteStatus& status, uint8_t fixType, uint16_t pdop,
+                          uint16_t hdop, uint16_t vdop)
+    {
+        const SatelliteStatus::FixQuality& q = status.quality();
+
+        if(q.fixType != fixType || q.pdop != pdop || q.hdop != hdop || q.vdop != vdop)
+        {
+            printf("%s: fix type %u, DOP %u/%u/%u instead of %u, %u/%u/%u\n", name, q.fixType, q.pdop, q.hdop,
+                   q.vdop, fixType, pdop, hdop, vdop);
+            return 1;
+        }
+
+        return 0;
+    }
+
+    uint32_t report(const char* name, uint32_t failures)
+    {
+        printf("%-40s %s\n", name, failures ? "FAILED" : "ok");
+        return failures;
+    }
+
+    /**
+        \brief u-blox NMEA 4.10: GNGSA with system IDs, GSV with signal IDs (GPS L1 C/A 1 and L2 CL 6,
+        GLONASS L1 OF 1 and L2 OF 3, Galileo E1 7 and E5 b 2)
+    **/
+    uint32_t checkNMEA410()
+    {
+        SatelliteStatus status;
+
+        uint32_t failures = replay({
+            "GNGSA,A,3,05,13,15,18,23,,,,,,,,1.42,0.78,1.19,1",
+            "GNGSA,A,3,65,71,72,,,,,,,,,,1.42,0.78,1.19,2",
+            "GNGSA,A,3,02,13,36,,,,,,,,,,1.42,0.78,1.19,3",
+            "GNGSA,A,3,,,,,,,,,,,,,1.42,0.78,1.19,4",
+            "GPGSV,2,1,07,05,45,120,42,13,30,200,38,15,60,300,45,18,10,050,30,1",
+            "GPGSV,2,2,07,23,25,080,40,24,05,010,,29,15,270,22,1",
+            "GPGSV,1,1,04,05,45,120,35,13,30,200,33,15,60,300,47,24,05,010,12,6",
+            "GLGSV,1,1,04,65,50,010,35,71,60,020,36,72,15,150,28,88,05,330,,1",
+            "GLGSV,1,1,03,65,50,010,38,71,60,020,30,72,15,150,,3",
+            "GAGSV,1,1,04,02,40,100,41,13,55,230,43,36,20,300,39,24,03,010,,7",
+            "GAGSV,1,1,03,02,40,100,44,13,55,230,40,36,20,300,,2"
+        }, status);
+
+        failures += checkTable("NMEA 4.10", status, {
+            {GPS,       5,  45, 120, 42, true},
+            {GPS,       13, 30, 200, 38, true},
+            {GPS,       15, 60, 300, 47, true},
+            {GPS,       18, 10, 50,  30, true},
+            {GPS,       23, 25, 80,  40, true},
+            {GPS,       24, 5,  10,  12, false},
+            {GPS,       29, 15, 270, 22, false},
+            {GLONASS,   65, 50, 10,  38, true},
+            {GLONASS,   71, 60, 20,  36, true},
+            {GLONASS,   72, 15, 150, 28, true},
+            {GLONASS,   88, 5,  330, 0,  false},
+            {GALILEO,   2,  40, 100, 44, true},
+            {GALILEO,   13, 55, 230, 43, true},
+            {GALILEO,   36, 20, 300, 39, true},
+            {GALILEO,   24, 3,  10,  0,  false}
+        });
+        failures += checkUsed("NMEA 4.10", status, {5, 3, 3, 0, 0});
+        failures += checkQuality("NMEA 4.10", status, 3, 142, 78, 119);
+
+        // Next epoch: GPS 18 lost, a Galileo satellite is not used anymore
+        failures += replay({
+            "GNGSA,A,3,05,13,15,23,,,,,,,,,1.55,0.84,1.30,1",
+            "GNGSA,A,3,65,71,72,,,,,,,,,,1.55,0.84,1.30,2",
+            "GNGSA,A,3,02,13,,,,,,,,,,,1.55,0.84,1.30,3",
+            "GNGSA,A,3,,,,,,,,,,,,,1.55,0.84,1.30,4",
+            "GPGSV,2,1,06,05,46,121,41,13,31,201,39,15,61,301,44,23,26,081,40,1",
+            "GPGSV,2,2,06,24,06,011,15,29,16,271,23,1",
+            "GPGSV,1,1,03,05,46,121,36,13,31,201,34,15,61,301,45,6"
+        }, status);
+
+        failures += checkTable("NMEA 4.10, next epoch", status, {
+            {GLONASS,   65, 50, 10,  38, true},
+            {GLONASS,   71, 60, 20,  36, true},
+            {GLONASS,   72, 15, 150, 28, true},
+            {GLONASS,   88, 5,  330, 0,  false},
+            {GALILEO,   2,  40, 100, 44, true},
+            {GALILEO,   13, 55, 230, 43, true},
+            {GALILEO,   36, 20, 300, 39, false},
+            {GALILEO,   24, 3,  10,  0,  false},
+            {GPS,       5,  46, 121, 41, true},
+            {GPS,       13, 31, 201, 39, true},
+            {GPS,       15, 61, 301, 45, true},
+            {GPS,       23, 26, 81,  40, true},
+            {GPS,       24, 6,  11,  15, false},
+            {GPS,       29, 16, 271, 23, false}
+        });
+        failures += checkUsed("NMEA 4.10, next epoch", status, {4, 3, 2, 0, 0});
+        failures += checkQuality("NMEA 4.10, next epoch", status, 3, 155, 84, 130);
+
+        return report("GN/GP/GL/GA, NMEA 4.10", failures);
+    }
+
+    /**
+        \brief NMEA 4.0: GNGSA without system ID, GSV without signal ID
+    **/
+    uint32_t checkNMEA40()
+    {
+        SatelliteStatus status;
+
+        uint32_t failures = replay({
+            "GNGSA,A,3,05,13,15,,,,,,,,,,2.10,1.20,1.72",
+            "GNGSA,A,3,65,71,,,,,,,,,,,2.10,1.20,1.72",
+            "GNGSA,A,3,302,313,,,,,,,,,,,2.10,1.20,1.72",
+            "GPGSV,1,1,04,05,45,120,42,13,30,200,38,15,60,300,45,24,05,010,",
+            "GLGSV,1,1,03,65,50,010,35,71,60,020,36,88,05,330,",
+            "GAGSV,1,1,02,302,40,100,41,313,55,230,43"
+        }, status);
+
+        failures += checkTable("NMEA 4.0", status, {
+            {GPS,       5,   45, 120, 42, true},
+            {GPS,       13,  30, 200, 38, true},
+            {GPS,       15,  60, 300, 45, true},
+            {GPS,       24,  5,  10,  0,  false},
+            {GLONASS,   65,  50, 10,  35, true},
+            {GLONASS,   71,  60, 20,  36, true},
+            {GLONASS,   88,  5,  330, 0,  false},
+            {GALILEO,   302, 40, 100, 41, true},
+            {GALILEO,   313, 55, 230, 43, true}
+        });
+        failures += checkUsed("NMEA 4.0", status, {3, 2, 2, 0, 0});
+        failures += checkQuality("NMEA 4.0", status, 3, 210, 120, 172);
+
+        return report("GN/GP/GL/GA, NMEA 4.0", failures);
+    }
+
+    /**
+        \brief GNGSV sentences listing all the constellations, and a GPS-only receiver
+    **/
+    uint32_t checkMixed()
+    {
+        SatelliteStatus mixed;
+
+        uint32_t failures = replay({
+            "GNGSA,A,3,07,,,,,,,,,,,,1.90,1.10,1.55",
+            "GNGSA,A,3,66,,,,,,,,,,,,1.90,1.10,1.55",
+            "GNGSA,A,3,305,,,,,,,,,,,,1.90,1.10,1.55",
+            "GNGSA,A,3,405,,,,,,,,,,,,1.90,1.10,1.55",
+            "GNGSV,2,1,06,07,45,120,42,66,30,200,38,305,60,300,45,405,05,010,31",
+            "GNGSV,2,2,06,195,70,180,40,08,12,045,"
+        }, mixed);
+
+        failures += checkTable("GNGSV", mixed, {
+            {GPS,       7,   45, 120, 42, true},
+            {GLONASS,   66,  30, 200, 38, true},
+            {GALILEO,   305, 60, 300, 45, true},
+            {BEIDOU,    405, 5,  10,  31, true},
+            {QZSS,      195, 70, 180, 40, false},
+            {GPS,       8,   12, 45,  0,  false}
+        });
+
+        // The next cycle replaces the whole list, whatever the constellations
+        failures += replay({"GNGSV,1,1,01,66,31,201,37"}, mixed);
+        failures += checkTable("GNGSV, next cycle", mixed, {{GLONASS, 66, 31, 201, 37, true}});
+
+        // NMEA 2.3: GPS talker only, no system ID
+        SatelliteStatus single;
+
+        failures += replay({
+            "GPGSA,A,2,04,09,17,,,,,,,,,,3.20,2.40,2.10",
+            "GPGSV,1,1,04,04,45,120,42,09,30,200,38,17,60,300,45,22,05,010,"
+        }, single);
+
+        failures += checkTable("GPS only", single, {
+            {GPS,   4,  45, 120, 42, true},
+            {GPS,   9,  30, 200, 38, true},
+            {GPS,   17, 60, 300, 45, true},
+            {GPS,   22, 5,  10,  0,  false}
+        });
+        failures += checkUsed("GPS only", single, {3, 0, 0, 0, 0});
+        failures += checkQuality("GPS only", single, 2, 320, 240, 210);
+
+        return report("GNGSV, and GPS only", failures);
+    }
+
+    /**
+        \brief Replay a GSV cycle of \c count satellites, IDs from \c first
+    **/
+    uint32_t cycle(SatelliteStatus& status, const char* talker, uint16_t first, uint8_t count)
+    {
+        std::vector<std::string> bodies;
+        const uint8_t messages = (count + 3)/4;
+
+        for(uint8_t m = 0; m < messages; ++m)
+        {
+            char body[NMEAParser::MAX_LENGTH];
+            int length = snprintf(body, sizeof(body), "%sGSV,%u,%u,%02u", talker, messages, m + 1, count);
+
+            for(uint8_t i = 4*m; i < count && i < 4*m + 4; ++i)
+                length += snprintf(body + length, sizeof(body) - length, ",%02u,%02u,%03u,%02u", first + i,
+                                   10 + i, 10*i, 20 + i);
+
+            bodies.push_back(body);
+        }
+
+        std::vector<const char*> pointers;
+        for(const std::string& body: bodies)
+            pointers.push_back(body.c_str());
+
+        return replay(pointers, status);
+    }
+
+    uint32_t checkFull()
+    {
+        SatelliteStatus status;
+        uint32_t failures = 0;
+
+        // 16 + 12 + 12 + 8 satellites
+        failures += cycle(status, "GP", 1, 16);
+        failures += cycle(status, "GL", 65, 12);
+        failures += cycle(status, "GA", 1, 12);
+        failures += cycle(status, "GB", 1, 8);
+
+        Satellite table[SatelliteStatus::MAX_SATELLITES + 1];
+        uint8_t count = status.getSatellites(table, sizeof(table)/sizeof(table[0]));
+        if(count != SatelliteStatus::MAX_SATELLITES || table[count - 1].constellation != GALILEO)
+        {
+            printf("Full table: %u satellites\n", count);
+            ++failures;
+        }
+
+        // The next GPS cycle lists less satellites: BeiDou gets the space left
+        failures += cycle(status, "GP", 1, 4);
+        failures += cycle(status, "GB", 1, 8);
+
+        count = status.getSatellites(table, sizeof(table)/sizeof(table[0]));
+        if(count != 36 || table[count - 1].constellation != BEIDOU || table[count - 1].id != 8)
+        {
+            printf("Table after a shorter cycle: %u satellites\n", count);
+            ++failures;
+        }
+
+        // A smaller destination array
+        if(status.getSatellites(table, 5) != 5)
+            ++failures;
+
+        return report("More satellites than the table holds", failures);
+    }
+
+    /**
+        \brief NAV-SAT satellite block: gnssId, svId, cno, elev, azim, prRes, flags
+    **/
+    void navSatellite(std::vector<uint8_t>& payload, uint8_t gnss, uint8_t sv, uint8_t snr, int8_t elevation,
+                      uint16_t azimuth, bool used)
+    {
+        const uint8_t block[12] = {gnss, sv, snr, (uint8_t)(elevation), (uint8_t)(azimuth & 0xFF),
+                                   (uint8_t)(azimuth >> 8), 0, 0, (uint8_t)(used ? 0x08 : 0), 0, 0, 0};
+
+        payload.insert(payload.end(), block, block + sizeof(block));
+        payload[5]++;
+    }
+
+    uint32_t checkNavSAT()
+    {
+        SatelliteStatus status;
+
+        // NMEA sentences first: replaced by the message
+        uint32_t failures = replay({
+            "GNGSA,A,3,05,13,,,,,,,,,,,1.42,0.78,1.19,1",
+            "GPGSV,1,1,02,05,45,120,42,13,30,200,38,1"
+        }, status);
+
+        std::vector<uint8_t> payload(8, 0);
+        payload[4] = 1;
+        navSatellite(payload, 0, 7, 41, 45, 120, true);
+        navSatellite(payload, 6, 3, 35, 30, 200, true);      // GLONASS slot 3: ID 67
+        navSatellite(payload, 6, 255, 20, 10, 0, false);    // Unknown GLONASS slot: skipped
+        navSatellite(payload, 2, 11, 43, -2, 359, false);
+        navSatellite(payload, 5, 1, 38, 70, 180, true);      // QZSS 1: ID 193
+        navSatellite(payload, 4, 1, 30, 20, 90, true);       // IMES: skipped
+
+        status.processNavSAT(payload.data(), payload.size());
+
+        failures += checkTable("NAV-SAT", status, {
+            {GPS,       7,   45, 120, 41, true},
+            {GLONASS,   67,  30, 200, 35, true},
+            {GALILEO,   11,  -2, 359, 43, false},
+            {QZSS,      193, 70, 180, 38, true}
+        });
+        failures += checkUsed("NAV-SAT", status, {1, 1, 0, 0, 1});
+
+        // Truncated: the satellites announced but not received are ignored
+        status.processNavSAT(payload.data(), 8 + 12 + 5);
+        failures += checkTable("NAV-SAT, truncated", status, {{GPS, 7, 45, 120, 41, true}});
+
+        return report("UBX NAV-SAT", failures);
+    }
+
+    volatile uint32_t sink;
+
+    void benchmark()
+    {
+        constexpr uint32_t EPOCHS = 20000;
+
+        const std::string epoch = sentences({
+            "GNGSA,A,3,05,13,15,18,23,,,,,,,,1.42,0.78,1.19,1",
+            "GNGSA,A,3,65,71,72,,,,,,,,,,1.42,0.78,1.19,2",
+            "GNGSA,A,3,02,13,36,,,,,,,,,,1.42,0.78,1.19,3",
+            "GPGSV,2,1,07,05,45,120,42,13,30,200,38,15,60,300,45,18,10,050,30,1",
+            "GPGSV,2,2,07,23,25,080,40,24,05,010,,29,15,270,22,1",
+            "GPGSV,1,1,03,05,45,120,35,13,30,200,33,15,60,300,47,6",
+            "GLGSV,1,1,04,65,50,010,35,71,60,020,36,72,15,150,28,88,05,330,,1",
+            "GAGSV,1,1,04,02,40,100,41,13,55,230,43,36,20,300,39,24,03,010,,7"
+        });
+
+        NMEAParser parser;
+        SatelliteStatus status;
+
+        // Parsing alone, then parsing and processing
+        uint32_t total = 0;
+        uint64_t start = nanos();
+        for(uint32_t i = 0; i < EPOCHS; ++i)
+            for(char c: epoch)
+                total += parser.parse(c);
+        const double parsing = (double)(nanos() - start)/total;
+
+        uint32_t dispatched = 0;
+        start = nanos();
+        for(uint32_t i = 0; i < EPOCHS; ++i)
+            dispatched += replay(epoch, parser, status);
+        const double processing = (double)(nanos() - start)/dispatched;
+
+        sink = total + dispatched;
+
+        printf("%-40s %8s\n", "GSA and GSV sentences", "ns");
+        printf("%-40s %8.1f\n", "parsing", parsing);
+        printf("%-40s %8.1f\n", "parsing and processing", processing);
+    }
+}
+
+int main(int argc, char**)
+{
+    if(argc > 1)
+    {
+        fprintf(stderr, "Usage: satellite_status_bench\n");
+        return 2;
+    }
+
+    uint32_t failures = checkNMEA410();
+    failures += checkNMEA40();
+    failures += checkMixed();
+    failures += checkFull();
+    failures += checkNavSAT();
+
+    printf("Satellite status checks: %s\n", failures ? "FAILED" : "ok");
+
+    if(failures)
+        return 1;
+
+    benchmark();
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+/**
+    \file snapshot.h
+    \brief Reference images of the host tests (see run.sh)
+
+    A snapshot file lists the reference images of a program, one per line: name, size and FNV-1a hash (64 bits) of
+    the RGB565 pixels, row by row. Lines starting with # are comments. The hash makes the reference files small and
+    reviewable; to look at the images, the programs write them as PPM files (-o option).
+
+    In update mode (-u), the images replace the references, and the file is written back by save().
+**/
+#ifndef GUARD_BENCH_SNAPSHOT
+#define GUARD_BENCH_SNAPSHOT
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+class Snapshots
+{
+    public:
+        /**
+            \brief Constructor, loads the references
+            \param path Snapshot file
+            \param update \c true to replace the references instead of comparing with them
+            \param imageDirectory Directory to write the images to, as PPM files, or \c nullptr
+        **/
+        Snapshots(const char* path, bool update, const char* imageDirectory):
+            m_path(path), m_update(update), m_imageDirectory(imageDirectory)
+        {
+            FILE* file = fopen(path, "r");
+            char line[256];
+
+            while(file && fgets(line, sizeof(line), file))
+            {
+                Entry entry;
+                char name[128];
+
+                if(line[0] != '#' && sscanf(line, "%127s %dx%d %" SCNx64, name, &entry.width, &entry.height, &entry.hash) == 4)
+                {
+                    entry.name = name;
+                    m_entries.push_back(entry);
+                }
+            }
+
+            if(file)
+                fclose(file);
+        }
+
+        /**
+            \brief Compare an image with its reference (or replace it, in update mode)
+            \param name Image name, without spaces
+            \param pixels RGB565 pixels, row by row
+            \returns \c true on a mismatch or a missing reference
+        **/
+        bool check(const char* name, const uint16_t* pixels, int width, int height)
+        {
+            const uint64_t h = hash(pixels, (uint32_t)(width)*height);
+
+            if(m_imageDirectory)
+                writePPM((std::string(m_imageDirectory) + "/" + name + ".ppm").c_str(), pixels, width, height);
+
+            Entry* entry = find(name);
+
+            if(m_update)
+            {
+                if(!entry)
+                {
+                    m_entries.push_back(Entry());
+                    entry = &m_entries.back();
+                    entry->name = name;
+                }
+
+                entry->width    = width;
+                entry->height   = height;
+                entry->hash     = h;
+                return false;
+            }
+
+            if(entry && entry->width == width && entry->height == height && entry->hash == h)
+                return false;
+
+            if(entry)
+                printf("Snapshot mismatch: %s (%016" PRIx64 ", reference %016" PRIx64 ")\n", name, h, entry->hash);
+            else
+                printf("No snapshot: %s (run with -u to add it)\n", name);
+
+            m_failures++;
+            return true;
+        }
+
+        /**
+            \brief Write the references back, in update mode
+            \returns \c true on error
+        **/
+        bool save() const
+        {
+            if(!m_update)
+                return false;
+
+            FILE* file = fopen(m_path, "w");
+
+            if(!file)
+                return true;
+
+            fprintf(file, "# name size FNV-1a hash of the RGB565 pixels, written by run.sh -u\n");
+
+            for(const Entry& entry: m_entries)
+                fprintf(file, "%s %dx%d %016" PRIx64 "\n", entry.name.c_str(), entry.width, entry.height, entry.hash);
+
+            return fclose(file) != 0;
+        }
+
+        /**
+            \returns Number of failed comparisons
+        **/
+        uint32_t failures() const
+        {
+            return m_failures;
+        }
+
+        static uint64_t hash(const uint16_t* pixels, uint32_t count)
+        {
+            uint64_t h = 0xcbf29ce484222325ull;
+
+            for(uint32_t i = 0; i < count; ++i)
+            {
+                h = (h ^ (pixels[i] & 0xFF)) * 0x100000001b3ull;
+                h = (h ^ (pixels[i] >> 8)) * 0x100000001b3ull;
+            }
+
+            return h;
+        }
+
+        /**
+            \brief Write an RGB565 image as a binary PPM file
+            \returns \c true on error
+        **/
+        static bool writePPM(const char* path, const uint16_t* pixels, int width, int height)
+        {
+            FILE* file = fopen(path, "wb");
+
+            if(!file)
+                return true;
+
+            fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+            for(int i = 0; i < width*height; ++i)
+            {
+                const uint8_t rgb[3] = {(uint8_t)((pixels[i] >> 11) * 255 / 31), (uint8_t)(((pixels[i] >> 5) & 0x3F) * 255 / 63),
+                                        (uint8_t)((pixels[i] & 0x1F) * 255 / 31)};
+                fwrite(rgb, 1, 3, file);
+            }
+
+            return fclose(file) != 0;
+        }
+
+    private:
+        struct Entry
+        {
+            std::string name;
+            int         width   = 0;
+            int         height  = 0;
+            uint64_t    hash    = 0;
+        };
+
+        Entry* find(const char* name)
+        {
+            for(Entry& entry: m_entries)
+                if(entry.name == name)
+                    return &entry;
+
+            return nullptr;
+        }
+
+        const char*         m_path;
+        bool                m_update;
+        const char*         m_imageDirectory;
+        std::vector<Entry>  m_entries;
+        uint32_t            m_failures = 0;
+};
+
+#endif
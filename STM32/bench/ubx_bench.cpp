@@ -0,0 +1,578 @@
+/**
+    \file ubx_bench.cpp
+    \brief Host replay test and benchmark of the streaming UBX parser (ubx.cpp)
+
+    - Frames from the u-blox protocol description (CFG-RATE, ACK-ACK) are parsed, and rejected once a byte of their
+      checksum is changed; UBXParser::checksum() must give the same checksums.
+    - A receiver output is generated: NAV-PVT, NAV-SAT (some longer than MAX_PAYLOAD, then truncated) and ACK frames,
+      with NMEA sentences between them, fed as GPS::process() does (NMEA is only parsed between UBX frames; the
+      payloads contain '$'). Every frame and sentence must be received, with its payload.
+    - Faults are then added: corrupted payload or checksum bytes, frames cut short, noise (false sync characters,
+      invalid lengths) between frames. The accepted frames and the error count must be those of a reference scan of
+      the whole stream (an offline implementation of the framing rules); every accepted frame must be an intact one;
+      a corrupted frame received in sync must only lose itself, and the parser must resynchronize within a false
+      frame length (MAX_LENGTH) after any fault.
+
+    The generated payloads never contain the sync characters, so that the expected losses are known; false syncs
+    come from the noise.
+
+    Usage: ubx_bench [-n frames] [-f file]
+    - -n: number of generated frames (default: 50000)
+    - -f: replay a recorded UBX log instead (frames and errors are counted, and the speed measured)
+
+    Returns 1 on a failed check. Build and run with run.sh.
+**/
+#include "nmea.h"
+#include "ubx.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    /**
+        \brief Random numbers, the same on every host (xorshift32)
+    **/
+    class Random
+    {
+        public:
+            Random(uint32_t seed): m_state(seed) {}
+
+            uint32_t next()
+            {
+                m_state ^= m_state << 13;
+                m_state ^= m_state >> 17;
+                m_state ^= m_state << 5;
+                return m_state;
+            }
+
+            // Uniform in [0, n)
+            uint32_t below(uint32_t n)
+            {
+                return next() % n;
+            }
+
+        private:
+            uint32_t m_state;
+    };
+
+    /**
+        \brief A frame found in a stream
+    **/
+    struct Frame
+    {
+        size_t      end;        // Offset of the byte following the frame
+        uint16_t    message;
+        uint16_t    length;     // Declared payload length
+        uint64_t    hash;       // FNV-1a of the stored payload (MAX_PAYLOAD bytes at most)
+
+        bool operator==(const Frame& other) const
+        {
+            return end == other.end && message == other.message && length == other.length && hash == other.hash;
+        }
+    };
+
+    uint64_t hash(const uint8_t* data, size_t size)
+    {
+        uint64_t h = 0xcbf29ce484222325ull;
+
+        for(size_t i = 0; i < size; ++i)
+            h = (h ^ data[i]) * 0x100000001b3ull;
+
+        return h;
+    }
+
+    /**
+        \brief Reference: the framing rules applied to a whole stream, with offsets instead of states
+        \param errors Frames dropped (bad checksum, invalid length)
+    **/
+    std::vector<Frame> scan(const std::vector<uint8_t>& bytes, uint32_t& errors)
+    {
+        std::vector<Frame> frames;
+        size_t i = 0;
+        errors = 0;
+
+        while(i + 1 < bytes.size())
+        {
+            if(bytes[i] != UBXParser::SYNC_1 || bytes[i + 1] != UBXParser::SYNC_2)
+            {
+                ++i;
+                continue;
+            }
+
+            const size_t header = i + 2;
+
+            if(header + 4 > bytes.size())
+                break;
+
+            const uint16_t length = bytes[header + 2] | (bytes[header + 3] << 8);
+
+            if(length > UBXParser::MAX_LENGTH)
+            {
+                ++errors;
+                i = header + 4;
+                continue;
+            }
+
+            const size_t check = header + 4 + length;
+
+            if(check >= bytes.size())
+                break;
+
+            uint8_t a = 0;
+            uint8_t b = 0;
+            UBXParser::checksum(&bytes[header], 4 + length, a, b);
+
+            if(bytes[check] != a)
+            { // The rejected byte may start the next frame
+                ++errors;
+                i = check;
+                continue;
+            }
+
+            if(check + 1 >= bytes.size())
+                break;
+
+            if(bytes[check + 1] != b)
+            {
+                ++errors;
+                i = check + 1;
+                continue;
+            }
+
+            const uint16_t stored = (length < UBXParser::MAX_PAYLOAD) ? length : UBXParser::MAX_PAYLOAD;
+            frames.push_back({check + 2, (uint16_t)((bytes[header] << 8) | bytes[header + 1]), length,
+                              hash(&bytes[header + 4], stored)});
+            i = check + 2;
+        }
+
+        return frames;
+    }
+
+    /**
+        \brief Feed a stream as GPS::process() does
+        \param sentences Number of NMEA sentences received
+    **/
+    std::vector<Frame> replay(const std::vector<uint8_t>& bytes, UBXParser& ubx, uint32_t& sentences, bool& truncated)
+    {
+        NMEAParser nmea;
+        std::vector<Frame> frames;
+        sentences = 0;
+        truncated = false;
+
+        for(size_t i = 0; i < bytes.size(); ++i)
+        {
+            if(ubx.parse(bytes[i]))
+            {
+                frames.push_back({i + 1, ubx.message(), ubx.truncated() ? (uint16_t)(UBXParser::MAX_PAYLOAD + 1) :
+                                  ubx.length(), hash(ubx.payload(), ubx.length())});
+                truncated = truncated || ubx.truncated();
+            }
+            else if(!ubx.busy() && nmea.parse(bytes[i]))
+                ++sentences;
+        }
+
+        return frames;
+    }
+
+    /**
+        \brief Generated receiver output
+    **/
+    struct Stream
+    {
+        std::vector<uint8_t>    bytes;
+        std::vector<Frame>      intact;         // Frames sent intact, in order
+        std::vector<size_t>     starts;         // Offsets of the intact frames
+        std::vector<size_t>     faults;         // Offsets of all faults
+        std::vector<bool>       corrupted;      // Per fault: corrupted payload or checksum
+        uint32_t                sentences = 0;  // NMEA sentences
+    };
+
+    void append(Stream& stream, const std::vector<uint8_t>& frame)
+    {
+        stream.bytes.insert(stream.bytes.end(), frame.begin(), frame.end());
+    }
+
+    std::vector<uint8_t> frame(uint16_t message, const std::vector<uint8_t>& payload)
+    {
+        std::vector<uint8_t> f = {UBXParser::SYNC_1, UBXParser::SYNC_2, (uint8_t)(message >> 8), (uint8_t)(message),
+                                  (uint8_t)(payload.size()), (uint8_t)(payload.size() >> 8)};
+        f.insert(f.end(), payload.begin(), payload.end());
+
+        uint8_t a = 0;
+        uint8_t b = 0;
+        UBXParser::checksum(&f[2], f.size() - 2, a, b);
+        f.push_back(a);
+        f.push_back(b);
+        return f;
+    }
+
+    // Random payload without the sync characters, numbered, with '$' (not NMEA)
+    std::vector<uint8_t> payload(Random& random, uint16_t length, uint32_t sequence)
+    {
+        std::vector<uint8_t> p(length);
+
+        for(uint16_t i = 0; i < length; ++i)
+        {
+            p[i] = random.next();
+            if(p[i] == UBXParser::SYNC_1)
+                p[i] = '$';
+        }
+
+        for(uint8_t i = 0; i < 4 && i < length; ++i)
+            p[i] = (sequence >> (7*i)) & 0x7F;
+
+        return p;
+    }
+
+    void generate(Stream& stream, uint32_t count, bool faults)
+    {
+        Random random(faults ? 0xC0FFEE : 0xBADCAB1E);
+        const char* nmea = "$GNGGA,120000.00,4807.038,N,01131.002,E,1,14,0.75,545.4,M,46.9,M,,*4D\r\n";
+
+        for(uint32_t n = 0; n < count; ++n)
+        {
+            std::vector<uint8_t> f;
+            const uint32_t kind = random.below(10);
+
+            if(kind < 6)
+                f = frame(UBXParser::NAV_PVT, payload(random, 92, n));
+            else if(kind < 9)   // 0 to 60 satellites: the longest are truncated
+                f = frame(UBXParser::NAV_SAT, payload(random, 8 + 12*random.below(61), n));
+            else
+                f = frame(UBXParser::ACK_ACK, payload(random, 2, n));
+
+            const uint32_t fault = faults ? random.below(100) : 100;
+            const size_t start = stream.bytes.size();
+            const uint16_t length = f[4] | (f[5] << 8);
+
+            if(fault < 3)
+            { // Corrupted byte: payload or checksum
+                const size_t p = 6 + random.below(f.size() - 6);
+                f[p] ^= 1 + random.below(255);
+                append(stream, f);
+                stream.faults.push_back(start);
+                stream.corrupted.push_back(true);
+            }
+            else if(fault < 5)
+            { // Cut short
+                f.resize(1 + random.below(f.size() - 1));
+                append(stream, f);
+                stream.faults.push_back(start);
+                stream.corrupted.push_back(false);
+            }
+            else
+            {
+                append(stream, f);
+
+                const uint16_t stored = (length < UBXParser::MAX_PAYLOAD) ? length : UBXParser::MAX_PAYLOAD;
+                stream.starts.push_back(start);
+                stream.intact.push_back({stream.bytes.size(), (uint16_t)((f[2] << 8) | f[3]), length,
+                                         hash(&f[6], stored)});
+            }
+
+            if(fault == 5 || fault == 6)
+            { // Noise, with a false sync
+                const size_t noise = stream.bytes.size();
+
+                for(uint32_t i = random.below(16); i; --i)
+                    stream.bytes.push_back(random.next() | 0x80);
+
+                stream.bytes.push_back((uint8_t)(UBXParser::SYNC_1));
+                stream.bytes.push_back((uint8_t)(UBXParser::SYNC_2));
+
+                // Invalid length, or a short false frame
+                const uint16_t falseLength = (fault == 5) ? UBXParser::MAX_LENGTH + 1 + random.below(60000) :
+                                                           random.below(100);
+                const uint8_t header[4] = {(uint8_t)(random.next()), (uint8_t)(random.next()),
+                                           (uint8_t)(falseLength), (uint8_t)(falseLength >> 8)};
+                stream.bytes.insert(stream.bytes.end(), header, header + 4);
+                stream.faults.push_back(noise);
+                stream.corrupted.push_back(false);
+            }
+
+            // NMEA between frames
+            if(random.below(4) == 0)
+            {
+                stream.bytes.insert(stream.bytes.end(), nmea, nmea + strlen(nmea));
+                stream.sentences++;
+            }
+        }
+    }
+
+    /**
+        \brief Frames published in the u-blox protocol description
+    **/
+    uint32_t checkDocumentedFrames()
+    {
+        static const uint8_t frames[][16] =
+        {
+            {14, 0xB5, 0x62, 0x06, 0x08, 0x06, 0x00, 0xE8, 0x03, 0x01, 0x00, 0x01, 0x00, 0x01, 0x39},  // CFG-RATE 1 Hz
+            {14, 0xB5, 0x62, 0x06, 0x08, 0x06, 0x00, 0xC8, 0x00, 0x01, 0x00, 0x01, 0x00, 0xDE, 0x6A},  // 5 Hz
+            {14, 0xB5, 0x62, 0x06, 0x08, 0x06, 0x00, 0x64, 0x00, 0x01, 0x00, 0x01, 0x00, 0x7A, 0x12},  // 10 Hz
+            {10, 0xB5, 0x62, 0x05, 0x01, 0x02, 0x00, 0x06, 0x08, 0x16, 0x3F}                           // ACK-ACK
+        };
+
+        uint32_t failures = 0;
+
+        for(const uint8_t* f: frames)
+        {
+            const uint8_t size = f[0];
+            const uint8_t* bytes = f + 1;
+            UBXParser parser;
+            uint32_t accepted = 0;
+
+            for(uint8_t i = 0; i < size; ++i)
+                accepted += parser.parse(bytes[i]);
+
+            uint8_t a = 0;
+            uint8_t b = 0;
+            UBXParser::checksum(bytes + 2, size - 4, a, b);
+
+            const bool ok = accepted == 1 && parser.message() == UBXParser::messageId(bytes[2], bytes[3]) &&
+                            parser.length() == size - 8 && !memcmp(parser.payload(), bytes + 6, size - 8) &&
+                            a == bytes[size - 2] && b == bytes[size - 1] && !parser.errors();
+
+            // Either checksum byte changed: dropped, and counted
+            for(uint8_t k = 1; k <= 2; ++k)
+            {
+                UBXParser damaged;
+                uint32_t n = 0;
+
+                for(uint8_t i = 0; i < size; ++i)
+                    n += damaged.parse((i == size - k) ? bytes[i] ^ 0x10 : bytes[i]);
+
+                failures += n != 0 || damaged.errors() != 1;
+            }
+
+            if(!ok)
+            {
+                printf("Documented frame %04X not parsed\n", UBXParser::messageId(bytes[2], bytes[3]));
+                failures++;
+            }
+        }
+
+        return failures;
+    }
+
+    uint32_t checkCleanStream(uint32_t count)
+    {
+        Stream stream;
+        generate(stream, count, false);
+
+        UBXParser parser;
+        uint32_t sentences;
+        bool truncated;
+        const std::vector<Frame> frames = replay(stream.bytes, parser, sentences, truncated);
+
+        // replay() marks truncated frames with a length of MAX_PAYLOAD + 1
+        std::vector<Frame> expected = stream.intact;
+        for(Frame& f: expected)
+            if(f.length > UBXParser::MAX_PAYLOAD)
+                f.length = UBXParser::MAX_PAYLOAD + 1;
+
+        if(frames == expected && sentences == stream.sentences && !parser.errors() && truncated)
+            return 0;
+
+        printf("Clean stream: %lu frames, %lu sentences and %lu errors, %lu frames and %lu sentences expected\n",
+               (unsigned long)(frames.size()), (unsigned long)(sentences), (unsigned long)(parser.errors()),
+               (unsigned long)(stream.intact.size()), (unsigned long)(stream.sentences));
+        return 1;
+    }
+
+    // First frame ending after an offset
+    // A false header (after up to 15 bytes of noise) hides at most MAX_LENGTH bytes and a checksum
+    constexpr size_t RESYNC_BYTES = 15 + UBXParser::HEADER + UBXParser::MAX_LENGTH + 2;
+
+    uint32_t checkFaultyStream(uint32_t count)
+    {
+        Stream stream;
+        generate(stream, count, true);
+
+        UBXParser parser;
+        uint32_t sentences;
+        bool truncated;
+        std::vector<Frame> frames = replay(stream.bytes, parser, sentences, truncated);
+
+        uint32_t referenceErrors;
+        std::vector<Frame> reference = scan(stream.bytes, referenceErrors);
+
+        for(Frame& f: reference)
+            if(f.length > UBXParser::MAX_PAYLOAD)
+                f.length = UBXParser::MAX_PAYLOAD + 1;
+
+        uint32_t failures = 0;
+
+        if(frames != reference || parser.errors() != referenceErrors)
+        {
+            printf("Faulty stream: %lu frames and %lu errors, the reference scan finds %lu and %lu\n",
+                   (unsigned long)(frames.size()), (unsigned long)(parser.errors()),
+                   (unsigned long)(reference.size()), (unsigned long)(referenceErrors));
+            failures++;
+        }
+
+        // Every accepted frame is an intact one
+        std::vector<Frame> intact = stream.intact;
+        for(Frame& f: intact)
+            if(f.length > UBXParser::MAX_PAYLOAD)
+                f.length = UBXParser::MAX_PAYLOAD + 1;
+
+        size_t next = 0;
+        for(const Frame& f: frames)
+        {
+            while(next < intact.size() && intact[next].end < f.end)
+                ++next;
+
+            if(next == intact.size() || !(intact[next] == f))
+            {
+                printf("Faulty stream: frame ending at %lu accepted, it was not sent intact\n", (unsigned long)(f.end));
+                failures++;
+                break;
+            }
+        }
+
+        // A corrupted frame received in sync only loses itself: the next intact frame is received, unless another
+        // fault comes first
+        for(size_t i = 0; i < stream.faults.size(); ++i)
+        {
+            if(!stream.corrupted[i] || (i && stream.faults[i - 1] + RESYNC_BYTES > stream.faults[i]))
+                continue;
+
+            const size_t k = std::lower_bound(stream.starts.begin(), stream.starts.end(), stream.faults[i]) -
+                             stream.starts.begin();
+
+            if(k == intact.size() || (i + 1 < stream.faults.size() && stream.faults[i + 1] < stream.starts[k]))
+                continue;
+
+            if(std::find(frames.begin(), frames.end(), intact[k]) == frames.end())
+            {
+                printf("Faulty stream: the frame after a corrupted one (starting at %lu) was lost\n",
+                       (unsigned long)(stream.faults[i]));
+                failures++;
+                break;
+            }
+        }
+
+        // Resynchronization: the first intact frame starting RESYNC_BYTES after a fault is received, unless another
+        // fault comes first
+        for(size_t i = 0; i < stream.faults.size(); ++i)
+        {
+            const size_t limit = stream.faults[i] + RESYNC_BYTES;
+            const size_t k = std::lower_bound(stream.starts.begin(), stream.starts.end(), limit) - stream.starts.begin();
+
+            if(k == intact.size() || (i + 1 < stream.faults.size() && stream.faults[i + 1] < stream.starts[k]))
+                continue;
+
+            if(std::find(frames.begin(), frames.end(), intact[k]) == frames.end())
+            {
+                printf("Faulty stream: not resynchronized at the frame starting at %lu, after the fault at %lu\n",
+                       (unsigned long)(stream.starts[k]), (unsigned long)(stream.faults[i]));
+                failures++;
+                break;
+            }
+        }
+
+        printf("Faulty stream: %lu faults, %lu of %lu intact frames received, %lu errors\n",
+               (unsigned long)(stream.faults.size()), (unsigned long)(frames.size()),
+               (unsigned long)(intact.size()), (unsigned long)(parser.errors()));
+
+        return failures;
+    }
+
+    uint64_t micros()
+    {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+    }
+
+    void measure(const char* name, const std::vector<uint8_t>& bytes)
+    {
+        UBXParser parser;
+        uint32_t sentences;
+        bool truncated;
+
+        const uint64_t start = micros();
+        const std::vector<Frame> frames = replay(bytes, parser, sentences, truncated);
+        const uint64_t elapsed = micros() - start;
+        const double seconds = elapsed ? elapsed/1e6 : 1e-6;
+
+        printf("%s: %.1f MB, %lu frames, %lu sentences, %lu errors in %.3f s: %.0f frames/s, %.1f MB/s\n", name,
+               bytes.size()/1e6, (unsigned long)(frames.size()), (unsigned long)(sentences),
+               (unsigned long)(parser.errors()), seconds, frames.size()/seconds, bytes.size()/seconds/1e6);
+    }
+
+    bool load(const char* path, std::vector<uint8_t>& bytes)
+    {
+        FILE* file = fopen(path, "rb");
+        if(!file)
+            return true;
+
+        uint8_t block[4096];
+        size_t n;
+
+        while((n = fread(block, 1, sizeof(block), file)) > 0)
+            bytes.insert(bytes.end(), block, block + n);
+
+        fclose(file);
+        return false;
+    }
+
+    void usage()
+    {
+        fprintf(stderr, "Usage: ubx_bench [-n frames] [-f file]\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t count      = 50000;
+    const char* path    = nullptr;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(!strcmp(argv[i], "-n") && i + 1 < argc)
+            count = strtoul(argv[++i], nullptr, 0);
+        else if(!strcmp(argv[i], "-f") && i + 1 < argc)
+            path = argv[++i];
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    if(path)
+    {
+        std::vector<uint8_t> bytes;
+
+        if(load(path, bytes))
+        {
+            fprintf(stderr, "Can not read %s\n", path);
+            return 1;
+        }
+
+        measure(path, bytes);
+        return 0;
+    }
+
+    uint32_t failures = 0;
+
+    failures += checkDocumentedFrames();
+    failures += checkCleanStream(count);
+    failures += checkFaultyStream(count);
+
+    printf("Documented frames, clean and faulty streams: %s\n", failures ? "FAILED" : "ok");
+
+    if(failures)
+        return 1;
+
+    Stream stream;
+    generate(stream, count, false);
+    measure("clean stream", stream.bytes);
+
+    return 0;
+}
@@ -0,0 +1,395 @@
+/**
+    \file ui_bench.cpp
+    \brief Host snapshot tests and frame time benchmark of the widget layer (ui/)
+
+    A dashboard (labels, bar graphs, gauge, strip chart, buttons) is rendered into a FrameBuffer:
+    - each step (first render, updates, button press and release) is compared with its snapshot (ui_snapshots.txt);
+    - after each incremental render, the screen is fully redrawn: the image must not change, i.e. the incremental
+      updates leave exactly what a full redraw draws;
+    - the button callback must fire on a release within the button only;
+    - a widget removed from the screen (alone, with its parent, or destroyed) while pressed must not receive the
+      release, and the next press must be dispatched.
+
+    Then the frame times are measured: full redraw, and typical update (texts, values, strip chart samples), with
+    the number of driver calls and pixels written (these do not depend on the host).
+
+    Usage: ui_bench [-s snapshots] [-u] [-o directory]
+    - -s: snapshot file (default: ui_snapshots.txt)
+    - -u: replace the snapshots with the current images
+    - -o: write the images to a directory, as PPM files
+
+    Returns 1 on a failed check. Build and run with run.sh.
+**/
+#include "ui/framebuffer.h"
+#include "ui/stripchart.h"
+#include "ui/widgets.h"
+
+#include "snapshot.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+namespace
+{
+    constexpr int16_t SCREEN_WIDTH  = 320;
+    constexpr int16_t SCREEN_HEIGHT = 240;
+
+    /**
+        \brief FrameBuffer counting the driver calls and the pixels written
+    **/
+    class CountingFrameBuffer: public FrameBuffer
+    {
+        public:
+            CountingFrameBuffer(uint16_t* buffer): FrameBuffer(SCREEN_WIDTH, SCREEN_HEIGHT, buffer) {}
+
+            virtual void writePixel(int16_t x, int16_t y, uint16_t color)
+            {
+                count(1, 1);
+                FrameBuffer::writePixel(x, y, color);
+            }
+
+            virtual void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+            {
+                count(w, h);
+                FrameBuffer::writeFillRect(x, y, w, h, color);
+            }
+
+            // FrameBuffer draws lines as rectangles: the calls are counted once
+            virtual void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+            {
+                count(w, 1);
+                FrameBuffer::writeFillRect(x, y, w, 1, color);
+            }
+
+            virtual void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+            {
+                count(1, h);
+                FrameBuffer::writeFillRect(x, y, 1, h, color);
+            }
+
+            uint64_t calls  = 0;
+            uint64_t pixels = 0;
+
+        private:
+            void count(int16_t w, int16_t h)
+            {
+                calls++;
+                pixels += (w > 0 && h > 0) ? (uint32_t)(w)*h : 0;
+            }
+    };
+
+    uint32_t clicks = 0;
+
+    void click()
+    {
+        clicks++;
+    }
+
+    /**
+        \brief Invisible widget counting its touch events
+    **/
+    class Recorder: public Widget
+    {
+        public:
+            Recorder(const Rect& bounds):
+                Widget(bounds)
+            {
+            }
+
+            uint32_t presses    = 0;
+            uint32_t releases   = 0;
+
+        protected:
+            virtual void draw(Display&, bool)
+            {
+            }
+
+            virtual bool touchEvent(const Point2D&, bool pressed)
+            {
+                if(pressed)
+                    presses++;
+                else
+                    releases++;
+
+                return true;
+            }
+    };
+
+    struct Dashboard
+    {
+        Dashboard(Display& display):
+            screen(display),
+            title(Rect(8, 4, 200, 8), "Dashboard", Color16::White),
+            voltage(Rect(8, 16, 120, 16), "12.5 V", Color16::Green, 2),
+            level(Rect(8, 40, 140, 12), 0, 100, Color16::Green),
+            tank(Rect(160, 36, 16, 64), 0, 100, Color16::Blue, true),
+            gauge(Rect(190, 8, 120, 64), 0, 100, Color16::Red),
+            chart(Rect(8, 108, 304, 80), -1000, 1000, Color16::White, 2),
+            start(Rect(8, 200, 90, 32), "Start", Color16::White, click),
+            stop(Rect(108, 200, 90, 32), "Stop", Color16::Red)
+        {
+            screen.setBackground(Color16::Black);
+
+            for(Widget* w: {(Widget*)(&title), (Widget*)(&voltage), (Widget*)(&level), (Widget*)(&tank),
+                            (Widget*)(&gauge), (Widget*)(&chart), (Widget*)(&start), (Widget*)(&stop)})
+                screen.addChild(w);
+        }
+
+        /**
+            \brief Change every widget, as a frame of an application would
+        **/
+        void update(uint32_t frame)
+        {
+            char text[16];
+
+            snprintf(text, sizeof(text), "%lu.%lu V", (unsigned long)(10 + frame % 5), (unsigned long)(frame % 10));
+            voltage.setText(text);
+
+            level.setValue((frame * 7) % 101);
+            tank.setValue(100 - (frame * 3) % 101);
+            gauge.setValue((frame * 11) % 101);
+
+            // Triangle wave, 4 samples per frame
+            for(uint32_t i = 0; i < 4; ++i)
+            {
+                const int32_t phase = (int32_t)((frame * 4 + i) * 37 % 800);
+                chart.addSample(phase < 400 ? phase * 5 - 1000 : 3000 - phase * 5);
+            }
+        }
+
+        Screen      screen;
+        Label       title;
+        Label       voltage;
+        BarGraph    level;
+        BarGraph    tank;
+        Gauge       gauge;
+        StripChart  chart;
+        Button      start;
+        Button      stop;
+    };
+
+    uint64_t micros()
+    {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+    }
+
+    uint16_t pixels[SCREEN_WIDTH*SCREEN_HEIGHT];
+    uint16_t incremental[SCREEN_WIDTH*SCREEN_HEIGHT];
+
+    /**
+        \brief Render, check the snapshot, then check that a full redraw gives the same image
+        \returns Number of failures
+    **/
+    uint32_t renderStep(Dashboard& dashboard, Snapshots& snapshots, const char* name)
+    {
+        uint32_t failures = 0;
+
+        dashboard.screen.render();
+        failures += snapshots.check(name, pixels, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+        memcpy(incremental, pixels, sizeof(pixels));
+        dashboard.screen.invalidate();
+        dashboard.screen.render();
+
+        for(int32_t i = 0; i < SCREEN_WIDTH*SCREEN_HEIGHT; ++i)
+        {
+            if(pixels[i] != incremental[i])
+            {
+                printf("Incremental render differs from a full redraw: %s, first at (%ld, %ld)\n", name,
+                       (long)(i % SCREEN_WIDTH), (long)(i / SCREEN_WIDTH));
+                failures++;
+                break;
+            }
+        }
+
+        return failures;
+    }
+
+    uint32_t checkButton(Dashboard& dashboard, Snapshots& snapshots)
+    {
+        uint32_t failures = 0;
+        const Rect& b = dashboard.start.bounds();
+        const Point2D inside(b.x + b.w/2, b.y + b.h/2);
+        const Point2D outside(b.x + b.w + 40, b.y - 20);
+
+        clicks = 0;
+
+        dashboard.screen.processTouch(std::make_pair(true, inside));
+        failures += !dashboard.start.isPressed();
+        failures += renderStep(dashboard, snapshots, "button-pressed");
+
+        dashboard.screen.processTouch(std::make_pair(false, inside));
+        failures += dashboard.start.isPressed() || clicks != 1;
+        failures += renderStep(dashboard, snapshots, "button-released");
+
+        // Press, then slide away: cancelled
+        dashboard.screen.processTouch(std::make_pair(true, inside));
+        dashboard.screen.processTouch(std::make_pair(false, outside));
+        failures += dashboard.start.isPressed() || clicks != 1;
+
+        // Press outside, release on the button: not a click either
+        dashboard.screen.processTouch(std::make_pair(true, outside));
+        dashboard.screen.processTouch(std::make_pair(false, inside));
+        failures += clicks != 1;
+
+        failures += renderStep(dashboard, snapshots, "button-cancelled");
+
+        if(failures)
+            printf("Button check failed (%lu clicks)\n", (unsigned long)(clicks));
+
+        return failures;
+    }
+
+    uint32_t checkRemovedWhilePressed(Screen& screen)
+    {
+        const Rect area(10, 190, 40, 20);
+        const Point2D p(20, 200);
+
+        Recorder parent(Rect(0, 180, 100, 60));
+        Recorder child(area);
+        parent.addChild(&child);
+        screen.addChild(&parent);
+
+        // The child alone
+        screen.processTouch(std::make_pair(true, p));
+        parent.removeChild(&child);
+        screen.processTouch(std::make_pair(false, p));
+        uint32_t failures = child.presses != 1 || child.releases != 0;
+
+        // The next press goes to the parent
+        screen.processTouch(std::make_pair(true, p));
+        screen.processTouch(std::make_pair(false, p));
+        failures += parent.presses != 1 || parent.releases != 1;
+
+        // With its parent
+        parent.addChild(&child);
+        screen.processTouch(std::make_pair(true, p));
+        screen.removeChild(&parent);
+        screen.processTouch(std::make_pair(false, p));
+        failures += child.presses != 2 || child.releases != 0;
+
+        // Destroyed: the widget built in its place must not get the release
+        parent.removeChild(&child);
+        screen.addChild(&parent);
+
+        alignas(Recorder) unsigned char storage[sizeof(Recorder)];
+        Recorder* pressed = new(storage) Recorder(area);
+        parent.addChild(pressed);
+        screen.processTouch(std::make_pair(true, p));
+        failures += pressed->presses != 1;
+        pressed->~Recorder();
+
+        Recorder* other = new(storage) Recorder(area);
+        screen.processTouch(std::make_pair(false, p));
+        failures += other->releases != 0;
+        other->~Recorder();
+
+        screen.removeChild(&parent);
+
+        if(failures)
+            printf("Removal of a pressed widget failed\n");
+
+        return failures;
+    }
+
+    void benchmark(Dashboard& dashboard, CountingFrameBuffer& display, const char* name, uint32_t frames, bool full)
+    {
+        display.calls = display.pixels = 0;
+        const uint64_t start = micros();
+
+        for(uint32_t frame = 0; frame < frames; ++frame)
+        {
+            if(full)
+                dashboard.screen.invalidate();
+            else
+                dashboard.update(frame);
+
+            dashboard.screen.render();
+        }
+
+        const double elapsed = micros() - start;
+
+        printf("%-14s %10.2f %12.1f %12.0f\n", name, elapsed / frames, (double)(display.calls) / frames,
+               (double)(display.pixels) / frames);
+    }
+
+    void usage()
+    {
+        fprintf(stderr, "Usage: ui_bench [-s snapshots] [-u] [-o directory]\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* snapshotFile    = "ui_snapshots.txt";
+    const char* imageDirectory  = nullptr;
+    bool update                 = false;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(!strcmp(argv[i], "-s") && i + 1 < argc)
+            snapshotFile = argv[++i];
+        else if(!strcmp(argv[i], "-o") && i + 1 < argc)
+            imageDirectory = argv[++i];
+        else if(!strcmp(argv[i], "-u"))
+            update = true;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    Snapshots snapshots(snapshotFile, update, imageDirectory);
+    CountingFrameBuffer display(pixels);
+    Dashboard dashboard(display);
+    uint32_t failures = 0;
+
+    failures += renderStep(dashboard, snapshots, "initial");
+
+    dashboard.update(1);
+    failures += renderStep(dashboard, snapshots, "update-1");
+
+    for(uint32_t frame = 2; frame < 60; ++frame)
+    {
+        dashboard.update(frame);
+        dashboard.screen.render();
+    }
+    failures += renderStep(dashboard, snapshots, "update-60");
+
+    // A whole sweep of the strip chart, and the wrap around
+    for(uint32_t frame = 60; frame < 400; ++frame)
+    {
+        dashboard.update(frame);
+        dashboard.screen.render();
+    }
+    failures += renderStep(dashboard, snapshots, "update-400");
+
+    failures += checkButton(dashboard, snapshots);
+
+    dashboard.tank.setVisible(false);
+    dashboard.voltage.setColor(Color16::Red);
+    failures += renderStep(dashboard, snapshots, "hidden-recolored");
+
+    failures += checkRemovedWhilePressed(dashboard.screen);
+
+    if(snapshots.save())
+    {
+        fprintf(stderr, "Can not write %s\n", snapshotFile);
+        return 1;
+    }
+
+    printf("Snapshots and incremental render checks: %s\n", failures ? "FAILED" : "ok");
+
+    if(failures)
+        return 1;
+
+    printf("%-14s %10s %12s %12s\n", "frame", "us/frame", "calls/frame", "pixels/frame");
+    benchmark(dashboard, display, "full redraw", 200, true);
+    benchmark(dashboard, display, "update", 5000, false);
+
+    return 0;
+}
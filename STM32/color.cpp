@@ -29,6 +29,18 @@ uint16_t Color16::toUInt16Rgb(uint8_t r, uint8_t g, uint8_t b)
     return ((((r)& 0xF8) << 8) | (((g) & 0xFC) << 3) | (((b) & 0xF8) >> 3));
 }
 
+uint16_t Color16::blend(uint16_t fg, uint16_t bg, uint8_t alpha)
+{
+    // The 3 components are spread over 32 bits (-----gggggg-----rrrrr------bbbbb)
+    // and blended at once, with 5 bits of alpha
+    const uint32_t a = (alpha + 4) >> 3;
+    const uint32_t f = (fg | ((uint32_t)(fg) << 16)) & 0x07E0F81F;
+    const uint32_t b = (bg | ((uint32_t)(bg) << 16)) & 0x07E0F81F;
+    const uint32_t c = (b + (((f - b)*a) >> 5)) & 0x07E0F81F;
+
+    return c | (c >> 16);
+}
+
 uint16_t Color16::toUInt16() const
 {
     return m_color;
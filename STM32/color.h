@@ -57,6 +57,15 @@ class Color16
         **/
         static uint16_t toUInt16Rgb(uint8_t r, uint8_t g, uint8_t b);
 
+        /**
+            \brief Blend two uint16_t 5-6-5 colors
+            \param fg Foreground color
+            \param bg Background color
+            \param alpha Opacity of the foreground, 0 (bg) to 255 (fg)
+            \returns uint16_t representation of the blended color
+        **/
+        static uint16_t blend(uint16_t fg, uint16_t bg, uint8_t alpha);
+
     private:
 
         uint16_t m_color;
@@ -1,7 +1,5 @@
 #include "datetime.h"
 
-#include <cstdio>
-
 DateTime::Time::Time(uint8_t _h, uint8_t _m, uint8_t _s):s(_s),m(_m),h(_h)
 {
     m += (s/60);
@@ -41,10 +39,6 @@ DateTime::Date::Date(uint8_t _d, uint8_t _m, uint16_t _y)
     :d(_d),m(_m),y(_y)
  { }
 
-DateTime::Date::Date(const Date& other)
-    : Date(other.d, other.m, other.y)
-{ }
-
 DateTime::DateTime(uint32_t epoch): m_epoch(epoch)
 {}
 
@@ -60,7 +54,7 @@ bool DateTime::operator>=(const DateTime& other) const { return !(*this < other)
 
 DateTime DateTime::operator+(const DateTime& other) const       { return DateTime(m_epoch+other.m_epoch); }
 DateTime DateTime::operator+(const DateTime::Date& date) const  { return DateTime(m_epoch+computeEpochFromDateTime(date)); }
-DateTime DateTime::operator+(const DateTime::Time& time) const  { return DateTime(m_epoch+computeEpochFromDateTime(Date(), time)); }
+DateTime DateTime::operator+(const DateTime::Time& time) const  { return DateTime(m_epoch+(uint32_t)(time.h)*3600+(uint32_t)(time.m)*60+time.s); }
 
 DateTime& DateTime::operator+=(const DateTime& other)        {  return (*this = *this + other); }
 DateTime& DateTime::operator+=(const DateTime::Date& date)   {  return (*this = *this + date);  }
@@ -76,36 +70,19 @@ DateTime::Time DateTime::getTime() const
     return computeTimeFromEpoch(m_epoch);
 }
 
-DateTime::Date DateTime::computeDateFromEpoch(uint32_t e)
+uint8_t DateTime::getDayOfWeek() const
 {
-    Date d(1, 1, 1970);
-
-    e /= (60*60*24);
-
-    while(true)
-    {
-        uint16_t days = isLeapYear(d.y)?366:365;
-
-        if(e >= days)
-            e -= days;
-        else
-            break;
-
-        ++d.y;
-    }
-
-    for(d.m = 1; d.m < 12; ++d.m)
-    {
-        uint8_t days = daysInMonth(d.m, d.y);
-        if(e >= days)
-            e -= days;
-        else
-            break;
-    }
+    return dayOfWeek(m_epoch/86400);
+}
 
-    d.d = e + 1;
+uint32_t DateTime::getEpoch() const
+{
+    return m_epoch;
+}
 
-    return d;
+DateTime::Date DateTime::computeDateFromEpoch(uint32_t e)
+{
+    return civilFromDays(e/86400);
 }
 
 DateTime::Time DateTime::computeTimeFromEpoch(uint32_t e)
@@ -125,19 +102,236 @@ DateTime::Time DateTime::computeTimeFromEpoch(uint32_t e)
 
 uint32_t DateTime::computeEpochFromDateTime(Date date, Time time)
 {
-    uint32_t days = 0;
+    return (uint32_t)(daysFromCivil(date))*86400 + (uint32_t)(time.h)*3600
+                                                 + (uint32_t)(time.m)*60
+                                                 + (uint32_t)(time.s);
+}
+
+DateTime::Date DateTime::computeDateFromEpoch64(int64_t e)
+{
+    return civilFromDays(floorDays(e));
+}
+
+DateTime::Time DateTime::computeTimeFromEpoch64(int64_t e)
+{
+    return computeTimeFromEpoch(e - (int64_t)(floorDays(e))*86400);
+}
+
+int64_t DateTime::computeEpoch64FromDateTime(const Date& date, const Time& time)
+{
+    return (int64_t)(daysFromCivil(date))*86400 + (int32_t)(time.h)*3600
+                                                + (int32_t)(time.m)*60
+                                                + (int32_t)(time.s);
+}
 
-    while(date.y > 1970)
-        days += (isLeapYear(date.y--)?366:365);
+// Days from civil and civil from days: http://howardhinnant.github.io/date_algorithms.html
+// Years start on March 1st, so that the leap day is the last day of the year.
+// An era is a 400-year cycle (146097 days), the calendar repeats itself.
+int32_t DateTime::daysFromCivil(const Date& date)
+{
+    const int32_t y     = (int32_t)(date.y) - (date.m <= 2);
+    const int32_t era   = (y >= 0 ? y : y - 399)/400;
+    const int32_t yoe   = y - era*400;                                          // [0, 399]
+    const int32_t doy   = (153*(date.m > 2 ? date.m - 3 : date.m + 9) + 2)/5 + date.d - 1;  // [0, 365]
+    const int32_t doe   = yoe*365 + yoe/4 - yoe/100 + doy;                      // [0, 146096]
+
+    return era*146097 + doe - 719468;
+}
+
+DateTime::Date DateTime::civilFromDays(int32_t days)
+{
+    const int32_t z     = days + 719468;                                        // Days since 0000-03-01
+    const int32_t era   = (z >= 0 ? z : z - 146096)/146097;
+    const uint32_t doe  = z - era*146097;                                       // [0, 146096]
+    const uint32_t yoe  = (doe - doe/1460 + doe/36524 - doe/146096)/365;        // [0, 399]
+    const uint32_t doy  = doe - (365*yoe + yoe/4 - yoe/100);                    // [0, 365]
+    const uint32_t mp   = (5*doy + 2)/153;                                      // [0, 11], from March
+
+    Date d;
+    d.d = doy - (153*mp + 2)/5 + 1;
+    d.m = mp < 10 ? mp + 3 : mp - 9;
+    d.y = (int32_t)(yoe) + era*400 + (d.m <= 2);
 
-    while(date.m > 1)
-        days += daysInMonth(--date.m);
+    return d;
+}
+
+uint8_t DateTime::dayOfWeek(int32_t days)
+{
+    // 01/01/1970 was a Thursday
+    const int32_t w = days%7;
+    return (w + (w < 0 ? 7 : 0) + 3)%7 + 1;
+}
 
-    days += (date.d-1);
+int32_t DateTime::floorDays(int64_t e)
+{
+    int64_t days = e/86400;
+    if(e%86400 < 0)
+        --days;
+
+    return days;
+}
+
+namespace
+{
+    /**
+        \brief Write a zero-padded decimal number
+        \returns Position after the number
+    **/
+    char* writeNumber(char* p, uint32_t value, uint8_t digits)
+    {
+        for(uint8_t i = digits; i > 0; --i)
+        {
+            p[i - 1] = '0' + value%10;
+            value /= 10;
+        }
+
+        return p + digits;
+    }
+
+    /**
+        \brief Read a fixed-width decimal number
+        \returns \c true on error, \c false otherwise
+    **/
+    bool readNumber(const char*& s, uint8_t digits, uint32_t& value)
+    {
+        value = 0;
+        for(uint8_t i = 0; i < digits; ++i, ++s)
+        {
+            if(*s < '0' || *s > '9')
+                return true;
+
+            value = value*10 + (*s - '0');
+        }
+
+        return false;
+    }
+}
+
+size_t DateTime::formatISO8601(int64_t e, char* buffer, size_t size, int16_t milliseconds)
+{
+    const Date date = computeDateFromEpoch64(e);
+    const Time time = computeTimeFromEpoch64(e);
+
+    const uint8_t yearDigits = (date.y > 9999) ? 5 : 4;
+    const size_t length = yearDigits + 16 + (milliseconds >= 0 ? 4 : 0);
+
+    if(size <= length)
+        return 0;
+
+    char* p = writeNumber(buffer, date.y, yearDigits);
+    *p++ = '-';
+    p = writeNumber(p, date.m, 2);
+    *p++ = '-';
+    p = writeNumber(p, date.d, 2);
+    *p++ = 'T';
+    p = writeNumber(p, time.h, 2);
+    *p++ = ':';
+    p = writeNumber(p, time.m, 2);
+    *p++ = ':';
+    p = writeNumber(p, time.s, 2);
+
+    if(milliseconds >= 0)
+    {
+        *p++ = '.';
+        p = writeNumber(p, milliseconds%1000, 3);
+    }
+
+    *p++ = 'Z';
+    *p = '\0';
+
+    return length;
+}
+
+bool DateTime::parseISO8601(const char* s, int64_t& e, uint16_t* milliseconds)
+{
+    uint32_t y, m, d, h = 0, min = 0, sec = 0, ms = 0;
+
+    if( readNumber(s, 4, y) || *s++ != '-' ||
+        readNumber(s, 2, m) || *s++ != '-' ||
+        readNumber(s, 2, d))
+        return true;
+
+    if(m < 1 || m > 12 || d < 1 || d > daysInMonth(m, y))
+        return true;
+
+    int32_t offset = 0;
+
+    if(*s == 'T' || *s == ' ')
+    {
+        ++s;
+        if(readNumber(s, 2, h) || *s++ != ':' || readNumber(s, 2, min))
+            return true;
+
+        if(*s == ':')
+        {
+            ++s;
+            if(readNumber(s, 2, sec))
+                return true;
+
+            if(*s == '.' || *s == ',')
+            {
+                ++s;
+                if(*s < '0' || *s > '9')
+                    return true;
+
+                // Milliseconds, further digits are ignored
+                for(uint32_t scale = 100; *s >= '0' && *s <= '9'; ++s, scale /= 10)
+                    ms += (*s - '0')*scale;
+            }
+        }
+
+        // 24:00:00 is the end of the day, 60 a leap second
+        if(h > 24 || min > 59 || sec > 60 || (h == 24 && (min || sec || ms)))
+            return true;
+
+        if(*s == 'Z')
+            ++s;
+        else if(*s == '+' || *s == '-')
+        {
+            const int8_t sign = (*s++ == '+') ? 1 : -1;
+            uint32_t oh, om = 0;
+
+            if(readNumber(s, 2, oh))
+                return true;
+
+            const bool colon = (*s == ':');
+            if(colon)
+                ++s;
+
+            if((*s || colon) && readNumber(s, 2, om))
+                return true;
+
+            if(oh > 23 || om > 59)
+                return true;
+
+            offset = sign*(int32_t)(oh*3600 + om*60);
+        }
+    }
+
+    if(*s)
+        return true;
+
+    e = (int64_t)(daysFromCivil(Date(d, m, y)))*86400 + (int32_t)(h*3600 + min*60 + sec) - offset;
+
+    if(milliseconds)
+        *milliseconds = ms;
+
+    return false;
+}
+
+size_t DateTime::toISO8601(char* buffer, size_t size) const
+{
+    return formatISO8601(m_epoch, buffer, size);
+}
+
+bool DateTime::fromISO8601(const char* s, DateTime& dt)
+{
+    int64_t e;
+    if(parseISO8601(s, e) || e < 0 || e > UINT32_MAX)
+        return true;
 
-    return days*86400 + (uint32_t)(time.h)*3600 
-                      + (uint32_t)(time.m)*60
-                      + (uint32_t)(time.s);
+    dt = DateTime(e);
+    return false;
 }
 
 bool DateTime::isLeapYear(uint16_t y)
@@ -2,6 +2,7 @@
 #define GUARD_DATETIME
 
 #include <cstdint>
+#include <cstddef>
 
 /**
     \brief Basic date and time class.
@@ -12,6 +13,10 @@
     dates before 01/01/1970 are invalid and may cause undefined behavior. On the other hand,
     this class will not be affected by the Y2038 overflow, since its timestamp will overflow
     around 2106.
+
+    Conversions are done in constant time (no loop over years or months), with 32-bit
+    arithmetic only for 32-bit timestamps. The static *64 functions handle signed 64-bit
+    timestamps, for the years 0 to 65535.
 **/
 class DateTime
 {
@@ -52,7 +57,8 @@ class DateTime
             \param _y Years
         **/
         Date(uint8_t _d=0, uint8_t _m=0, uint16_t _y=0);
-        Date(const Date& other);
+        Date(const Date& other) = default;
+        Date& operator=(const Date& other) = default;
 
         uint8_t d;  ///< Days
         uint8_t m;  ///< Months
@@ -95,6 +101,32 @@ class DateTime
         **/
         Time getTime() const;
 
+        /**
+            \returns The day of the week, from 1 (Monday) to 7 (Sunday), as RTC_WEEKDAY_*
+        **/
+        uint8_t getDayOfWeek() const;
+
+        /**
+            \returns Seconds since epoch
+        **/
+        uint32_t getEpoch() const;
+
+        /**
+            \brief Format as ISO-8601 (e.g. 2017-08-22T12:00:00Z)
+            \param buffer Destination buffer
+            \param size Size of the buffer, at least 21 bytes
+            \returns Length of the string, 0 if the buffer is too small
+        **/
+        size_t toISO8601(char* buffer, size_t size) const;
+
+        /**
+            \brief Parse an ISO-8601 date and time, see parseISO8601()
+            \param s String
+            \param dt Result
+            \returns \c true on error (invalid string, date out of the 1970-2106 range), \c false otherwise
+        **/
+        static bool fromISO8601(const char* s, DateTime& dt);
+
         /**
             \brief Compute a date from an Unix timestamp
             \param e Seconds since epoch
@@ -112,10 +144,72 @@ class DateTime
         /**
             \brief Compute an Unix timestamp from a date and a time
             \param date Date
-            \param 
+            \param time Time of day
         **/
         static uint32_t computeEpochFromDateTime(Date date, Time time = Time());
 
+        /**
+            \brief Compute a date from a 64-bit Unix timestamp
+            \param e Seconds since epoch (negative before 1970)
+            \returns Date
+        **/
+        static Date computeDateFromEpoch64(int64_t e);
+
+        /**
+            \brief Compute a time of day from a 64-bit Unix timestamp
+            \param e Seconds since epoch (negative before 1970)
+            \returns Time of day
+        **/
+        static Time computeTimeFromEpoch64(int64_t e);
+
+        /**
+            \brief Compute a 64-bit Unix timestamp from a date and a time
+            \param date Date
+            \param time Time of day
+            \returns Seconds since epoch (negative before 1970)
+        **/
+        static int64_t computeEpoch64FromDateTime(const Date& date, const Time& time = Time());
+
+        /**
+            \brief Count the days from 01/01/1970 to a date (proleptic Gregorian calendar)
+            \param date Date
+            \returns Number of days (negative before 1970)
+        **/
+        static int32_t daysFromCivil(const Date& date);
+
+        /**
+            \brief Compute the date a number of days after 01/01/1970
+            \param days Number of days (negative before 1970)
+            \returns Date
+        **/
+        static Date civilFromDays(int32_t days);
+
+        /**
+            \param days Number of days since 01/01/1970
+            \returns The day of the week, from 1 (Monday) to 7 (Sunday)
+        **/
+        static uint8_t dayOfWeek(int32_t days);
+
+        /**
+            \brief Format a 64-bit Unix timestamp as ISO-8601 (YYYY-MM-DDThh:mm:ss[.sss]Z)
+            \param e Seconds since epoch
+            \param buffer Destination buffer
+            \param size Size of the buffer, at least 21 bytes (25 with milliseconds, 26 after year 9999)
+            \param milliseconds Milliseconds, added as a fraction of second if not negative
+            \returns Length of the string, 0 if the buffer is too small
+        **/
+        static size_t formatISO8601(int64_t e, char* buffer, size_t size, int16_t milliseconds = -1);
+
+        /**
+            \brief Parse an ISO-8601 date and time
+            \param s String: YYYY-MM-DD, optionally followed by 'T' (or a space) and hh:mm[:ss[.sss]],
+            optionally followed by 'Z' or a UTC offset (+hh, +hh:mm or +hhmm)
+            \param e Seconds since epoch, UTC
+            \param milliseconds Fraction of second, in ms (optional)
+            \returns \c true on error, \c false otherwise
+        **/
+        static bool parseISO8601(const char* s, int64_t& e, uint16_t* milliseconds = nullptr);
+
         /**
             \param y Year to check
             \returns \c true if year is a leap year, \c false otherwise
@@ -130,6 +224,11 @@ class DateTime
         static uint8_t daysInMonth(uint8_t month, uint16_t year = 1970);
 
     private:
+        /**
+            \returns Days since epoch, rounded down (toward the past)
+        **/
+        static int32_t floorDays(int64_t e);
+
         uint32_t m_epoch;
 };
 
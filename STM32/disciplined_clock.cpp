@@ -0,0 +1,236 @@
+#include "disciplined_clock.h"
+
+#include "system.h"
+#include "exti.h"
+
+#if defined(HAL_RTC_MODULE_ENABLED)
+	#include "rtc.h"
+#endif
+
+namespace
+{
+	constexpr uint64_t	SECOND			= 1000000;
+	constexpr uint64_t	GPS_TIMEOUT		= 3*SECOND;		///< GPS time is lost after this delay without epoch
+	constexpr uint64_t	RTC_PERIOD		= SECOND;		///< Period of the RTC checks
+	constexpr uint64_t	MAX_LATENCY		= 900000;		///< Maximum reception latency of the GPS epochs
+}
+
+DisciplinedClock* DisciplinedClock::s_pps = nullptr;
+
+bool DisciplinedClock::enablePPS(Pin pin, bool risingEdge)
+{
+	if(s_pps && s_pps != this)
+		return true;
+
+	if(pin.init(risingEdge ? GPIO_MODE_IT_RISING : GPIO_MODE_IT_FALLING, GPIO_NOPULL, GPIO_SPEED_HIGH))
+		return true;
+
+	// Highest priority: the latency of the interrupt is the accuracy of the clock
+	s_pps = this;
+	if(exti.registerCallback(pin.pin(), ppsHandler, 0, 0))
+	{
+		s_pps = nullptr;
+		return true;
+	}
+
+	return false;
+}
+
+void DisciplinedClock::ppsHandler()
+{
+	const uint64_t local = System::micros();
+
+	// Not overwritten before processed, so that process() reads a consistent value
+	if(s_pps && !s_pps->m_ppsPending)
+	{
+		s_pps->m_ppsLocal	= local;
+		s_pps->m_ppsPending	= true;
+	}
+}
+
+void DisciplinedClock::addGPSEpoch(const FixHistory::Epoch& epoch)
+{
+	if(!(epoch.flags & FixHistory::HAS_TIME))
+		return;
+
+	// Epoch ticks are System::millis(): converted to the System::micros() time base
+	const uint64_t	now		= System::micros();
+	const uint64_t	age		= (uint64_t)(System::millis() - epoch.tick)*1000;
+	const uint64_t	local	= (age < now) ? now - age : 0;
+	const int64_t	utc		= (int64_t)(epoch.time)*SECOND + (int64_t)(epoch.milliseconds)*1000;
+
+	m_gpsLocal = local;
+	m_gpsValid = true;
+
+	// The pulses are more accurate, as long as they come
+	if(m_lastPPS && local - m_lastPPS < GPS_TIMEOUT)
+		return;
+
+	m_clock.synchronize(local, utc, WallClock::GPS);
+}
+
+void DisciplinedClock::process()
+{
+	if(m_ppsPending)
+	{
+		const uint64_t local = m_ppsLocal;
+		m_ppsPending = false;
+
+		// The pulse starts a second: the GPS time at that moment is known to a fraction of second, and late
+		// (reception latency of the epochs), so it is rounded up
+		int64_t utc;
+		if(	m_gpsValid && (int64_t)(local - m_gpsLocal) < (int64_t)(GPS_TIMEOUT) &&
+			(int64_t)(m_gpsLocal - local) < (int64_t)(GPS_TIMEOUT) && !m_clock.toUTC(local, utc))
+		{
+			const int64_t second = (utc + (int64_t)(MAX_LATENCY))/(int64_t)(SECOND);
+
+			m_clock.synchronize(local, second*SECOND, WallClock::PPS);
+			m_lastPPS = local;
+		}
+	}
+
+#if defined(HAL_RTC_MODULE_ENABLED)
+	const uint64_t now = System::micros();
+
+	if(m_rtcSetLocal)
+	{ // Scheduled set: no check until it is done
+		if((int64_t)(now - m_rtcSetLocal) >= 0)
+			setRTC();
+		return;
+	}
+
+	if(now - m_rtcCheck < RTC_PERIOD || !rtc.isInitialized())
+		return;
+
+	m_rtcCheck = now;
+
+	if(gpsTime())
+		disciplineRTC();
+	else
+	{ // GPS time lost: the RTC takes over
+		m_rtcMeasuring = false;
+		m_clock.synchronizeRTC();
+	}
+#endif
+}
+
+bool DisciplinedClock::gpsTime() const
+{
+	return	m_clock.source() >= WallClock::GPS &&
+			System::micros() - m_clock.lastSynchronization() < GPS_TIMEOUT;
+}
+
+void DisciplinedClock::disciplineRTC()
+{
+#if defined(HAL_RTC_MODULE_ENABLED)
+	DateTime	dt;
+	uint32_t	microseconds;
+
+	const uint64_t before = System::micros();
+	if(rtc.getDateTime(dt, microseconds))
+		return;
+
+	const uint64_t local = before + (System::micros() - before)/2;
+
+	int64_t utc;
+	if(m_clock.toUTC(local, utc))
+		return;
+
+	const int64_t error		= (int64_t)(dt.getEpoch())*SECOND + microseconds - utc;
+	const int64_t maxError	= (m_clock.source() == WallClock::PPS) ? MAX_PPS_OFFSET : MAX_GPS_OFFSET;
+
+	if(error > maxError || error < -maxError)
+	{
+#if defined(STM32F1xx)
+		// The RTC cannot be shifted: set when the next second starts, without waiting here
+		m_rtcSetLocal	= local + (SECOND - utc%SECOND);
+		m_rtcSetError	= error;
+#else
+		m_clock.toUTC(System::micros(), utc);
+		if(rtc.setDateTime(DateTime(utc/SECOND), utc%SECOND))
+			return;
+
+		rtcCorrected(error, 0);
+#endif
+		return;
+	}
+
+	if(!m_rtcMeasuring)
+	{
+		m_rtcMeasuring	= true;
+		m_rtcStartUtc	= utc;
+		m_rtcStartError	= error;
+		return;
+	}
+
+	const int64_t elapsed = utc - m_rtcStartUtc;
+	if(elapsed < (int64_t)(CALIBRATION_INTERVAL))
+		return;
+
+	m_rtcDrift = (error - m_rtcStartError)*1000000000LL/elapsed;
+	rtc.setCalibration(rtc.calibration() - m_rtcDrift);
+
+	m_rtcStartUtc	= utc;
+	m_rtcStartError	= error;
+#endif
+}
+
+void DisciplinedClock::setRTC()
+{
+#if defined(HAL_RTC_MODULE_ENABLED)
+	const uint64_t local = System::micros();
+	m_rtcSetLocal = 0;
+
+	int64_t utc;
+	if(!gpsTime() || m_clock.toUTC(local, utc))
+		return;
+
+	// Called late (main loop busy): the RTC would be that late, try the next second
+	const int64_t late = utc%SECOND;
+	if(late > MAX_SET_LATENESS)
+	{
+		m_rtcSetLocal = local + (SECOND - late);
+		return;
+	}
+
+	if(rtc.setDateTime(DateTime(utc/SECOND)))
+		return;
+
+	rtcCorrected(m_rtcSetError, -late);
+#endif
+}
+
+void DisciplinedClock::rtcCorrected(int64_t error, int64_t residual)
+{
+	// The drift measurement goes on across small corrections
+	if(error > (int64_t)(SECOND) || error < -(int64_t)(SECOND))
+		m_rtcMeasuring = false;
+	else
+		m_rtcStartError += residual - error;
+}
+
+bool DisciplinedClock::now(int64_t& utc) const
+{
+	return m_clock.now(utc);
+}
+
+bool DisciplinedClock::getDateTime(DateTime& dt, uint16_t& milliseconds) const
+{
+	int64_t utc;
+	if(now(utc) || utc < 0)
+		return true;
+
+	dt				= DateTime(utc/SECOND);
+	milliseconds	= (utc%SECOND)/1000;
+	return false;
+}
+
+const WallClock& DisciplinedClock::wallClock() const
+{
+	return m_clock;
+}
+
+int32_t DisciplinedClock::rtcDrift() const
+{
+	return m_rtcDrift;
+}
@@ -0,0 +1,128 @@
+/**
+	\file disciplined_clock.h
+	\version 1.0
+**/
+
+#ifndef GUARD_DISCIPLINED_CLOCK
+#define GUARD_DISCIPLINED_CLOCK
+
+#include "hal.h"
+#include "pin.h"
+#include "datetime.h"
+#include "fix_history.h"
+#include "wall_clock.h"
+
+/**
+	\brief Wall clock disciplined by GPS time, keeping the RTC on time
+
+	The wall clock (see WallClock) is synchronized:
+	- on the GPS time pulse (PPS) if enabled, to the microsecond. The pulse only marks the start of a second:
+	which second is given by the GPS epochs (that must be received less than 0.9 s after their time);
+	- on the GPS epochs otherwise, to the reception latency of the messages (a few tens of ms);
+	- on the RTC, when GPS time is lost.
+
+	While the GPS time is available, the RTC is compared to the wall clock: its fraction of second is set when
+	it is off by more than MAX_PPS_OFFSET (MAX_GPS_OFFSET without PPS), and its drift, measured over
+	CALIBRATION_INTERVAL, is trimmed with the smooth calibration (see RealTimeClock::setCalibration()). Once
+	disciplined, the RTC keeps devices aligned to the millisecond over hours without GPS.
+
+	On STM32F1, the RTC cannot be shifted by a fraction of second: it is set by process() when the next second
+	starts, if process() is called within MAX_SET_LATENESS of it (otherwise on a later second).
+
+	Only one instance can use the PPS.
+**/
+class DisciplinedClock
+{
+	public:
+		static constexpr uint64_t CALIBRATION_INTERVAL	= 1024000000;	///< RTC drift measurement interval, in us
+		static constexpr int64_t MAX_PPS_OFFSET			= 2000;			///< Maximum RTC error with PPS, in us
+		static constexpr int64_t MAX_GPS_OFFSET			= 50000;		///< Maximum RTC error without PPS, in us
+		static constexpr int64_t MAX_SET_LATENESS		= 500;			///< Maximum delay of an RTC set (STM32F1), in us
+
+	public:
+		/**
+			\brief Enable the GPS time pulse input
+			\param pin Pin connected to the PPS output of the receiver
+			\param risingEdge \c true if the pulse starts on the rising edge (u-blox default), \c false otherwise
+			\returns \c true on error (EXTI line used, or PPS used by another instance), \c false otherwise
+		**/
+		bool enablePPS(Pin pin, bool risingEdge = true);
+
+		/**
+			\brief Add a GPS epoch (e.g. GPS::history()[0] when GPS::process() returns \c true)
+			\param epoch Epoch, ignored if it has no time
+		**/
+		void addGPSEpoch(const FixHistory::Epoch& epoch);
+
+		/**
+			\brief Process the time pulses and discipline the RTC, to be called regularly (main loop)
+		**/
+		void process();
+
+		/**
+			\param utc Current UTC time, in us since epoch
+			\returns \c true on error (no time source yet), \c false otherwise
+		**/
+		bool now(int64_t& utc) const;
+
+		/**
+			\brief Get the current date and time
+			\param dt Date and time
+			\param milliseconds Milliseconds
+			\returns \c true on error (no time source yet), \c false otherwise
+		**/
+		bool getDateTime(DateTime& dt, uint16_t& milliseconds) const;
+
+		/**
+			\returns The wall clock, to convert local timestamps (System::micros()) to UTC
+		**/
+		const WallClock& wallClock() const;
+
+		/**
+			\returns The latest measured RTC drift, before correction, in ppb (positive if it was fast)
+		**/
+		int32_t rtcDrift() const;
+
+	private:
+		static void ppsHandler();
+
+		/**
+			\returns \c true if the wall clock was synchronized on GPS time recently
+		**/
+		bool gpsTime() const;
+
+		void disciplineRTC();
+
+		/**
+			\brief Set the RTC at the scheduled second (STM32F1)
+		**/
+		void setRTC();
+
+		/**
+			\brief Carry the drift measurement across an RTC correction
+			\param error RTC error before the correction, in us
+			\param residual RTC error after the correction, in us
+		**/
+		void rtcCorrected(int64_t error, int64_t residual);
+
+		static DisciplinedClock* s_pps;	///< Instance using the PPS
+
+		WallClock			m_clock;
+
+		volatile uint64_t	m_ppsLocal		= 0;		///< Local time of the latest pulse
+		volatile bool		m_ppsPending	= false;	///< m_ppsLocal not processed yet
+		uint64_t			m_lastPPS		= 0;		///< Local time of the latest valid pulse
+
+		uint64_t			m_gpsLocal		= 0;		///< Local time of the latest GPS epoch
+		bool				m_gpsValid		= false;
+
+		uint64_t			m_rtcCheck		= 0;		///< Local time of the latest RTC check
+		bool				m_rtcMeasuring	= false;
+		int64_t				m_rtcStartUtc	= 0;		///< Start of the drift measurement
+		int64_t				m_rtcStartError	= 0;		///< RTC error at the start of the drift measurement, in us
+		int32_t				m_rtcDrift		= 0;
+		uint64_t			m_rtcSetLocal	= 0;		///< Local time of the second the RTC is set at, 0 if none
+		int64_t				m_rtcSetError	= 0;		///< RTC error when the set was scheduled
+};
+
+#endif
@@ -35,8 +35,6 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include <cmath>
 #include <algorithm>
-#include <cstdio>
-#include "system.h"
 
 extern const unsigned char glcdfont_font[];
 
@@ -56,12 +54,100 @@ void Display::setSize(Point2D s)
     m_size = s;
 }
 
+// Cohen-Sutherland region codes
+static const uint8_t OUT_LEFT   = 0x1;
+static const uint8_t OUT_RIGHT  = 0x2;
+static const uint8_t OUT_TOP    = 0x4;
+static const uint8_t OUT_BOTTOM = 0x8;
+
+uint8_t Display::outCode(int32_t x, int32_t y) const
+{
+    uint8_t code = 0;
+
+    if(x < 0)
+        code |= OUT_LEFT;
+    else if(x >= m_size.x())
+        code |= OUT_RIGHT;
+
+    if(y < 0)
+        code |= OUT_TOP;
+    else if(y >= m_size.y())
+        code |= OUT_BOTTOM;
+
+    return code;
+}
+
+void Display::writeClippedPixel(int32_t x, int32_t y, uint16_t color)
+{
+    if(x >= 0 && x < m_size.x() && y >= 0 && y < m_size.y())
+        writePixel(x, y, color);
+}
+
+// Span from x0 to x1 (inclusive, x0 <= x1)
+void Display::writeClippedHLine(int32_t x0, int32_t x1, int32_t y, uint16_t color)
+{
+    if(y < 0 || y >= m_size.y())
+        return;
+
+    if(x0 < 0)
+        x0 = 0;
+    if(x1 >= m_size.x())
+        x1 = m_size.x() - 1;
+
+    if(x0 == x1)
+        writePixel(x0, y, color);
+    else if(x0 < x1)
+        writeFastHLine(x0, y, x1 - x0 + 1, color);
+}
+
+// Span from y0 to y1 (inclusive, y0 <= y1)
+void Display::writeClippedVLine(int32_t x, int32_t y0, int32_t y1, uint16_t color)
+{
+    if(x < 0 || x >= m_size.x())
+        return;
+
+    if(y0 < 0)
+        y0 = 0;
+    if(y1 >= m_size.y())
+        y1 = m_size.y() - 1;
+
+    if(y0 == y1)
+        writePixel(x, y0, color);
+    else if(y0 < y1)
+        writeFastVLine(x, y0, y1 - y0 + 1, color);
+}
+
+// Rectangle from (x0, y0) to (x1, y1) (inclusive, x0 <= x1, y0 <= y1)
+void Display::writeClippedRect(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint16_t color)
+{
+    if(x0 < 0)
+        x0 = 0;
+    if(y0 < 0)
+        y0 = 0;
+    if(x1 >= m_size.x())
+        x1 = m_size.x() - 1;
+    if(y1 >= m_size.y())
+        y1 = m_size.y() - 1;
+
+    if(x0 <= x1 && y0 <= y1)
+        writeFillRect(x0, y0, x1 - x0 + 1, y1 - y0 + 1, color);
+}
+
 // Bresenham's algorithm - thx wikpedia
+// Clipped once against the screen (the pixels are the same as the unclipped line's),
+// runs of pixels along the major axis are sent as spans.
 void Display::writeLine(int16_t x0, int16_t y0,
                         int16_t x1, int16_t y1,
                         uint16_t color)
 {
-    int16_t steep = std::abs(y1 - y0) > std::abs(x1 - x0);
+    const uint8_t code0 = outCode(x0, y0);
+    const uint8_t code1 = outCode(x1, y1);
+
+    // Both ends on the same outer side: trivially rejected
+    if(code0 & code1)
+        return;
+
+    const bool steep = std::abs(y1 - y0) > std::abs(x1 - x0);
     if (steep)
     {
         std::swap(x0, y0);
@@ -74,24 +160,82 @@ void Display::writeLine(int16_t x0, int16_t y0,
         std::swap(y0, y1);
     }
 
-    int16_t dx, dy;
-    dx = x1 - x0;
-    dy = std::abs(y1 - y0);
+    const int32_t dx    = x1 - x0;
+    const int32_t dy    = std::abs(y1 - y0);
+    const int32_t ystep = (y0 < y1)?1:-1;
+    const int32_t half  = dx / 2;
 
-    int16_t err = dx / 2;
-    int16_t ystep = (y0 < y1)?1:-1;
+    // Range of steps along the major axis to draw
+    int32_t first = 0;
+    int32_t last  = dx;
 
-    for (; x0<=x1; ++x0)
+    if(code0 | code1)
     {
-        if (steep)
-            writePixel(y0, x0, color);
+        const int32_t majorMax = (steep ? m_size.y() : m_size.x()) - 1;
+        const int32_t minorMax = (steep ? m_size.x() : m_size.y()) - 1;
+
+        first = std::max<int32_t>(first, -x0);
+        last  = std::min<int32_t>(last,  majorMax - x0);
+
+        // After k steps the minor coordinate moved n(k) = max(0, ceil((k*dy - dx/2) / dx)),
+        // it must stay in [low, high]
+        const int32_t low  = (ystep > 0) ? -y0 : y0 - minorMax;
+        const int32_t high = (ystep > 0) ? minorMax - y0 : y0;
+
+        if(high < 0)
+            return;
+
+        if(dy == 0)
+        {
+            if(low > 0)
+                return;
+        }
         else
-            writePixel(x0, y0, color);
+        {
+            if(low > 0)
+                first = std::max<int32_t>(first, ((int64_t)(low - 1)*dx + half) / dy + 1);
+
+            last = std::min<int32_t>(last, ((int64_t)(high)*dx + half) / dy);
+        }
+
+        if(first > last)
+            return;
+    }
+
+    // Bresenham's state after 'first' steps
+    int32_t n = 0;
+    if((int64_t)(first)*dy > half)
+        n = ((int64_t)(first)*dy - half + dx - 1) / dx;
 
+    int32_t err = half - (int64_t)(first)*dy + (int64_t)(n)*dx;
+    int32_t y   = y0 + ystep*n;
+
+    const int32_t xEnd  = x0 + last;
+    int32_t       start = x0 + first;
+
+    for (int32_t x = start; x <= xEnd; ++x)
+    {
         err -= dy;
+        if (err < 0 || x == xEnd)
+        { // Minor coordinate changes after this pixel: draw the run
+            if (start == x)
+            {
+                if (steep)
+                    writePixel(y, x, color);
+                else
+                    writePixel(x, y, color);
+            }
+            else if (steep)
+                writeFastVLine(y, start, x - start + 1, color);
+            else
+                writeFastHLine(start, y, x - start + 1, color);
+
+            start = x + 1;
+        }
+
         if (err < 0)
         {
-            y0 += ystep;
+            y   += ystep;
             err += dx;
         }
     }
@@ -208,49 +352,43 @@ void Display::drawLine(    int16_t x0, int16_t y0,
 }
 
 
-// Draw a circle outline
-void Display::drawCircle(  int16_t x0, int16_t y0, int16_t r,
-                           uint16_t color)
+// Midpoint circle: calls span(x0, x1, y) for the runs of the first octant
+// (x from x0 to x1 at height y, x >= 1, y >= x)
+template<typename Span>
+static void circleRuns(int16_t r, Span span)
 {
-    int16_t f = 1 - r;
+    int16_t f     = 1 - r;
     int16_t ddF_x = 1;
     int16_t ddF_y = -2 * r;
-    int16_t x = 0;
-    int16_t y = r;
-
-    startWrite();
-    writePixel(x0  , y0+r, color);
-    writePixel(x0  , y0-r, color);
-    writePixel(x0+r, y0  , color);
-    writePixel(x0-r, y0  , color);
+    int16_t x     = 0;
+    int16_t y     = r;
+    int16_t start = 1;
 
     while (x<y)
     {
         if (f >= 0)
         {
+            if (start <= x)
+                span(start, x, y);
+            start = x + 1;
+
             --y;
             ddF_y += 2;
-            f += ddF_y;
+            f     += ddF_y;
         }
         ++x;
         ddF_x += 2;
-        f += ddF_x;
-
-        writePixel(x0 + x, y0 + y, color);
-        writePixel(x0 - x, y0 + y, color);
-        writePixel(x0 + x, y0 - y, color);
-        writePixel(x0 - x, y0 - y, color);
-        writePixel(x0 + y, y0 + x, color);
-        writePixel(x0 - y, y0 + x, color);
-        writePixel(x0 + y, y0 - x, color);
-        writePixel(x0 - y, y0 - x, color);
+        f     += ddF_x;
     }
-    endWrite();
+
+    if (start <= x)
+        span(start, x, y);
 }
 
-void Display::drawCircleHelper(int16_t x0, int16_t y0,
-                               int16_t r, uint8_t cornername,
-                               uint16_t color)
+// Midpoint circle: calls row(t, w) with the half width w of the filled circle at
+// t rows from the center, for t = 1..r. A row may be reported more than once.
+template<typename Row>
+static void circleRows(int16_t r, Row row)
 {
     int16_t f     = 1 - r;
     int16_t ddF_x = 1;
@@ -262,6 +400,8 @@ void Display::drawCircleHelper(int16_t x0, int16_t y0,
     {
         if (f >= 0)
         {
+            row(y, x);      // Last (widest) run at this height
+
             --y;
             ddF_y += 2;
             f     += ddF_y;
@@ -270,72 +410,104 @@ void Display::drawCircleHelper(int16_t x0, int16_t y0,
         ddF_x += 2;
         f     += ddF_x;
 
+        row(x, y);
+    }
+
+    if (y > 0)
+        row(y, x);
+}
+
+// Draw a circle outline
+void Display::drawCircle(  int16_t x0, int16_t y0, int16_t r,
+                           uint16_t color)
+{
+    startWrite();
+    writeClippedPixel(x0  , y0+r, color);
+    writeClippedPixel(x0  , y0-r, color);
+    writeClippedPixel(x0+r, y0  , color);
+    writeClippedPixel(x0-r, y0  , color);
+    drawCircleHelper(x0, y0, r, 0xF, color);
+    endWrite();
+}
+
+void Display::drawCircleHelper(int16_t x0, int16_t y0,
+                               int16_t r, uint8_t cornername,
+                               uint16_t color)
+{
+    // Off screen?
+    if( x0 + r < 0 || x0 - r >= m_size.x() ||
+        y0 + r < 0 || y0 - r >= m_size.y())
+        return;
+
+    // Horizontal runs near the top and bottom, vertical runs near the sides
+    circleRuns(r, [&](int32_t a, int32_t b, int32_t y)
+    {
         if (cornername & 0x4)
         {
-            writePixel(x0 + x, y0 + y, color);
-            writePixel(x0 + y, y0 + x, color);
+            writeClippedHLine(x0 + a, x0 + b, y0 + y, color);
+            writeClippedVLine(x0 + y, y0 + a, y0 + b, color);
         }
         if (cornername & 0x2)
         {
-            writePixel(x0 + x, y0 - y, color);
-            writePixel(x0 + y, y0 - x, color);
+            writeClippedHLine(x0 + a, x0 + b, y0 - y, color);
+            writeClippedVLine(x0 + y, y0 - b, y0 - a, color);
         }
         if (cornername & 0x8)
         {
-            writePixel(x0 - y, y0 + x, color);
-            writePixel(x0 - x, y0 + y, color);
+            writeClippedVLine(x0 - y, y0 + a, y0 + b, color);
+            writeClippedHLine(x0 - b, x0 - a, y0 + y, color);
         }
         if (cornername & 0x1)
         {
-            writePixel(x0 - y, y0 - x, color);
-            writePixel(x0 - x, y0 - y, color);
+            writeClippedVLine(x0 - y, y0 - b, y0 - a, color);
+            writeClippedHLine(x0 - b, x0 - a, y0 - y, color);
         }
-    }
+    });
 }
 
 void Display::fillCircle(  int16_t x0, int16_t y0,
                            int16_t r,  uint16_t color)
 {
+    if( x0 + r < 0 || x0 - r >= m_size.x() ||
+        y0 + r < 0 || y0 - r >= m_size.y())
+        return;
+
     startWrite();
-    writeFastVLine(x0, y0-r, 2*r+1, color);
-    fillCircleHelper(x0, y0, r, 3, 0, color);
+    writeClippedHLine(x0-r, x0+r, y0, color);
+
+    circleRows(r, [&](int32_t t, int32_t w)
+    {
+        writeClippedHLine(x0-w, x0+w, y0-t, color);
+        writeClippedHLine(x0-w, x0+w, y0+t, color);
+    });
     endWrite();
 }
 
 // Used to do circles and roundrects
+// Right (cornername & 0x1) and/or left (cornername & 0x2) half of a filled circle,
+// without the center column, stretched down by 'delta' rows. Drawn as horizontal spans.
 void Display::fillCircleHelper(int16_t x0, int16_t y0, int16_t r,
                                uint8_t cornername, int16_t delta, uint16_t color)
 {
+    if(r <= 0)
+        return;
 
-    int16_t f     = 1 - r;
-    int16_t ddF_x = 1;
-    int16_t ddF_y = -2 * r;
-    int16_t x     = 0;
-    int16_t y     = r;
-
-    while (x<y)
+    auto halfSpans = [&](int32_t y, int32_t w)
     {
-        if (f >= 0)
-        {
-            --y;
-            ddF_y += 2;
-            f     += ddF_y;
-        }
-        ++x;
-        ddF_x += 2;
-        f     += ddF_x;
-
         if (cornername & 0x1)
-        {
-            writeFastVLine(x0+x, y0-y, 2*y+1+delta, color);
-            writeFastVLine(x0+y, y0-x, 2*x+1+delta, color);
-        }
+            writeClippedHLine(x0+1, x0+w, y, color);
         if (cornername & 0x2)
-        {
-            writeFastVLine(x0-x, y0-y, 2*y+1+delta, color);
-            writeFastVLine(x0-y, y0-x, 2*x+1+delta, color);
-        }
-    }
+            writeClippedHLine(x0-w, x0-1, y, color);
+    };
+
+    for (int32_t y = y0; y <= y0 + delta; ++y)
+        halfSpans(y, r);
+
+    circleRows(r, [&](int32_t t, int32_t w)
+    {
+        halfSpans(y0 - t, w);
+        halfSpans(y0 + delta + t, w);
+    });
 }
 
 // Draw a rectangle
@@ -343,11 +515,14 @@ void Display::drawRect(int16_t x, int16_t y,
                        int16_t w, int16_t h,
                        uint16_t color)
 {
+    if(w <= 0 || h <= 0)
+        return;
+
     startWrite();
-    writeFastHLine(x, y, w, color);
-    writeFastHLine(x, y+h-1, w, color);
-    writeFastVLine(x, y, h, color);
-    writeFastVLine(x+w-1, y, h, color);
+    writeClippedHLine(x,     x+w-1, y,     color);
+    writeClippedHLine(x,     x+w-1, y+h-1, color);
+    writeClippedVLine(x,     y,     y+h-1, color);
+    writeClippedVLine(x+w-1, y,     y+h-1, color);
     endWrite();
 }
 
@@ -355,12 +530,16 @@ void Display::drawRect(int16_t x, int16_t y,
 void Display::drawRoundRect(int16_t x, int16_t y, int16_t w,
                             int16_t h, int16_t r, uint16_t color)
 {
+    const int16_t maxRadius = ((w < h) ? w : h) / 2;
+    if(r > maxRadius)
+        r = maxRadius;
+
     // smarter version
     startWrite();
-    writeFastHLine(x+r  , y    , w-2*r, color); // Top
-    writeFastHLine(x+r  , y+h-1, w-2*r, color); // Bottom
-    writeFastVLine(x    , y+r  , h-2*r, color); // Left
-    writeFastVLine(x+w-1, y+r  , h-2*r, color); // Right
+    writeClippedHLine(x+r  , x+w-r-1, y    , color); // Top
+    writeClippedHLine(x+r  , x+w-r-1, y+h-1, color); // Bottom
+    writeClippedVLine(x    , y+r, y+h-r-1  , color); // Left
+    writeClippedVLine(x+w-1, y+r, y+h-r-1  , color); // Right
     // draw four corners
     drawCircleHelper(x+r    , y+r    , r, 1, color);
     drawCircleHelper(x+w-r-1, y+r    , r, 2, color);
@@ -373,13 +552,22 @@ void Display::drawRoundRect(int16_t x, int16_t y, int16_t w,
 void Display::fillRoundRect(int16_t x, int16_t y, int16_t w,
                             int16_t h, int16_t r, uint16_t color)
 {
-    // smarter version
+    if(w <= 0 || h <= 0)
+        return;
+
+    const int16_t maxRadius = ((w < h) ? w : h) / 2;
+    if(r > maxRadius)
+        r = maxRadius;
+
+    // One span per row: the corners extend the middle part
     startWrite();
-    writeFillRect(x+r, y, w-2*r, h, color);
+    writeClippedRect(x, y+r, x+w-1, y+h-r-1, color);
 
-    // draw four corners
-    fillCircleHelper(x+w-r-1, y+r, r, 1, h-2*r-1, color);
-    fillCircleHelper(x+r    , y+r, r, 2, h-2*r-1, color);
+    circleRows(r, [&](int32_t t, int32_t cw)
+    {
+        writeClippedHLine(x+r-cw, x+w-r-1+cw, y+r-t    , color);
+        writeClippedHLine(x+r-cw, x+w-r-1+cw, y+h-r-1+t, color);
+    });
     endWrite();
 }
 
@@ -401,7 +589,7 @@ void Display::fillTriangle( int16_t x0, int16_t y0,
                             uint16_t color)
 {
 
-    int16_t a, b, y, last;
+    int32_t a, b, y, last;
 
     // Sort coordinates by Y order (y2 >= y1 >= y0)
     if (y0 > y1)
@@ -420,6 +608,10 @@ void Display::fillTriangle( int16_t x0, int16_t y0,
         std::swap(x0, x1);
     }
 
+    // Off screen?
+    if(outCode(x0, y0) & outCode(x1, y1) & outCode(x2, y2))
+        return;
+
     startWrite();
     if(y0 == y2)
     { // Handle awkward all-on-same-line case as its own thing
@@ -433,19 +625,22 @@ void Display::fillTriangle( int16_t x0, int16_t y0,
             a = x2;
         else if(x2 > b)
             b = x2;
-        writeFastHLine(a, y0, b-a+1, color);
+        writeClippedHLine(a, b, y0, color);
         endWrite();
         return;
     }
 
-    int16_t dx01 = x1 - x0;
-    int16_t dy01 = y1 - y0;
-    int16_t dx02 = x2 - x0;
-    int16_t dy02 = y2 - y0;
-    int16_t dx12 = x2 - x1;
-    int16_t dy12 = y2 - y1;
-    int32_t sa   = 0;
-    int32_t sb   = 0;
+    const int32_t dx01 = x1 - x0;
+    const int32_t dy01 = y1 - y0;
+    const int32_t dx02 = x2 - x0;
+    const int32_t dy02 = y2 - y0;
+    const int32_t dx12 = x2 - x1;
+    const int32_t dy12 = y2 - y1;
+    int32_t sa;
+    int32_t sb;
+
+    // Scanlines outside the screen are skipped
+    const int32_t yMax = std::min<int32_t>(y2, m_size.y() - 1);
 
     // For upper part of triangle, find scanline crossings for segments
     // 0-1 and 0-2.  If y1=y2 (flat-bottomed triangle), the scanline y1
@@ -458,7 +653,14 @@ void Display::fillTriangle( int16_t x0, int16_t y0,
     else
         last = y1-1; // Skip it
 
-    for(y=y0; y<=last; ++y)
+    if(last > yMax)
+        last = yMax;
+
+    y  = std::max<int32_t>(y0, 0);
+    sa = dx01 * (y - y0);
+    sb = dx02 * (y - y0);
+
+    for(; y<=last; ++y)
     {
         a   = x0 + sa / dy01;
         b   = x0 + sb / dy02;
@@ -471,14 +673,15 @@ void Display::fillTriangle( int16_t x0, int16_t y0,
         if(a > b)
             std::swap(a,b);
 
-        writeFastHLine(a, y, b-a+1, color);
+        writeClippedHLine(a, b, y, color);
     }
 
     // For lower part of triangle, find scanline crossings for segments
     // 0-2 and 1-2.  This loop is skipped if y1=y2.
+    y  = std::max<int32_t>((y1 == y2) ? y2 + 1 : y1, 0);
     sa = dx12 * (y - y1);
     sb = dx02 * (y - y0);
-    for(; y<=y2; ++y)
+    for(; y<=yMax; ++y)
     {
         a   = x1 + sa / dy12;
         b   = x0 + sb / dy02;
@@ -491,7 +694,132 @@ void Display::fillTriangle( int16_t x0, int16_t y0,
         if(a > b)
             std::swap(a,b);
 
-        writeFastHLine(a, y, b-a+1, color);
+        writeClippedHLine(a, b, y, color);
+    }
+    endWrite();
+}
+
+// Integer square root (rounded down)
+static uint32_t isqrt(uint64_t v)
+{
+    uint64_t result = 0;
+    uint64_t bit    = (uint64_t)(1) << 62;
+
+    while(bit > v)
+        bit >>= 2;
+
+    while(bit)
+    {
+        if(v >= result + bit)
+        {
+            v      -= result + bit;
+            result  = (result >> 1) + bit;
+        }
+        else
+            result >>= 1;
+
+        bit >>= 2;
+    }
+
+    return result;
+}
+
+// Xiaolin Wu's line, 16.16 fixed point
+void Display::drawLineAA(  int16_t x0, int16_t y0,
+                           int16_t x1, int16_t y1,
+                           uint16_t color, uint16_t bg)
+{
+    if(outCode(x0, y0) & outCode(x1, y1))
+        return;
+
+    const bool steep = std::abs(y1 - y0) > std::abs(x1 - x0);
+    if (steep)
+    {
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+    }
+
+    if (x0 > x1)
+    {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+    }
+
+    const int32_t dx       = x1 - x0;
+    const int32_t gradient = dx ? ((int64_t)(y1 - y0)*65536) / dx : 0;
+
+    // Only the steps along the major axis that are on screen
+    const int32_t majorMax = (steep ? m_size.y() : m_size.x()) - 1;
+    const int32_t first    = std::max<int32_t>(0, -x0);
+    const int32_t last     = std::min<int32_t>(dx, majorMax - x0);
+
+    // Exact position of the line, centered on the pixels
+    int32_t y = (int32_t)(y0)*65536 + (int64_t)(gradient)*first;
+
+    auto plot = [&](int32_t major, int32_t minor, uint8_t alpha)
+    {
+        if(alpha == 0)
+            return;
+
+        const uint16_t c = (alpha == 0xFF) ? color : Color16::blend(color, bg, alpha);
+
+        if(steep)
+            writeClippedPixel(minor, major, c);
+        else
+            writeClippedPixel(major, minor, c);
+    };
+
+    startWrite();
+    for(int32_t x = x0 + first; x <= x0 + last; ++x, y += gradient)
+    {
+        const uint8_t fraction = (y >> 8) & 0xFF;
+
+        plot(x, y >> 16,        0xFF - fraction);
+        plot(x, (y >> 16) + 1,  fraction);
+    }
+    endWrite();
+}
+
+// Wu's circle: two pixels per step, weighted by the distance to the exact radius
+void Display::drawCircleAA(int16_t x0, int16_t y0, int16_t r,
+                           uint16_t color, uint16_t bg)
+{
+    if( r < 0 ||
+        x0 + r + 1 < 0 || x0 - r - 1 >= m_size.x() ||
+        y0 + r + 1 < 0 || y0 - r - 1 >= m_size.y())
+        return;
+
+    auto plot8 = [&](int32_t x, int32_t y, uint8_t alpha)
+    {
+        if(alpha == 0)
+            return;
+
+        const uint16_t c = (alpha == 0xFF) ? color : Color16::blend(color, bg, alpha);
+
+        writeClippedPixel(x0 + x, y0 + y, c);
+        writeClippedPixel(x0 - x, y0 + y, c);
+        writeClippedPixel(x0 + x, y0 - y, c);
+        writeClippedPixel(x0 - x, y0 - y, c);
+        writeClippedPixel(x0 + y, y0 + x, c);
+        writeClippedPixel(x0 - y, y0 + x, c);
+        writeClippedPixel(x0 + y, y0 - x, c);
+        writeClippedPixel(x0 - y, y0 - x, c);
+    };
+
+    const uint64_t r2 = (uint64_t)(r)*r;
+
+    startWrite();
+    for(int32_t x = 0; x <= r; ++x)
+    {
+        // Exact height of the circle at x, 24.8 fixed point
+        const uint32_t y = isqrt((r2 - (uint64_t)(x)*x) << 16);
+        if((int32_t)(y >> 8) < x)
+            break;
+
+        const uint8_t fraction = y & 0xFF;
+
+        plot8(x, y >> 8,       0xFF - fraction);
+        plot8(x, (y >> 8) + 1, fraction);
     }
     endWrite();
 }
@@ -686,8 +1014,200 @@ void Display::drawChar( int16_t x, int16_t y, unsigned char c,
     } // End classic vs custom font
 }
 
+void Display::drawGlyph(int16_t x, int16_t y, uint32_t codePoint,
+                        uint16_t color, uint16_t bg, uint8_t size)
+{
+    const RLEGlyph* glyph = findGlyph(rleFont, codePoint);
+    if(!glyph)
+        return;
+
+    const uint8_t* data  = rleFont->bitmap + glyph->bitmapOffset;
+    const uint8_t  bpp   = rleFont->bpp;
+    const uint8_t  max   = (1 << bpp) - 1;
+    const uint8_t  scale = 0xFF / max;     // Level to alpha
+
+    const int16_t w  = glyph->width;
+    const int32_t x0 = x + glyph->xOffset*size;
+    const int32_t y0 = y + glyph->yOffset*size;
+
+    // Off screen?
+    if( x0 >= m_size.x() || x0 + w*size <= 0 ||
+        y0 >= m_size.y() || y0 + glyph->height*size <= 0)
+        return;
+
+    uint32_t remaining = (uint32_t)(glyph->width)*glyph->height;
+    int16_t  gx = 0;
+    int16_t  gy = 0;
+
+    // Draw (or skip) n pixels, as one clipped span per glyph row
+    auto span = [&](uint32_t n, bool draw, uint16_t c)
+    {
+        while(n)
+        {
+            int16_t len = w - gx;
+            if(n < (uint32_t)(len))
+                len = n;
+
+            if(draw)
+            {
+                if(size == 1)
+                    writeClippedHLine(x0+gx, x0+gx+len-1, y0+gy, c);
+                else
+                    writeClippedRect(x0+gx*size, y0+gy*size, x0+(gx+len)*size-1, y0+(gy+1)*size-1, c);
+            }
+
+            n  -= len;
+            gx += len;
+            if(gx >= w)
+            {
+                gx = 0;
+                ++gy;
+            }
+        }
+    };
+
+    startWrite();
+    while(remaining)
+    {
+        const uint8_t op = *(data++);
+        uint32_t n = (op & 0x3F) + 1;
+        if(n > remaining)
+            n = remaining;
+
+        remaining -= n;
+
+        switch(op >> 6)
+        {
+            case 0: // Transparent run
+                span(n, false, 0);
+                break;
+
+            case 1: // Opaque run
+                span(n, true, color);
+                break;
+
+            default: // Literal pixels
+            {
+                uint8_t bits  = 0;
+                uint8_t avail = 0;
+
+                for(uint32_t i = 0; i < n; ++i)
+                {
+                    if(!avail)
+                    {
+                        bits  = *(data++);
+                        avail = 8;
+                    }
+
+                    avail -= bpp;
+                    const uint8_t level = (bits >> avail) & max;
+
+                    if(level == 0)
+                        span(1, false, 0);
+                    else if(level == max || (bg == color && level >= (max+1)/2))
+                        span(1, true, color);
+                    else if(bg != color)
+                        span(1, true, Color16::blend(color, bg, level*scale));
+                    else
+                        span(1, false, 0);
+                }
+                break;
+            }
+        }
+    }
+    endWrite();
+}
+
+const RLEGlyph* Display::findGlyph(const RLEFont* font, uint32_t codePoint)
+{
+    if(!font)
+        return nullptr;
+
+    // Binary search in the (sorted) ranges
+    int32_t low  = 0;
+    int32_t high = font->rangeCount - 1;
+
+    while(low <= high)
+    {
+        const int32_t   mid = (low + high) / 2;
+        const RLERange& r   = font->range[mid];
+
+        if(codePoint < r.first)
+            high = mid - 1;
+        else if(codePoint >= r.first + r.count)
+            low = mid + 1;
+        else
+            return font->glyph + r.glyph + (codePoint - r.first);
+    }
+
+    return nullptr;
+}
+
+void Display::writeCodePoint(uint32_t codePoint)
+{
+    if(codePoint == '\n')
+    {
+        cursor_x  = 0;
+        cursor_y += textsize*rleFont->yAdvance;
+        return;
+    }
+
+    if(codePoint == '\r')
+        return;
+
+    const RLEGlyph* glyph = findGlyph(rleFont, codePoint);
+    if(!glyph)
+        return;
+
+    if(wrap && (cursor_x + textsize*(glyph->xOffset + glyph->width)) > m_size.x())
+    { // Heading off edge?
+        cursor_x  = 0;
+        cursor_y += textsize*rleFont->yAdvance;
+    }
+
+    drawGlyph(cursor_x, cursor_y, codePoint, textcolor, textbgcolor, textsize);
+    cursor_x += textsize*glyph->xAdvance;
+}
+
 size_t Display::write(uint8_t c)
 {
+    if(rleFont)
+    { // UTF-8 decoding
+        if(c < 0x80)
+        {
+            utf8Remaining = 0;
+            writeCodePoint(c);
+        }
+        else if((c & 0xC0) == 0x80)
+        { // Continuation byte
+            if(utf8Remaining)
+            {
+                utf8CodePoint = (utf8CodePoint << 6) | (c & 0x3F);
+                if(--utf8Remaining == 0)
+                    writeCodePoint(utf8CodePoint);
+            }
+        }
+        else if((c & 0xE0) == 0xC0)
+        {
+            utf8CodePoint = c & 0x1F;
+            utf8Remaining = 1;
+        }
+        else if((c & 0xF0) == 0xE0)
+        {
+            utf8CodePoint = c & 0x0F;
+            utf8Remaining = 2;
+        }
+        else if((c & 0xF8) == 0xF0)
+        {
+            utf8CodePoint = c & 0x07;
+            utf8Remaining = 3;
+        }
+        else
+            utf8Remaining = 0;
+
+        return 1;
+    }
+
     if(c == '\n')
     {
         cursor_y += textsize*8;
@@ -798,6 +1318,15 @@ void Display::cp437(bool x)
 
 void Display::setFont(const GFXfont *f)
 {
+    if(rleFont)
+    { // Custom font to custom font: the cursor is already on the baseline
+        rleFont = nullptr;
+        if(!f)
+            cursor_y -= 6;
+        gfxFont = (GFXfont *)f;
+        return;
+    }
+
     if(f)
     {          // Font struct pointer passed in?
         if(!gfxFont)
@@ -816,6 +1345,21 @@ void Display::setFont(const GFXfont *f)
     gfxFont = (GFXfont *)f;
 }
 
+void Display::setCompressedFont(const RLEFont *f)
+{
+    const bool customFont = gfxFont || rleFont;
+
+    // Same baseline handling as setFont()
+    if(f && !customFont)
+        cursor_y += 6;
+    else if(!f && customFont)
+        cursor_y -= 6;
+
+    gfxFont       = nullptr;
+    rleFont       = f;
+    utf8Remaining = 0;
+}
+
 // Pass string and a cursor position, returns UL corner and W,H.
 void Display::getTextBounds(char *str, int16_t x, int16_t y,
                             int16_t *x1, int16_t *y1, uint16_t *w, uint16_t *h)
@@ -938,11 +1482,17 @@ int16_t Display::height() const
     return m_size.y();
 }
 
-void Display::invertDisplay(bool i)
+void Display::invertDisplay(bool)
 {
     // Do nothing, must be subclassed if supported by hardware
 }
 
+bool Display::setHorizontalScroll(int16_t)
+{
+    // Must be subclassed if supported by hardware
+    return true;
+}
+
 Point2D Display::orient(const Point2D& p)
 {
     switch(orientation())
@@ -957,122 +1507,3 @@ Point2D Display::orient(const Point2D& p)
             return p;
     }
 }
-
-
-uint32_t Display::doBenchmark()
-{
-    uint32_t start = System::millis();
-
-    const uint32_t sx = size().x();
-    const uint32_t sy = size().y();
-
-    for(uint32_t k = 0, km = 300; k<km; ++k)
-    {
-        const uint32_t thd = sx/3;
-
-        volatile uint16_t r = Color16::Red;
-        volatile uint16_t g = Color16::Green;
-        volatile uint16_t b = Color16::Blue;
-
-        fillRect(0,     0, thd, sy, Color16::Red);
-        fillRect(thd,   0, thd, sy, Color16::Green);
-        fillRect(thd*2, 0, thd, sy, Color16::Blue);
-        
-        drawLine(sx/2, sy/2, sx/2 + 50*cos(2*3.14*(float)(k*5)/(float)(km)), sy/2 + 50*sin(2*3.14*(float)(k*5)/(float)(km)), Color16::Black);
-    }
-    
-    fillScreen(Color16::Black);
-
-    for(uint32_t k = 0, km = 3000, sm = std::min(sx, sy)/2; k<km; ++k)
-        drawLine(sx/2, sy/2, (sx/2) + sm*cos(2*3.14*(float)(k)/(float)(km)), sy/2 + sm*sin(2*3.14*(float)(k)/(float)(km)), Color16::White);
-
-    for(uint32_t k = 0, km = 3000, sm = std::min(sx, sy)/2; k<km; ++k)
-        drawLine(sx/2, sy/2, (sx/2) + sm*cos(-2*3.14*(float)(k)/(float)(km)), sy/2 + sm*sin(-2*3.14*(float)(k)/(float)(km)), Color16::Black);
-
-    fillScreen(Color16::Black);
-
-    drawFastHLine(0,    sy/2,   sx, Color16::Blue);
-    drawFastVLine(sx/2, 0,      sy, Color16::Blue);
-
-    uint32_t buf[sx];
-    for (uint32_t i=1, x=1; i<(sx*400); ++i) 
-    {
-        ++x;
-        if (x==sx)
-            x=1;
-
-        if (i>sx)
-        {
-            if ((x==sx/2) || (buf[x-1]==sy/2))
-                drawPixel(x, buf[x-1], Color16::Blue);
-            else
-                drawPixel(x, buf[x-1], 0);
-        }
-
-        int y= sy/2 + sin(i*(6.28)/(sx*0.98)) * (sy/2 - 20) * sin(i*0.0001);
-        drawPixel(x, y, 0xFFFF);
-        buf[x-1]=y;
-    }
-    
-    uint16_t colors[] = {Color16::Red, Color16::Blue, Color16::Green};
-    fillScreen(0x0000);
-    
-    for(int k=0; k<15; ++k)
-    {
-        for (uint32_t i=15; i<sy; i+=5)
-            drawLine(0, i, (i*1.44)-10, sy, colors[(k)%3]);
-
-        for (uint32_t i=sy; i>15; i-=5)
-            drawLine(sx, i, (i*1.44)-12, 15, colors[(k+1)%3]);
-
-        for (uint32_t i=sy; i>15; i-=5)
-            drawLine(1, i, sx-8-(i*1.44), 15, colors[(k+2)%3]);
-
-        for (uint32_t i=15; i<sy; i+=5)
-            drawLine(sx, i, sx-9-(i*1.44), sy, colors[(k)%3]);
-    }
-    
-    const char lorem[] = "Lorem ipsum dolor sit amet, consectetur adipiscing elit. Pellentesque accumsan est et nunc tristique tincidunt. In ultrices velit et vehicula fermentum. Sed lobortis id" \
-                         "mi sed mattis. Nulla non imperdiet ipsum. Nam diam nisi, fringilla a libero non, hendrerit iaculis augue. In congue nunc dui, sed maximus ligula faucibus nec." \
-                         "Praesent feugiat mattis diam non tempus. Pellentesque porttitor commodo enim laoreet ullamcorper. Ut non risus lorem. Fusce vulputate tristique lacinia. In a mattis ex." \
-                         "Cras neque orci, egestas at finibus id, laoreet quis eros. Integer tincidunt consequat diam, non facilisis arcu. Nunc lacinia, lectus a viverra volutpat, sem nulla" \
-                         "interdum lectus, nec imperdiet arcu tortor at arcu. Donec eros ipsum, sollicitudin ut metus quis, semper vulputate libero";
-
-    for(uint32_t i=0;i<25;++i)
-    {
-        fillScreen(0x0000);
-        setCursor(0, 0);
-        write(lorem);
-    }
-    
-    fillScreen(0xFFFF);
-
-    const int steps = std::min(sx, sy)/10;
-    const float xstep = (float)sx/(float)(steps*2);
-    const float ystep = (float)sy/(float)(steps*2);
-
-    for(int c=0;c<30;++c)
-    {
-        float x=xstep, y=ystep;
-
-        for(int i=0; i<steps; ++i, x+=xstep, y+=ystep)
-        {
-            fillRect(0,     0,      x, y, colors[c%3]);
-            fillRect(0,     sy-y,   x, y, colors[c%3]);
-            fillRect(sx-x,  sy-y,   x, y, colors[c%3]);
-            fillRect(sx-x,  0,      x, y, colors[c%3]);
-        }
-    }
-    
-    uint32_t l = System::millis()-start;
-
-    char s[32] = {0};
-
-    snprintf(s, sizeof(s), "Time: %ld ms", l);
-    
-    fillScreen(0x0000);
-    setCursor(25, sy/3*2);
-    write(s);
-
-    return l;
-}
@@ -2,6 +2,7 @@
 #define GUARD_SCREEN
 
 #include "gfxfont.h"
+#include "rlefont.h"
 
 #include "color.h"
 #include "point2d.h"
@@ -40,6 +41,11 @@ class Display
         // optimized code.  Otherwise 'generic' versions are used.
         virtual void invertDisplay(bool i);
 
+        // Hardware scrolling of the whole screen along the x axis: whatever is drawn
+        // at column x is shown at column (x - offset) modulo width().
+        // Returns true if the hardware (or the current orientation) does not support it.
+        virtual bool setHorizontalScroll(int16_t offset);
+
         // BASIC DRAW API
         // These MAY be overridden by the subclass to provide device-specific
         // optimized code.  Otherwise 'generic' versions are used.
@@ -68,6 +74,14 @@ class Display
         void fillTriangle(  int16_t x0, int16_t y0, int16_t x1, int16_t y1,
                             int16_t x2, int16_t y2, uint16_t color);
 
+        // Anti-aliased variants (Wu's algorithm). The display is not read back: edge
+        // pixels are blended with 'bg', which should be the color underneath.
+        void drawLineAA(    int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                            uint16_t color, uint16_t bg);
+
+        void drawCircleAA(  int16_t x0, int16_t y0, int16_t r,
+                            uint16_t color, uint16_t bg);
+
         void drawRoundRect( int16_t x0, int16_t y0, int16_t w, int16_t h,
                             int16_t radius, uint16_t color);
 
@@ -92,6 +106,13 @@ class Display
         void drawChar(      int16_t x, int16_t y, unsigned char c, uint16_t color,
                             uint16_t bg, uint8_t size);
 
+        // Draw a glyph of the current compressed font (see setCompressedFont()).
+        // Opaque runs are sent as horizontal spans, clipped against the screen.
+        // Anti-aliased pixels are blended with 'bg', or thresholded if bg == color
+        // (transparent background).
+        void drawGlyph(     int16_t x, int16_t y, uint32_t codePoint, uint16_t color,
+                            uint16_t bg, uint8_t size);
+
         void setCursor(int16_t x, int16_t y);
         void setTextColor(uint16_t c);
         void setTextColor(uint16_t c, uint16_t bg);
@@ -100,6 +121,10 @@ class Display
         void cp437(bool x=true);
         void setFont(const GFXfont *f = nullptr);
 
+        // Use a compressed font. Text passed to write() is then decoded as UTF-8.
+        // Pass nullptr to revert to the 'classic' font.
+        void setCompressedFont(const RLEFont *f);
+
         void getTextBounds(char *string, int16_t x, int16_t y,
           int16_t *x1, int16_t *y1, uint16_t *w, uint16_t *h);
 
@@ -131,6 +156,14 @@ class Display
         void setSize(Point2D s);
         virtual Point2D orient(const Point2D& p);
 
+        // Primitives are clipped once against the screen, then only send visible
+        // pixels and spans (x0 <= x1, y0 <= y1) to the driver
+        uint8_t outCode(            int32_t x, int32_t y) const;
+        void    writeClippedPixel(  int32_t x, int32_t y, uint16_t color);
+        void    writeClippedHLine(  int32_t x0, int32_t x1, int32_t y, uint16_t color);
+        void    writeClippedVLine(  int32_t x, int32_t y0, int32_t y1, uint16_t color);
+        void    writeClippedRect(   int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint16_t color);
+
         Point2D m_size;
 
         int16_t     cursor_x    = 0;
@@ -146,6 +179,14 @@ class Display
         bool        wrap    = true;   // If set, 'wrap' text at right edge of display
         bool        _cp437  = false; // If set, use correct CP437 charset (default is off)
         GFXfont*    gfxFont = nullptr;
+
+        const RLEFont* rleFont      = nullptr;
+        uint32_t    utf8CodePoint   = 0;   // Code point being decoded by write()
+        uint8_t     utf8Remaining   = 0;   // Continuation bytes still expected
+
+    private:
+        void writeCodePoint(uint32_t codePoint);
+        static const RLEGlyph* findGlyph(const RLEFont* font, uint32_t codePoint);
 };
 
 #endif
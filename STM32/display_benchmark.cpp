@@ -0,0 +1,176 @@
+#include "display.h"
+#include "system.h"
+
+#include <algorithm>
+#include <cstdio>
+
+/*
+    Display::doBenchmark() is kept apart from display.cpp: it is the only part of Display that
+    depends on the HAL (System::millis()), the drawing code also builds on a host.
+*/
+
+// Sine of angle/65536 turn, as a 1.15 fixed point number.
+// Quarter wave table with linear interpolation, no floating point (F1 has no FPU).
+static int32_t sinQ15(uint32_t angle)
+{
+    static const int16_t table[65] = {
+            0,   804,  1608,  2410,  3212,  4011,  4808,  5602,
+         6393,  7179,  7962,  8739,  9512, 10278, 11039, 11793,
+        12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+        18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+        23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+        27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+        30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+        32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+        32767 };
+
+    const uint32_t quadrant = (angle >> 14) & 0x3;
+    uint32_t       position = angle & 0x3FFF;
+
+    if(quadrant & 1)
+        position = 0x4000 - position;
+
+    int32_t value = 32767;
+    if(position < 0x4000)
+    {
+        const uint32_t i        = position >> 8;
+        const int32_t  fraction = position & 0xFF;
+        value = table[i] + (((table[i+1] - table[i])*fraction) >> 8);
+    }
+
+    return (quadrant & 2) ? -value : value;
+}
+
+static int32_t cosQ15(uint32_t angle)
+{
+    return sinQ15(angle + 0x4000);
+}
+
+uint32_t Display::doBenchmark()
+{
+    uint32_t start = System::millis();
+
+    const int32_t sx = size().x();
+    const int32_t sy = size().y();
+
+    for(uint32_t k = 0, km = 300; k<km; ++k)
+    {
+        const int32_t  thd   = sx/3;
+        const uint32_t angle = (k*5*65536)/km;
+
+        fillRect(0,     0, thd, sy, Color16::Red);
+        fillRect(thd,   0, thd, sy, Color16::Green);
+        fillRect(thd*2, 0, thd, sy, Color16::Blue);
+        
+        drawLine(sx/2, sy/2, sx/2 + ((50*cosQ15(angle)) >> 15), sy/2 + ((50*sinQ15(angle)) >> 15), Color16::Black);
+    }
+    
+    fillScreen(Color16::Black);
+
+    for(int32_t k = 0, km = 3000, sm = std::min(sx, sy)/2; k<km; ++k)
+    {
+        const uint32_t angle = ((uint32_t)(k)*65536)/km;
+        drawLine(sx/2, sy/2, sx/2 + ((sm*cosQ15(angle)) >> 15), sy/2 + ((sm*sinQ15(angle)) >> 15), Color16::White);
+    }
+
+    for(int32_t k = 0, km = 3000, sm = std::min(sx, sy)/2; k<km; ++k)
+    {
+        const uint32_t angle = -(((uint32_t)(k)*65536)/km);
+        drawLine(sx/2, sy/2, sx/2 + ((sm*cosQ15(angle)) >> 15), sy/2 + ((sm*sinQ15(angle)) >> 15), Color16::Black);
+    }
+
+    fillScreen(Color16::Black);
+
+    drawFastHLine(0,    sy/2,   sx, Color16::Blue);
+    drawFastVLine(sx/2, 0,      sy, Color16::Blue);
+
+    int32_t buf[sx];
+    for (int32_t i=1, x=1; i<(sx*400); ++i) 
+    {
+        ++x;
+        if (x==sx)
+            x=1;
+
+        if (i>sx)
+        {
+            if ((x==sx/2) || (buf[x-1]==sy/2))
+                drawPixel(x, buf[x-1], Color16::Blue);
+            else
+                drawPixel(x, buf[x-1], 0);
+        }
+
+        // sin(i*2pi/(sx*0.98)) * (sy/2 - 20) * sin(i*0.0001)
+        const int32_t wave     = sinQ15(((uint64_t)(i)*65536*100)/(sx*98));
+        const int32_t envelope = sinQ15(((uint64_t)(i)*1043)/1000);
+
+        int32_t y = sy/2 + ((((wave*(sy/2 - 20)) >> 15)*envelope) >> 15);
+        drawPixel(x, y, 0xFFFF);
+        buf[x-1]=y;
+    }
+    
+    uint16_t colors[] = {Color16::Red, Color16::Blue, Color16::Green};
+    fillScreen(0x0000);
+    
+    for(int k=0; k<15; ++k)
+    {
+        for (int32_t i=15; i<sy; i+=5)
+            drawLine(0, i, (i*144)/100-10, sy, colors[(k)%3]);
+
+        for (int32_t i=sy; i>15; i-=5)
+            drawLine(sx, i, (i*144)/100-12, 15, colors[(k+1)%3]);
+
+        for (int32_t i=sy; i>15; i-=5)
+            drawLine(1, i, sx-8-(i*144)/100, 15, colors[(k+2)%3]);
+
+        for (int32_t i=15; i<sy; i+=5)
+            drawLine(sx, i, sx-9-(i*144)/100, sy, colors[(k)%3]);
+    }
+    
+    const char lorem[] = "Lorem ipsum dolor sit amet, consectetur adipiscing elit. Pellentesque accumsan est et nunc tristique tincidunt. In ultrices velit et vehicula fermentum. Sed lobortis id" \
+                         "mi sed mattis. Nulla non imperdiet ipsum. Nam diam nisi, fringilla a libero non, hendrerit iaculis augue. In congue nunc dui, sed maximus ligula faucibus nec." \
+                         "Praesent feugiat mattis diam non tempus. Pellentesque porttitor commodo enim laoreet ullamcorper. Ut non risus lorem. Fusce vulputate tristique lacinia. In a mattis ex." \
+                         "Cras neque orci, egestas at finibus id, laoreet quis eros. Integer tincidunt consequat diam, non facilisis arcu. Nunc lacinia, lectus a viverra volutpat, sem nulla" \
+                         "interdum lectus, nec imperdiet arcu tortor at arcu. Donec eros ipsum, sollicitudin ut metus quis, semper vulputate libero";
+
+    for(uint32_t i=0;i<25;++i)
+    {
+        fillScreen(0x0000);
+        setCursor(0, 0);
+        write(lorem);
+    }
+    
+    fillScreen(0xFFFF);
+
+    // Steps in 24.8 fixed point
+    const int32_t steps = std::min(sx, sy)/10;
+    const int32_t xstep = (sx << 8)/(steps*2);
+    const int32_t ystep = (sy << 8)/(steps*2);
+
+    for(int c=0;c<30;++c)
+    {
+        int32_t x=xstep, y=ystep;
+
+        for(int i=0; i<steps; ++i, x+=xstep, y+=ystep)
+        {
+            const int16_t w = x >> 8;
+            const int16_t h = y >> 8;
+
+            fillRect(0,     0,      w, h, colors[c%3]);
+            fillRect(0,     sy-h,   w, h, colors[c%3]);
+            fillRect(sx-w,  sy-h,   w, h, colors[c%3]);
+            fillRect(sx-w,  0,      w, h, colors[c%3]);
+        }
+    }
+    
+    uint32_t l = System::millis()-start;
+
+    char s[32] = {0};
+
+    snprintf(s, sizeof(s), "Time: %ld ms", l);
+    
+    fillScreen(0x0000);
+    setCursor(25, sy/3*2);
+    write(s);
+
+    return l;
+}
@@ -222,6 +222,29 @@ void ILI9341::scrollTo(uint16_t y)
     endWrite();
 }
 
+bool ILI9341::setHorizontalScroll(int16_t offset)
+{
+    /* The panel scrolls along its 320 pixels axis, which is the x axis in landscape modes.
+    Assumes the default (full screen) vertical scrolling area. */
+    offset %= (int16_t)(ILI9341::HEIGHT);
+    if(offset < 0)
+        offset += ILI9341::HEIGHT;
+
+    switch(orientation())
+    {
+        case Orientation::LANDSCAPE_1:
+            scrollTo(offset);
+            break;
+        case Orientation::LANDSCAPE_2: /* Row addresses are mirrored (MADCTL_MY) */
+            scrollTo((ILI9341::HEIGHT - offset) % ILI9341::HEIGHT);
+            break;
+        default:
+            return true;
+    }
+
+    return false;
+}
+
 uint8_t ILI9341::spiRead()
 {
     uint8_t c;
@@ -38,6 +38,8 @@ class ILI9341: public ILI9xxx
         void invertDisplay  (bool i);
         void scrollTo       (uint16_t y);
 
+        virtual bool setHorizontalScroll(int16_t offset);
+
                 
     private:
 
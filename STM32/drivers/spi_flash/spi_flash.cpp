@@ -0,0 +1,175 @@
+#include "spi_flash.h"
+#include "system.h"
+
+#include <algorithm>
+
+constexpr uint32_t SPIFlash::PAGE_SIZE;
+constexpr uint32_t SPIFlash::SECTOR_SIZE;
+constexpr uint32_t SPIFlash::PROGRAM_TIMEOUT;
+constexpr uint32_t SPIFlash::ERASE_TIMEOUT;
+constexpr uint32_t SPIFlash::SPI_MAX_FREQUENCY;
+
+namespace
+{
+    constexpr uint8_t CMD_WRITE_ENABLE  = 0x06;
+    constexpr uint8_t CMD_READ_STATUS   = 0x05;
+    constexpr uint8_t CMD_READ          = 0x03;
+    constexpr uint8_t CMD_PAGE_PROGRAM  = 0x02;
+    constexpr uint8_t CMD_SECTOR_ERASE  = 0x20;
+    constexpr uint8_t CMD_JEDEC_ID      = 0x9F;
+
+    constexpr uint8_t STATUS_BUSY       = 0x01;
+
+    constexpr uint32_t MAX_TRANSFER     = 0x8000;   ///< SPI transfers are limited to 16-bit sizes
+}
+
+SPIFlash::SPIFlash(SPI& spi, Pin cs, uint32_t size):
+    m_spi(spi), m_cs(cs), m_size(size)
+{
+}
+
+bool SPIFlash::init()
+{
+    m_cs.init(GPIO_MODE_OUTPUT_PP);
+    m_cs.setHigh();
+
+    const uint32_t id = jedecID();
+
+    // No chip: the bus reads 0x00 or 0xFF
+    if(id == 0 || id == 0xFFFFFF)
+        return true;
+
+    if(!m_size)
+    {
+        const uint8_t capacity = id & 0xFF;
+
+        if(capacity < 16 || capacity > 24)
+            return true;
+
+        m_size = 1UL << capacity;
+    }
+
+    return false;
+}
+
+uint32_t SPIFlash::jedecID()
+{
+    uint8_t id[3] = {0};
+
+    const bool error = command(CMD_JEDEC_ID, 0, false) || m_spi.read(id, sizeof(id), SPI_MAX_FREQUENCY);
+    m_cs.setHigh();
+
+    if(error)
+        return 0;
+
+    return ((uint32_t)(id[0]) << 16) | ((uint32_t)(id[1]) << 8) | id[2];
+}
+
+uint32_t SPIFlash::size() const
+{
+    return m_size;
+}
+
+uint32_t SPIFlash::sectorSize() const
+{
+    return SECTOR_SIZE;
+}
+
+bool SPIFlash::read(uint32_t address, void* data, uint32_t size)
+{
+    if(address > m_size || size > m_size - address)
+        return true;
+
+    // The read command streams the whole memory: a single command, read in SPI sized chunks
+    bool error = command(CMD_READ, address, true);
+
+    uint8_t* p = reinterpret_cast<uint8_t*>(data);
+
+    while(!error && size)
+    {
+        const uint32_t chunk = std::min(size, MAX_TRANSFER);
+
+        error   = m_spi.read(p, chunk, SPI_MAX_FREQUENCY);
+        p      += chunk;
+        size   -= chunk;
+    }
+
+    m_cs.setHigh();
+    return error;
+}
+
+bool SPIFlash::program(uint32_t address, const void* data, uint32_t size)
+{
+    if(address > m_size || size > m_size - address)
+        return true;
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+
+    while(size)
+    {
+        // A page program wraps around at the end of the page
+        const uint32_t chunk = std::min(size, PAGE_SIZE - address % PAGE_SIZE);
+
+        if(writeEnable())
+            return true;
+
+        const bool error = command(CMD_PAGE_PROGRAM, address, true) || m_spi.write(p, chunk, SPI_MAX_FREQUENCY);
+        m_cs.setHigh();
+
+        if(error || waitReady(PROGRAM_TIMEOUT))
+            return true;
+
+        address += chunk;
+        p       += chunk;
+        size    -= chunk;
+    }
+
+    return false;
+}
+
+bool SPIFlash::erase(uint32_t address)
+{
+    if(address >= m_size || writeEnable())
+        return true;
+
+    const bool error = command(CMD_SECTOR_ERASE, address - address % SECTOR_SIZE, true);
+    m_cs.setHigh();
+
+    return error || waitReady(ERASE_TIMEOUT);
+}
+
+bool SPIFlash::command(uint8_t cmd, uint32_t address, bool withAddress)
+{
+    const uint8_t frame[] = {cmd, (uint8_t)(address >> 16), (uint8_t)(address >> 8), (uint8_t)(address)};
+
+    m_cs.setLow();
+    return m_spi.write(frame, withAddress ? sizeof(frame) : 1, SPI_MAX_FREQUENCY);
+}
+
+bool SPIFlash::writeEnable()
+{
+    const bool error = command(CMD_WRITE_ENABLE, 0, false);
+    m_cs.setHigh();
+
+    return error;
+}
+
+bool SPIFlash::waitReady(uint32_t timeout)
+{
+    const uint32_t start = System::millis();
+    uint8_t status = STATUS_BUSY;
+
+    while(status & STATUS_BUSY)
+    {
+        if(System::millis() - start > timeout)
+            return true;
+
+        const bool error = command(CMD_READ_STATUS, 0, false) || m_spi.read(&status, 1, SPI_MAX_FREQUENCY);
+        m_cs.setHigh();
+
+        if(error)
+            return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,72 @@
+#ifndef GUARD_SPI_FLASH
+#define GUARD_SPI_FLASH
+
+#include "pin.h"
+#include "spi.h"
+
+#include "flash.h"
+
+/**
+    \brief Driver for SPI NOR flash memories (Winbond W25Qxx, Macronix MX25Lxx, ...)
+
+    Uses the common JEDEC command set: 3-byte addresses (up to 16 MB), 256-byte pages, 4 KB sector erase.
+**/
+class SPIFlash: public Flash
+{
+    public:
+        static constexpr uint32_t PAGE_SIZE             = 256;
+        static constexpr uint32_t SECTOR_SIZE           = 4096;
+
+        static constexpr uint32_t PROGRAM_TIMEOUT       = 10;   ///< Page program timeout, in ms
+        static constexpr uint32_t ERASE_TIMEOUT         = 1000; ///< Sector erase timeout, in ms
+
+        static constexpr uint32_t SPI_MAX_FREQUENCY     = 50000000; ///< Read command (0x03) limit of most chips
+
+    public:
+        /**
+            \brief Constructor
+            \param spi SPI interface to be used
+            \param cs Chip select pin
+            \param size Size of the memory, in bytes (0: from the JEDEC ID)
+        **/
+        SPIFlash(SPI& spi, Pin cs, uint32_t size = 0);
+
+        /**
+            \brief Initialize the driver, and check the chip responds
+            \returns \c true on error, \c false otherwise
+        **/
+        bool init();
+
+        /**
+            \returns JEDEC ID: manufacturer (bits 23:16), memory type (15:8), capacity (7:0, log2 of the size)
+        **/
+        uint32_t jedecID();
+
+        virtual uint32_t size() const;
+        virtual uint32_t sectorSize() const;
+        virtual bool read(uint32_t address, void* data, uint32_t size);
+        virtual bool program(uint32_t address, const void* data, uint32_t size);
+        virtual bool erase(uint32_t address);
+
+    private:
+        /**
+            \brief Send a command with an optional address, CS left low for the data phase
+            \returns \c true on error, \c false otherwise
+        **/
+        bool command(uint8_t cmd, uint32_t address, bool withAddress);
+
+        bool writeEnable();
+
+        /**
+            \brief Wait for the end of a program or erase
+            \param timeout Timeout, in ms
+            \returns \c true on error or timeout, \c false otherwise
+        **/
+        bool waitReady(uint32_t timeout);
+
+        SPI&        m_spi;
+        Pin         m_cs;
+        uint32_t    m_size;
+};
+
+#endif
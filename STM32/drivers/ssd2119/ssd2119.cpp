@@ -6,6 +6,12 @@
 #define ENTRY_MODE_DEFAULT 0x6830
 #define ENTRY_MODE_BMP 	   0x6810
 #define MAKE_ENTRY_MODE(x) ((ENTRY_MODE_DEFAULT & 0xFF00) | (x))
+#define ENTRY_MODE_VERTICAL (ENTRY_MODE_DEFAULT | 0x0008) /* AM=1: GRAM address goes down the columns first */
+
+#if SSD2119_USE_DMA
+/* Display owning the DMA stream, for the IRQ handler */
+static SSD2119* s_dmaDisplay = nullptr;
+#endif
 
 
 SSD2119::SSD2119(Pin rst, Pin backlight) :
@@ -18,6 +24,11 @@ bool SSD2119::init(Orientation orientation)
     if(initGpio() || initFSMC())
         return true;
 
+#if SSD2119_USE_DMA
+    if(initDMA())
+        return true;
+#endif
+
     reset();
 
 	m_backlight.setHigh();
@@ -94,6 +105,10 @@ void SSD2119::writePixel(int16_t x, int16_t y, uint16_t color)
 {
 	//Point2D p = orient(Point2D(x, y));	
 
+#if SSD2119_USE_DMA
+    waitForTransfer();
+#endif
+
     if( orientation() == Orientation::PORTRAIT_1 ||
         orientation() == Orientation::PORTRAIT_2)
         std::swap(x, y);
@@ -111,6 +126,14 @@ void SSD2119::writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t
         h <= 0)
         return;
 
+#if SSD2119_USE_DMA
+    if((uint32_t)(w)*(uint32_t)(h) >= SSD2119::DMA_MIN_PIXELS &&
+       !fillRectAsync(x, y, w, h, color))
+        return;
+
+    waitForTransfer();
+#endif
+
     volatile uint16_t px = x;
     volatile uint16_t py = y;
     volatile uint16_t ph = h;
@@ -156,8 +179,27 @@ void SSD2119::reset()
     }
 }
 
+void SSD2119::setWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    writeReg(SSD2119::H_RAM_START,  x);
+    writeReg(SSD2119::H_RAM_END,    x+w-1);
+    writeReg(SSD2119::V_RAM_POS,    ((y+h-1) << 8) | y);
+
+    writeReg(SSD2119::X_RAM_ADDR,   x);
+    writeReg(SSD2119::Y_RAM_ADDR,   y);
+}
+
+void SSD2119::resetWindow()
+{
+    setWindow(0, 0, LCD_WIDTH, LCD_HEIGHT);
+}
+
 void SSD2119::setOrientation(Orientation orientation)
 {
+#if SSD2119_USE_DMA
+    waitForTransfer();
+#endif
+
     constexpr uint16_t RL   = (1<<14);
     constexpr uint16_t REV  = (1<<13);
     constexpr uint16_t GD   = (1<<12);
@@ -265,6 +307,10 @@ bool SSD2119::drawBmpFromFile(File& file, int32_t x, int32_t y, bool invert)
        y >= m_size.y())
        return false;
 
+#if SSD2119_USE_DMA
+    waitForTransfer();
+#endif
+
     /* Too small to be a BMP file */
     if(file.size() < 54)
         return true;
@@ -391,3 +437,195 @@ bool SSD2119::drawBmpFromFile(File& file, int32_t x, int32_t y, bool invert)
 
     return error;
 }
+
+#if SSD2119_USE_DMA
+bool SSD2119::initDMA()
+{
+    __HAL_RCC_DMA2_CLK_ENABLE();
+
+    /* Only DMA2 can do memory-to-memory transfers.
+    In this mode, the 'peripheral' port is the source and the 'memory' port is the destination */
+    m_dma.Instance                 = DMA2_Stream0;
+    m_dma.Init.Channel             = DMA_CHANNEL_0;
+    m_dma.Init.Direction           = DMA_MEMORY_TO_MEMORY;
+    m_dma.Init.PeriphInc           = DMA_PINC_DISABLE;
+    m_dma.Init.MemInc              = DMA_MINC_DISABLE;
+    m_dma.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+    m_dma.Init.MemDataAlignment    = DMA_MDATAALIGN_HALFWORD;
+    m_dma.Init.Mode                = DMA_NORMAL;
+    m_dma.Init.Priority            = DMA_PRIORITY_HIGH;
+    m_dma.Init.FIFOMode            = DMA_FIFOMODE_ENABLE; /* Direct mode is not allowed in memory-to-memory */
+    m_dma.Init.FIFOThreshold       = DMA_FIFO_THRESHOLD_FULL;
+    m_dma.Init.MemBurst            = DMA_MBURST_SINGLE;
+    m_dma.Init.PeriphBurst         = DMA_PBURST_SINGLE;
+
+    if(HAL_DMA_Init(&m_dma) != HAL_OK)
+        return true;
+
+    m_dma.Parent            = this;
+    m_dma.XferCpltCallback  = &SSD2119::dmaTransferComplete;
+    m_dma.XferErrorCallback = &SSD2119::dmaTransferComplete;
+
+    s_dmaDisplay = this;
+
+    HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, SSD2119::DMA_NVIC_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+
+    return false;
+}
+
+bool SSD2119::fillRectAsync(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color, void (*callback)(void))
+{
+    /* Clip to the screen */
+    if(x < 0)
+    {
+        w += x;
+        x = 0;
+    }
+    if(y < 0)
+    {
+        h += y;
+        y = 0;
+    }
+    if(x + w > m_size.x())
+        w = m_size.x() - x;
+    if(y + h > m_size.y())
+        h = m_size.y() - y;
+
+    if(w <= 0 || h <= 0)
+    {
+        if(callback)
+            callback();
+        return false;
+    }
+
+    waitForTransfer();
+
+    m_dmaFillColor = color;
+
+    return startTransfer(x, y, w, h, &m_dmaFillColor, false, callback);
+}
+
+bool SSD2119::drawImageAsync(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* pixels, void (*callback)(void))
+{
+    if(!pixels  ||
+       w <= 0   || h <= 0 ||
+       x < 0    || y < 0  ||
+       x + w > m_size.x() ||
+       y + h > m_size.y())
+        return true;
+
+    waitForTransfer();
+
+    return startTransfer(x, y, w, h, pixels, true, callback);
+}
+
+bool SSD2119::isTransferInProgress() const
+{
+    return m_dmaBusy;
+}
+
+void SSD2119::waitForTransfer() const
+{
+    while(m_dmaBusy)
+    {
+    }
+}
+
+bool SSD2119::startTransfer(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* source, bool incrementSource, void (*callback)(void))
+{
+    uint16_t px = x;
+    uint16_t py = y;
+    uint16_t pw = w;
+    uint16_t ph = h;
+
+    bool portrait = orientation() == Orientation::PORTRAIT_1 ||
+                    orientation() == Orientation::PORTRAIT_2;
+
+    if(portrait)
+    {
+        std::swap(px, py);
+        std::swap(pw, ph);
+    }
+
+    /* The GRAM address wraps within the window, so the whole area is a single stream of pixels */
+    setWindow(px, py, pw, ph);
+
+    /* Images are stored row by row in screen coordinates, which are columns in portrait mode */
+    if(portrait && incrementSource)
+        writeReg(SSD2119::ENTRY_MODE, ENTRY_MODE_VERTICAL);
+
+    writeCmd(SSD2119::RAM_DATA);
+
+    m_dmaSource          = source;
+    m_dmaRemaining       = (uint32_t)(w)*(uint32_t)(h);
+    m_dmaIncrementSource = incrementSource;
+    m_dmaCallback        = callback;
+    m_dmaBusy            = true;
+
+    if(startChunk())
+    {
+        m_dmaRemaining = 0;
+        transferComplete();
+        return true;
+    }
+
+    return false;
+}
+
+bool SSD2119::startChunk()
+{
+    uint32_t n = (m_dmaRemaining > SSD2119::DMA_MAX_TRANSFER) ? SSD2119::DMA_MAX_TRANSFER : m_dmaRemaining;
+
+    /* PINC can only be changed while the stream is disabled, which is the case between two chunks */
+    if(m_dmaIncrementSource)
+        m_dma.Instance->CR |= DMA_SxCR_PINC;
+    else
+        m_dma.Instance->CR &= ~DMA_SxCR_PINC;
+
+    if(HAL_DMA_Start_IT(&m_dma, (uint32_t)(m_dmaSource), (uint32_t)(baseAdr), n) != HAL_OK)
+        return true;
+
+    m_dmaRemaining -= n;
+
+    if(m_dmaIncrementSource)
+        m_dmaSource += n;
+
+    return false;
+}
+
+void SSD2119::transferComplete()
+{
+    if(m_dmaRemaining && !startChunk())
+        return;
+
+    m_dmaRemaining = 0;
+
+    resetWindow();
+    writeReg(SSD2119::ENTRY_MODE, ENTRY_MODE_DEFAULT);
+
+    void (*callback)(void) = m_dmaCallback;
+    m_dmaCallback = nullptr;
+    m_dmaBusy     = false;
+
+    if(callback)
+        callback();
+}
+
+void SSD2119::dmaTransferComplete(DMA_HandleTypeDef* hdma)
+{
+    SSD2119* display = static_cast<SSD2119*>(hdma->Parent);
+
+    /* Abort the remaining chunks on error */
+    if(hdma->ErrorCode != HAL_DMA_ERROR_NONE)
+        display->m_dmaRemaining = 0;
+
+    display->transferComplete();
+}
+
+extern "C" void DMA2_Stream0_IRQHandler(void)
+{
+    if(s_dmaDisplay)
+        HAL_DMA_IRQHandler(&(s_dmaDisplay->m_dma));
+}
+#endif
@@ -6,6 +6,17 @@
 #include "display.h"
 #include "filesystem/file.h"
 
+/* Push pixels to the FSMC data address with DMA2 memory-to-memory transfers */
+#if defined(STM32F4xx)
+    #define SSD2119_USE_DMA 1
+#else
+    #define SSD2119_USE_DMA 0
+#endif
+
+#if SSD2119_USE_DMA
+extern "C" void DMA2_Stream0_IRQHandler(void);
+#endif
+
 /* HAL (possible?) patch: in stm32f4xx_ll_fsmmc.c:FSMC_NORSRAM_Init(), 
 Replace:
 tmpr = Device->BTCR[Init->NSBank];
@@ -26,6 +37,12 @@ class SSD2119: public Display
         static constexpr uint32_t LCD_WIDTH     = 320; /* x axis */
         static constexpr uint32_t LCD_HEIGHT    = 240; /* y axis */
 
+    #if SSD2119_USE_DMA
+        static constexpr uint32_t DMA_MAX_TRANSFER  = 0xFFFF;   ///< NDTR is 16 bits wide
+        static constexpr uint32_t DMA_MIN_PIXELS    = 64;       ///< Below that, CPU stores are cheaper than setting up a transfer
+        static constexpr uint8_t  DMA_NVIC_PRIORITY = 5;
+    #endif
+
     public:
         SSD2119(Pin rst = Pin(), Pin backlight = Pin());
 
@@ -36,6 +53,48 @@ class SSD2119: public Display
         
         bool drawBmpFromFile(File& file, int32_t x, int32_t y, bool invert = true);
 
+    #if SSD2119_USE_DMA
+        /**
+            \brief Fill a rectangle using a DMA transfer, without waiting for its completion
+            \param x X coordinate of the upper left corner
+            \param y Y coordinate of the upper left corner
+            \param w Width
+            \param h Height
+            \param color Fill color
+            \param callback Function called (from the DMA interrupt) once the rectangle is drawn. Can be \c nullptr.
+            \returns \c true on error, \c false otherwise
+
+            \remark The rectangle is clipped to the screen.
+            \remark Any other drawing operation will block until the transfer is complete.
+        **/
+        bool fillRectAsync(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color, void (*callback)(void) = nullptr);
+
+        /**
+            \brief Draw a RGB565 image using a DMA transfer, without waiting for its completion
+            \param x X coordinate of the upper left corner
+            \param y Y coordinate of the upper left corner
+            \param w Image width
+            \param h Image height
+            \param pixels Pixel data, row by row. Must remain valid until the transfer is complete.
+            \param callback Function called (from the DMA interrupt) once the image is drawn. Can be \c nullptr.
+            \returns \c true on error, \c false otherwise
+
+            \remark The image must fit entirely within the screen.
+            \remark Any other drawing operation will block until the transfer is complete.
+        **/
+        bool drawImageAsync(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* pixels, void (*callback)(void) = nullptr);
+
+        /**
+            \returns \c true if a DMA transfer is in progress, \c false otherwise
+        **/
+        bool isTransferInProgress() const;
+
+        /**
+            \brief Block until the current DMA transfer (if any) is complete
+        **/
+        void waitForTransfer() const;
+    #endif
+
         virtual void setOrientation(Orientation orientation);
 
     private:
@@ -45,6 +104,9 @@ class SSD2119: public Display
 
         void reset();
 
+        void setWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+        void resetWindow();
+
         virtual void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
 
         inline void __attribute__((optimize("O0"))) writeCmd(volatile uint16_t cmd) { *cmdAdr = cmd; };
@@ -57,6 +119,26 @@ class SSD2119: public Display
         Pin m_rst;
         Pin m_backlight;
 
+    #if SSD2119_USE_DMA
+        bool initDMA();
+        bool startTransfer(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* source, bool incrementSource, void (*callback)(void));
+        bool startChunk();
+        void transferComplete();
+
+        static void dmaTransferComplete(DMA_HandleTypeDef* hdma);
+
+        DMA_HandleTypeDef m_dma = {};
+
+        const uint16_t*     m_dmaSource          = nullptr;
+        uint32_t            m_dmaRemaining       = 0;
+        bool                m_dmaIncrementSource = false;
+        uint16_t            m_dmaFillColor       = 0;
+        volatile bool       m_dmaBusy            = false;
+        void (*m_dmaCallback)(void)              = nullptr;
+
+        friend void ::DMA2_Stream0_IRQHandler(void);
+    #endif
+
         enum Registers
         {
             DEVICE_CODE_READ  = 0x00,
@@ -34,7 +34,7 @@ bool Exti::registerCallback(uint8_t line, void (*callback)(void),
         return true;
 
     if(i == 0)
-        enableInterruptLine(line);
+        enableInterruptLine(line, priority, subPriority);
 
     m_callbacks[line].list[i] = callback;
 
@@ -0,0 +1,560 @@
+/**
+    \file fs_bench.cpp
+    \brief Host benchmark of the file system stack, see FilesystemBench
+
+    FatFS is mounted on a RAM disk or on an image file, attached to the driver table as USER1 (drive 7:), behind
+    the sector cache when the build enables it for this drive. The driver calls are counted: unlike the times,
+    these counts do not depend on the host, and make an exact regression check.
+
+    Usage: fs_bench [-i image] [-m size] [-f fat|fat32|exfat] [-c cluster] [-k] [-l] [-g] [-s clock] [-d] [-n label]
+    - -i: image file (created with the given size if missing), RAM disk otherwise
+    - -m: size of the volume, in MB (default 64)
+    - -f: format (default fat32)
+    - -c: cluster size, in bytes (default: chosen by f_mkfs, 512 bytes on small FAT32 volumes). FAT32 needs at
+    least 65526 clusters: 32 KB clusters, as on SD cards, need a 2 GB volume (the RAM disk is allocated on use)
+    - -k: keep the volume of the image, do not format it
+    - -l: long file names in the directory tests
+    - -g: fragment the free space before the tests (see fragment()): the sequential test file is made of
+    one-cluster fragments, as on a card used for months, and the seek tests compare FAT chain walks with fast
+    seek. Its number of fragments is checked, and printed in a comment line
+    - -s: SD card timing model, bus clock in MHz (24: default speed, 48: high speed). The times are given by a
+    virtual clock, advanced by the driver calls only: each command takes CardModel::command us, plus the transfer
+    on the 4-bit bus (2 clocks per byte), and a write keeps the card busy for CardModel::programming us, waited for
+    by the next command or by CTRL_SYNC (as the DMA driver of fatfs_sd_sdio.c). The CPU time of FatFS is not
+    counted: the results are the same on every host
+    - -d: run the sector benchmark of the driver (diskio_bench.h) first, on the area formatted afterwards (not
+    with -k)
+    - -n: label of the results (e.g. configuration variant)
+
+    After the tests, a power loss during a BinaryLog flush is simulated: every sector of the interrupted driver
+    write is garbage, and the drive fails until it is mounted again. The records of the previous flushes must all
+    be read back.
+
+    Results are tab-separated, one line per test. Build and compare configurations with run.sh.
+**/
+extern "C"
+{
+    #include "fatfs/ff.h"
+    #include "fatfs/diskio.h"
+    #include "fatfs/diskio_bench.h"
+    #include "fatfs/diskio_cache.h"
+    #include "fatfs/fatfs_ramdisk.h"
+}
+
+#include "binary_log.h"
+#include "filesystem_bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    struct Counters
+    {
+        uint32_t    reads           = 0;
+        uint32_t    sectorsRead     = 0;
+        uint32_t    writes          = 0;
+        uint32_t    sectorsWritten  = 0;
+    };
+
+    Counters counters;
+    DISKIO_LowLevelDriver_t backend;
+
+    bool powerFailing = false;  ///< The next driver write is interrupted by a power loss
+    bool powerOff = false;      ///< Writes fail, until the drive is mounted again
+
+    FILE* image = nullptr;
+    DWORD imageSectors = 0;
+
+    /* SD card timing model (-s) */
+
+    struct CardModel
+    {
+        uint32_t    clock           = 0;    ///< Bus clock, in MHz (0: no model, host time)
+        uint32_t    command         = 100;  ///< Command, response and access time, in us
+        uint32_t    programming     = 250;  ///< Busy time after a write, in us
+    };
+
+    CardModel card;
+    uint64_t cardTime = 0;      ///< Virtual clock, in us
+    uint64_t cardBusy = 0;      ///< End of the programming of the last write
+
+    void cardWait()
+    {
+        cardTime = std::max(cardTime, cardBusy);
+    }
+
+    void cardTransfer(UINT count, bool write)
+    {
+        if(!card.clock)
+            return;
+
+        // 4-bit bus: 2 clocks per byte
+        cardWait();
+        cardTime += card.command + (uint64_t)(count) * _MAX_SS * 2 / card.clock;
+
+        if(write)
+            cardBusy = cardTime + card.programming;
+    }
+
+    uint64_t micros()
+    {
+        if(card.clock)
+            return cardTime;
+
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+    }
+
+    DWORD driverMicros()
+    {
+        return micros();
+    }
+
+    /* Counting driver, in front of the RAM disk or the image */
+
+    DSTATUS countingInitialize() { return backend.disk_initialize(); }
+    DSTATUS countingStatus() { return backend.disk_status(); }
+
+    DRESULT countingIoctl(BYTE cmd, void* buff)
+    {
+        if(cmd == CTRL_SYNC)
+            cardWait();
+
+        return backend.disk_ioctl(cmd, buff);
+    }
+
+    DRESULT countingRead(BYTE* buff, DWORD sector, UINT count)
+    {
+        cardTransfer(count, false);
+        counters.reads++;
+        counters.sectorsRead += count;
+        return backend.disk_read(buff, sector, count);
+    }
+
+    DRESULT countingWrite(const BYTE* buff, DWORD sector, UINT count)
+    {
+        if(powerOff)
+            return RES_NOTRDY;
+
+        if(powerFailing)
+        {
+            // Worst case: none of the sectors of the write is complete
+            BYTE garbage[_MAX_SS];
+            memset(garbage, 0xA5, sizeof(garbage));
+
+            for(UINT i = 0; i < count; ++i)
+                backend.disk_write(garbage, sector + i, 1);
+
+            powerFailing = false;
+            powerOff = true;
+            return RES_ERROR;
+        }
+
+        cardTransfer(count, true);
+        counters.writes++;
+        counters.sectorsWritten += count;
+        return backend.disk_write(buff, sector, count);
+    }
+
+    /* Image file driver */
+
+    DSTATUS imageStatus() { return image ? 0 : STA_NOINIT; }
+
+    DRESULT imageIoctl(BYTE cmd, void* buff)
+    {
+        switch(cmd)
+        {
+            case CTRL_SYNC:         return fflush(image) ? RES_ERROR : RES_OK;
+            case GET_SECTOR_COUNT:  *(DWORD*)(buff) = imageSectors;   return RES_OK;
+            case GET_SECTOR_SIZE:   *(WORD*)(buff) = _MAX_SS;         return RES_OK;
+            case GET_BLOCK_SIZE:    *(DWORD*)(buff) = 1;              return RES_OK;
+            default:                return RES_PARERR;
+        }
+    }
+
+    DRESULT imageRead(BYTE* buff, DWORD sector, UINT count)
+    {
+        if(sector + count > imageSectors || fseek(image, (long)(sector) * _MAX_SS, SEEK_SET))
+            return RES_PARERR;
+
+        return fread(buff, _MAX_SS, count, image) == count ? RES_OK : RES_ERROR;
+    }
+
+    DRESULT imageWrite(const BYTE* buff, DWORD sector, UINT count)
+    {
+        if(sector + count > imageSectors || fseek(image, (long)(sector) * _MAX_SS, SEEK_SET))
+            return RES_PARERR;
+
+        return fwrite(buff, _MAX_SS, count, image) == count ? RES_OK : RES_ERROR;
+    }
+
+    bool openImage(const char* filename, DWORD sectors)
+    {
+        image = fopen(filename, "r+b");
+
+        if(!image)
+        {
+            // New image, of the requested size
+            image = fopen(filename, "w+b");
+
+            if(!image || fseek(image, (long)(sectors) * _MAX_SS - 1, SEEK_SET) || fputc(0, image) == EOF)
+                return true;
+        }
+
+        fseek(image, 0, SEEK_END);
+        imageSectors = ftell(image) / _MAX_SS;
+
+        backend = {imageStatus, imageStatus, imageIoctl, imageWrite, imageRead};
+        return false;
+    }
+
+    /**
+        \brief Fragment the free space of drive 7: (see -g)
+
+        The volume is filled with clusters of files A and B in turn (size bytes each), then a contiguous file R
+        (RESERVED bytes), and file C up to the end. A and R are deleted: the allocations restart from the end of the
+        volume, so the next files fill the one-cluster holes left by A first, while BinaryLog finds R to preallocate
+        its contiguous files.
+
+        \param fs Mounted file system object
+        \param size Size of the holes, in bytes
+        \returns Error code. See FatFS documentation
+    **/
+    FRESULT fragment(const FATFS& fs, FSIZE_t size)
+    {
+        constexpr FSIZE_t RESERVED = 16 << 20;
+        const char* names[4] = {"7:/fill_a.bin", "7:/fill_b.bin", "7:/fill_r.bin", "7:/fill_c.bin"};
+        const std::vector<BYTE> cluster((UINT)(fs.csize) * _MAX_SS, 0xFF);
+        File files[4];
+        FRESULT res = FR_OK;
+
+        for(int i = 0; i < 4 && res == FR_OK; ++i)
+            res = files[i].open(names[i], File::Mode::W);
+
+        // Each write allocates a cluster
+        for(FSIZE_t done = 0; res == FR_OK && done < size; done += cluster.size())
+            for(int i = 0; i < 2 && res == FR_OK; ++i)
+                res = files[i].write(cluster.data(), cluster.size());
+
+        for(FSIZE_t done = 0; res == FR_OK && done < RESERVED; done += cluster.size())
+            res = files[2].write(cluster.data(), cluster.size());
+
+        // Until the volume is full (FR_DENIED)
+        while(res == FR_OK)
+            res = files[3].write(cluster.data(), cluster.size());
+
+        if(res != FR_DENIED)
+            return res;
+
+        for(int i = 0; i < 4; ++i)
+            if(auto r = files[i].close())
+                return r;
+
+        if(auto r = f_unlink(names[0]))
+            return r;
+
+        return f_unlink(names[2]);
+    }
+
+    /**
+        \brief Interrupt a BinaryLog flush by a power loss, then check the records of the previous flushes
+        \param fs File system object of drive 7:, mounted again after the power loss
+        \returns \c true if records were lost, \c false otherwise
+    **/
+    bool powerLoss(FATFS& fs)
+    {
+        const char* filename = "7:/power.log";
+        constexpr uint32_t RECORDS = 3;     // Per flush: a few flushes per block
+        constexpr uint32_t FLUSHES = 10;    // Before the power loss
+        uint32_t appended = 0;
+
+        {
+            BinaryLog log;
+
+            if(log.create(filename, 64*1024, 2))
+                return true;
+
+            for(uint32_t i = 0; i <= FLUSHES; ++i)
+            {
+                for(uint32_t j = 0; j < RECORDS; ++j, ++appended)
+                    if(log.append(appended, &appended, sizeof(appended)))
+                        return true;
+
+                // The power fails during the last flush (the full blocks are written by process() first)
+                if(log.process())
+                    return true;
+
+                powerFailing = i == FLUSHES;
+
+                if((log.flush() != FR_OK) != (i == FLUSHES))
+                    return true;
+            }
+
+            // The log is closed without power: nothing written
+        }
+
+        // Restart: the sectors cached in RAM are lost
+        TM_FATFS_CACHE_Invalidate(TM_FATFS_Driver_USER1);
+        powerOff = false;
+
+        if(f_mount(&fs, "7:", 1) != FR_OK)
+            return true;
+
+        BinaryLogReader reader;
+        BinaryLog::Record record;
+        uint32_t count = 0;
+
+        if(reader.open(filename))
+            return true;
+
+        // Records after the last flush may be there or not, but in order
+        for(; !reader.read(record); ++count)
+        {
+            uint32_t value;
+            memcpy(&value, record.data, sizeof(value));
+
+            if(record.timestamp != count || record.size != sizeof(value) || value != count)
+                return true;
+        }
+
+        reader.close();
+        f_unlink(filename);
+
+        return count < FLUSHES*RECORDS;
+    }
+
+    /**
+        \brief Run the sector benchmark of the driver of drive 7: (see -d), and print its results
+        \param sectors Size of the drive, in sectors
+        \returns \c true on error, \c false otherwise
+    **/
+    bool driverBench(const char* label, DWORD sectors)
+    {
+        static const char* const names[TM_FATFS_BENCH_Count] =
+        {
+            "sector seq read", "sector seq write", "sector rnd read", "sector rnd write"
+        };
+
+        // 64 sectors per sequential call (32 KB clusters), 512-byte random calls
+        static BYTE buffer[64 * _MAX_SS];
+        const TM_FATFS_BENCH_Config_t config = {0, std::min<DWORD>(sectors, 16384), buffer, 64, 1, 1000, driverMicros};
+        TM_FATFS_BENCH_Result_t results[TM_FATFS_BENCH_Count];
+
+        if(TM_FATFS_BENCH_Run(TM_FATFS_Driver_USER1, &config, results) != RES_OK)
+            return true;
+
+        // The driver counts, from the results: one driver call per operation
+        for(int i = 0; i < TM_FATFS_BENCH_Count; ++i)
+        {
+            const TM_FATFS_BENCH_Result_t& result = results[i];
+            const bool write = i == TM_FATFS_BENCH_SequentialWrite || i == TM_FATFS_BENCH_RandomWrite;
+            const uint32_t calls = result.Operations, sectors = result.Sectors;
+
+            printf("%s\t%s\t%u\t%llu\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\n", label, names[i], calls,
+                (unsigned long long)(sectors) * _MAX_SS, (uint32_t)(result.Micros), (uint32_t)(result.MaxMicros),
+                (uint32_t)(TM_FATFS_BENCH_KBps(&result)), (uint32_t)(TM_FATFS_BENCH_IOPS(&result)), write ? 0 : calls,
+                write ? 0 : sectors, write ? calls : 0, write ? sectors : 0);
+        }
+
+        return false;
+    }
+
+    void usage()
+    {
+        fprintf(stderr, "Usage: fs_bench [-i image] [-m size (MB)] [-f fat|fat32|exfat] [-c cluster] [-k] [-l] [-g] [-s clock (MHz)] [-d] [-n label]\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* imageName   = nullptr;
+    const char* label       = "default";
+    DWORD size              = 64;
+    DWORD cluster           = 0;
+    BYTE format             = FM_FAT32;
+    bool keep               = false;
+    bool longNames          = false;
+    bool fragmented         = false;
+    bool driver             = false;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const bool value = i + 1 < argc;
+
+        if(!strcmp(argv[i], "-i") && value)
+            imageName = argv[++i];
+        else if(!strcmp(argv[i], "-m") && value)
+            size = strtoul(argv[++i], nullptr, 0);
+        else if(!strcmp(argv[i], "-c") && value)
+            cluster = strtoul(argv[++i], nullptr, 0);
+        else if(!strcmp(argv[i], "-n") && value)
+            label = argv[++i];
+        else if(!strcmp(argv[i], "-k"))
+            keep = true;
+        else if(!strcmp(argv[i], "-l"))
+            longNames = true;
+        else if(!strcmp(argv[i], "-g"))
+            fragmented = true;
+        else if(!strcmp(argv[i], "-d"))
+            driver = true;
+        else if(!strcmp(argv[i], "-s") && value)
+            card.clock = strtoul(argv[++i], nullptr, 0);
+        else if(!strcmp(argv[i], "-f") && value)
+        {
+            const char* name = argv[++i];
+
+            if(!strcmp(name, "fat"))
+                format = FM_FAT;
+            else if(!strcmp(name, "fat32"))
+                format = FM_FAT32;
+            #if _FS_EXFAT
+            else if(!strcmp(name, "exfat"))
+                format = FM_EXFAT;
+            #endif
+            else
+            {
+                fprintf(stderr, "Unsupported format: %s\n", name);
+                return 2;
+            }
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    if(driver && keep)
+    {
+        usage();
+        return 2;
+    }
+
+    const DWORD sectors = (QWORD)(size) * 1024 * 1024 / _MAX_SS;
+    BYTE* ram = nullptr;
+
+    if(imageName)
+    {
+        if(openImage(imageName, sectors))
+        {
+            fprintf(stderr, "Can not open %s\n", imageName);
+            return 1;
+        }
+    }
+    else
+    {
+        ram = (BYTE*)(calloc(sectors, _MAX_SS));
+
+        // Attach the RAM disk to get its functions, then put the counting driver in front
+        TM_FATFS_RAMDISK_Attach(ram, sectors, TM_FATFS_Driver_USER1);
+        backend = FATFS_LowLevelDrivers[TM_FATFS_Driver_USER1];
+        keep = false;
+    }
+
+    DISKIO_LowLevelDriver_t counting = {countingInitialize, countingStatus, countingIoctl, countingWrite, countingRead};
+    TM_FATFS_AddDriver(&counting, TM_FATFS_Driver_USER1);
+
+    printf("#variant\ttest\tops\tbytes\tus\tmax_us\tKB/s\tops/s\tdrv_reads\tdrv_rd_sectors\tdrv_writes\tdrv_wr_sectors\n");
+
+    if(driver && driverBench(label, sectors))
+    {
+        fprintf(stderr, "Sector benchmark failed\n");
+        return 1;
+    }
+
+    FilesystemBench::Config config;
+    config.path         = "7:/bench";
+    config.fileSize     = 8 << 20;
+    config.longNames    = longNames;
+    config.micros       = micros;
+
+    static BYTE work[32 * _MAX_SS];
+    static FATFS fs;
+    FRESULT res = keep ? FR_OK : f_mkfs("7:", format, cluster, work, sizeof(work));
+
+    if(res == FR_OK)
+        res = f_mount(&fs, "7:", 1);
+
+    if(res == FR_OK && fragmented)
+        res = fragment(fs, config.fileSize);
+
+    if(res != FR_OK)
+    {
+        fprintf(stderr, "Can not format, mount or fragment the volume: %d\n", res);
+        return 1;
+    }
+
+    FilesystemBench bench(config);
+
+    for(uint32_t i = 0; i < FilesystemBench::TEST_COUNT && res == FR_OK; ++i)
+    {
+        const FilesystemBench::Test test = (FilesystemBench::Test)(i);
+        FilesystemBench::Result result;
+
+        counters = Counters();
+        res = bench.run(test, result);
+
+        printf("%s\t%s\t%u\t%llu\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\n", label, FilesystemBench::name(test),
+            result.operations, (unsigned long long)(result.bytes), result.micros, result.maxMicros, result.kbps(),
+            result.perSecond(), counters.reads, counters.sectorsRead, counters.writes, counters.sectorsWritten);
+    }
+
+    if(res != FR_OK)
+        fprintf(stderr, "Test failed: %d\n", res);
+    else if(fragmented)
+    {
+        // One fragment per cluster expected: at least half of them, the holes of the volume may be adjacent
+        File file;
+        const uint32_t clusters = config.fileSize / (fs.csize * _MAX_SS);
+
+        res = file.open("7:/bench/seq.bin", File::Mode::R, true);
+
+        if(res == FR_OK)
+        {
+            printf("# %s\tseq.bin\t%u clusters\t%u fragments\n", label, clusters, file.fragments());
+
+            if(file.fragments() < clusters / 2)
+            {
+                fprintf(stderr, "The sequential test file is not fragmented\n");
+                res = FR_INT_ERR;
+            }
+        }
+
+        const FRESULT closed = file.close();
+
+        if(res == FR_OK)
+            res = closed;
+    }
+
+    const FRESULT cleaned = bench.cleanup();
+    bool lost = false;
+
+    if(res == FR_OK && cleaned == FR_OK)
+    {
+        lost = powerLoss(fs);
+
+        if(lost)
+            fprintf(stderr, "Binary log records lost on power loss\n");
+    }
+
+    if(fragmented)
+    {
+        f_unlink("7:/fill_b.bin");
+        f_unlink("7:/fill_c.bin");
+    }
+
+    // f_mount() does not sync: write the cached sectors first (see Filesystem::unmount())
+    TM_FATFS_CACHE_Flush(TM_FATFS_Driver_USER1);
+    f_mount(nullptr, "7:", 1);
+
+    if(image)
+        fclose(image);
+
+    free(ram);
+    return res != FR_OK || cleaned != FR_OK || lost;
+}
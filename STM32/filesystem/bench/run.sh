@@ -0,0 +1,118 @@
+#!/bin/sh
+# Build the host file system benchmark (fs_bench.cpp) in each configuration variant, run it on a RAM disk, and
+# optionally compare the results with a baseline: the regression gate for storage performance changes.
+#
+# Usage: run.sh [-o results] [-b baseline] [-t tolerance]
+#   -o: results file (default: $BUILD/results.tsv), to be used as the next baseline
+#   -b: baseline results: a driver call or sector count above the baseline fails, as does a throughput (KB/s,
+#       or calls per second without data) more than tolerance percent below it (host timing noise)
+#   -t: tolerance, in percent (default 20)
+#
+# Environment: CC, CXX (default gcc, g++), BUILD (build directory, default /tmp/fs_bench)
+
+set -e
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+ROOT=$HERE/../..
+FATFS=$ROOT/filesystem/fatfs
+
+CC=${CC:-gcc}
+CXX=${CXX:-g++}
+BUILD=${BUILD:-/tmp/fs_bench}
+RESULTS=
+BASELINE=
+TOLERANCE=20
+
+while getopts "o:b:t:" option; do
+    case $option in
+        o) RESULTS=$OPTARG ;;
+        b) BASELINE=$OPTARG ;;
+        t) TOLERANCE=$OPTARG ;;
+        *) sed -n '4,9p' "$0"; exit 2 ;;
+    esac
+done
+
+RESULTS=${RESULTS:-$BUILD/results.tsv}
+
+# No HAL on the host: the RAM disk replaces the SD card driver (FATFS_USE_SDIO=2), cached like drive 0 on the target
+FLAGS="-O2 -include stdint.h -D__weak=__attribute__((weak)) -DFATFS_USE_SDIO=2 -I$ROOT -I$ROOT/filesystem"
+CACHE="-DFATFS_CACHE_DRIVES=(1<<7)"
+
+# name|ffconf.h and driver options|fs_bench options
+# 32 KB clusters, as on SD cards (FAT32 needs a 2 GB volume for them, the RAM disk pages are only allocated on use)
+# fragmented: on an image file (in the build directory of the variant), one-cluster fragments
+# sd24, sd48: SD card timing model at 24 and 48 MHz (high speed), virtual clock: exact throughputs on every host
+# -d: sector benchmark of the driver (diskio_bench.c), before formatting
+VARIANTS="
+default||-m 2048 -c 32768 -f fat32 -d
+fat16||-m 1024 -c 32768 -f fat
+exfat||-m 2048 -c 32768 -f exfat
+tiny|-D_FS_TINY=1|-m 2048 -c 32768 -f fat32
+nolfn|-D_USE_LFN=0 -D_FS_EXFAT=0|-m 2048 -c 32768 -f fat32
+longnames||-m 2048 -c 32768 -f fat32 -l
+nocache|-DFATFS_CACHE_DRIVES=0|-m 2048 -c 32768 -f fat32
+smallclusters||-m 64 -f fat32
+fragmented||-i fragmented.img -m 128 -c 4096 -f fat -g
+sd24||-m 2048 -c 32768 -f fat32 -s 24 -d
+sd48||-m 2048 -c 32768 -f fat32 -s 48 -d
+"
+
+mkdir -p "$BUILD"
+: > "$RESULTS"
+
+echo "$VARIANTS" | while IFS='|' read -r name defines options; do
+    [ -n "$name" ] || continue
+
+    case $defines in
+        *FATFS_CACHE_DRIVES*) ;;
+        *) defines="$defines $CACHE" ;;
+    esac
+
+    dir=$BUILD/$name
+    rm -rf "$dir"
+    mkdir -p "$dir"
+
+    # The code page conversions are only built with LFN
+    sources="ff diskio diskio_bench diskio_cache fatfs_ramdisk syscall"
+
+    case $defines in
+        *_USE_LFN=0*) ;;
+        *) sources="$sources ccsbcs" ;;
+    esac
+
+    for source in $sources; do
+        $CC $FLAGS $defines -w -c "$FATFS/$source.c" -o "$dir/$source.o"
+    done
+
+    $CXX $FLAGS $defines -std=c++11 -o "$dir/fs_bench" "$HERE/fs_bench.cpp" "$ROOT/filesystem/filesystem_bench.cpp" \
+        "$ROOT/filesystem/file.cpp" "$ROOT/filesystem/binary_log.cpp" "$ROOT/byte_array.cpp" "$dir"/*.o
+
+    # shellcheck disable=SC2086
+    # Not piped: a failed check stops the script. Run in the build directory, for the image files
+    (cd "$dir" && ./fs_bench -n "$name" $options > results.tsv)
+    grep -v '^#' "$dir/results.tsv" >> "$RESULTS"
+done
+
+printf '%-13s %-18s %10s %10s %10s %10s %10s\n' variant test KB/s ops/s max_us rd_sectors wr_sectors
+awk -F '\t' '{ printf "%-13s %-18s %10s %10s %10s %10s %10s\n", $1, $2, $7, $8, $6, $10, $12 }' "$RESULTS"
+
+[ -n "$BASELINE" ] || exit 0
+
+awk -F '\t' -v tolerance="$TOLERANCE" '
+    BEGIN { split("driver reads,sectors read,driver writes,sectors written", counts, ",") }
+
+    # Baseline first: key variant + test
+    FNR == NR { base[$1 FS $2] = $0; next }
+    {
+        key = $1 FS $2
+        if(!(key in base)) { print "new: " $1 " / " $2; next }
+        split(base[key], b, FS)
+
+        for(i = 9; i <= 12; ++i)
+            if($i + 0 > b[i] + 0) { print "FAIL " $1 " / " $2 ": " counts[i - 8] " " b[i] " -> " $i; failed = 1 }
+
+        column = $4 + 0 > 0 ? 7 : 8
+        if($column + 0 < b[column] * (100 - tolerance) / 100) { print "FAIL " $1 " / " $2 ": throughput " b[column] " -> " $column; failed = 1 }
+    }
+    END { if(failed) exit 1; print "No regression against the baseline" }
+' "$BASELINE" "$RESULTS"
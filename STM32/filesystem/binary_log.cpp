@@ -0,0 +1,515 @@
+#include "binary_log.h"
+
+#include <cstring>
+
+namespace
+{
+    constexpr uint32_t BLOCK_SIZE   = BinaryLog::BLOCK_SIZE;
+    constexpr uint32_t HEADER_SIZE  = BinaryLog::HEADER_SIZE;
+
+    // Header fields
+    constexpr uint32_t ID           = 4;
+    constexpr uint32_t SEQUENCE     = 8;
+    constexpr uint32_t TIMESTAMP    = 12;
+    constexpr uint32_t SIZE         = 20;
+    constexpr uint32_t COUNT        = 22;
+    constexpr uint32_t CRC          = 24;
+
+    const uint8_t MAGIC[4] = {'B', 'L', 'O', 'G'};
+
+    uint16_t readU16(const uint8_t* p)
+    {
+        return p[0] | ((uint16_t)(p[1]) << 8);
+    }
+
+    uint32_t readU32(const uint8_t* p)
+    {
+        return p[0] | ((uint32_t)(p[1]) << 8) | ((uint32_t)(p[2]) << 16) | ((uint32_t)(p[3]) << 24);
+    }
+
+    int64_t readI64(const uint8_t* p)
+    {
+        return (int64_t)(readU32(p) | ((uint64_t)(readU32(p + 4)) << 32));
+    }
+
+    void writeU16(uint8_t* p, uint16_t v)
+    {
+        p[0] = v;
+        p[1] = v >> 8;
+    }
+
+    void writeU32(uint8_t* p, uint32_t v)
+    {
+        writeU16(p, v);
+        writeU16(p + 2, v >> 16);
+    }
+
+    void writeI64(uint8_t* p, int64_t v)
+    {
+        writeU32(p, (uint64_t)(v));
+        writeU32(p + 4, (uint64_t)(v) >> 32);
+    }
+
+    /**
+        \brief CRC-32 (IEEE 802.3), 4 bits at a time
+        \param crc CRC of the previous data, to chain calls
+    **/
+    uint32_t crc32(const uint8_t* data, uint32_t size, uint32_t crc = 0)
+    {
+        static const uint32_t table[16] =
+        {
+            0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+            0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+        };
+
+        crc = ~crc;
+        for(uint32_t i = 0; i < size; ++i)
+        {
+            crc = table[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+            crc = table[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+        }
+        return ~crc;
+    }
+
+    uint32_t blockCRC(const uint8_t* b)
+    {
+        return crc32(b + HEADER_SIZE, readU16(b + SIZE), crc32(b, CRC));
+    }
+
+    bool validBlock(const uint8_t* b, uint32_t index, uint32_t id)
+    {
+        return  !memcmp(b, MAGIC, sizeof(MAGIC)) && readU32(b + ID) == id && readU32(b + SEQUENCE) == index &&
+                readU16(b + SIZE) <= BLOCK_SIZE - HEADER_SIZE && readU32(b + CRC) == blockCRC(b);
+    }
+
+    FRESULT readBlocks(File& file, uint32_t index, uint8_t* b, uint32_t count = 1)
+    {
+        if(auto r = file.seek((FSIZE_t)(index)*BLOCK_SIZE))
+            return r;
+
+        return (file.read(b, count*BLOCK_SIZE) == count*BLOCK_SIZE) ? FR_OK : FR_DISK_ERR;
+    }
+
+    /**
+        \brief Find the end of a log: blocks are written in order, so the valid ones are a prefix of the file
+        \param b Block buffer
+        \param id Log ID
+        \param count Number of valid blocks
+    **/
+    FRESULT findEnd(File& file, uint8_t* b, uint32_t& id, uint32_t& count)
+    {
+        const uint32_t blocks = file.size()/BLOCK_SIZE;
+        if(!blocks)
+            return FR_NO_FILE;
+
+        if(auto r = readBlocks(file, 0, b))
+            return r;
+
+        id = readU32(b + ID);
+        if(!validBlock(b, 0, id))
+            return FR_NO_FILE;
+
+        uint32_t valid = 0, invalid = blocks;
+        while(invalid - valid > 1)
+        {
+            const uint32_t middle = valid + (invalid - valid)/2;
+            if(auto r = readBlocks(file, middle, b))
+                return r;
+
+            if(validBlock(b, middle, id))
+                valid = middle;
+            else
+                invalid = middle;
+        }
+
+        count = valid + 1;
+        return FR_OK;
+    }
+}
+
+BinaryLog::BinaryLog()
+{
+}
+
+BinaryLog::~BinaryLog()
+{
+    close();
+}
+
+FRESULT BinaryLog::create(const char* filename, FSIZE_t capacity, uint32_t id)
+{
+    close();
+
+    if(auto r = m_file.open(filename, File::Mode::W))
+        return r;
+
+    const FSIZE_t bufferSize = BUFFER_BLOCKS*BLOCK_SIZE;
+    m_capacity = ((capacity + bufferSize - 1)/bufferSize)*BUFFER_BLOCKS;
+    if(!m_capacity)
+        m_capacity = BUFFER_BLOCKS;
+
+    // Contiguous, the cluster link map has a single fragment
+    FRESULT r = m_file.expand((FSIZE_t)(m_capacity)*BLOCK_SIZE);
+    if(r == FR_OK)
+        r = m_file.enableFastSeek();
+
+    if(r != FR_OK)
+    {
+        m_file.close();
+        return r;
+    }
+
+    m_id            = id;
+    m_active        = 0;
+    m_activeBlock   = 0;
+    m_current       = 0;
+    m_written       = 0;
+    m_lastTime      = INT64_MIN;
+    m_pending       = false;
+    m_open          = true;
+
+    // Mark the file as a log, and write its allocation
+    startBlock();
+    m_blockTime = 0;
+
+    if(auto r = flush())
+        return r;
+
+    return m_file.sync();
+}
+
+FRESULT BinaryLog::open(const char* filename)
+{
+    close();
+
+    if(auto r = m_file.open(filename, File::Mode::R_PLUS, true))
+        return r;
+
+    uint32_t count;
+    if(auto r = findEnd(m_file, m_buffers[0], m_id, count))
+    {
+        m_file.close();
+        return r;
+    }
+
+    const uint32_t last = count - 1;
+    m_capacity      = (m_file.size()/BLOCK_SIZE/BUFFER_BLOCKS)*BUFFER_BLOCKS;
+    m_active        = 0;
+    m_activeBlock   = last - last%BUFFER_BLOCKS;
+    m_current       = last%BUFFER_BLOCKS;
+    m_written       = m_current + 1;
+    m_sealed        = true;
+    m_pending       = false;
+
+    // The last block is final: read for its timestamps, the next records start a new block
+    if(auto r = readBlocks(m_file, last, block(m_current)))
+    {
+        m_file.close();
+        return r;
+    }
+
+    const uint8_t* b = block(m_current);
+    m_blockTime = readI64(b + TIMESTAMP);
+    m_size      = readU16(b + SIZE);
+    m_count     = readU16(b + COUNT);
+    m_lastTime  = m_count ? m_blockTime : INT64_MIN;
+
+    for(uint32_t p = HEADER_SIZE; p + RECORD_HEADER_SIZE <= HEADER_SIZE + m_size;)
+    {
+        m_lastTime = m_blockTime + readU32(b + p);
+        p += RECORD_HEADER_SIZE + readU16(b + p + 4);
+    }
+
+    m_open = true;
+    return FR_OK;
+}
+
+FRESULT BinaryLog::close()
+{
+    if(!m_open)
+        return FR_OK;
+
+    FRESULT r = flush();
+    m_open = false;
+
+    if(auto c = m_file.close())
+        return r ? r : c;
+
+    return r;
+}
+
+bool BinaryLog::append(int64_t timestamp, const void* data, uint16_t size)
+{
+    if(!m_open || size > MAX_RECORD_SIZE || timestamp < m_lastTime)
+        return true;
+
+    // Relative timestamps are 32-bit. A flushed block is on the disk: never rewritten
+    if(m_sealed || (m_count && (m_size + RECORD_HEADER_SIZE + size > BLOCK_SIZE - HEADER_SIZE ||
+                                (uint64_t)(timestamp - m_blockTime) > UINT32_MAX)))
+    {
+        if(nextBlock())
+            return true;
+    }
+
+    if(!m_count)
+        m_blockTime = timestamp;
+
+    uint8_t* p = block(m_current) + HEADER_SIZE + m_size;
+    writeU32(p, timestamp - m_blockTime);
+    writeU16(p + 4, size);
+    memcpy(p + RECORD_HEADER_SIZE, data, size);
+
+    m_size     += RECORD_HEADER_SIZE + size;
+    m_lastTime  = timestamp;
+    ++m_count;
+
+    return false;
+}
+
+FRESULT BinaryLog::process()
+{
+    if(!m_open)
+        return FR_INVALID_OBJECT;
+
+    return writePending();
+}
+
+FRESULT BinaryLog::flush()
+{
+    if(!m_open)
+        return FR_INVALID_OBJECT;
+
+    if(auto r = writePending())
+        return r;
+
+    // The blocks before m_written are on the disk. The partial block is written once, and closed: rewriting it
+    // in place would lose its previous records too if the power failed during the write
+    if(!m_sealed)
+    {
+        sealBlock();
+
+        if(auto r = m_file.seek((FSIZE_t)(m_activeBlock + m_written)*BLOCK_SIZE))
+            return r;
+
+        if(auto r = m_file.write(block(m_written), (m_current + 1 - m_written)*BLOCK_SIZE))
+            return r;
+
+        m_written   = m_current + 1;
+        m_sealed    = true;
+    }
+
+    // The size of the file does not change: no need to update its directory entry
+    return m_file.syncData();
+}
+
+uint32_t BinaryLog::blocks() const
+{
+    return m_open ? m_activeBlock + m_current + 1 : 0;
+}
+
+uint32_t BinaryLog::capacity() const
+{
+    return m_capacity;
+}
+
+uint8_t* BinaryLog::block(uint32_t index)
+{
+    return m_buffers[m_active] + index*BLOCK_SIZE;
+}
+
+void BinaryLog::sealBlock()
+{
+    uint8_t* b = block(m_current);
+
+    writeI64(b + TIMESTAMP, m_blockTime);
+    writeU16(b + SIZE, m_size);
+    writeU16(b + COUNT, m_count);
+    writeU32(b + CRC, blockCRC(b));
+}
+
+bool BinaryLog::nextBlock()
+{
+    if(m_activeBlock + m_current + 1 >= m_capacity)
+        return true;
+
+    sealBlock();
+
+    if(m_current + 1 < BUFFER_BLOCKS)
+        ++m_current;
+    else
+    {
+        // Swap the half buffers: the other one must have been written
+        if(writePending())
+            return true;
+
+        // None left if the last block was flushed
+        m_pendingBlock  = m_activeBlock + m_written;
+        m_pendingCount  = BUFFER_BLOCKS - m_written;
+        m_pending       = m_pendingCount != 0;
+        m_active       ^= 1;
+        m_activeBlock  += BUFFER_BLOCKS;
+        m_current       = 0;
+        m_written       = 0;
+    }
+
+    startBlock();
+    return false;
+}
+
+void BinaryLog::startBlock()
+{
+    uint8_t* b = block(m_current);
+
+    memset(b, 0, HEADER_SIZE);
+    memcpy(b, MAGIC, sizeof(MAGIC));
+    writeU32(b + ID, m_id);
+    writeU32(b + SEQUENCE, m_activeBlock + m_current);
+
+    m_size      = 0;
+    m_count     = 0;
+    m_sealed    = false;
+}
+
+FRESULT BinaryLog::writePending()
+{
+    if(!m_pending)
+        return FR_OK;
+
+    if(auto r = m_file.seek((FSIZE_t)(m_pendingBlock)*BLOCK_SIZE))
+        return r;
+
+    const uint8_t* data = m_buffers[m_active ^ 1] + (BUFFER_BLOCKS - m_pendingCount)*BLOCK_SIZE;
+    if(auto r = m_file.write(data, m_pendingCount*BLOCK_SIZE))
+        return r;
+
+    m_pending = false;
+    return FR_OK;
+}
+
+BinaryLogReader::BinaryLogReader()
+{
+}
+
+FRESULT BinaryLogReader::open(const char* filename)
+{
+    close();
+
+    if(auto r = m_file.open(filename, File::Mode::R, true))
+        return r;
+
+    if(auto r = findEnd(m_file, m_block, m_id, m_blocks))
+    {
+        m_file.close();
+        m_blocks = 0;
+        return r;
+    }
+
+    return loadBlock(0);
+}
+
+FRESULT BinaryLogReader::close()
+{
+    m_blocks = 0;
+    m_loaded = 0xFFFFFFFF;
+    return m_file.close();
+}
+
+FRESULT BinaryLogReader::seek(int64_t timestamp)
+{
+    if(!m_blocks)
+        return FR_INVALID_OBJECT;
+
+    // Last block starting at or before the timestamp
+    uint32_t before = 0, after = m_blocks;
+    while(after - before > 1)
+    {
+        const uint32_t middle = before + (after - before)/2;
+        if(auto r = loadBlock(middle))
+            return r;
+
+        if(readI64(m_block + TIMESTAMP) <= timestamp)
+            before = middle;
+        else
+            after = middle;
+    }
+
+    if(auto r = loadBlock(before))
+        return r;
+
+    BinaryLog::Record record;
+    while(!peek(record) && record.timestamp < timestamp)
+        m_position += BinaryLog::RECORD_HEADER_SIZE + record.size;
+
+    return FR_OK;
+}
+
+bool BinaryLogReader::read(BinaryLog::Record& record)
+{
+    if(peek(record))
+        return true;
+
+    m_position += BinaryLog::RECORD_HEADER_SIZE + record.size;
+    return false;
+}
+
+bool BinaryLogReader::read(int64_t end, BinaryLog::Record& record)
+{
+    if(peek(record) || record.timestamp >= end)
+        return true;
+
+    m_position += BinaryLog::RECORD_HEADER_SIZE + record.size;
+    return false;
+}
+
+uint32_t BinaryLogReader::blocks() const
+{
+    return m_blocks;
+}
+
+FRESULT BinaryLogReader::loadBlock(uint32_t index)
+{
+    if(m_loaded == index)
+    {
+        m_position = HEADER_SIZE;
+        return FR_OK;
+    }
+
+    m_loaded = 0xFFFFFFFF;
+
+    if(auto r = readBlocks(m_file, index, m_block))
+        return r;
+
+    if(!validBlock(m_block, index, m_id))
+        return FR_INT_ERR;
+
+    m_loaded    = index;
+    m_position  = HEADER_SIZE;
+    return FR_OK;
+}
+
+bool BinaryLogReader::peek(BinaryLog::Record& record)
+{
+    for(;;)
+    {
+        if(m_loaded >= m_blocks)
+            return true;
+
+        const uint32_t end = HEADER_SIZE + readU16(m_block + SIZE);
+        if(m_position + BinaryLog::RECORD_HEADER_SIZE <= end)
+        {
+            const uint8_t* p = m_block + m_position;
+
+            record.timestamp    = readI64(m_block + TIMESTAMP) + readU32(p);
+            record.size         = readU16(p + 4);
+            record.data         = p + BinaryLog::RECORD_HEADER_SIZE;
+
+            return m_position + BinaryLog::RECORD_HEADER_SIZE + record.size > end;
+        }
+
+        if(m_loaded + 1 >= m_blocks || loadBlock(m_loaded + 1))
+        {
+            m_loaded = 0xFFFFFFFF;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,230 @@
+/**
+    \file binary_log.h
+    \version 1.0
+**/
+#ifndef GUARD_BINARY_LOG
+#define GUARD_BINARY_LOG
+
+#include "file.h"
+
+/**
+    \brief Append-only log of timestamped binary records
+
+    The log file is preallocated in contiguous clusters when it is created: appending never changes the FAT nor
+    the directory entry, and blocks are written with whole sector writes, straight to the disk. Fast seek is
+    enabled (see File::enableFastSeek()): seeks do not follow the FAT chain.
+
+    The file is a sequence of 512-byte blocks. Each block starts with a header (all fields little-endian):
+    magic "BLOG", log ID (u32), sequence number (u32, index of the block in the file), timestamp of the first
+    record (i64), size of the records (u16), number of records (u16), CRC-32 of the header (CRC field excluded)
+    and the records (u32), reserved (4 bytes). Records follow: timestamp relative to the block timestamp (u32),
+    size (u16), data.
+
+    Records are assembled in one half of a double buffer of BUFFER_BLOCKS blocks, while the other half, full,
+    waits to be written by process() (or by the next append() that needs it). flush() writes the partial block
+    too, records are only durable after it. A block on the disk is never rewritten, so a write interrupted by a
+    power loss can not damage the records already flushed: the records appended after a flush start a new block.
+    Each flush uses a block, partly empty: flush every few seconds, not after every record.
+
+    After a power loss, the log is valid up to the last block written with its CRC, sequence number and ID: the
+    end of the log is found by a binary search when the file is opened. The log ID, given on creation, rejects
+    the blocks left at the same place by a previous log.
+
+    BinaryLogReader finds a timestamp by a binary search on the block timestamps, with a few sector reads.
+**/
+class BinaryLog
+{
+    public:
+        static constexpr uint32_t BLOCK_SIZE            = 512;
+        static constexpr uint32_t HEADER_SIZE           = 32;
+        static constexpr uint32_t RECORD_HEADER_SIZE    = 6;
+        static constexpr uint32_t MAX_RECORD_SIZE       = BLOCK_SIZE - HEADER_SIZE - RECORD_HEADER_SIZE;   ///< Maximum record data size
+        static constexpr uint32_t BUFFER_BLOCKS         = 4;    ///< Blocks per half buffer
+
+        /**
+            \brief Record, as read by BinaryLogReader
+        **/
+        struct Record
+        {
+            int64_t         timestamp;
+            uint16_t        size;
+            const uint8_t*  data;   ///< Valid until the next read
+        };
+
+    public:
+        BinaryLog();
+
+        /**
+            No copy.
+        **/
+        BinaryLog(const BinaryLog&) = delete;
+
+        ~BinaryLog();
+
+        /**
+            \brief Create a log, replacing any file with the same name
+            \param filename Path to the file
+            \param capacity Maximum size of the file, in bytes (rounded up to the buffer size)
+            \param id Log identifier, different from the previous logs at the same place (e.g. creation time,
+            Rng output)
+            \returns Error code (FR_DENIED if there is no contiguous area large enough). See FatFS documentation
+        **/
+        FRESULT create(const char* filename, FSIZE_t capacity, uint32_t id);
+
+        /**
+            \brief Open an existing log, to append records after the last valid block
+            \param filename Path to the file
+            \returns Error code (FR_NO_FILE if the file is not a log). See FatFS documentation
+        **/
+        FRESULT open(const char* filename);
+
+        /**
+            \brief Write the buffered records and close the log
+            \returns Error code. See FatFS documentation
+        **/
+        FRESULT close();
+
+        /**
+            \brief Append a record
+            \param timestamp Record timestamp (any unit, e.g. us), not before the previous one
+            \param data Record data
+            \param size Size of the data, up to MAX_RECORD_SIZE
+            \returns \c true on error (log not open or full, invalid parameter, write error), \c false otherwise
+        **/
+        bool append(int64_t timestamp, const void* data, uint16_t size);
+
+        /**
+            \brief Write the full half buffer, if any (main loop)
+            \returns Error code. See FatFS documentation
+        **/
+        FRESULT process();
+
+        /**
+            \brief Write all the records, including the partial block, which is closed
+            \returns Error code. See FatFS documentation
+        **/
+        FRESULT flush();
+
+        /**
+            \returns Number of blocks used, including the partial one
+        **/
+        uint32_t blocks() const;
+
+        /**
+            \returns Number of blocks of the file
+        **/
+        uint32_t capacity() const;
+
+        bool isOpen() const { return m_open; }
+
+    private:
+        /**
+            \returns Header of a block of the active half buffer
+        **/
+        uint8_t* block(uint32_t index);
+
+        /**
+            \brief Set the size, number of records and CRC of the current block
+        **/
+        void sealBlock();
+
+        /**
+            \brief Start the next block, writing the other half buffer if needed
+            \returns \c true on error (log full, write error), \c false otherwise
+        **/
+        bool nextBlock();
+
+        void startBlock();
+
+        FRESULT writePending();
+
+        File        m_file;
+        bool        m_open              = false;
+        uint32_t    m_id                = 0;
+        uint32_t    m_capacity          = 0;    ///< In blocks
+
+        alignas(4) uint8_t m_buffers[2][BUFFER_BLOCKS*BLOCK_SIZE];  ///< Word aligned, for the SD card DMA
+        uint8_t     m_active            = 0;    ///< Half buffer being filled
+        uint32_t    m_activeBlock       = 0;    ///< Index in the file of the first block of the active half buffer
+        uint32_t    m_current           = 0;    ///< Index of the current block in the active half buffer
+        uint32_t    m_written           = 0;    ///< Number of blocks of the active half buffer on the disk, final
+        bool        m_sealed            = false;    ///< Current block on the disk: the next record starts a new one
+        uint16_t    m_size              = 0;    ///< Size of the records of the current block
+        uint16_t    m_count             = 0;    ///< Number of records of the current block
+        int64_t     m_blockTime         = 0;    ///< Timestamp of the current block
+        int64_t     m_lastTime          = 0;
+
+        bool        m_pending           = false;    ///< Other half buffer full, not written yet
+        uint32_t    m_pendingBlock      = 0;    ///< Index in the file of the first block to write
+        uint32_t    m_pendingCount      = 0;    ///< Number of blocks to write
+};
+
+/**
+    \brief Reader of logs written by BinaryLog, with time-range queries
+
+    A log can not be read while it is open for writing (FatFS file lock): close it first, or read a copy.
+**/
+class BinaryLogReader
+{
+    public:
+        BinaryLogReader();
+
+        /**
+            No copy.
+        **/
+        BinaryLogReader(const BinaryLogReader&) = delete;
+
+        /**
+            \brief Open a log, positioned on the first record
+            \param filename Path to the file
+            \returns Error code (FR_NO_FILE if the file is not a log). See FatFS documentation
+        **/
+        FRESULT open(const char* filename);
+
+        FRESULT close();
+
+        /**
+            \brief Position the reader on the first record at or after a timestamp
+            \param timestamp Timestamp
+            \returns Error code. See FatFS documentation
+        **/
+        FRESULT seek(int64_t timestamp);
+
+        /**
+            \brief Read the next record
+            \param record Record
+            \returns \c true at the end of the log or on error, \c false otherwise
+        **/
+        bool read(BinaryLog::Record& record);
+
+        /**
+            \brief Read the next record before a timestamp (e.g. after seek(), for a time range)
+            \param end End of the range (excluded)
+            \param record Record
+            \returns \c true at the end of the range or of the log, or on error, \c false otherwise
+        **/
+        bool read(int64_t end, BinaryLog::Record& record);
+
+        /**
+            \returns Number of valid blocks
+        **/
+        uint32_t blocks() const;
+
+    private:
+        FRESULT loadBlock(uint32_t index);
+
+        /**
+            \brief Get the next record, without moving past it
+            \returns \c true at the end of the log or on error, \c false otherwise
+        **/
+        bool peek(BinaryLog::Record& record);
+
+        File        m_file;
+        uint32_t    m_id            = 0;
+        uint32_t    m_blocks        = 0;
+        uint32_t    m_loaded        = 0xFFFFFFFF;   ///< Index of the block in m_block
+        uint16_t    m_position      = 0;            ///< Offset of the next record in m_block
+        uint8_t     m_block[BinaryLog::BLOCK_SIZE];
+};
+
+#endif
@@ -8,6 +8,7 @@
 /*-----------------------------------------------------------------------*/
 
 #include "diskio.h"		/* FatFs lower layer API */
+#include "diskio_cache.h"
 #include "ff.h"
 
 /* Not USB in use */
@@ -169,6 +170,8 @@ DSTATUS disk_initialize (
 {
 	/* Return low level status */
 	if (FATFS_LowLevelDrivers[pdrv].disk_initialize) {
+		/* The medium may have been replaced */
+		TM_FATFS_CACHE_Invalidate(pdrv);
 		return FATFS_LowLevelDrivers[pdrv].disk_initialize();
 	}
 	
@@ -207,13 +210,8 @@ DRESULT disk_read (
 		return RES_PARERR;
 	}
 	
-	/* Return low level status */
-	if (FATFS_LowLevelDrivers[pdrv].disk_read) {
-		return FATFS_LowLevelDrivers[pdrv].disk_read(buff, sector, count);
-	}
-	
-	/* Return parameter error */
-	return RES_PARERR;
+	/* Read through the sector cache */
+	return TM_FATFS_CACHE_Read(pdrv, buff, sector, count);
 }
 
 
@@ -234,13 +232,8 @@ DRESULT disk_write (
 		return RES_PARERR;
 	}
 	
-	/* Return low level status */
-	if (FATFS_LowLevelDrivers[pdrv].disk_write) {
-		return FATFS_LowLevelDrivers[pdrv].disk_write(buff, sector, count);
-	}
-	
-	/* Return parameter error */
-	return RES_PARERR;
+	/* Write through the sector cache */
+	return TM_FATFS_CACHE_Write(pdrv, buff, sector, count);
 }
 #endif
 
@@ -255,6 +248,14 @@ DRESULT disk_ioctl (
 	void *buff		/* Buffer to send/receive control data */
 )
 {
+	/* Write the cached sectors before the low level driver sync */
+	if (cmd == CTRL_SYNC) {
+		DRESULT res = TM_FATFS_CACHE_Flush(pdrv);
+		if (res != RES_OK) {
+			return res;
+		}
+	}
+	
 	/* Return low level status */
 	if (FATFS_LowLevelDrivers[pdrv].disk_ioctl) {
 		return FATFS_LowLevelDrivers[pdrv].disk_ioctl(cmd, buff);
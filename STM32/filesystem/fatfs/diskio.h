@@ -43,6 +43,9 @@ typedef struct {
 	DRESULT (*disk_read)(BYTE *, DWORD, UINT);
 } DISKIO_LowLevelDriver_t;
 
+/* Low level drivers, indexed by physical drive number */
+extern DISKIO_LowLevelDriver_t FATFS_LowLevelDrivers[_VOLUMES];
+
 /**
  * @brief  Custom drivers for fatfs
  */
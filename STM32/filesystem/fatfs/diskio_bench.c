@@ -0,0 +1,155 @@
+/*-----------------------------------------------------------------------*/
+/* Sector throughput and IOPS benchmark for the low level disk drivers   */
+/*-----------------------------------------------------------------------*/
+
+#include "diskio_bench.h"
+#include "diskio_cache.h"
+
+/* Reproducible pseudo-random positions (xorshift32) */
+static DWORD Next(DWORD* state) {
+	DWORD x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static DRESULT Transfer(BYTE pdrv, const TM_FATFS_BENCH_Config_t* config, BYTE write, DWORD sector, UINT count, TM_FATFS_BENCH_Result_t* result) {
+	DWORD start, time;
+	DRESULT res;
+
+	start = config->Micros();
+	if (write) {
+		res = FATFS_LowLevelDrivers[pdrv].disk_write(config->Buffer, sector, count);
+	} else {
+		res = FATFS_LowLevelDrivers[pdrv].disk_read(config->Buffer, sector, count);
+	}
+	time = config->Micros() - start;
+
+	if (time > result->MaxMicros) {
+		result->MaxMicros = time;
+	}
+	result->Operations++;
+	result->Sectors += count;
+	return res;
+}
+
+static DRESULT Sequential(BYTE pdrv, const TM_FATFS_BENCH_Config_t* config, BYTE write, TM_FATFS_BENCH_Result_t* result) {
+	DWORD sector, count;
+	DRESULT res;
+
+	for (sector = 0; sector < config->Sectors; sector += count) {
+		count = config->Sectors - sector;
+		if (count > config->BufferSectors) {
+			count = config->BufferSectors;
+		}
+
+		res = Transfer(pdrv, config, write, config->Start + sector, count, result);
+		if (res != RES_OK) {
+			return res;
+		}
+	}
+
+	return RES_OK;
+}
+
+static DRESULT Random(BYTE pdrv, const TM_FATFS_BENCH_Config_t* config, BYTE write, TM_FATFS_BENCH_Result_t* result) {
+	DWORD state = 0x2545F491, slots, i;
+	DRESULT res;
+
+	slots = config->Sectors / config->RandomSectors;
+
+	for (i = 0; i < config->RandomOperations; i++) {
+		res = Transfer(pdrv, config, write, config->Start + (Next(&state) % slots) * config->RandomSectors, config->RandomSectors, result);
+		if (res != RES_OK) {
+			return res;
+		}
+	}
+
+	return RES_OK;
+}
+
+DRESULT TM_FATFS_BENCH_Run(BYTE pdrv, const TM_FATFS_BENCH_Config_t* Config, TM_FATFS_BENCH_Result_t* Results) {
+	TM_FATFS_BENCH_Result_t* result;
+	DWORD start;
+	DRESULT res = RES_OK;
+	UINT i;
+	int test;
+
+	if (
+		pdrv >= _VOLUMES ||
+		!FATFS_LowLevelDrivers[pdrv].disk_read ||
+		!FATFS_LowLevelDrivers[pdrv].disk_write ||
+		!FATFS_LowLevelDrivers[pdrv].disk_ioctl ||
+		!Config->Buffer || !Config->Micros ||
+		!Config->BufferSectors ||
+		!Config->RandomSectors || Config->RandomSectors > Config->BufferSectors ||
+		Config->Sectors < Config->RandomSectors
+	) {
+		return RES_PARERR;
+	}
+
+	/* Write the file system sectors the tests could overwrite */
+	res = TM_FATFS_CACHE_Flush(pdrv);
+	if (res != RES_OK) {
+		return res;
+	}
+
+	/* Recognizable data, for the write tests */
+	for (i = 0; i < Config->BufferSectors * _MAX_SS; i++) {
+		Config->Buffer[i] = (BYTE) i;
+	}
+
+	for (test = 0; test < TM_FATFS_BENCH_Count && res == RES_OK; test++) {
+		result = &Results[test];
+		result->Operations = 0;
+		result->Sectors = 0;
+		result->MaxMicros = 0;
+
+		start = Config->Micros();
+		switch (test) {
+			case TM_FATFS_BENCH_SequentialRead:
+				res = Sequential(pdrv, Config, 0, result);
+				break;
+
+			case TM_FATFS_BENCH_SequentialWrite:
+				res = Sequential(pdrv, Config, 1, result);
+				break;
+
+			case TM_FATFS_BENCH_RandomRead:
+				res = Random(pdrv, Config, 0, result);
+				break;
+
+			case TM_FATFS_BENCH_RandomWrite:
+				res = Random(pdrv, Config, 1, result);
+				break;
+		}
+
+		/* Writes are done once the data is programmed */
+		if (res == RES_OK && (test == TM_FATFS_BENCH_SequentialWrite || test == TM_FATFS_BENCH_RandomWrite)) {
+			res = FATFS_LowLevelDrivers[pdrv].disk_ioctl(CTRL_SYNC, 0);
+		}
+		result->Micros = Config->Micros() - start;
+	}
+
+	/* The cached sectors of the test area are outdated */
+	TM_FATFS_CACHE_Invalidate(pdrv);
+
+	return res;
+}
+
+DWORD TM_FATFS_BENCH_KBps(const TM_FATFS_BENCH_Result_t* Result) {
+	if (!Result->Micros) {
+		return 0;
+	}
+	return (DWORD) ((QWORD) Result->Sectors * _MAX_SS * 1000000 / 1024 / Result->Micros);
+}
+
+DWORD TM_FATFS_BENCH_IOPS(const TM_FATFS_BENCH_Result_t* Result) {
+	if (!Result->Micros) {
+		return 0;
+	}
+	return (DWORD) ((QWORD) Result->Operations * 1000000 / Result->Micros);
+}
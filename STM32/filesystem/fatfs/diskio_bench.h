@@ -0,0 +1,95 @@
+/*-----------------------------------------------------------------------/
+/  Sector throughput and IOPS benchmark for the low level disk drivers   /
+/-----------------------------------------------------------------------*/
+
+#ifndef _DISKIO_BENCH_DEFINED
+#define _DISKIO_BENCH_DEFINED
+
+/* C++ detection */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "diskio.h"
+
+/**
+ * Measures a low level driver of the driver table (see diskio.h), below FatFs and the sector cache:
+ *  - sequential reads and writes of BufferSectors sectors per driver call (multi-block transfers),
+ *  - random reads and writes of RandomSectors sectors per call, at pseudo-random positions aligned on RandomSectors.
+ *
+ * Write tests end with CTRL_SYNC, included in their time: the SD card driver returns before the card has
+ * programmed the data. The content of the test area is destroyed, the cached sectors of the drive are flushed before
+ * and dropped after the tests: use an area outside the file system, or format it afterwards.
+ *
+ * The RAM disk (see fatfs_ramdisk.h) is the card stand-in on a host: it gives the overhead of the driver table and
+ * of the benchmark itself.
+ *
+ * Usage (drive initialized, e.g. after f_mount):
+ *  TM_FATFS_BENCH_Config_t config = {Start, 8192, Buffer, 64, 1, 1000, Micros};
+ *  TM_FATFS_BENCH_Run(0, &config, results);
+ *  TM_FATFS_BENCH_KBps(&results[TM_FATFS_BENCH_SequentialRead]);
+ */
+
+/**
+ * @brief  Benchmark tests, index of their result
+ */
+typedef enum {
+	TM_FATFS_BENCH_SequentialRead = 0,
+	TM_FATFS_BENCH_SequentialWrite,
+	TM_FATFS_BENCH_RandomRead,
+	TM_FATFS_BENCH_RandomWrite,
+	TM_FATFS_BENCH_Count
+} TM_FATFS_BENCH_Test_t;
+
+/**
+ * @brief  Benchmark parameters
+ */
+typedef struct {
+	DWORD Start;				/*!< First sector of the test area */
+	DWORD Sectors;				/*!< Size of the test area, in sectors, read entirely by the sequential tests */
+	BYTE* Buffer;				/*!< Buffer of BufferSectors sectors, word aligned for the DMA */
+	UINT BufferSectors;			/*!< Sectors per sequential transfer */
+	UINT RandomSectors;			/*!< Sectors per random transfer, up to BufferSectors (1: 512 bytes, 8: 4 KB) */
+	DWORD RandomOperations;		/*!< Number of random transfers per random test */
+	DWORD (*Micros)(void);		/*!< Time, in us (e.g. System::micros() on the target) */
+} TM_FATFS_BENCH_Config_t;
+
+/**
+ * @brief  Result of a test
+ */
+typedef struct {
+	DWORD Operations;			/*!< Driver calls */
+	DWORD Sectors;				/*!< Sectors transferred */
+	DWORD Micros;				/*!< Duration of the test, in us */
+	DWORD MaxMicros;			/*!< Slowest driver call, in us */
+} TM_FATFS_BENCH_Result_t;
+
+/**
+ * @brief  Runs all the tests on a physical drive
+ * @param  pdrv: Physical drive number, initialized
+ * @param  *Config: Benchmark parameters
+ * @param  *Results: Results of the tests, TM_FATFS_BENCH_Count entries indexed by @ref TM_FATFS_BENCH_Test_t
+ * @retval RES_OK on success, RES_PARERR for invalid parameters, error of the low level driver otherwise
+ */
+DRESULT TM_FATFS_BENCH_Run(BYTE pdrv, const TM_FATFS_BENCH_Config_t* Config, TM_FATFS_BENCH_Result_t* Results);
+
+/**
+ * @brief  Gets the throughput of a test
+ * @param  *Result: Result of the test
+ * @retval Throughput, in KB/s
+ */
+DWORD TM_FATFS_BENCH_KBps(const TM_FATFS_BENCH_Result_t* Result);
+
+/**
+ * @brief  Gets the number of operations per second of a test
+ * @param  *Result: Result of the test
+ * @retval Driver calls per second
+ */
+DWORD TM_FATFS_BENCH_IOPS(const TM_FATFS_BENCH_Result_t* Result);
+
+/* C++ detection */
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,303 @@
+/*-----------------------------------------------------------------------*/
+/* Write-back sector cache for the low level disk I/O module             */
+/*-----------------------------------------------------------------------*/
+
+#include "diskio_cache.h"
+#include <string.h>
+
+/* Entry flags */
+#define CACHE_VALID		0x01
+#define CACHE_DIRTY		0x02
+
+/* Driver statistics */
+static TM_FATFS_CACHE_Stats_t Stats;
+
+static DRESULT DriverRead(BYTE pdrv, BYTE* buff, DWORD sector, UINT count) {
+	if (!FATFS_LowLevelDrivers[pdrv].disk_read) {
+		return RES_PARERR;
+	}
+
+	Stats.DriverReads++;
+	Stats.SectorsRead += count;
+	return FATFS_LowLevelDrivers[pdrv].disk_read(buff, sector, count);
+}
+
+static DRESULT DriverWrite(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count) {
+	if (!FATFS_LowLevelDrivers[pdrv].disk_write) {
+		return RES_PARERR;
+	}
+
+	Stats.DriverWrites++;
+	Stats.SectorsWritten += count;
+	return FATFS_LowLevelDrivers[pdrv].disk_write(buff, sector, count);
+}
+
+#if FATFS_CACHE_SECTORS > 0
+
+/* Sector size, in words */
+#define CACHE_WORDS		((int) (_MAX_SS / sizeof(DWORD)))
+
+typedef struct {
+	DWORD Sector;
+	DWORD Used;			/* Access stamp, for LRU eviction */
+	BYTE Drive;
+	BYTE Flags;
+} CACHE_Entry_t;
+
+static CACHE_Entry_t Entries[FATFS_CACHE_SECTORS];
+static DWORD Data[FATFS_CACHE_SECTORS][CACHE_WORDS];	/* Word aligned, for the DMA */
+static DWORD Stamp;
+
+#define IS_CACHED(pdrv)	((FATFS_CACHE_DRIVES >> (pdrv)) & 1)
+
+static int Find(BYTE pdrv, DWORD sector) {
+	int i;
+
+	for (i = 0; i < FATFS_CACHE_SECTORS; i++) {
+		if ((Entries[i].Flags & CACHE_VALID) && Entries[i].Drive == pdrv && Entries[i].Sector == sector) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void Touch(int i) {
+	Entries[i].Used = ++Stamp;
+}
+
+/* Exchanges two entries and their data, without a sector sized buffer */
+static void Swap(int a, int b) {
+	CACHE_Entry_t e;
+	DWORD w;
+	int i;
+
+	e = Entries[a];
+	Entries[a] = Entries[b];
+	Entries[b] = e;
+
+	for (i = 0; i < CACHE_WORDS; i++) {
+		w = Data[a][i];
+		Data[a][i] = Data[b][i];
+		Data[b][i] = w;
+	}
+}
+
+/* Orders the dirty entries of a drive by sector, at the start of the cache, so that consecutive sectors are contiguous in memory */
+static int SortDirty(BYTE pdrv) {
+	int count = 0, i, j, min;
+
+	for (i = 0; i < FATFS_CACHE_SECTORS; i++) {
+		if ((Entries[i].Flags & CACHE_DIRTY) && Entries[i].Drive == pdrv) {
+			if (i != count) {
+				Swap(i, count);
+			}
+			count++;
+		}
+	}
+
+	/* Selection sort: a few entries, and at most count data swaps */
+	for (i = 0; i < count - 1; i++) {
+		min = i;
+		for (j = i + 1; j < count; j++) {
+			if (Entries[j].Sector < Entries[min].Sector) {
+				min = j;
+			}
+		}
+		if (min != i) {
+			Swap(i, min);
+		}
+	}
+
+	return count;
+}
+
+static DRESULT Flush(BYTE pdrv) {
+	int count, i, j, k;
+	DRESULT res;
+
+	count = SortDirty(pdrv);
+
+	for (i = 0; i < count; i = j) {
+		/* Run of consecutive sectors */
+		for (j = i + 1; j < count && Entries[j].Sector == Entries[j - 1].Sector + 1; j++);
+
+		res = DriverWrite(pdrv, (const BYTE*) Data[i], Entries[i].Sector, j - i);
+		if (res != RES_OK) {
+			return res;
+		}
+
+		for (k = i; k < j; k++) {
+			Entries[k].Flags &= ~CACHE_DIRTY;
+		}
+	}
+
+	return RES_OK;
+}
+
+/* Gets a free entry, evicting the least recently used one */
+static DRESULT Allocate(BYTE pdrv, DWORD sector, int* entry) {
+	int i, victim = 0;
+	DRESULT res;
+
+	for (i = 0; i < FATFS_CACHE_SECTORS; i++) {
+		if (!(Entries[i].Flags & CACHE_VALID)) {
+			victim = i;
+			break;
+		}
+		if (Entries[i].Used < Entries[victim].Used) {
+			victim = i;
+		}
+	}
+
+	if (Entries[victim].Flags & CACHE_DIRTY) {
+		/* Write all the dirty sectors of the drive together, the victim is clean afterwards */
+		res = Flush(Entries[victim].Drive);
+		if (res != RES_OK) {
+			return res;
+		}
+
+		/* Flush reorders the entries: look for the least recently used one again */
+		return Allocate(pdrv, sector, entry);
+	}
+
+	Entries[victim].Drive = pdrv;
+	Entries[victim].Sector = sector;
+	Entries[victim].Flags = CACHE_VALID;
+	Touch(victim);
+	*entry = victim;
+
+	return RES_OK;
+}
+
+DRESULT TM_FATFS_CACHE_Read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count) {
+	DRESULT res;
+	UINT n;
+	int i;
+
+	Stats.Reads += count;
+
+	if (!IS_CACHED(pdrv)) {
+		return DriverRead(pdrv, buff, sector, count);
+	}
+
+	if (count > 1) {
+		/* Multi sector reads are file data: not cached, but the cache holds the latest version of dirty sectors */
+		res = DriverRead(pdrv, buff, sector, count);
+		if (res != RES_OK) {
+			return res;
+		}
+
+		for (i = 0; i < FATFS_CACHE_SECTORS; i++) {
+			if ((Entries[i].Flags & CACHE_DIRTY) && Entries[i].Drive == pdrv && Entries[i].Sector - sector < count) {
+				n = Entries[i].Sector - sector;
+				memcpy(buff + n * _MAX_SS, Data[i], _MAX_SS);
+			}
+		}
+		return RES_OK;
+	}
+
+	i = Find(pdrv, sector);
+	if (i >= 0) {
+		Stats.Hits++;
+	} else {
+		res = Allocate(pdrv, sector, &i);
+		if (res != RES_OK) {
+			return res;
+		}
+
+		res = DriverRead(pdrv, (BYTE*) Data[i], sector, 1);
+		if (res != RES_OK) {
+			Entries[i].Flags = 0;
+			return res;
+		}
+	}
+
+	Touch(i);
+	memcpy(buff, Data[i], _MAX_SS);
+	return RES_OK;
+}
+
+DRESULT TM_FATFS_CACHE_Write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count) {
+	DRESULT res;
+	UINT n;
+	int i;
+
+	Stats.Writes += count;
+
+	if (!IS_CACHED(pdrv)) {
+		return DriverWrite(pdrv, buff, sector, count);
+	}
+
+	if (count >= FATFS_CACHE_SECTORS) {
+		/* Large writes would flush the whole cache anyway: write directly, cached copies are outdated */
+		for (i = 0; i < FATFS_CACHE_SECTORS; i++) {
+			if ((Entries[i].Flags & CACHE_VALID) && Entries[i].Drive == pdrv && Entries[i].Sector - sector < count) {
+				Entries[i].Flags = 0;
+			}
+		}
+		return DriverWrite(pdrv, buff, sector, count);
+	}
+
+	for (n = 0; n < count; n++) {
+		i = Find(pdrv, sector + n);
+		if (i >= 0) {
+			Stats.Hits++;
+		} else {
+			res = Allocate(pdrv, sector + n, &i);
+			if (res != RES_OK) {
+				return res;
+			}
+		}
+
+		Touch(i);
+		memcpy(Data[i], buff + n * _MAX_SS, _MAX_SS);
+		Entries[i].Flags |= CACHE_DIRTY;
+	}
+
+	return RES_OK;
+}
+
+DRESULT TM_FATFS_CACHE_Flush(BYTE pdrv) {
+	return Flush(pdrv);
+}
+
+void TM_FATFS_CACHE_Invalidate(BYTE pdrv) {
+	int i;
+
+	for (i = 0; i < FATFS_CACHE_SECTORS; i++) {
+		if (Entries[i].Drive == pdrv) {
+			Entries[i].Flags = 0;
+		}
+	}
+}
+
+#else
+
+DRESULT TM_FATFS_CACHE_Read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count) {
+	Stats.Reads += count;
+	return DriverRead(pdrv, buff, sector, count);
+}
+
+DRESULT TM_FATFS_CACHE_Write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count) {
+	Stats.Writes += count;
+	return DriverWrite(pdrv, buff, sector, count);
+}
+
+DRESULT TM_FATFS_CACHE_Flush(BYTE pdrv) {
+	(void) pdrv;
+	return RES_OK;
+}
+
+void TM_FATFS_CACHE_Invalidate(BYTE pdrv) {
+	(void) pdrv;
+}
+
+#endif /* FATFS_CACHE_SECTORS */
+
+void TM_FATFS_CACHE_GetStats(TM_FATFS_CACHE_Stats_t* stats) {
+	*stats = Stats;
+}
+
+void TM_FATFS_CACHE_ResetStats(void) {
+	memset(&Stats, 0, sizeof(Stats));
+}
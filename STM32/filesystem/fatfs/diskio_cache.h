@@ -0,0 +1,95 @@
+/*-----------------------------------------------------------------------/
+/  Write-back sector cache for the low level disk I/O module             /
+/-----------------------------------------------------------------------*/
+
+#ifndef _DISKIO_CACHE_DEFINED
+#define _DISKIO_CACHE_DEFINED
+
+/* C++ detection */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "diskio.h"
+
+/**
+ * The cache sits between disk_read/disk_write and the low level drivers (see diskio.c):
+ *  - single sector reads (FAT, directory, partial file sectors) are cached, multi sector reads go to the driver,
+ *  - writes of less than FATFS_CACHE_SECTORS sectors are kept in the cache (dirty) until a flush or an eviction.
+ *    A flush writes each run of consecutive dirty sectors with a single multi-block driver call, so small
+ *    appends to a file end up as a few large writes instead of many single sector read-modify-write cycles,
+ *  - larger writes go straight to the driver, cached copies of their sectors are dropped.
+ *
+ * The cache is flushed by CTRL_SYNC (f_sync, f_close), when a dirty sector is evicted, and by TM_FATFS_CACHE_Flush.
+ * Data not flushed is lost on power loss: close or sync files as usual.
+ */
+
+/* Number of cached sectors (_MAX_SS bytes each), 0 to disable the cache */
+/* Define it in defines.h project file to change it */
+#ifndef FATFS_CACHE_SECTORS
+	#define FATFS_CACHE_SECTORS			8
+#endif
+
+/* Cached physical drives, one bit per drive (bit 0: SD card) */
+#ifndef FATFS_CACHE_DRIVES
+	#define FATFS_CACHE_DRIVES			(1 << 0)
+#endif
+
+/**
+ * @brief  Cache statistics, since startup or the latest @ref TM_FATFS_CACHE_ResetStats call
+ */
+typedef struct {
+	DWORD Reads;			/*!< Sectors read by FatFs */
+	DWORD Writes;			/*!< Sectors written by FatFs */
+	DWORD Hits;				/*!< Sectors read or written in the cache */
+	DWORD DriverReads;		/*!< Low level driver read calls */
+	DWORD DriverWrites;		/*!< Low level driver write calls */
+	DWORD SectorsRead;		/*!< Sectors read by the low level driver */
+	DWORD SectorsWritten;	/*!< Sectors written by the low level driver */
+} TM_FATFS_CACHE_Stats_t;
+
+/**
+ * @brief  Reads sectors through the cache
+ * @note   Called by disk_read, same parameters
+ */
+DRESULT TM_FATFS_CACHE_Read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count);
+
+/**
+ * @brief  Writes sectors through the cache
+ * @note   Called by disk_write, same parameters
+ */
+DRESULT TM_FATFS_CACHE_Write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count);
+
+/**
+ * @brief  Writes the dirty sectors of a drive
+ * @param  pdrv: Physical drive number
+ * @retval RES_OK on success, error of the low level driver otherwise (the sectors stay dirty)
+ */
+DRESULT TM_FATFS_CACHE_Flush(BYTE pdrv);
+
+/**
+ * @brief  Drops the cached sectors of a drive, dirty or not (e.g. when the card is replaced)
+ * @param  pdrv: Physical drive number
+ * @retval None
+ */
+void TM_FATFS_CACHE_Invalidate(BYTE pdrv);
+
+/**
+ * @brief  Gets the cache statistics
+ * @param  *Stats: Pointer to @ref TM_FATFS_CACHE_Stats_t structure to fill
+ * @retval None
+ */
+void TM_FATFS_CACHE_GetStats(TM_FATFS_CACHE_Stats_t* Stats);
+
+/**
+ * @brief  Resets the cache statistics
+ * @retval None
+ */
+void TM_FATFS_CACHE_ResetStats(void);
+
+/* C++ detection */
+#ifdef __cplusplus
+}
+#endif
+
+#endif
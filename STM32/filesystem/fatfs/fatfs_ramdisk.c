@@ -0,0 +1,123 @@
+/*-----------------------------------------------------------------------*/
+/* RAM disk driver for the low level disk I/O module                     */
+/*-----------------------------------------------------------------------*/
+
+#include "fatfs_ramdisk.h"
+#include <string.h>
+
+typedef struct {
+	BYTE* Memory;
+	DWORD Sectors;
+} RAMDISK_t;
+
+/* One disk per custom driver: the driver functions have no drive parameter, each disk has its own */
+static RAMDISK_t Disks[2];
+
+static DSTATUS Status(const RAMDISK_t* disk) {
+	return disk->Memory ? 0 : STA_NOINIT;
+}
+
+static DRESULT Ioctl(const RAMDISK_t* disk, BYTE cmd, void *buff) {
+	if (!disk->Memory) {
+		return RES_NOTRDY;
+	}
+
+	switch (cmd) {
+		case CTRL_SYNC:
+			return RES_OK;
+
+		case GET_SECTOR_COUNT:
+			*(DWORD*) buff = disk->Sectors;
+			return RES_OK;
+
+		case GET_SECTOR_SIZE:
+			*(WORD*) buff = _MAX_SS;
+			return RES_OK;
+
+		case GET_BLOCK_SIZE:
+			*(DWORD*) buff = 1;
+			return RES_OK;
+
+		default:
+			return RES_PARERR;
+	}
+}
+
+static DRESULT Read(const RAMDISK_t* disk, BYTE *buff, DWORD sector, UINT count) {
+	if (!disk->Memory) {
+		return RES_NOTRDY;
+	}
+	if (sector >= disk->Sectors || count > disk->Sectors - sector) {
+		return RES_PARERR;
+	}
+
+	memcpy(buff, disk->Memory + sector * _MAX_SS, count * _MAX_SS);
+	return RES_OK;
+}
+
+static DRESULT Write(const RAMDISK_t* disk, const BYTE *buff, DWORD sector, UINT count) {
+	if (!disk->Memory) {
+		return RES_NOTRDY;
+	}
+	if (sector >= disk->Sectors || count > disk->Sectors - sector) {
+		return RES_PARERR;
+	}
+
+	memcpy(disk->Memory + sector * _MAX_SS, buff, count * _MAX_SS);
+	return RES_OK;
+}
+
+/* USER1 */
+static DSTATUS USER1_disk_status(void) {
+	return Status(&Disks[0]);
+}
+
+static DRESULT USER1_disk_ioctl(BYTE cmd, void *buff) {
+	return Ioctl(&Disks[0], cmd, buff);
+}
+
+static DRESULT USER1_disk_read(BYTE *buff, DWORD sector, UINT count) {
+	return Read(&Disks[0], buff, sector, count);
+}
+
+static DRESULT USER1_disk_write(const BYTE *buff, DWORD sector, UINT count) {
+	return Write(&Disks[0], buff, sector, count);
+}
+
+/* USER2 */
+static DSTATUS USER2_disk_status(void) {
+	return Status(&Disks[1]);
+}
+
+static DRESULT USER2_disk_ioctl(BYTE cmd, void *buff) {
+	return Ioctl(&Disks[1], cmd, buff);
+}
+
+static DRESULT USER2_disk_read(BYTE *buff, DWORD sector, UINT count) {
+	return Read(&Disks[1], buff, sector, count);
+}
+
+static DRESULT USER2_disk_write(const BYTE *buff, DWORD sector, UINT count) {
+	return Write(&Disks[1], buff, sector, count);
+}
+
+void TM_FATFS_RAMDISK_Attach(BYTE* memory, DWORD sectors, TM_FATFS_Driver_t DriverName) {
+	/* Initialization only checks the memory: same as the status */
+	DISKIO_LowLevelDriver_t drivers[2] = {
+		{USER1_disk_status, USER1_disk_status, USER1_disk_ioctl, USER1_disk_write, USER1_disk_read},
+		{USER2_disk_status, USER2_disk_status, USER2_disk_ioctl, USER2_disk_write, USER2_disk_read}
+	};
+	int index;
+
+	if (DriverName == TM_FATFS_Driver_USER1) {
+		index = 0;
+	} else if (DriverName == TM_FATFS_Driver_USER2) {
+		index = 1;
+	} else {
+		return;
+	}
+
+	Disks[index].Memory = memory;
+	Disks[index].Sectors = sectors;
+	TM_FATFS_AddDriver(&drivers[index], DriverName);
+}
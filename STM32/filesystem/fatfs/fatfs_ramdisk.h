@@ -0,0 +1,40 @@
+/*-----------------------------------------------------------------------/
+/  RAM disk driver for the low level disk I/O module                     /
+/-----------------------------------------------------------------------*/
+
+#ifndef TM_FATFS_RAMDISK_H
+#define TM_FATFS_RAMDISK_H 100
+
+/* C++ detection */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "diskio.h"
+
+/**
+ * Volume in a RAM buffer (_MAX_SS bytes per sector), attached as a custom driver. Useful for temporary files,
+ * and to measure the file system and the sector cache (see diskio_cache.h) without the SD card, e.g. on a host.
+ * Each custom driver (USER1, USER2) can hold its own RAM disk.
+ *
+ * Usage:
+ *  TM_FATFS_RAMDISK_Attach(buffer, sizeof(buffer) / _MAX_SS, TM_FATFS_Driver_USER1);
+ *  f_mkfs("7:", FM_ANY, 0, work, sizeof(work));
+ *  f_mount(&fs, "7:", 1);
+ */
+
+/**
+ * @brief  Attaches a RAM disk as a custom driver, replacing the disk previously attached to this driver if any
+ * @param  *Memory: Disk content
+ * @param  Sectors: Size of the disk, in sectors
+ * @param  DriverName: Drive to use: TM_FATFS_Driver_USER1 or TM_FATFS_Driver_USER2, other values are ignored
+ * @retval None
+ */
+void TM_FATFS_RAMDISK_Attach(BYTE* Memory, DWORD Sectors, TM_FATFS_Driver_t DriverName);
+
+/* C++ detection */
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -17,6 +17,7 @@
  * |----------------------------------------------------------------------
  */
 #include "fatfs_sd_sdio.h"
+#include <string.h>
 
 #if SD_USE_DETECT
     #define SD_DETECT_PORT  GPIOB
@@ -32,6 +33,18 @@
 static volatile DSTATUS Stat = STA_NOINIT;
 static SD_HandleTypeDef uSdHandle;
 
+#if FATFS_SDIO_DMA
+static DMA_HandleTypeDef dmaRxHandle;
+static DMA_HandleTypeDef dmaTxHandle;
+
+/* End of the DMA transfer, set by the HAL callbacks */
+static volatile uint8_t TransferDone;
+static volatile uint8_t TransferError;
+
+/* Word aligned sector, for the buffers the DMA can not access */
+static uint32_t ScratchBuffer[SD_BLOCK_SIZE / 4];
+#endif
+
 /**
   * @brief  Initializes the SD card device.
   * @retval SD status
@@ -62,7 +75,79 @@ uint8_t BSP_SD_Init(void)
 	if (HAL_SD_Init(&uSdHandle) != HAL_OK)
 		return MSD_ERROR;
 
-	return (HAL_SD_ConfigWideBusOperation(&uSdHandle, SDIO_BUS_WIDE_4B) != HAL_OK) ? MSD_ERROR : MSD_OK;
+	if (HAL_SD_ConfigWideBusOperation(&uSdHandle, SDIO_BUS_WIDE_4B) != HAL_OK)
+		return MSD_ERROR;
+
+	uSdHandle.Init.BusWide = SDIO_BUS_WIDE_4B;
+
+#if FATFS_SDIO_HIGH_SPEED
+	/* Cards without high speed support stay at the default clock */
+	BSP_SD_HighSpeed();
+#endif
+
+	return MSD_OK;
+}
+
+/**
+  * @brief  Switches the card to high speed mode (CMD6) and the bus clock to SDIO_CK = SDIOCLK (48 MHz).
+  * @retval SD status (MSD_ERROR if the card does not support it, the clock is unchanged)
+  */
+uint8_t BSP_SD_HighSpeed(void)
+{
+	SDIO_DataInitTypeDef config;
+	uint32_t status[16];
+	uint32_t count = 0;
+	uint32_t tickstart = HAL_GetTick();
+
+	/* Switch functions (CMD6) appeared with the version 1.10 of the specification: only sure on v2.0 cards */
+	if (uSdHandle.SdCard.CardVersion != CARD_V2_X)
+		return MSD_ERROR;
+
+	/* 512-bit switch status */
+	if (SDMMC_CmdBlockLength(uSdHandle.Instance, sizeof(status)) != HAL_SD_ERROR_NONE)
+		return MSD_ERROR;
+
+	config.DataTimeOut   = SDMMC_DATATIMEOUT;
+	config.DataLength    = sizeof(status);
+	config.DataBlockSize = SDIO_DATABLOCK_SIZE_64B;
+	config.TransferDir   = SDIO_TRANSFER_DIR_TO_SDIO;
+	config.TransferMode  = SDIO_TRANSFER_MODE_BLOCK;
+	config.DPSM          = SDIO_DPSM_ENABLE;
+	SDIO_ConfigData(uSdHandle.Instance, &config);
+
+	/* Set function 1 (high speed) of group 1 (access mode), other groups unchanged */
+	if (SDMMC_CmdSwitch(uSdHandle.Instance, 0x80FFFFF1) != HAL_SD_ERROR_NONE)
+		return MSD_ERROR;
+
+	while (!__HAL_SD_GET_FLAG(&uSdHandle, SDIO_FLAG_RXOVERR | SDIO_FLAG_DCRCFAIL | SDIO_FLAG_DTIMEOUT | SDIO_FLAG_DBCKEND))
+	{
+		if (__HAL_SD_GET_FLAG(&uSdHandle, SDIO_FLAG_RXDAVL) && count < 16)
+			status[count++] = SDIO_ReadFIFO(uSdHandle.Instance);
+
+		if (HAL_GetTick() - tickstart >= SD_TIMEOUT)
+			break;
+	}
+
+	while (__HAL_SD_GET_FLAG(&uSdHandle, SDIO_FLAG_RXDAVL) && count < 16)
+		status[count++] = SDIO_ReadFIFO(uSdHandle.Instance);
+
+	if (!__HAL_SD_GET_FLAG(&uSdHandle, SDIO_FLAG_DBCKEND) || count < 16)
+	{
+		__HAL_SD_CLEAR_FLAG(&uSdHandle, SDIO_STATIC_FLAGS);
+		SDMMC_CmdBlockLength(uSdHandle.Instance, SD_BLOCK_SIZE);
+		return MSD_ERROR;
+	}
+
+	__HAL_SD_CLEAR_FLAG(&uSdHandle, SDIO_STATIC_FLAGS);
+	SDMMC_CmdBlockLength(uSdHandle.Instance, SD_BLOCK_SIZE);
+
+	/* Bits 379:376, function selected in group 1: the status bytes are received MSB first, 4 per FIFO word */
+	if ((status[4] & 0x0F) != 1)
+		return MSD_ERROR;
+
+	/* The card switches within 8 clocks: raise the clock */
+	uSdHandle.Init.ClockBypass = SDIO_CLOCK_BYPASS_ENABLE;
+	return (SDIO_Init(uSdHandle.Instance, uSdHandle.Init) != HAL_OK) ? MSD_ERROR : MSD_OK;
 }
 
 /**
@@ -111,6 +196,82 @@ uint8_t BSP_SD_WriteBlocks(uint32_t *pData, uint64_t sector, uint32_t NumOfBlock
     return (HAL_SD_WriteBlocks(&uSdHandle, (uint8_t *)pData, sector, NumOfBlocks, Timeout) != HAL_OK) ? MSD_ERROR : MSD_OK;
 }
 
+#if FATFS_SDIO_DMA
+/**
+  * @brief  Waits for the end of the DMA transfer, aborting it on error or timeout.
+  * @retval SD status
+  */
+static uint8_t SD_WaitTransfer(void)
+{
+    uint32_t tickstart = HAL_GetTick();
+
+    while (!TransferDone)
+    {
+        if (TransferError || HAL_GetTick() - tickstart >= SD_TIMEOUT)
+        {
+            HAL_SD_Abort(&uSdHandle);
+            return MSD_ERROR;
+        }
+    }
+
+    return MSD_OK;
+}
+
+/**
+  * @brief  Reads block(s) from a specified address in an SD card, in DMA mode (multi-block read for several blocks).
+  * @param  pData: Pointer to the buffer that will contain the data, word aligned
+  * @param  sector: Address of the first block
+  * @param  NumOfBlocks: Number of SD blocks to read
+  * @retval SD status, at the end of the transfer (transfer complete interrupt)
+  */
+uint8_t BSP_SD_ReadBlocks_DMA(uint32_t *pData, uint64_t sector, uint32_t NumOfBlocks)
+{
+    TransferDone = 0;
+    TransferError = 0;
+
+    if (HAL_SD_ReadBlocks_DMA(&uSdHandle, (uint8_t *)pData, sector, NumOfBlocks) != HAL_OK)
+        return MSD_ERROR;
+
+    return SD_WaitTransfer();
+}
+
+/**
+  * @brief  Writes block(s) to a specified address in an SD card, in DMA mode (multi-block write for several blocks).
+  * @param  pData: Pointer to the buffer that contains the data, word aligned
+  * @param  sector: Address of the first block
+  * @param  NumOfBlocks: Number of SD blocks to write
+  * @retval SD status, at the end of the transfer. The card may still be programming the data (see BSP_SD_GetStatus)
+  */
+uint8_t BSP_SD_WriteBlocks_DMA(uint32_t *pData, uint64_t sector, uint32_t NumOfBlocks)
+{
+    TransferDone = 0;
+    TransferError = 0;
+
+    if (HAL_SD_WriteBlocks_DMA(&uSdHandle, (uint8_t *)pData, sector, NumOfBlocks) != HAL_OK)
+        return MSD_ERROR;
+
+    return SD_WaitTransfer();
+}
+
+void HAL_SD_RxCpltCallback(SD_HandleTypeDef *hsd)
+{
+    (void)hsd;
+    TransferDone = 1;
+}
+
+void HAL_SD_TxCpltCallback(SD_HandleTypeDef *hsd)
+{
+    (void)hsd;
+    TransferDone = 1;
+}
+
+void HAL_SD_ErrorCallback(SD_HandleTypeDef *hsd)
+{
+    (void)hsd;
+    TransferError = 1;
+}
+#endif
+
 /**
   * @brief  Erases the specified memory area of the given SD card. 
   * @param  StartAddr: Start byte address
@@ -172,6 +333,44 @@ __weak void BSP_SD_MspInit(SD_HandleTypeDef *hsd, void *Params)
     /* NVIC configuration for SDIO interrupts */
     HAL_NVIC_SetPriority(SDMMC1_IRQn, 5, 0);
     HAL_NVIC_EnableIRQ(SDMMC1_IRQn);
+
+#if FATFS_SDIO_DMA
+    /* DMA streams, with the SDIO as flow controller */
+    __DMAx_TxRx_CLK_ENABLE();
+
+    dmaRxHandle.Instance                 = SD_DMAx_Rx_STREAM;
+    dmaRxHandle.Init.Channel             = SD_DMAx_Rx_CHANNEL;
+    dmaRxHandle.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+    dmaRxHandle.Init.PeriphInc           = DMA_PINC_DISABLE;
+    dmaRxHandle.Init.MemInc              = DMA_MINC_ENABLE;
+    dmaRxHandle.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+    dmaRxHandle.Init.MemDataAlignment    = DMA_MDATAALIGN_WORD;
+    dmaRxHandle.Init.Mode                = DMA_PFCTRL;
+    dmaRxHandle.Init.Priority            = DMA_PRIORITY_VERY_HIGH;
+    dmaRxHandle.Init.FIFOMode            = DMA_FIFOMODE_ENABLE;
+    dmaRxHandle.Init.FIFOThreshold       = DMA_FIFO_THRESHOLD_FULL;
+    dmaRxHandle.Init.MemBurst            = DMA_MBURST_INC4;
+    dmaRxHandle.Init.PeriphBurst         = DMA_PBURST_INC4;
+
+    __HAL_LINKDMA(hsd, hdmarx, dmaRxHandle);
+    HAL_DMA_DeInit(&dmaRxHandle);
+    HAL_DMA_Init(&dmaRxHandle);
+
+    dmaTxHandle.Instance                 = SD_DMAx_Tx_STREAM;
+    dmaTxHandle.Init                     = dmaRxHandle.Init;
+    dmaTxHandle.Init.Channel             = SD_DMAx_Tx_CHANNEL;
+    dmaTxHandle.Init.Direction           = DMA_MEMORY_TO_PERIPH;
+
+    __HAL_LINKDMA(hsd, hdmatx, dmaTxHandle);
+    HAL_DMA_DeInit(&dmaTxHandle);
+    HAL_DMA_Init(&dmaTxHandle);
+
+    /* Lower priority than the SDIO interrupt, that ends the transfers */
+    HAL_NVIC_SetPriority(SD_DMAx_Rx_IRQn, 6, 0);
+    HAL_NVIC_EnableIRQ(SD_DMAx_Rx_IRQn);
+    HAL_NVIC_SetPriority(SD_DMAx_Tx_IRQn, 6, 0);
+    HAL_NVIC_EnableIRQ(SD_DMAx_Tx_IRQn);
+#endif
 }
 
 /**
@@ -195,6 +394,13 @@ __weak void BSP_SD_MspDeInit(SD_HandleTypeDef *hsd, void *Params)
     /* Disable NVIC for SDIO interrupts */
     HAL_NVIC_DisableIRQ(SDMMC1_IRQn);
 
+#if FATFS_SDIO_DMA
+    HAL_NVIC_DisableIRQ(SD_DMAx_Rx_IRQn);
+    HAL_NVIC_DisableIRQ(SD_DMAx_Tx_IRQn);
+    HAL_DMA_DeInit(&dmaRxHandle);
+    HAL_DMA_DeInit(&dmaTxHandle);
+#endif
+
     /* DeInit GPIO pins can be done in the application
     (by surcharging this __weak function) */
 
@@ -280,6 +486,18 @@ static uint8_t SDCARD_IsWriteEnabled(void)
 /**************************************************************/
 /*                    LOW LEVEL FUNCTIONS                     */
 /**************************************************************/
+/* Waits until the card can take a command: the programming of the latest write is done */
+static uint8_t SD_WaitReady(void)
+{
+	uint32_t tickstart = HAL_GetTick();
+
+	while (BSP_SD_GetStatus() != MSD_OK)
+		if (HAL_GetTick() - tickstart >= SD_TIMEOUT)
+			return MSD_ERROR;
+
+	return MSD_OK;
+}
+
 DSTATUS TM_FATFS_SD_SDIO_disk_initialize(void)
 {
 	Stat = STA_NOINIT;
@@ -295,10 +513,13 @@ DSTATUS TM_FATFS_SD_SDIO_disk_initialize(void)
 
 DSTATUS TM_FATFS_SD_SDIO_disk_status(void)
 {
+	HAL_SD_CardStateTypeDef state;
+
 	Stat = STA_NOINIT;
 
-	/* Check SDCARD status */
-	if (BSP_SD_GetStatus() == MSD_OK)
+	/* Check SDCARD status: still programming the latest write is fine (see TM_FATFS_SD_SDIO_disk_write) */
+	state = HAL_SD_GetCardState(&uSdHandle);
+	if (state == HAL_SD_CARD_TRANSFER || state == HAL_SD_CARD_PROGRAMMING)
 		Stat &= ~STA_NOINIT;
 	else
 		Stat |= STA_NOINIT;
@@ -325,7 +546,7 @@ DRESULT TM_FATFS_SD_SDIO_disk_ioctl(BYTE cmd, void *buff)
     {
 		/* Make sure that no pending write process */
 		case CTRL_SYNC :
-			res = RES_OK;
+			res = (SD_WaitReady() == MSD_OK) ? RES_OK : RES_ERROR;
 			break;
 
 		/* Size in bytes for single sector */
@@ -353,29 +574,61 @@ DRESULT TM_FATFS_SD_SDIO_disk_ioctl(BYTE cmd, void *buff)
 	return res;
 }
 
+/* Writes return at the end of the transfer, without waiting for the card to program the data: the card is
+   busy while FatFs prepares the next request, the next command (or CTRL_SYNC) waits for it */
 DRESULT TM_FATFS_SD_SDIO_disk_read(BYTE *buff, DWORD sector, UINT count)
 {
-    uint32_t timeout = 100000;
-	if (BSP_SD_ReadBlocks((uint32_t *)buff, sector, count, 1000) != MSD_OK)
+	if (SD_WaitReady() != MSD_OK)
 		return RES_ERROR;
 
-	while (BSP_SD_GetStatus() != MSD_OK)
-        if (timeout-- == 0)
-            return RES_ERROR;
+#if FATFS_SDIO_DMA
+	if ((uint32_t) buff & 3)
+	{
+		/* The DMA transfers words: go through the word aligned sector */
+		for (; count; count--, sector++, buff += SD_BLOCK_SIZE)
+		{
+			if (BSP_SD_ReadBlocks_DMA(ScratchBuffer, sector, 1) != MSD_OK || SD_WaitReady() != MSD_OK)
+				return RES_ERROR;
+
+			memcpy(buff, ScratchBuffer, SD_BLOCK_SIZE);
+		}
+		return RES_OK;
+	}
+
+	if (BSP_SD_ReadBlocks_DMA((uint32_t *)buff, sector, count) != MSD_OK)
+		return RES_ERROR;
+#else
+	if (BSP_SD_ReadBlocks((uint32_t *)buff, sector, count, SD_TIMEOUT) != MSD_OK)
+		return RES_ERROR;
+#endif
 
 	return RES_OK;
 }
 
 DRESULT TM_FATFS_SD_SDIO_disk_write(const BYTE *buff, DWORD sector, UINT count)
 {
-    uint32_t timeout = 100000;
-
-	if (BSP_SD_WriteBlocks((uint32_t *)buff, sector, count, 1000) != MSD_OK)
+	if (SD_WaitReady() != MSD_OK)
 		return RES_ERROR;
 
-	while (BSP_SD_GetStatus() != MSD_OK)
-        if (timeout-- == 0)
-            return RES_ERROR;
+#if FATFS_SDIO_DMA
+	if ((uint32_t) buff & 3)
+	{
+		for (; count; count--, sector++, buff += SD_BLOCK_SIZE)
+		{
+			memcpy(ScratchBuffer, buff, SD_BLOCK_SIZE);
+
+			if (BSP_SD_WriteBlocks_DMA(ScratchBuffer, sector, 1) != MSD_OK || SD_WaitReady() != MSD_OK)
+				return RES_ERROR;
+		}
+		return RES_OK;
+	}
+
+	if (BSP_SD_WriteBlocks_DMA((uint32_t *)buff, sector, count) != MSD_OK)
+		return RES_ERROR;
+#else
+	if (BSP_SD_WriteBlocks((uint32_t *)buff, sector, count, SD_TIMEOUT) != MSD_OK)
+		return RES_ERROR;
+#endif
 
 	return RES_OK;
 }
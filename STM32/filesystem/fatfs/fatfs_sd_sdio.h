@@ -46,6 +46,21 @@ extern "C" {
 #define MSD_ERROR_SD_NOT_PRESENT      ((uint8_t)0x02)
    
 #define SD_DATATIMEOUT           ((uint32_t)100000000)
+
+/* Timeout of a transfer, and of the card programming after a write, in ms */
+#define SD_TIMEOUT               ((uint32_t)1000)
+
+/* Transfer the sectors with the DMA (1) or by polling the FIFO (0) */
+/* Define it in defines.h project file to change it */
+#ifndef FATFS_SDIO_DMA
+	#define FATFS_SDIO_DMA				1
+#endif
+
+/* Switch the cards that support it to high speed: 4-bit bus at SDIO_CK = 48 MHz instead of 24 MHz */
+/* Define it in defines.h project file to change it */
+#ifndef FATFS_SDIO_HIGH_SPEED
+	#define FATFS_SDIO_HIGH_SPEED		1
+#endif
     
 /* DMA definitions for SD DMA transfer */
 #define __DMAx_TxRx_CLK_ENABLE            __HAL_RCC_DMA2_CLK_ENABLE
@@ -70,6 +85,9 @@ void    BSP_SD_DetectIT(void);
 void    BSP_SD_DetectCallback(void);
 uint8_t BSP_SD_ReadBlocks(uint32_t *pData, uint64_t ReadAddr, uint32_t NumOfBlocks, uint32_t Timeout);
 uint8_t BSP_SD_WriteBlocks(uint32_t *pData, uint64_t WriteAddr, uint32_t NumOfBlocks, uint32_t Timeout);
+uint8_t BSP_SD_ReadBlocks_DMA(uint32_t *pData, uint64_t ReadAddr, uint32_t NumOfBlocks);
+uint8_t BSP_SD_WriteBlocks_DMA(uint32_t *pData, uint64_t WriteAddr, uint32_t NumOfBlocks);
+uint8_t BSP_SD_HighSpeed(void);
 uint8_t BSP_SD_Erase(uint64_t StartAddr, uint64_t EndAddr);
 void    BSP_SD_IRQHandler(void);
 void    BSP_SD_DMA_Tx_IRQHandler(void);
@@ -43,7 +43,7 @@
 /* This option switches f_mkfs() function. (0:Disable or 1:Enable) */
 
 
-#define	_USE_FASTSEEK	0
+#define	_USE_FASTSEEK	1
 /* This option switches fast seek function. (0:Disable or 1:Enable) */
 
 
@@ -98,7 +98,10 @@
 */
 
 
+/* _USE_LFN, _FS_TINY and _FS_EXFAT can be set by the build, e.g. -D_FS_TINY=1 (see filesystem/bench) */
+#ifndef _USE_LFN
 #define	_USE_LFN	3
+#endif
 #define	_MAX_LFN	255
 /* The _USE_LFN switches the support of long file name (LFN).
 /
@@ -202,14 +205,18 @@
 / System Configurations
 /---------------------------------------------------------------------------*/
 
+#ifndef _FS_TINY
 #define	_FS_TINY	0
+#endif
 /* This option switches tiny buffer configuration. (0:Normal or 1:Tiny)
 /  At the tiny configuration, size of file object (FIL) is reduced _MAX_SS bytes.
 /  Instead of private sector buffer eliminated from the file object, common sector
 /  buffer in the file system object (FATFS) is used for the file data transfer. */
 
 
+#ifndef _FS_EXFAT
 #define _FS_EXFAT	1
+#endif
 /* This option switches support of exFAT file system. (0:Disable or 1:Enable)
 /  When enable exFAT, also LFN needs to be enabled. (_USE_LFN >= 1)
 /  Note that enabling exFAT discards C89 compatibility. */
@@ -1,6 +1,26 @@
 #include "file.h"
 
+extern "C"
+{
+    #include "fatfs/diskio.h"
+}
+
 #include <algorithm>
+#include <cstdlib>
+
+namespace
+{
+    File::Sink* s_sink = nullptr;   ///< Sink of the current forward()
+
+    UINT forwardHandler(const BYTE* data, UINT size)
+    {
+        // Sense call: can the sink take data?
+        if(!size)
+            return s_sink->ready() ? 1 : 0;
+
+        return s_sink->write(data, size);
+    }
+}
 
 File::File()
 {
@@ -11,7 +31,7 @@ File::~File()
     close();
 }
 
-FRESULT File::open(const char* const filename, Mode::Value mode)
+FRESULT File::open(const char* const filename, Mode::Value mode, bool fastSeek)
 {
     if(isOpen())
         close();
@@ -21,19 +41,33 @@ FRESULT File::open(const char* const filename, Mode::Value mode)
     if(r == FR_OK)
         m_open = true;
 
+    if(r == FR_OK && fastSeek)
+    {
+        r = enableFastSeek();
+        if(r != FR_OK)
+            close();
+    }
+
     return r;
 }
 
 FRESULT File::close()
 {
-    return f_close(&m_file);
+    if(!isOpen())
+        return FR_OK;
+
+    m_open = false;
+    FRESULT r = f_close(&m_file);
+
+    disableFastSeek();
+    return r;
 }
 
 uint32_t File::read(uint8_t* data, uint32_t maxData)
 {
-    UINT d = 0;
+    uint32_t d = 0;
 
-    if(f_read(&m_file, reinterpret_cast<void*>(data), maxData, &d) != FR_OK)
+    if(read(data, maxData, d) != FR_OK)
         return 0;
 
     return d;
@@ -46,26 +80,159 @@ FRESULT File::read(ByteArray& data, uint32_t maxData)
     if(maxData == 0)
         return FR_OK;
 
+    // The allocation of data is kept: a buffer read again and again is not reallocated
     data.resize(std::min((FSIZE_t)maxData, size() - tell()));
 
-    UINT d = 0;
+    uint32_t d = 0;
 
-    if(auto r = f_read(&m_file, reinterpret_cast<void*>(data.internalBuffer()), data.size(), &d))
+    if(auto r = read(data.internalBuffer(), data.size(), d))
     {
         data.clear();
         return r;
     }
 
     data.resize(d);
-    data.shrink();
     
     return FR_OK;
 }
 
+FRESULT File::read(void* data, uint32_t size, uint32_t& read)
+{
+    UINT d = 0;
+    FRESULT r = f_read(&m_file, data, size, &d);
+
+    read = d;
+    return r;
+}
+
+FRESULT File::forward(Sink& sink, uint32_t size, uint32_t& forwarded)
+{
+    if(s_sink)
+        return FR_LOCKED;
+
+    s_sink = &sink;
+
+    UINT d = 0;
+    FRESULT r = f_forward(&m_file, forwardHandler, size, &d);
+
+    s_sink      = nullptr;
+    forwarded   = d;
+    return r;
+}
+
 FRESULT File::write(const ByteArray& data)
+{
+    return write(data.internalBuffer(), data.size());
+}
+
+FRESULT File::write(const void* data, uint32_t size)
 {
     UINT d;
-    return f_write(&m_file, reinterpret_cast<const void*>(data.internalBuffer()), data.size(), &d);
+    if(auto r = f_write(&m_file, data, size, &d))
+        return r;
+
+    return (d == size) ? FR_OK : FR_DENIED;
+}
+
+FRESULT File::expand(FSIZE_t size)
+{
+    return f_expand(&m_file, size, 1);
+}
+
+FRESULT File::sync()
+{
+    return f_sync(&m_file);
+}
+
+// FIL::flag bit private to ff.c, checked against this revision: update syncData() with FatFS
+#if _FATFS != 68020
+#error "File::syncData() depends on the FA_DIRTY flag of FatFS R0.12b"
+#endif
+
+FRESULT File::syncData()
+{
+    if(!isOpen())
+        return FR_INVALID_OBJECT;
+
+#if _FS_TINY
+    // Partial sectors are written in the file system window, not in FIL::buf
+    const bool dirty = m_file.obj.fs->wflag;
+#else
+    // FA_DIRTY: partial sector in FIL::buf, not written yet
+    constexpr BYTE FA_DIRTY = 0x80;
+    const bool dirty = m_file.flag & FA_DIRTY;
+#endif
+
+    if(dirty)
+        return sync();
+
+    return (disk_ioctl(m_file.obj.fs->drv, CTRL_SYNC, nullptr) == RES_OK) ? FR_OK : FR_DISK_ERR;
+}
+
+FRESULT File::enableFastSeek()
+{
+    if(!isOpen())
+        return FR_INVALID_OBJECT;
+
+    disableFastSeek();
+
+    // With an empty table, FatFS only computes the size of the map
+    DWORD size = 0;
+    m_file.cltbl = &size;
+    FRESULT r = f_lseek(&m_file, CREATE_LINKMAP);
+    m_file.cltbl = nullptr;
+
+    if(r != FR_NOT_ENOUGH_CORE)
+        return r;
+
+    m_linkMap = reinterpret_cast<DWORD*>(malloc(size*sizeof(DWORD)));
+    if(!m_linkMap)
+        return FR_NOT_ENOUGH_CORE;
+
+    m_linkMap[0]    = size;
+    m_file.cltbl    = m_linkMap;
+
+    r = f_lseek(&m_file, CREATE_LINKMAP);
+    if(r != FR_OK)
+        disableFastSeek();
+
+    return r;
+}
+
+void File::disableFastSeek()
+{
+    m_file.cltbl = nullptr;
+
+    free(m_linkMap);
+    m_linkMap = nullptr;
+}
+
+uint32_t File::fragments() const
+{
+    // Size of the map, then (length, first cluster) per fragment, then 0
+    return m_linkMap ? (m_linkMap[0] - 2)/2 : 0;
+}
+
+uint32_t File::seekCost(FSIZE_t p) const
+{
+    if(!isOpen() || m_linkMap || !p)
+        return 0;
+
+#if _FS_EXFAT
+    // Contiguous exFAT files have no FAT chain
+    if(m_file.obj.stat == 2)
+        return 0;
+#endif
+
+    // Same as f_lseek(): from the current cluster when moving forward, from the start of the file otherwise
+    const FSIZE_t clusterSize   = (FSIZE_t)(m_file.obj.fs->csize)*_MAX_SS;
+    const FSIZE_t target        = (p - 1)/clusterSize;
+    const FSIZE_t current       = m_file.fptr ? (m_file.fptr - 1)/clusterSize : 0;
+
+    if(m_file.fptr && target >= current)
+        return target - current;
+
+    return target;
 }
 
 FRESULT File::rewind()
@@ -7,7 +7,8 @@
 #define GUARD_FILE
 
 /* IMPORTANT NOTE FOR STM32F4 HAL USERS */
-/* There's a bug in HAL when writing to SD cards, see: */
+/* There's a bug in HAL when writing to SD cards by polling (FATFS_SDIO_DMA set to 0, the default DMA transfers */
+/* are not affected), see: */
 /* https://community.st.com/thread/41225-buffer-overflow-in-cubemx-sdmmc-driver */
 /* The proposed patch doesn't work. Use this patch instead: */
 /* 
@@ -69,6 +70,28 @@ class File
             };
         };
 
+        /**
+            \brief Consumer of streamed file data (see forward())
+        **/
+        class Sink
+        {
+            public:
+                virtual ~Sink() {}
+
+                /**
+                    \brief Consume data
+                    \param data Data, in the sector buffer of the file
+                    \param size Size of the data, up to the end of the sector
+                    \returns Number of bytes consumed, at least 1 (0 aborts the transfer with FR_INT_ERR)
+                **/
+                virtual uint32_t write(const uint8_t* data, uint32_t size) = 0;
+
+                /**
+                    \returns \c true if write() can be called, \c false to stop the transfer (e.g. UART busy)
+                **/
+                virtual bool ready() { return true; }
+        };
+
     public:
         /**
             Constructor.
@@ -89,9 +112,10 @@ class File
             \brief Open a file
             \param filename Path to the file to be opened
             \param mode Opening mode. \see File::Mode
+            \param fastSeek \c true to enable fast seek (see enableFastSeek())
             \return Error code. See FatFS documentation
         **/
-        FRESULT open(const char* const filename, Mode::Value mode = Mode::R_PLUS);
+        FRESULT open(const char* const filename, Mode::Value mode = Mode::R_PLUS, bool fastSeek = false);
 
         /**
             \brief Close the file
@@ -104,6 +128,7 @@ class File
             \param data Buffer the data will be written to
             \param maxData Maximum bytes to be read
             \returns Bytes actually read from the file. Returns 0 on errors
+            \remark Same as read(void*, uint32_t, uint32_t&), without the error code
         **/
         uint32_t read(uint8_t* data, uint32_t maxData);
 
@@ -115,6 +140,31 @@ class File
         **/
         FRESULT read(ByteArray& data, uint32_t maxData = 0xFFFFFFFF);
 
+        /**
+            \brief Read data from the file, straight into a buffer
+            \param data Buffer the data will be written to
+            \param size Bytes to be read
+            \param read Bytes actually read (less than \c size at the end of the file)
+            \returns Error code. See FatFS documentation
+
+            \remark Whole sectors are transferred by the disk driver directly into \c data, only the partial
+            sectors at both ends go through the sector buffer of the file: read large blocks at sector-aligned
+            positions (e.g. multiples of 512 bytes), into word-aligned buffers for the SD card DMA.
+        **/
+        FRESULT read(void* data, uint32_t size, uint32_t& read);
+
+        /**
+            \brief Stream data from the file to a sink, without copy: the sink gets the sector buffer of the file
+            \param sink Consumer of the data
+            \param size Bytes to be forwarded
+            \param forwarded Bytes actually forwarded (less than \c size at the end of the file, or when the sink
+            is not ready)
+            \returns Error code. See FatFS documentation
+
+            \remark Not reentrant: the sink must not forward data from another file.
+        **/
+        FRESULT forward(Sink& sink, uint32_t size, uint32_t& forwarded);
+
         /**
             \brief Write data to the file
             \param data Data to be written
@@ -122,6 +172,38 @@ class File
         **/
         FRESULT write(const ByteArray& data);
 
+        /**
+            \brief Write data to the file
+            \param data Data to be written
+            \param size Size of the data, in bytes
+            \returns Error code. See FatFS documentation
+
+            \remark As for read(), whole sectors are transferred directly from \c data.
+        **/
+        FRESULT write(const void* data, uint32_t size);
+
+        /**
+            \brief Allocate contiguous clusters to an empty file, and set its size
+            \param size New file size
+            \returns Error code (FR_DENIED if there is no contiguous area large enough). See FatFS documentation
+        **/
+        FRESULT expand(FSIZE_t size);
+
+        /**
+            \brief Write the cached data and the directory entry of the file
+            \returns Error code. See FatFS documentation
+        **/
+        FRESULT sync();
+
+        /**
+            \brief Write the cached data of the file, without updating its directory entry
+            \returns Error code. See FatFS documentation
+
+            \remark For files whose size does not change (e.g. allocated with expand()): the size and the
+            modification time are only written by sync() and close().
+        **/
+        FRESULT syncData();
+
         /**
             \returns Position of the virtual file cursor
         **/
@@ -148,11 +230,39 @@ class File
         **/
         FRESULT seek(FSIZE_t p);
 
+        /**
+            \brief Enable fast seek: build the cluster link map of the file (allocated on the heap, 8 bytes per
+            fragment), so that seek() does not follow the FAT chain from the start of the file anymore
+            \returns Error code (FR_NOT_ENOUGH_CORE if the allocation failed). See FatFS documentation
+
+            \remark The file can not grow while fast seek is enabled (writes past the end fail): use it for
+            files that are read, or allocated beforehand with expand().
+        **/
+        FRESULT enableFastSeek();
+
+        /**
+            \brief Disable fast seek, and free the cluster link map
+        **/
+        void disableFastSeek();
+
+        /**
+            \returns Number of fragments of the file (contiguous cluster runs) if fast seek is enabled, 0 otherwise
+        **/
+        uint32_t fragments() const;
+
+        /**
+            \brief Estimate the cost of a seek
+            \param p Cursor position
+            \returns Number of FAT entries seek(p) would read (0 with fast seek, or for a contiguous exFAT file)
+        **/
+        uint32_t seekCost(FSIZE_t p) const;
+
         bool isOpen() const { return m_open; }
 
     private:
         FIL m_file;
         bool m_open = false;
+        DWORD* m_linkMap = nullptr;   ///< Cluster link map, for fast seek
 };
 
 #endif
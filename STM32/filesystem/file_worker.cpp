@@ -0,0 +1,357 @@
+#include "file_worker.h"
+#include "system.h"
+
+#include <algorithm>
+#include <cstring>
+
+constexpr uint32_t FileWorker::DEFAULT_QUEUE_SIZE;
+constexpr uint32_t FileWorker::DEFAULT_BUFFER_SIZE;
+constexpr uint32_t FileWorker::STEP_SIZE;
+constexpr uint32_t FileWorker::Histogram::BINS;
+
+void FileWorker::Histogram::add(uint32_t latency)
+{
+    const uint32_t i = latency < 2 ? 0 : 31 - __builtin_clz(latency);
+
+    m_bins[i]++;
+    m_count++;
+    m_max = std::max(m_max, latency);
+}
+
+void FileWorker::Histogram::reset()
+{
+    *this = Histogram();
+}
+
+uint32_t FileWorker::Histogram::percentile(uint32_t percent) const
+{
+    const uint64_t target = ((uint64_t)(m_count) * std::min<uint32_t>(percent, 100) + 99) / 100;
+    uint64_t sum = 0;
+
+    for(uint32_t i = 0; i < BINS && target; ++i)
+    {
+        sum += m_bins[i];
+
+        if(sum >= target)
+            return i < BINS - 1 ? std::min<uint32_t>(2UL << i, m_max) : m_max;
+    }
+
+    return 0;
+}
+
+FileWorker::FileWorker(uint32_t queueSize, uint32_t bufferSize):
+    m_queueSize(queueSize), m_bufferSize(bufferSize)
+{
+    m_queue     = new Request[m_queueSize];
+    m_buffer    = new uint8_t[m_bufferSize];
+
+    #if defined(FILE_WORKER_FREERTOS)
+    m_mutex     = xSemaphoreCreateMutex();
+    #endif
+}
+
+FileWorker::~FileWorker()
+{
+    #if defined(FILE_WORKER_FREERTOS)
+    if(m_task)
+        vTaskDelete(m_task);
+
+    if(m_mutex)
+        vSemaphoreDelete(m_mutex);
+    #endif
+
+    delete[] m_queue;
+    delete[] m_buffer;
+}
+
+bool FileWorker::open(File& file, const char* filename, File::Mode::Value mode, const Callback& callback)
+{
+    Request request;
+    request.type        = Type::OPEN;
+    request.mode        = mode;
+    request.file        = &file;
+    request.size        = std::strlen(filename) + 1;
+    request.callback    = callback;
+
+    return submit(request, filename);
+}
+
+bool FileWorker::write(File& file, const void* data, uint32_t size, const Callback& callback)
+{
+    Request request;
+    request.type        = Type::WRITE;
+    request.file        = &file;
+    request.data        = nullptr;
+    request.size        = size;
+    request.callback    = callback;
+
+    return submit(request, data);
+}
+
+bool FileWorker::read(File& file, void* data, uint32_t size, const Callback& callback)
+{
+    Request request;
+    request.type        = Type::READ;
+    request.file        = &file;
+    request.data        = reinterpret_cast<uint8_t*>(data);
+    request.size        = size;
+    request.callback    = callback;
+
+    return submit(request);
+}
+
+bool FileWorker::seek(File& file, FSIZE_t position, const Callback& callback)
+{
+    Request request;
+    request.type        = Type::SEEK;
+    request.file        = &file;
+    request.size        = 0;
+    request.position    = position;
+    request.callback    = callback;
+
+    return submit(request);
+}
+
+bool FileWorker::sync(File& file, const Callback& callback)
+{
+    Request request;
+    request.type        = Type::SYNC;
+    request.file        = &file;
+    request.size        = 0;
+    request.callback    = callback;
+
+    return submit(request);
+}
+
+bool FileWorker::close(File& file, const Callback& callback)
+{
+    Request request;
+    request.type        = Type::CLOSE;
+    request.file        = &file;
+    request.size        = 0;
+    request.callback    = callback;
+
+    return submit(request);
+}
+
+bool FileWorker::process()
+{
+    lock();
+    const bool empty = !m_count;
+    Request& request = m_queue[m_first];
+    unlock();
+
+    if(empty)
+        return false;
+
+    // The oldest request is not modified by the submissions: executed without the lock
+    FRESULT result = FR_OK;
+
+    if(!step(request, result))
+        return true;
+
+    const uint64_t latency = System::micros() - request.submitted;
+    const uint32_t done = request.done;
+    Callback callback;
+    std::swap(callback, request.callback);
+
+    lock();
+
+    // Requests complete in submission order: the buffer is freed in allocation order
+    if(request.reserved)
+    {
+        m_used -= request.reserved;
+        m_tail  = request.data - m_buffer + request.size;
+    }
+
+    if(!m_used)
+        m_head = m_tail = 0;
+
+    m_first = (m_first + 1) % m_queueSize;
+    m_count--;
+    m_latency.add(std::min<uint64_t>(latency, UINT32_MAX));
+    unlock();
+
+    if(callback)
+        callback(result, done);
+
+    return pending();
+}
+
+#if defined(FILE_WORKER_FREERTOS)
+bool FileWorker::start(UBaseType_t priority, uint16_t stackDepth)
+{
+    if(m_task || !m_mutex)
+        return true;
+
+    return xTaskCreate(task, "files", stackDepth, this, priority, &m_task) != pdPASS;
+}
+
+void FileWorker::task(void* worker)
+{
+    FileWorker* self = reinterpret_cast<FileWorker*>(worker);
+
+    for(;;)
+    {
+        // Submissions notify the task: a notification given while a request runs is kept for the next wait
+        if(!self->process())
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+#endif
+
+uint32_t FileWorker::pending() const
+{
+    lock();
+    const uint32_t count = m_count;
+    unlock();
+
+    return count;
+}
+
+uint32_t FileWorker::available() const
+{
+    lock();
+    uint32_t size = 0;
+
+    if(m_count < m_queueSize)
+    {
+        if(!m_used)
+            size = m_bufferSize;
+        else if(m_head > m_tail)
+            size = std::max(m_bufferSize - m_head, m_tail);
+        else
+            size = m_tail - m_head;
+    }
+
+    unlock();
+    return size;
+}
+
+bool FileWorker::submit(Request& request, const void* source)
+{
+    request.done        = 0;
+    request.reserved    = 0;
+
+    lock();
+    bool error = m_count == m_queueSize;
+
+    if(!error && source)
+    {
+        request.data = allocate(request.size, request.reserved);
+
+        if(request.data)
+        {
+            std::memcpy(request.data, source, request.size);
+
+            m_head  = request.data - m_buffer + request.size;
+            m_used += request.reserved;
+        }
+        else
+            error = true;
+    }
+
+    if(error)
+        m_rejected++;
+    else
+    {
+        request.submitted = System::micros();
+        m_queue[(m_first + m_count) % m_queueSize] = request;
+        m_count++;
+    }
+
+    unlock();
+
+    #if defined(FILE_WORKER_FREERTOS)
+    if(!error && m_task)
+        xTaskNotifyGive(m_task);
+    #endif
+
+    return error;
+}
+
+uint8_t* FileWorker::allocate(uint32_t size, uint32_t& reserved) const
+{
+    reserved = size;
+
+    if(!m_used)
+        return size <= m_bufferSize ? m_buffer : nullptr;
+
+    // Not wrapped: room at the end of the buffer, or at its start (skipping the end)
+    if(m_head > m_tail)
+    {
+        if(size <= m_bufferSize - m_head)
+            return m_buffer + m_head;
+
+        reserved = m_bufferSize - m_head + size;
+        return size <= m_tail ? m_buffer : nullptr;
+    }
+
+    // Wrapped: room between the newest and the oldest allocations
+    return size <= m_tail - m_head ? m_buffer + m_head : nullptr;
+}
+
+bool FileWorker::step(Request& request, FRESULT& result)
+{
+    switch(request.type)
+    {
+        case Type::OPEN:
+            result = request.file->open(reinterpret_cast<const char*>(request.data), (File::Mode::Value)(request.mode));
+            return true;
+
+        case Type::WRITE:
+        {
+            const uint32_t chunk = std::min(request.size - request.done, STEP_SIZE);
+
+            result = request.file->write(request.data + request.done, chunk);
+
+            if(result == FR_OK)
+                request.done += chunk;
+
+            return result != FR_OK || request.done == request.size;
+        }
+
+        case Type::READ:
+        {
+            const uint32_t chunk = std::min(request.size - request.done, STEP_SIZE);
+            uint32_t read = 0;
+
+            result = request.file->read(request.data + request.done, chunk, read);
+            request.done += read;
+
+            // Fewer bytes at the end of the file
+            return result != FR_OK || read < chunk || request.done == request.size;
+        }
+
+        case Type::SEEK:
+            result = request.file->seek(request.position);
+            return true;
+
+        case Type::SYNC:
+            result = request.file->sync();
+            return true;
+
+        case Type::CLOSE:
+            result = request.file->close();
+            return true;
+    }
+
+    result = FR_INT_ERR;
+    return true;
+}
+
+void FileWorker::lock() const
+{
+    #if defined(FILE_WORKER_FREERTOS)
+    if(m_mutex)
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+    #endif
+}
+
+void FileWorker::unlock() const
+{
+    #if defined(FILE_WORKER_FREERTOS)
+    if(m_mutex)
+        xSemaphoreGive(m_mutex);
+    #endif
+}
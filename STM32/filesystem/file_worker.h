@@ -0,0 +1,266 @@
+/**
+    \file file_worker.h
+    \version 1.0
+**/
+#ifndef GUARD_FILE_WORKER
+#define GUARD_FILE_WORKER
+
+#include "file.h"
+
+#include <functional>
+
+/* #define FILE_WORKER_FREERTOS to run the requests in a FreeRTOS task (see FileWorker::start()) */
+#if defined(FILE_WORKER_FREERTOS)
+    #include "FreeRTOS.h"
+    #include "task.h"
+    #include "semphr.h"
+#endif
+
+/**
+    \brief Asynchronous file operations: requests are queued, and executed by a worker context
+
+    The main loop submits requests (open, read, write, seek, sync, close) and returns immediately; the FatFS calls
+    are made later by the worker, and each request ends with an optional completion callback. An SD card busy
+    time (flash garbage collection, hundreds of ms) only delays the completions.
+
+    The worker context is either:
+    - a FreeRTOS task, when FILE_WORKER_FREERTOS is defined, see start(): a low priority task absorbs the card
+    stalls while the sampling tasks keep running;
+    - the caller of process() otherwise (cooperative pump, e.g. in the main loop or an idle hook). Reads and writes
+    are split in steps of STEP_SIZE bytes, one step per process() call, to bound the time of each call.
+
+    Memory is bounded and allocated at construction: a queue of requests, and a buffer holding the data of the
+    pending writes (copied at submission: the caller's buffer is free on return) and the file names. When either
+    is full, the request is rejected (backpressure): the caller keeps the data, retries later or drops it, and
+    pending() / available() tell how much room is left.
+
+    Requests are executed in submission order. The File objects must outlive their requests, and must not be
+    used directly while they have requests pending. FatFS is not reentrant (_FS_REENTRANT is 0): with the task,
+    all the accesses to the volume must go through the worker.
+
+    Completion latencies (submission to completion) are recorded in a histogram, see latency().
+**/
+class FileWorker
+{
+    public:
+        static constexpr uint32_t DEFAULT_QUEUE_SIZE    = 16;
+        static constexpr uint32_t DEFAULT_BUFFER_SIZE   = 8192;
+        static constexpr uint32_t STEP_SIZE             = 4096; ///< Maximum bytes read or written per step
+
+        /**
+            \brief Completion callback, called from the worker context
+            \param result Result of the request. See FatFS documentation
+            \param size Bytes read or written (0 for the other requests)
+        **/
+        typedef std::function<void (FRESULT result, uint32_t size)> Callback;
+
+        /**
+            \brief Histogram of latencies, in power of 2 bins
+        **/
+        class Histogram
+        {
+            public:
+                static constexpr uint32_t BINS = 32;
+
+                /**
+                    \brief Record a latency
+                    \param latency Latency, in us
+                **/
+                void add(uint32_t latency);
+
+                void reset();
+
+                /**
+                    \returns Number of latencies in a bin: bin 0 is [0, 2) us, bin i > 0 is [2^i, 2^(i+1)) us
+                **/
+                uint32_t bin(uint32_t i) const { return i < BINS ? m_bins[i] : 0; }
+
+                uint32_t count() const { return m_count; }
+
+                /**
+                    \returns Largest latency recorded, in us
+                **/
+                uint32_t max() const { return m_max; }
+
+                /**
+                    \brief Latency under which a fraction of the requests completed
+                    \param percent Fraction, in percent (e.g. 99)
+                    \returns Upper bound of the bin holding the percentile (at most max()), in us (0 if empty)
+                **/
+                uint32_t percentile(uint32_t percent) const;
+
+            private:
+                uint32_t    m_bins[BINS]    = {0};
+                uint32_t    m_count         = 0;
+                uint32_t    m_max           = 0;
+        };
+
+    public:
+        /**
+            \brief Constructor
+            \param queueSize Maximum number of pending requests
+            \param bufferSize Size of the buffer for the write data and the file names, in bytes. Bounds the
+            size of a write
+        **/
+        FileWorker(uint32_t queueSize = DEFAULT_QUEUE_SIZE, uint32_t bufferSize = DEFAULT_BUFFER_SIZE);
+
+        /**
+            No copy.
+        **/
+        FileWorker(const FileWorker&) = delete;
+
+        ~FileWorker();
+
+        /**
+            \brief Open a file (see File::open())
+            \param file File
+            \param filename Path to the file, copied
+            \param mode Opening mode
+            \param callback Completion callback
+            \returns \c true if the request is rejected (queue or buffer full), \c false otherwise
+        **/
+        bool open(File& file, const char* filename, File::Mode::Value mode, const Callback& callback = nullptr);
+
+        /**
+            \brief Write data at the current position
+            \param file File
+            \param data Data, copied in the buffer
+            \param size Size of the data, in bytes
+            \param callback Completion callback
+            \returns \c true if the request is rejected (queue or buffer full), \c false otherwise
+        **/
+        bool write(File& file, const void* data, uint32_t size, const Callback& callback = nullptr);
+
+        /**
+            \brief Read data at the current position
+            \param file File
+            \param data Destination, must stay valid until the completion
+            \param size Size of the data, in bytes (fewer are read at the end of the file)
+            \param callback Completion callback
+            \returns \c true if the request is rejected (queue full), \c false otherwise
+        **/
+        bool read(File& file, void* data, uint32_t size, const Callback& callback = nullptr);
+
+        /**
+            \brief Move the position (see File::seek())
+            \returns \c true if the request is rejected (queue full), \c false otherwise
+        **/
+        bool seek(File& file, FSIZE_t position, const Callback& callback = nullptr);
+
+        /**
+            \brief Flush the cached data of a file (see File::sync())
+            \returns \c true if the request is rejected (queue full), \c false otherwise
+        **/
+        bool sync(File& file, const Callback& callback = nullptr);
+
+        /**
+            \brief Close a file
+            \returns \c true if the request is rejected (queue full), \c false otherwise
+        **/
+        bool close(File& file, const Callback& callback = nullptr);
+
+        /**
+            \brief Execute one step of the oldest request (cooperative pump, not needed with the task)
+            \returns \c true if requests are still pending, \c false otherwise
+        **/
+        bool process();
+
+        #if defined(FILE_WORKER_FREERTOS)
+        /**
+            \brief Start the worker task, which executes the requests as soon as they are submitted
+            \param priority Task priority, below the tasks that must not be delayed by the SD card
+            \param stackDepth Task stack, in words (FatFS needs a few hundred bytes, plus the callbacks)
+            \returns \c true on error, \c false otherwise
+            \remark Requests must then be submitted from tasks, not from interrupts
+        **/
+        bool start(UBaseType_t priority, uint16_t stackDepth = 512);
+        #endif
+
+        /**
+            \returns Number of pending requests, including the one being executed
+        **/
+        uint32_t pending() const;
+
+        /**
+            \returns Size of the largest write accepted now, in bytes (0 if the queue is full)
+        **/
+        uint32_t available() const;
+
+        /**
+            \returns Number of requests rejected since construction
+        **/
+        uint32_t rejected() const { return m_rejected; }
+
+        /**
+            \returns Histogram of the completion latencies (from submission), resettable
+        **/
+        Histogram& latency() { return m_latency; }
+
+    private:
+        enum class Type: uint8_t
+        {
+            OPEN, WRITE, READ, SEEK, SYNC, CLOSE
+        };
+
+        struct Request
+        {
+            Type        type;
+            uint8_t     mode;
+            File*       file;
+            uint8_t*    data;       ///< Write data or file name in the buffer, or read destination
+            uint32_t    size;
+            uint32_t    done;       ///< Bytes read or written so far
+            FSIZE_t     position;
+            uint32_t    reserved;   ///< Bytes of the buffer used, including the end of buffer skipped
+            uint64_t    submitted;  ///< Submission time, in us
+            Callback    callback;
+        };
+
+        /**
+            \brief Queue a request
+            \param request Request
+            \param source Data to copy in the buffer (request.size bytes), or \c nullptr
+            \returns \c true if the request is rejected, \c false otherwise
+        **/
+        bool submit(Request& request, const void* source = nullptr);
+
+        /**
+            \brief Reserve a contiguous area of the buffer
+            \param size Size of the area
+            \param reserved Bytes reserved, including the end of buffer skipped to stay contiguous
+            \returns Area, or \c nullptr if there is not enough room
+        **/
+        uint8_t* allocate(uint32_t size, uint32_t& reserved) const;
+
+        /**
+            \brief Execute one step of a request
+            \returns \c true when the request is complete, \c false otherwise
+        **/
+        bool step(Request& request, FRESULT& result);
+
+        void lock() const;
+        void unlock() const;
+
+        #if defined(FILE_WORKER_FREERTOS)
+        static void task(void* worker);
+
+        TaskHandle_t        m_task          = nullptr;
+        SemaphoreHandle_t   m_mutex         = nullptr;
+        #endif
+
+        const uint32_t  m_queueSize;
+        Request*        m_queue;
+        uint32_t        m_first         = 0;
+        uint32_t        m_count         = 0;
+
+        const uint32_t  m_bufferSize;
+        uint8_t*        m_buffer;
+        uint32_t        m_head          = 0;    ///< Next allocation
+        uint32_t        m_tail          = 0;    ///< Start of the oldest allocation
+        uint32_t        m_used          = 0;    ///< Bytes reserved by the pending requests
+
+        uint32_t        m_rejected      = 0;
+        Histogram       m_latency;
+};
+
+#endif
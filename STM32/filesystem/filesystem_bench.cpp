@@ -0,0 +1,410 @@
+#include "filesystem_bench.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+uint32_t FilesystemBench::Result::kbps() const
+{
+    if(!micros)
+        return 0;
+
+    return bytes * 1000000 / 1024 / micros;
+}
+
+uint32_t FilesystemBench::Result::perSecond() const
+{
+    if(!micros)
+        return 0;
+
+    return (uint64_t)(operations) * 1000000 / micros;
+}
+
+FilesystemBench::FilesystemBench(const Config& config):
+    m_config(config)
+{
+    m_buffer = new uint8_t[m_config.chunkSize];
+
+    for(uint32_t i = 0; i < m_config.chunkSize; ++i)
+        m_buffer[i] = i;
+}
+
+FilesystemBench::~FilesystemBench()
+{
+    delete[] m_buffer;
+}
+
+FRESULT FilesystemBench::run(Result* results)
+{
+    // Files left by an interrupted run would change the directory tests
+    cleanup();
+
+    FRESULT res = FR_OK;
+
+    for(uint32_t i = 0; i < TEST_COUNT && res == FR_OK; ++i)
+        res = run((Test)(i), results[i]);
+
+    const FRESULT cleaned = cleanup();
+    return res != FR_OK ? res : cleaned;
+}
+
+FRESULT FilesystemBench::run(Test test, Result& result)
+{
+    result = Result();
+    m_seed = 1;
+
+    if(!m_config.micros || !m_config.chunkSize || m_config.randomSize > m_config.chunkSize
+        || m_config.appendSize > m_config.chunkSize || m_config.appendSize > BinaryLog::MAX_RECORD_SIZE)
+        return FR_INVALID_PARAMETER;
+
+    // Already there after the first test: an invalid path shows up on the first open
+    f_mkdir(m_config.path);
+
+    FRESULT res = FR_INVALID_PARAMETER;
+    const uint64_t start = m_config.micros();
+
+    switch(test)
+    {
+        case SEQUENTIAL_WRITE:  res = sequential(true, result);     break;
+        case SEQUENTIAL_READ:   res = sequential(false, result);    break;
+        case RANDOM_WRITE:      res = random(true, result);         break;
+        case RANDOM_READ:       res = random(false, result);        break;
+        case SEEK:              res = seek(false, result);          break;
+        case FAST_SEEK:         res = seek(true, result);           break;
+        case SMALL_APPEND:      res = append(result);               break;
+        case DIRECTORY_CREATE:  res = create(result);               break;
+        case DIRECTORY_SCAN:    res = scan(result);                 break;
+        case DIRECTORY_LOOKUP:  res = lookup(result);               break;
+        case LOG_APPEND:        res = logAppend(result);            break;
+        case LOG_READ:          res = logRead(result);              break;
+        default:                                                    break;
+    }
+
+    result.micros = m_config.micros() - start;
+    return res;
+}
+
+FRESULT FilesystemBench::cleanup()
+{
+    FRESULT res = FR_OK;
+
+    auto remove = [&res](const char* path)
+    {
+        const FRESULT removed = f_unlink(path);
+
+        if(removed != FR_OK && removed != FR_NO_FILE && removed != FR_NO_PATH && res == FR_OK)
+            res = removed;
+    };
+
+    for(uint32_t i = 0; i < m_config.files; ++i)
+        remove(filePath(i));
+
+    remove(path("dir"));
+    remove(path("seq.bin"));
+    remove(path("append.bin"));
+    remove(path("log.bin"));
+
+    // The test directory may be the root, or hold other files: not an error
+    f_unlink(m_config.path);
+    return res;
+}
+
+const char* FilesystemBench::name(Test test)
+{
+    static const char* const names[TEST_COUNT] =
+    {
+        "sequential write", "sequential read", "random write", "random read", "seek", "fast seek", "small append",
+        "directory create", "directory scan", "directory lookup", "log append", "log read"
+    };
+
+    return test < TEST_COUNT ? names[test] : "";
+}
+
+FRESULT FilesystemBench::sequential(bool write, Result& result)
+{
+    File file;
+    FRESULT res = file.open(path("seq.bin"), write ? File::Mode::W : File::Mode::R);
+
+    for(uint32_t done = 0; res == FR_OK && done < m_config.fileSize;)
+    {
+        const uint32_t chunk = std::min(m_config.chunkSize, m_config.fileSize - done);
+        const uint64_t start = m_config.micros();
+
+        if(write)
+            res = file.write(m_buffer, chunk);
+        else
+        {
+            uint32_t read = 0;
+            res = file.read(m_buffer, chunk, read);
+
+            if(res == FR_OK && read < chunk)
+                res = FR_INT_ERR;
+        }
+
+        measure(result, start);
+        result.bytes   += chunk;
+        done           += chunk;
+    }
+
+    if(write && res == FR_OK)
+    {
+        const uint64_t start = m_config.micros();
+        res = file.sync();
+        measure(result, start);
+    }
+
+    const FRESULT closed = file.close();
+    return res != FR_OK ? res : closed;
+}
+
+FRESULT FilesystemBench::random(bool write, Result& result)
+{
+    const uint32_t blocks = m_config.randomSize ? m_config.fileSize / m_config.randomSize : 0;
+
+    if(!blocks)
+        return FR_INVALID_PARAMETER;
+
+    File file;
+    FRESULT res = file.open(path("seq.bin"), write ? File::Mode::R_PLUS : File::Mode::R);
+
+    for(uint32_t i = 0; res == FR_OK && i < m_config.randomOperations; ++i)
+    {
+        const FSIZE_t position = (FSIZE_t)(next() % blocks) * m_config.randomSize;
+        const uint64_t start = m_config.micros();
+
+        res = file.seek(position);
+
+        if(res == FR_OK && write)
+            res = file.write(m_buffer, m_config.randomSize);
+        else if(res == FR_OK)
+        {
+            uint32_t read = 0;
+            res = file.read(m_buffer, m_config.randomSize, read);
+        }
+
+        measure(result, start);
+        result.bytes += m_config.randomSize;
+    }
+
+    if(write && res == FR_OK)
+    {
+        const uint64_t start = m_config.micros();
+        res = file.sync();
+        measure(result, start);
+    }
+
+    const FRESULT closed = file.close();
+    return res != FR_OK ? res : closed;
+}
+
+FRESULT FilesystemBench::seek(bool fast, Result& result)
+{
+    if(!m_config.fileSize)
+        return FR_INVALID_PARAMETER;
+
+    File file;
+    FRESULT res = file.open(path("seq.bin"), File::Mode::R, fast);
+
+    for(uint32_t i = 0; res == FR_OK && i < m_config.randomOperations; ++i)
+    {
+        const FSIZE_t position = next() % m_config.fileSize;
+        const uint64_t start = m_config.micros();
+
+        res = file.seek(position);
+        measure(result, start);
+    }
+
+    const FRESULT closed = file.close();
+    return res != FR_OK ? res : closed;
+}
+
+FRESULT FilesystemBench::append(Result& result)
+{
+    File file;
+    FRESULT res = file.open(path("append.bin"), File::Mode::W);
+
+    for(uint32_t i = 0; res == FR_OK && i < m_config.appendRecords; ++i)
+    {
+        const uint64_t start = m_config.micros();
+
+        res = file.write(m_buffer, m_config.appendSize);
+
+        if(res == FR_OK && m_config.appendSync && (i + 1) % m_config.appendSync == 0)
+            res = file.sync();
+
+        measure(result, start);
+        result.bytes += m_config.appendSize;
+    }
+
+    const FRESULT closed = file.close();
+    return res != FR_OK ? res : closed;
+}
+
+FRESULT FilesystemBench::create(Result& result)
+{
+    FRESULT res = f_mkdir(path("dir"));
+
+    if(res == FR_EXIST)
+        res = FR_OK;
+
+    for(uint32_t i = 0; res == FR_OK && i < m_config.files; ++i)
+    {
+        File file;
+        const uint64_t start = m_config.micros();
+
+        res = file.open(filePath(i), File::Mode::W);
+
+        if(res == FR_OK)
+            res = file.close();
+
+        measure(result, start);
+    }
+
+    return res;
+}
+
+FRESULT FilesystemBench::scan(Result& result)
+{
+    FRESULT res = FR_OK;
+
+    for(uint32_t i = 0; res == FR_OK && i < m_config.scans; ++i)
+    {
+        DIR dir;
+        res = f_opendir(&dir, path("dir"));
+
+        if(res != FR_OK)
+            break;
+
+        for(bool end = false; res == FR_OK && !end;)
+        {
+            FILINFO info;
+            const uint64_t start = m_config.micros();
+
+            res = f_readdir(&dir, &info);
+            measure(result, start);
+
+            end = res != FR_OK || !info.fname[0];
+        }
+
+        const FRESULT closed = f_closedir(&dir);
+
+        if(res == FR_OK)
+            res = closed;
+    }
+
+    return res;
+}
+
+FRESULT FilesystemBench::lookup(Result& result)
+{
+    FRESULT res = FR_OK;
+
+    for(uint32_t i = 0; res == FR_OK && i < m_config.files; ++i)
+    {
+        FILINFO info;
+        const char* name = filePath(i);
+        const uint64_t start = m_config.micros();
+
+        res = f_stat(name, &info);
+        measure(result, start);
+    }
+
+    return res;
+}
+
+FRESULT FilesystemBench::logAppend(Result& result)
+{
+    // Full blocks, plus a partial one per flush
+    const uint32_t perBlock = (BinaryLog::BLOCK_SIZE - BinaryLog::HEADER_SIZE)/(BinaryLog::RECORD_HEADER_SIZE + m_config.appendSize);
+    const uint32_t blocks = m_config.logRecords/perBlock + (m_config.logFlush ? m_config.logRecords/m_config.logFlush : 0) + 2;
+
+    BinaryLog log;
+    FRESULT res = log.create(path("log.bin"), (FSIZE_t)(blocks)*BinaryLog::BLOCK_SIZE, 1);
+
+    for(uint32_t i = 0; res == FR_OK && i < m_config.logRecords; ++i)
+    {
+        const uint64_t start = m_config.micros();
+
+        // Records told apart by their first byte
+        m_buffer[0] = i;
+
+        if(log.append((int64_t)(i)*1000, m_buffer, m_config.appendSize))
+            res = FR_INT_ERR;
+        else
+            res = log.process();
+
+        if(res == FR_OK && m_config.logFlush && (i + 1) % m_config.logFlush == 0)
+            res = log.flush();
+
+        measure(result, start);
+        result.bytes += m_config.appendSize;
+    }
+
+    m_buffer[0] = 0;
+
+    const FRESULT closed = log.close();
+    return res != FR_OK ? res : closed;
+}
+
+FRESULT FilesystemBench::logRead(Result& result)
+{
+    BinaryLogReader reader;
+    FRESULT res = reader.open(path("log.bin"));
+    uint32_t count = 0;
+
+    while(res == FR_OK)
+    {
+        BinaryLog::Record record;
+        const uint64_t start = m_config.micros();
+        const bool end = reader.read(record);
+
+        measure(result, start);
+
+        if(end)
+            break;
+
+        if(record.timestamp != (int64_t)(count)*1000 || record.size != m_config.appendSize ||
+            record.data[0] != (uint8_t)(count) || memcmp(record.data + 1, m_buffer + 1, record.size - 1))
+            res = FR_INT_ERR;
+
+        result.bytes += record.size;
+        ++count;
+    }
+
+    if(res == FR_OK && count != m_config.logRecords)
+        res = FR_INT_ERR;
+
+    const FRESULT closed = reader.close();
+    return res != FR_OK ? res : closed;
+}
+
+const char* FilesystemBench::path(const char* name)
+{
+    std::snprintf(m_path, sizeof(m_path), "%s/%s", m_config.path, name);
+    return m_path;
+}
+
+const char* FilesystemBench::filePath(uint32_t index)
+{
+    const char* format = m_config.longNames && _USE_LFN ? "%s/dir/benchmark file %05lu.data" : "%s/dir/F%05lu.DAT";
+
+    std::snprintf(m_path, sizeof(m_path), format, m_config.path, (unsigned long)(index));
+    return m_path;
+}
+
+uint32_t FilesystemBench::next()
+{
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+
+    return m_seed;
+}
+
+void FilesystemBench::measure(Result& result, uint64_t start)
+{
+    const uint32_t elapsed = m_config.micros() - start;
+
+    result.operations++;
+    result.maxMicros = std::max(result.maxMicros, elapsed);
+}
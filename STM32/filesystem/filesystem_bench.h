@@ -0,0 +1,174 @@
+/**
+    \file filesystem_bench.h
+    \version 1.0
+**/
+#ifndef GUARD_FILESYSTEM_BENCH
+#define GUARD_FILESYSTEM_BENCH
+
+#include "binary_log.h"
+
+/**
+    \brief Throughput and latency benchmark of the file system stack (File, FatFS, sector cache, disk driver)
+
+    The tests work in a directory of a mounted volume, created if needed, and are run in this order (each one uses
+    the files of the previous ones):
+    - SEQUENTIAL_WRITE: a file of fileSize bytes written in chunkSize calls, then synced;
+    - SEQUENTIAL_READ: the file read back in chunkSize calls;
+    - RANDOM_WRITE, RANDOM_READ: randomOperations seek + transfer of randomSize bytes, at pseudo-random positions
+    aligned on randomSize (the write test ends with a sync);
+    - SEEK: randomOperations seeks alone, forward and backward (FAT chain walks, fast seek is not enabled);
+    - FAST_SEEK: the same seeks with fast seek enabled, the cluster link map being built on open (no FAT reads
+    after it: the difference with SEEK grows with the fragmentation of the file);
+    - SMALL_APPEND: appendRecords records of appendSize bytes appended to a new file, synced every appendSync
+    records (a log);
+    - DIRECTORY_CREATE: files empty files created in a sub-directory;
+    - DIRECTORY_SCAN: the sub-directory listed scans times;
+    - DIRECTORY_LOOKUP: each file found by name (f_stat);
+    - LOG_APPEND: logRecords records of appendSize bytes appended to a BinaryLog, with process() after each one
+    and a flush every logFlush records;
+    - LOG_READ: the log read back with BinaryLogReader, timestamps and data checked (FR_INT_ERR otherwise).
+
+    Each result gives the number of calls, the bytes transferred, the total time and the slowest call. The
+    positions are generated from a fixed seed: runs are repeatable, and their results comparable across
+    configurations (ffconf.h options, cache, drivers). The files are deleted by cleanup().
+
+    Timing comes from a function given in the configuration (System::micros on the target), the class itself does
+    not depend on the target: it is built on a host as well, on the RAM disk (see filesystem/bench).
+**/
+class FilesystemBench
+{
+    public:
+        enum Test
+        {
+            SEQUENTIAL_WRITE = 0,
+            SEQUENTIAL_READ,
+            RANDOM_WRITE,
+            RANDOM_READ,
+            SEEK,
+            FAST_SEEK,
+            SMALL_APPEND,
+            DIRECTORY_CREATE,
+            DIRECTORY_SCAN,
+            DIRECTORY_LOOKUP,
+            LOG_APPEND,
+            LOG_READ,
+            TEST_COUNT
+        };
+
+        struct Config
+        {
+            const char* path            = "0:/bench";   ///< Test directory
+            uint32_t    fileSize        = 1 << 20;
+            uint32_t    chunkSize       = 4096;         ///< Bytes per sequential call
+            uint32_t    randomSize      = 512;          ///< Bytes per random call, up to chunkSize
+            uint32_t    randomOperations = 1000;
+            uint32_t    appendSize      = 32;
+            uint32_t    appendRecords   = 4096;
+            uint32_t    appendSync      = 16;           ///< Records between syncs (0: sync on close only)
+            uint32_t    logRecords      = 16384;
+            uint32_t    logFlush        = 256;          ///< Log records between flushes (0: flush on close only)
+            uint32_t    files           = 256;
+            uint32_t    scans           = 16;
+            bool        longNames       = false;        ///< Long file names in the directory tests (_USE_LFN != 0)
+            uint64_t    (*micros)()     = nullptr;      ///< Time, in us
+        };
+
+        struct Result
+        {
+            uint32_t    operations      = 0;    ///< Calls
+            uint64_t    bytes           = 0;    ///< Bytes transferred
+            uint32_t    micros          = 0;    ///< Duration of the test, in us
+            uint32_t    maxMicros       = 0;    ///< Slowest call, in us
+
+            /**
+                \returns Throughput, in KB/s
+            **/
+            uint32_t kbps() const;
+
+            /**
+                \returns Calls per second
+            **/
+            uint32_t perSecond() const;
+        };
+
+    public:
+        /**
+            \brief Constructor
+            \param config Benchmark parameters (a copy is kept, the path must stay valid)
+        **/
+        FilesystemBench(const Config& config);
+
+        /**
+            No copy.
+        **/
+        FilesystemBench(const FilesystemBench&) = delete;
+
+        ~FilesystemBench();
+
+        /**
+            \brief Run all the tests, then delete the files
+            \param results Results, TEST_COUNT entries indexed by Test
+            \returns Error code of the first failing test. See FatFS documentation
+        **/
+        FRESULT run(Result* results);
+
+        /**
+            \brief Run a test, e.g. to read driver counters between tests
+            \param test Test, after the previous ones
+            \param result Result
+            \returns Error code. See FatFS documentation
+        **/
+        FRESULT run(Test test, Result& result);
+
+        /**
+            \brief Delete the test files and directories
+            \returns Error code. See FatFS documentation
+        **/
+        FRESULT cleanup();
+
+        /**
+            \returns Name of a test
+        **/
+        static const char* name(Test test);
+
+    private:
+        FRESULT sequential(bool write, Result& result);
+        FRESULT random(bool write, Result& result);
+        FRESULT seek(bool fast, Result& result);
+        FRESULT append(Result& result);
+        FRESULT create(Result& result);
+        FRESULT scan(Result& result);
+        FRESULT lookup(Result& result);
+        FRESULT logAppend(Result& result);
+        FRESULT logRead(Result& result);
+
+        /**
+            \brief Build the path of a test file
+            \param name File name, in the test directory
+            \returns Path, valid until the next call
+        **/
+        const char* path(const char* name);
+
+        /**
+            \returns Path of a file of the directory tests, valid until the next call
+        **/
+        const char* filePath(uint32_t index);
+
+        /**
+            \returns Next pseudo-random number (xorshift)
+        **/
+        uint32_t next();
+
+        /**
+            \brief Account a call
+            \param start Start of the call, in us
+        **/
+        void measure(Result& result, uint64_t start);
+
+        Config      m_config;
+        uint8_t*    m_buffer;
+        char        m_path[80];
+        uint32_t    m_seed          = 1;
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "filesystem_sdio.h"
+#include "fatfs/diskio_cache.h"
 
 Filesystem::Filesystem(const Pin& sdDetect, const Pin& writeProtect)
         : m_sdDetect(sdDetect), m_writeProtect(writeProtect)
@@ -25,7 +26,11 @@ FRESULT Filesystem::mount()
 
 FRESULT Filesystem::unmount()
 {
-    return f_mount(nullptr, "0:", 1);
+    // f_mount() does not sync: write the cached sectors first
+    const bool error = TM_FATFS_CACHE_Flush(0) != RES_OK;
+
+    const FRESULT result = f_mount(nullptr, "0:", 1);
+    return error ? FR_DISK_ERR : result;
 }
 
 bool Filesystem::isSDCardPresent() const
@@ -45,7 +45,7 @@ class Filesystem
         FRESULT mount();
 
         /*
-            \brief Unmount SD card filesystem.
+            \brief Unmount SD card filesystem, after writing the sectors left in the disk cache.
             \return Error code. See FatFS documentation for details.
         */
         FRESULT unmount();
@@ -0,0 +1,307 @@
+#include "fix_history.h"
+
+#include <cmath>
+
+namespace
+{
+	constexpr float		GRAVITY				= 9.80665f;		///< mm/s^2 per mG
+	constexpr float		GRAVITY_TIME		= 4000.f;		///< Time constant of the gravity filter, in ms
+	constexpr float		RADIANS_PER_UNIT	= 1.74532925e-9f;	///< Radians per 1e-7 degree
+	constexpr int64_t	HALF_TURN			= 1800000000;	///< 180 degrees, in 1e-7 degrees
+
+	/**
+		\brief Longitude difference, wrapped to [-180, 180] degrees
+	**/
+	int32_t longitudeDelta(int32_t from, int32_t to)
+	{
+		int64_t d = (int64_t)(to) - from;
+		if(d > HALF_TURN)
+			d -= 2*HALF_TURN;
+		else if(d < -HALF_TURN)
+			d += 2*HALF_TURN;
+
+		return d;
+	}
+}
+
+FixHistory::FixHistory(uint8_t capacity):
+	m_epochs(new Epoch[capacity ? capacity : 1]), m_capacity(capacity ? capacity : 1)
+{
+}
+
+FixHistory::~FixHistory()
+{
+	delete[] m_epochs;
+}
+
+void FixHistory::clear()
+{
+	m_size			= 0;
+	m_drSpeed		= 0.f;
+	m_drDistance	= 0.f;
+}
+
+void FixHistory::push(const Epoch& epoch)
+{
+	if(m_size)
+	{
+		const int32_t d = epoch.tick - at(0).tick;
+
+		if(d == 0)
+		{
+			m_epochs[m_latest] = epoch;
+			return;
+		}
+
+		if(d < 0)
+			clear();
+	}
+
+	m_latest = m_size ? (m_latest + 1) % m_capacity : 0;
+	m_epochs[m_latest] = epoch;
+
+	if(m_size < m_capacity)
+		++m_size;
+
+	// Dead reckoning restarts from the new epoch
+	m_drSpeed		= 0.f;
+	m_drDistance	= 0.f;
+}
+
+uint8_t FixHistory::size() const
+{
+	return m_size;
+}
+
+const FixHistory::Epoch& FixHistory::operator[](uint8_t i) const
+{
+	return at(i);
+}
+
+const FixHistory::Epoch& FixHistory::at(uint8_t i) const
+{
+	return m_epochs[(m_latest + m_capacity - i) % m_capacity];
+}
+
+bool FixHistory::interpolate(uint32_t tick, Epoch& result) const
+{
+	if(!m_size)
+		return true;
+
+	const int32_t d = tick - at(0).tick;
+
+	if(d > (int32_t)(MAX_EXTRAPOLATION))
+		return true;
+
+	if(d == 0 && (at(0).flags & HAS_VELOCITY))
+	{
+		result = at(0);
+		return false;
+	}
+
+	if(d >= 0)
+		return extrapolate(tick, result);
+
+	// Epochs around tick, from the latest
+	for(uint8_t i = 0; i + 1 < m_size; ++i)
+	{
+		const Epoch& e0 = at(i + 1);
+		const Epoch& e1 = at(i);
+
+		if((int32_t)(tick - e0.tick) < 0)
+			continue;
+
+		const uint32_t	span	= e1.tick - e0.tick;
+		const float		h		= span*1e-3f;
+		const float		s		= (float)(tick - e0.tick)/span;
+
+		// e1 in a plane tangent at e0, in mm
+		const float scale	= MM_PER_UNIT*std::cos(e0.latitude*RADIANS_PER_UNIT);
+		const float dn		= (float)(e1.latitude - e0.latitude)*MM_PER_UNIT;
+		const float de		= longitudeDelta(e0.longitude, e1.longitude)*scale;
+
+		float north, east, vn, ve;
+		if(e0.flags & e1.flags & HAS_VELOCITY)
+		{ // Cubic Hermite spline
+			const float s2 = s*s;
+			const float s3 = s2*s;
+			const float h10 = (s3 - 2*s2 + s)*h;
+			const float h01 = 3*s2 - 2*s3;
+			const float h11 = (s3 - s2)*h;
+
+			north	= h10*e0.velocityNorth + h01*dn + h11*e1.velocityNorth;
+			east	= h10*e0.velocityEast  + h01*de + h11*e1.velocityEast;
+			vn		= e0.velocityNorth + s*(e1.velocityNorth - e0.velocityNorth);
+			ve		= e0.velocityEast  + s*(e1.velocityEast  - e0.velocityEast);
+		}
+		else
+		{
+			north	= s*dn;
+			east	= s*de;
+			vn		= dn/h;
+			ve		= de/h;
+		}
+
+		result					= e0;
+		result.tick				= tick;
+		result.flags			= (e0.flags & e1.flags & (HAS_ALTITUDE | HAS_TIME)) | HAS_VELOCITY | INTERPOLATED;
+		result.altitude			= e0.altitude + s*(e1.altitude - e0.altitude);
+		result.velocityNorth	= std::lround(vn);
+		result.velocityEast		= std::lround(ve);
+		result.accuracy			= e0.accuracy + s*((float)(e1.accuracy) - (float)(e0.accuracy));
+
+		offset(result, north, east);
+		shiftTime(e0, tick - e0.tick, result);
+		return false;
+	}
+
+	return true;
+}
+
+bool FixHistory::extrapolate(uint32_t tick, Epoch& result) const
+{
+	const Epoch&	latest	= at(0);
+	const uint32_t	dt		= tick - latest.tick;
+
+	result			= latest;
+	result.tick		= tick;
+	result.flags	= (latest.flags & ~(INTERPOLATED | DEAD_RECKONING)) | EXTRAPOLATED;
+
+	float vn, ve;
+	if(latest.flags & HAS_VELOCITY)
+	{
+		vn = latest.velocityNorth;
+		ve = latest.velocityEast;
+	}
+	else if(m_size > 1)
+	{ // Estimated from the previous epoch
+		const Epoch&	previous	= at(1);
+		const float		h			= (latest.tick - previous.tick)*1e-3f;
+
+		vn = (float)(latest.latitude - previous.latitude)*MM_PER_UNIT/h;
+		ve = longitudeDelta(previous.longitude, latest.longitude)*MM_PER_UNIT*
+				std::cos(latest.latitude*RADIANS_PER_UNIT)/h;
+
+		result.flags |= HAS_VELOCITY;
+	}
+	else
+		return true;
+
+	float north	= vn*dt*1e-3f;
+	float east	= ve*dt*1e-3f;
+
+	const float speed = std::sqrt(vn*vn + ve*ve);
+	if(speed >= MIN_SPEED && (int32_t)(m_drTick - latest.tick) > 0)
+	{ // Accelerometer correction, along the course
+		float correction;
+		if((int32_t)(tick - m_drTick) >= 0)
+			correction = m_drDistance + m_drSpeed*(tick - m_drTick)*1e-3f;
+		else
+			correction = m_drDistance*dt/(m_drTick - latest.tick);
+
+		north	+= correction*vn/speed;
+		east	+= correction*ve/speed;
+
+		const float gain = (speed + m_drSpeed)/speed;
+		vn *= gain;
+		ve *= gain;
+
+		result.flags |= DEAD_RECKONING;
+	}
+
+	result.velocityNorth	= std::lround(vn);
+	result.velocityEast		= std::lround(ve);
+
+	offset(result, north, east);
+	shiftTime(latest, dt, result);
+	return false;
+}
+
+bool FixHistory::velocity(uint32_t tick, int32_t& north, int32_t& east) const
+{
+	Epoch epoch;
+	if(interpolate(tick, epoch) || !(epoch.flags & HAS_VELOCITY))
+		return true;
+
+	north	= epoch.velocityNorth;
+	east	= epoch.velocityEast;
+	return false;
+}
+
+void FixHistory::setForwardAxis(uint8_t axis, bool inverted)
+{
+	m_axis			= (axis < 3) ? axis : 0;
+	m_inverted		= inverted;
+	m_gravityValid	= false;
+}
+
+void FixHistory::addAcceleration(uint32_t tick, int16_t x, int16_t y, int16_t z)
+{
+	const int16_t axes[3] = {x, y, z};
+
+	float a = axes[m_axis]*GRAVITY;
+	if(m_inverted)
+		a = -a;
+
+	if(!m_gravityValid)
+	{
+		m_gravity		= a;
+		m_gravityValid	= true;
+		m_drTick		= tick;
+		return;
+	}
+
+	const int32_t dt = tick - m_drTick;
+	if(dt <= 0)
+		return;
+
+	m_drTick	= tick;
+	m_gravity	+= (a - m_gravity)*dt/(GRAVITY_TIME + dt);
+
+	if(!m_size)
+		return;
+
+	// Only the part of the interval after the latest epoch
+	const int32_t since = tick - at(0).tick;
+	if(since <= 0)
+		return;
+
+	const float h		= ((since < dt) ? since : dt)*1e-3f;
+	const float linear	= a - m_gravity;
+
+	m_drDistance	+= (m_drSpeed + 0.5f*linear*h)*h;
+	m_drSpeed		+= linear*h;
+}
+
+void FixHistory::shiftTime(const Epoch& from, int32_t delta, Epoch& result)
+{
+	if(!(from.flags & HAS_TIME))
+		return;
+
+	int32_t ms		= from.milliseconds + delta;
+	int32_t seconds	= ms/1000;
+	ms %= 1000;
+	if(ms < 0)
+	{
+		ms += 1000;
+		--seconds;
+	}
+
+	result.time			= from.time + seconds;
+	result.milliseconds	= ms;
+}
+
+void FixHistory::offset(Epoch& epoch, float north, float east)
+{
+	const float scale = MM_PER_UNIT*std::cos(epoch.latitude*RADIANS_PER_UNIT);
+
+	epoch.latitude += std::lround(north/MM_PER_UNIT);
+
+	int64_t longitude = epoch.longitude + (int64_t)(std::lround(east/scale));
+	if(longitude > HALF_TURN)
+		longitude -= 2*HALF_TURN;
+	else if(longitude < -HALF_TURN)
+		longitude += 2*HALF_TURN;
+
+	epoch.longitude = longitude;
+}
@@ -0,0 +1,174 @@
+/**
+	\file fix_history.h
+	\version 1.0
+**/
+
+#ifndef GUARD_FIX_HISTORY
+#define GUARD_FIX_HISTORY
+
+#include <cstdint>
+
+/**
+	\brief Fixed-capacity history of GPS navigation epochs
+
+	Each epoch is a coherent navigation solution (position, velocity and time of the same measurement),
+	timestamped with the local millisecond tick (System::millis()) at which it was received. This allows to
+	get the position at the time a sensor was sampled, rather than the latest known position:
+	- between two epochs, the position is interpolated with a cubic Hermite spline using the reported velocities
+	(linearly if the receiver does not report velocity);
+	- after the latest epoch, it is extrapolated for up to MAX_EXTRAPOLATION milliseconds, optionally corrected
+	by accelerometer samples (dead reckoning, see addAcceleration()).
+
+	Positions are stored in fixed point (1e-7 degrees, millimeters). Interpolation is done in a local plane
+	tangent to the Earth, which is accurate for the distances covered between two epochs.
+
+	Memory is allocated on the heap by the constructor, and never reallocated.
+**/
+class FixHistory
+{
+	public:
+		static constexpr uint32_t MAX_EXTRAPOLATION = 2000;	///< Maximum extrapolation after the latest epoch, in ms
+
+		/**
+			\brief Epoch flags
+		**/
+		enum Flags: uint8_t
+		{
+			HAS_VELOCITY	= 0x01,	///< velocityNorth and velocityEast are valid
+			HAS_ALTITUDE	= 0x02,	///< altitude is valid
+			HAS_TIME		= 0x04,	///< time and milliseconds are valid
+			INTERPOLATED	= 0x08,	///< Result of an interpolation
+			EXTRAPOLATED	= 0x10,	///< Result of an extrapolation
+			DEAD_RECKONING	= 0x20	///< Extrapolation corrected by accelerometer data
+		};
+
+		/**
+			\brief Navigation epoch
+		**/
+		struct Epoch
+		{
+			uint32_t	tick			= 0;	///< Local time of reception (System::millis()), in ms
+			uint32_t	time			= 0;	///< UTC time of the measurement, in seconds since Epoch
+			uint16_t	milliseconds	= 0;	///< UTC time of the measurement, milliseconds
+			uint8_t		flags			= 0;	///< Combination of Flags
+			int32_t		latitude		= 0;	///< Latitude, in 1e-7 degrees
+			int32_t		longitude		= 0;	///< Longitude, in 1e-7 degrees
+			int32_t		altitude		= 0;	///< Altitude above mean sea level, in mm
+			int32_t		velocityNorth	= 0;	///< North velocity, in mm/s
+			int32_t		velocityEast	= 0;	///< East velocity, in mm/s
+			uint32_t	accuracy		= 0;	///< Horizontal accuracy, in mm
+		};
+
+	public:
+		/**
+			\brief Constructor
+			\param capacity Number of epochs kept
+		**/
+		FixHistory(uint8_t capacity);
+
+		FixHistory(const FixHistory&) = delete;
+		FixHistory& operator=(const FixHistory&) = delete;
+
+		~FixHistory();
+
+		/**
+			\brief Forget all epochs
+		**/
+		void clear();
+
+		/**
+			\brief Add an epoch
+			\param epoch Epoch. Its tick should be greater than the tick of the latest epoch: an epoch with the
+			same tick replaces the latest one, and an older one clears the history (tick overflow)
+
+			The oldest epoch is dropped when the history is full.
+		**/
+		void push(const Epoch& epoch);
+
+		/**
+			\returns Number of epochs stored
+		**/
+		uint8_t size() const;
+
+		/**
+			\param i Index of the epoch, 0 being the latest one
+			\returns The epoch (undefined if \c i >= size())
+		**/
+		const Epoch& operator[](uint8_t i) const;
+
+		/**
+			\brief Get the position at a given time
+			\param tick Local time (System::millis()), in ms
+			\param result Position, velocity and accuracy at \c tick (time is the UTC time at \c tick, if known)
+			\returns \c true on error (\c tick before the oldest epoch or too long after the latest one),
+			\c false otherwise
+		**/
+		bool interpolate(uint32_t tick, Epoch& result) const;
+
+		/**
+			\brief Estimate the velocity at a given time
+			\param tick Local time (System::millis()), in ms
+			\param north North velocity, in mm/s
+			\param east East velocity, in mm/s
+			\returns \c true on error, \c false otherwise
+
+			Reported velocities are interpolated. When the receiver does not report velocity (GGA only), it is
+			estimated from the positions of the epochs around \c tick.
+		**/
+		bool velocity(uint32_t tick, int32_t& north, int32_t& east) const;
+
+		/**
+			\brief Set the accelerometer axis pointing forward (the direction of travel)
+			\param axis 0 for X, 1 for Y, 2 for Z
+			\param inverted \c true if the axis points backward
+		**/
+		void setForwardAxis(uint8_t axis, bool inverted = false);
+
+		/**
+			\brief Add an accelerometer sample, for dead reckoning after the latest epoch
+			\param tick Local time of the sample (System::millis()), in ms
+			\param x X axis acceleration, in mG (e.g. LIS3DSH::Data)
+			\param y Y axis acceleration, in mG
+			\param z Z axis acceleration, in mG
+
+			Without gyroscope or magnetometer, only the forward acceleration is used: it corrects the speed along
+			the course of the latest epoch. The gravity component (mounting tilt) is removed by a low-pass filter.
+			Samples should be added regularly (e.g. at the accelerometer data rate), moving or not.
+		**/
+		void addAcceleration(uint32_t tick, int16_t x, int16_t y, int16_t z);
+
+	private:
+		static constexpr float MM_PER_UNIT	= 11.1194927f;	///< Millimeters per 1e-7 degree of latitude
+		static constexpr int32_t MIN_SPEED	= 500;			///< Minimum speed for dead reckoning, in mm/s
+
+		const Epoch& at(uint8_t i) const;
+
+		/**
+			\brief Add the UTC time of \c from, shifted by \c delta ms, to \c result
+		**/
+		static void shiftTime(const Epoch& from, int32_t delta, Epoch& result);
+
+		/**
+			\brief Move a position by a distance
+			\param north North distance, in mm
+			\param east East distance, in mm
+		**/
+		static void offset(Epoch& epoch, float north, float east);
+
+		bool extrapolate(uint32_t tick, Epoch& result) const;
+
+		Epoch*		m_epochs;
+		uint8_t		m_capacity;
+		uint8_t		m_size			= 0;
+		uint8_t		m_latest		= 0;	///< Index of the latest epoch in m_epochs
+
+		uint8_t		m_axis			= 0;
+		bool		m_inverted		= false;
+		bool		m_gravityValid	= false;
+		float		m_gravity		= 0.f;	///< Forward component of the gravity, in mm/s^2
+		uint32_t	m_drTick		= 0;	///< Tick of the latest accelerometer sample
+		float		m_drSpeed		= 0.f;	///< Speed correction since the latest epoch, in mm/s
+		float		m_drDistance	= 0.f;	///< Distance correction since the latest epoch, in mm
+};
+
+#endif
@@ -0,0 +1,61 @@
+/**
+    \file flash.h
+    \version 1.0
+**/
+#ifndef GUARD_FLASH
+#define GUARD_FLASH
+
+#include <cstdint>
+
+/**
+    \brief Abstract base class for NOR flash memories
+
+    NOR flash semantics: erasing a sector sets all its bits to 1, programming can only clear bits (1 -> 0). A byte
+    programmed twice holds the AND of both values.
+    Daughter classes must implement all the methods.
+**/
+class Flash
+{
+    public:
+        /**
+            Destructor
+        **/
+        virtual ~Flash() {}
+
+        /**
+            \returns Size of the memory, in bytes
+        **/
+        virtual uint32_t size() const = 0;
+
+        /**
+            \returns Size of the erase unit, in bytes
+        **/
+        virtual uint32_t sectorSize() const = 0;
+
+        /**
+            \brief Read data
+            \param address Address of the first byte
+            \param data Destination buffer
+            \param size Size of the data, in bytes
+            \returns \c true on error, \c false otherwise
+        **/
+        virtual bool read(uint32_t address, void* data, uint32_t size) = 0;
+
+        /**
+            \brief Program data, at any address and of any size (page boundaries are handled by the driver)
+            \param address Address of the first byte
+            \param data Data to be programmed
+            \param size Size of the data, in bytes
+            \returns \c true on error, \c false otherwise
+        **/
+        virtual bool program(uint32_t address, const void* data, uint32_t size) = 0;
+
+        /**
+            \brief Erase a sector
+            \param address Address in the sector
+            \returns \c true on error, \c false otherwise
+        **/
+        virtual bool erase(uint32_t address) = 0;
+};
+
+#endif
@@ -0,0 +1,345 @@
+#!/usr/bin/env python3
+"""
+Font converter for the compressed RLEFont format (see rlefont.h).
+
+Sources:
+  - an existing Adafruit GFXfont header (1 bpp, e.g. the ones in this directory):
+        fontconvert.py gfx FreeSans24pt7b.h > FreeSans24pt_rle.h
+  - a TrueType/OpenType font, rendered with FreeType (pip install freetype-py),
+    with any set of code points and 1, 2 or 4 bits per pixel:
+        fontconvert.py ttf Lato-Regular.ttf 12 --bpp 4 --range 0x20-0x7E,0xA0-0xFF > Lato12_aa.h
+
+Report mode compares the GFXfont headers with their compressed version:
+        fontconvert.py report *.h
+
+Sizes are flash footprints: bitmaps + glyph table (+ range table), 7 bytes per
+glyph as laid out in the headers. 'Calls' is the number of primitive calls needed
+to draw every glyph once: set pixels for Display::drawChar() (one writePixel each),
+spans + literal pixels for Display::drawGlyph().
+"""
+
+import argparse
+import os
+import re
+import sys
+
+GLYPH_SIZE = 7      # bitmapOffset (2) + width, height, xAdvance, xOffset, yOffset
+RANGE_SIZE = 8      # first (4) + count (2) + glyph (2)
+FONT_DPI   = 141    # Same as Adafruit's fontconvert
+
+MAX_OP_LENGTH = 64
+
+
+class Glyph:
+    def __init__(self, codepoint, width, height, xadvance, xoffset, yoffset, pixels):
+        self.codepoint = codepoint
+        self.width     = width
+        self.height    = height
+        self.xadvance  = xadvance
+        self.xoffset   = xoffset
+        self.yoffset   = yoffset
+        self.pixels    = pixels     # Row by row, levels in [0, 2^bpp - 1]
+
+
+class Font:
+    def __init__(self, name, bpp, yadvance, glyphs):
+        self.name     = name
+        self.bpp      = bpp
+        self.yadvance = yadvance
+        self.glyphs   = sorted(glyphs, key=lambda g: g.codepoint)
+
+
+# ---------------------------------------------------------------------------
+# Sources
+
+def load_gfx(path):
+    """Parse an Adafruit GFXfont header"""
+    text = open(path).read()
+
+    bitmap_match = re.search(r'(\w+)Bitmaps\[\]\s*\w*\s*=\s*\{(.*?)\};', text, re.S)
+    glyph_match  = re.search(r'Glyphs\[\]\s*\w*\s*=\s*\{(.*?)\};', text, re.S)
+    font_match   = re.search(r'GFXfont\s+(\w+)\s*\w*\s*=\s*\{(.*?)\};', text, re.S)
+    if not (bitmap_match and glyph_match and font_match):
+        raise ValueError('%s: not a GFXfont header' % path)
+
+    bitmap = [int(v, 0) for v in re.findall(r'0x[0-9A-Fa-f]+', bitmap_match.group(2))]
+    tuples = re.findall(r'\{\s*(-?\d+),\s*(-?\d+),\s*(-?\d+),\s*(-?\d+),\s*(-?\d+),\s*(-?\d+)\s*\}',
+                        glyph_match.group(1))
+    fields = [f.strip() for f in re.sub(r'\([^)]*\)', '', font_match.group(2)).split(',')]
+    first, last, yadvance = (int(v, 0) for v in fields[2:5])
+
+    glyphs = []
+    for i, t in enumerate(tuples):
+        offset, width, height, xadvance, xoffset, yoffset = (int(v) for v in t)
+        pixels = []
+        for bit in range(width*height):
+            byte = bitmap[offset + bit//8]
+            pixels.append((byte >> (7 - bit % 8)) & 1)
+        glyphs.append(Glyph(first + i, width, height, xadvance, xoffset, yoffset, pixels))
+
+    if len(glyphs) != last - first + 1:
+        raise ValueError('%s: glyph count mismatch' % path)
+
+    return Font(font_match.group(1), 1, yadvance, glyphs), len(bitmap)
+
+
+def parse_ranges(spec):
+    codepoints = []
+    for part in spec.split(','):
+        if '-' in part:
+            a, b = part.split('-')
+            codepoints.extend(range(int(a, 0), int(b, 0) + 1))
+        else:
+            codepoints.append(int(part, 0))
+    return sorted(set(codepoints))
+
+
+def load_ttf(path, size, bpp, codepoints, name):
+    """Render a TrueType font with FreeType"""
+    import freetype
+
+    face = freetype.Face(path)
+    face.set_char_size(size*64, 0, FONT_DPI, 0)
+
+    maximum = (1 << bpp) - 1
+    flags   = freetype.FT_LOAD_RENDER
+    if bpp == 1:
+        flags |= freetype.FT_LOAD_TARGET_MONO
+
+    glyphs = []
+    for cp in codepoints:
+        if face.get_char_index(cp) == 0:
+            continue
+
+        face.load_char(cp, flags)
+        slot   = face.glyph
+        bitmap = slot.bitmap
+
+        pixels = []
+        for y in range(bitmap.rows):
+            for x in range(bitmap.width):
+                if bpp == 1:
+                    byte = bitmap.buffer[y*bitmap.pitch + x//8]
+                    pixels.append((byte >> (7 - x % 8)) & 1)
+                else:
+                    gray = bitmap.buffer[y*bitmap.pitch + x]
+                    pixels.append((gray*maximum + 127) // 255)
+
+        glyphs.append(Glyph(cp, bitmap.width, bitmap.rows, slot.advance.x >> 6,
+                            slot.bitmap_left, 1 - slot.bitmap_top, pixels))
+
+    return Font(name, bpp, face.size.height >> 6, glyphs)
+
+
+# ---------------------------------------------------------------------------
+# Encoding
+
+def encode(pixels, bpp):
+    """Run-length encode a glyph. Optimal split between runs and literals (dynamic programming)."""
+    n       = len(pixels)
+    maximum = (1 << bpp) - 1
+    step    = 8 // bpp      # Literal pixels per byte
+
+    runlength = [0]*(n + 1)
+    for i in range(n - 1, -1, -1):
+        same = i + 1 < n and pixels[i + 1] == pixels[i]
+        runlength[i] = runlength[i + 1] + 1 if same else 1
+
+    cost   = [0]*(n + 1)
+    choice = [None]*(n + 1)
+    for i in range(n - 1, -1, -1):
+        best = None
+        if pixels[i] in (0, maximum):
+            length = min(runlength[i], MAX_OP_LENGTH)
+            best   = (1 + cost[i + length], 'run', length)
+
+        candidates = set(range(step, min(MAX_OP_LENGTH, n - i) + 1, step))
+        candidates.add(min(MAX_OP_LENGTH, n - i))
+        for length in candidates:
+            c = 1 + (length*bpp + 7)//8 + cost[i + length]
+            if best is None or c < best[0]:
+                best = (c, 'literal', length)
+
+        cost[i], choice[i] = best[0], best[1:]
+
+    out   = bytearray()
+    spans = 0
+    i     = 0
+    while i < n:
+        kind, length = choice[i]
+        if kind == 'run':
+            out.append((0x40 if pixels[i] else 0x00) | (length - 1))
+            spans += 1 if pixels[i] else 0
+        else:
+            out.append(0x80 | (length - 1))
+            bits, count = 0, 0
+            for p in pixels[i:i + length]:
+                bits   = (bits << bpp) | p
+                count += bpp
+                spans += 1 if p else 0
+                if count == 8:
+                    out.append(bits)
+                    bits, count = 0, 0
+            if count:
+                out.append(bits << (8 - count))
+        i += length
+
+    return bytes(out), spans
+
+
+def decode(data, count, bpp):
+    """Reference decoder, mirrors Display::drawGlyph()"""
+    pixels  = []
+    maximum = (1 << bpp) - 1
+    i = 0
+    while len(pixels) < count:
+        op = data[i]
+        i += 1
+        length = (op & 0x3F) + 1
+        if op >> 6 == 0:
+            pixels += [0]*length
+        elif op >> 6 == 1:
+            pixels += [maximum]*length
+        else:
+            avail, bits = 0, 0
+            for _ in range(length):
+                if not avail:
+                    bits, avail = data[i], 8
+                    i += 1
+                avail -= bpp
+                pixels.append((bits >> avail) & maximum)
+    return pixels[:count]
+
+
+def ranges_of(glyphs):
+    ranges = []
+    for index, g in enumerate(glyphs):
+        if ranges and ranges[-1][0] + ranges[-1][1] == g.codepoint:
+            ranges[-1][1] += 1
+        else:
+            ranges.append([g.codepoint, 1, index])
+    return ranges
+
+
+def compress(font):
+    bitmap  = bytearray()
+    entries = []
+    spans   = 0
+    for g in font.glyphs:
+        data, s = encode(g.pixels, font.bpp)
+        assert decode(data, len(g.pixels), font.bpp) == g.pixels
+        entries.append((len(bitmap), g))
+        bitmap += data
+        spans  += s
+
+    if len(bitmap) > 0xFFFF:
+        raise ValueError('%s: encoded bitmaps exceed 64KB' % font.name)
+
+    return bitmap, entries, ranges_of(font.glyphs), spans
+
+
+def flash_size(bitmap, glyphs, ranges):
+    return len(bitmap) + GLYPH_SIZE*len(glyphs) + RANGE_SIZE*len(ranges)
+
+
+# ---------------------------------------------------------------------------
+# Output
+
+def char_comment(cp):
+    if 0x20 <= cp < 0x7F and chr(cp) not in '\\\'':
+        return "'%s'" % chr(cp)
+    return 'U+%04X' % cp
+
+
+def write_header(font, out):
+    bitmap, entries, ranges, _ = compress(font)
+    name = font.name
+
+    out.write('// Generated by fontconvert.py, %d bpp, %d glyphs\n\n' % (font.bpp, len(entries)))
+    out.write('const uint8_t %sBitmaps[] = {\n' % name)
+    for i in range(0, len(bitmap), 12):
+        out.write('  ' + ', '.join('0x%02X' % b for b in bitmap[i:i + 12]) + ',\n')
+    out.write('};\n\n')
+
+    out.write('const RLEGlyph %sGlyphs[] = {\n' % name)
+    for offset, g in entries:
+        out.write('  { %5d, %3d, %3d, %3d, %4d, %4d },   // 0x%02X %s\n'
+                  % (offset, g.width, g.height, g.xadvance, g.xoffset, g.yoffset,
+                     g.codepoint, char_comment(g.codepoint)))
+    out.write('};\n\n')
+
+    out.write('const RLERange %sRanges[] = {\n' % name)
+    for first, count, index in ranges:
+        out.write('  { 0x%04X, %3d, %3d },\n' % (first, count, index))
+    out.write('};\n\n')
+
+    out.write('const RLEFont %s = {\n' % name)
+    out.write('  %sBitmaps,\n  %sGlyphs,\n  %sRanges,\n' % (name, name, name))
+    out.write('  %d, %d, %d };\n\n' % (len(ranges), font.yadvance, font.bpp))
+    out.write('// Approx. %d bytes\n' % flash_size(bitmap, entries, ranges))
+
+
+def report(paths):
+    print('%-32s %8s %8s %7s %9s %9s' % ('Font', 'GFX', 'RLE', 'Ratio', 'GFX calls', 'RLE calls'))
+    total_gfx, total_rle = 0, 0
+    for path in paths:
+        try:
+            font, bitmap_size = load_gfx(path)
+        except ValueError:
+            continue
+
+        bitmap, entries, ranges, spans = compress(font)
+
+        gfx_size = bitmap_size + GLYPH_SIZE*len(font.glyphs)
+        rle_size = flash_size(bitmap, entries, ranges)
+        pixels   = sum(sum(g.pixels) for g in font.glyphs)
+
+        total_gfx += gfx_size
+        total_rle += rle_size
+        print('%-32s %8d %8d %6.1f%% %9d %9d'
+              % (os.path.basename(path), gfx_size, rle_size, 100.0*rle_size/gfx_size, pixels, spans))
+
+    if total_gfx:
+        print('%-32s %8d %8d %6.1f%%' % ('Total', total_gfx, total_rle, 100.0*total_rle/total_gfx))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert fonts to the compressed RLEFont format')
+    sub = parser.add_subparsers(dest='command')
+
+    gfx = sub.add_parser('gfx', help='convert a GFXfont header')
+    gfx.add_argument('header')
+    gfx.add_argument('--name', help='font name (default: GFXfont name + "_rle")')
+
+    ttf = sub.add_parser('ttf', help='render a TrueType font')
+    ttf.add_argument('font')
+    ttf.add_argument('size', type=int, help='size in points')
+    ttf.add_argument('--bpp', type=int, choices=(1, 2, 4), default=1)
+    ttf.add_argument('--range', default='0x20-0x7E', help='code points, e.g. 0x20-0x7E,0xA0-0xFF')
+    ttf.add_argument('--name')
+
+    rep = sub.add_parser('report', help='compare GFXfont headers with their compressed version')
+    rep.add_argument('headers', nargs='+')
+
+    args = parser.parse_args()
+
+    if args.command == 'gfx':
+        font, _ = load_gfx(args.header)
+        font.name = args.name or font.name + '_rle'
+        write_header(font, sys.stdout)
+    elif args.command == 'ttf':
+        name = args.name or re.sub(r'\W', '', os.path.splitext(os.path.basename(args.font))[0]) \
+               + '%dpt%db' % (args.size, args.bpp)
+        font = load_ttf(args.font, args.size, args.bpp, parse_ranges(args.range), name)
+        write_header(font, sys.stdout)
+    elif args.command == 'report':
+        report(args.headers)
+    else:
+        parser.print_help()
+        return 1
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,316 @@
+#include "geodesy.h"
+
+#include <cmath>
+
+namespace
+{
+	constexpr float		DEG_TO_RAD_F	= 0.0174532925f;
+	constexpr double	DEG_TO_RAD		= 0.017453292519943295;
+
+	constexpr uint32_t	NORTH_BASE		= 724000;		///< Offset of s_north
+	constexpr uint64_t	EAST_EQUATOR	= 729543;		///< Millimeters per 1e-7 degree of longitude at the equator, 16.16 fixed point
+	constexpr uint64_t	UNIT_TO_INDEX	= 80063993;		///< 1e-7 degrees to table index (256 per 90 degrees), 16.32 fixed point
+	constexpr int64_t	HALF_TURN		= 1800000000;	///< 180 degrees, in 1e-7 degrees
+
+	// WGS84 local scales from 0 to 90 degrees of latitude, 257 entries
+
+	/**
+		\brief Millimeters per 1e-7 degree of latitude (meridional radius of curvature), 16.16 fixed point, minus
+		NORTH_BASE
+	**/
+	const uint16_t s_north[257] =
+	{
+		  660,   660,   661,   662,   664,   666,   669,   673,   677,   682,   687,   693,
+		  699,   706,   713,   721,   729,   738,   748,   758,   769,   780,   791,   804,
+		  816,   829,   843,   858,   872,   888,   903,   920,   937,   954,   972,   990,
+		 1009,  1028,  1048,  1069,  1089,  1111,  1133,  1155,  1178,  1201,  1224,  1249,
+		 1273,  1298,  1324,  1350,  1376,  1403,  1430,  1458,  1486,  1515,  1544,  1573,
+		 1603,  1633,  1664,  1695,  1727,  1758,  1791,  1823,  1856,  1890,  1923,  1957,
+		 1992,  2027,  2062,  2097,  2133,  2169,  2206,  2242,  2280,  2317,  2355,  2393,
+		 2431,  2470,  2509,  2548,  2587,  2627,  2667,  2707,  2747,  2788,  2829,  2870,
+		 2911,  2953,  2995,  3037,  3079,  3121,  3164,  3207,  3249,  3293,  3336,  3379,
+		 3423,  3466,  3510,  3554,  3598,  3642,  3686,  3731,  3775,  3820,  3864,  3909,
+		 3954,  3999,  4043,  4088,  4133,  4178,  4223,  4268,  4313,  4358,  4403,  4448,
+		 4493,  4538,  4583,  4628,  4673,  4718,  4763,  4807,  4852,  4896,  4941,  4985,
+		 5030,  5074,  5118,  5162,  5206,  5249,  5293,  5336,  5380,  5423,  5466,  5508,
+		 5551,  5593,  5636,  5678,  5720,  5761,  5803,  5844,  5885,  5925,  5966,  6006,
+		 6046,  6086,  6125,  6165,  6204,  6242,  6281,  6319,  6356,  6394,  6431,  6468,
+		 6504,  6540,  6576,  6612,  6647,  6682,  6716,  6750,  6784,  6817,  6850,  6883,
+		 6915,  6947,  6979,  7010,  7040,  7070,  7100,  7130,  7159,  7187,  7215,  7243,
+		 7270,  7297,  7323,  7349,  7375,  7400,  7424,  7448,  7472,  7495,  7517,  7539,
+		 7561,  7582,  7603,  7623,  7643,  7662,  7680,  7698,  7716,  7733,  7750,  7766,
+		 7781,  7796,  7811,  7825,  7838,  7851,  7864,  7875,  7887,  7898,  7908,  7917,
+		 7927,  7935,  7943,  7951,  7958,  7964,  7970,  7975,  7980,  7984,  7988,  7991,
+		 7993,  7995,  7997,  7997,  7998
+	};
+
+	/**
+		\brief Millimeters per 1e-7 degree of longitude (parallel radius), p/r the equator, 0.16 fixed point
+	**/
+	const uint16_t s_east[257] =
+	{
+		65535, 65535, 65531, 65525, 65516, 65505, 65492, 65476, 65458, 65437, 65413, 65388,
+		65360, 65329, 65296, 65260, 65223, 65182, 65139, 65094, 65046, 64996, 64944, 64889,
+		64831, 64772, 64709, 64645, 64577, 64508, 64436, 64362, 64285, 64206, 64124, 64040,
+		63954, 63865, 63774, 63680, 63585, 63486, 63386, 63282, 63177, 63069, 62959, 62847,
+		62732, 62615, 62495, 62373, 62249, 62122, 61993, 61862, 61728, 61593, 61454, 61314,
+		61171, 61026, 60879, 60729, 60577, 60423, 60266, 60108, 59947, 59783, 59618, 59450,
+		59280, 59108, 58933, 58757, 58578, 58397, 58214, 58028, 57841, 57651, 57459, 57265,
+		57068, 56870, 56669, 56467, 56262, 56055, 55846, 55635, 55421, 55206, 54989, 54769,
+		54548, 54324, 54098, 53871, 53641, 53409, 53175, 52939, 52702, 52462, 52220, 51976,
+		51731, 51483, 51233, 50982, 50728, 50473, 50216, 49957, 49695, 49432, 49168, 48901,
+		48632, 48362, 48090, 47816, 47540, 47262, 46983, 46702, 46419, 46134, 45847, 45559,
+		45269, 44978, 44684, 44389, 44092, 43794, 43494, 43192, 42889, 42584, 42277, 41969,
+		41659, 41348, 41035, 40720, 40404, 40086, 39767, 39446, 39124, 38801, 38476, 38149,
+		37821, 37491, 37160, 36828, 36494, 36159, 35823, 35485, 35146, 34805, 34463, 34120,
+		33776, 33430, 33083, 32734, 32385, 32034, 31682, 31329, 30974, 30619, 30262, 29904,
+		29545, 29185, 28823, 28461, 28097, 27733, 27367, 27000, 26633, 26264, 25894, 25523,
+		25152, 24779, 24405, 24031, 23655, 23279, 22901, 22523, 22144, 21764, 21384, 21002,
+		20620, 20237, 19853, 19468, 19083, 18697, 18310, 17922, 17534, 17145, 16755, 16365,
+		15974, 15583, 15191, 14798, 14405, 14011, 13617, 13222, 12827, 12431, 12035, 11638,
+		11241, 10843, 10445, 10047,  9648,  9249,  8849,  8449,  8049,  7648,  7248,  6846,
+		 6445,  6043,  5642,  5240,  4837,  4435,  4032,  3629,  3226,  2823,  2420,  2017,
+		 1614,  1210,   807,   403,     0
+	};
+
+	/**
+		\brief Longitude difference, wrapped to [-180, 180] degrees
+	**/
+	int64_t longitudeDelta(int32_t from, int32_t to)
+	{
+		int64_t d = (int64_t)(to) - from;
+		if(d > HALF_TURN)
+			d -= 2*HALF_TURN;
+		else if(d < -HALF_TURN)
+			d += 2*HALF_TURN;
+
+		return d;
+	}
+
+	float longitudeDelta(float from, float to)
+	{
+		float d = to - from;
+		if(d > 180.f)
+			d -= 360.f;
+		else if(d < -180.f)
+			d += 360.f;
+
+		return d;
+	}
+
+	uint32_t isqrt(uint64_t v)
+	{
+		if(!v)
+			return 0;
+
+		uint64_t result	= 0;
+		uint64_t bit	= (uint64_t)(1) << ((63 - __builtin_clzll(v)) & ~1);
+
+		for(; bit; bit >>= 2)
+		{
+			if(v >= result + bit)
+			{
+				v		-= result + bit;
+				result	= (result >> 1) + bit;
+			}
+			else
+				result >>= 1;
+		}
+
+		return result;
+	}
+
+	/**
+		\brief Squared local distance, in mm^2
+		\param north Scale of latitudes, from Geodesy::scales()
+		\param east Scale of longitudes, from Geodesy::scales()
+		\returns \c true if a component does not fit in 31 bits (~2000 km), \c false otherwise
+	**/
+	bool squaredDistance(const Geodesy::Coordinate& a, const Geodesy::Coordinate& b, uint32_t north, uint32_t east,
+							uint64_t& result)
+	{
+		const int64_t y = (((int64_t)(b.latitude) - a.latitude)*north) >> 16;
+		const int64_t x = (longitudeDelta(a.longitude, b.longitude)*east) >> 16;
+
+		if(y > INT32_MAX || y < -INT32_MAX || x > INT32_MAX || x < -INT32_MAX)
+			return true;
+
+		result = (uint64_t)(x*x) + (uint64_t)(y*y);
+		return false;
+	}
+}
+
+float Geodesy::equirectangular(float lat1, float lon1, float lat2, float lon2)
+{
+	const float x = longitudeDelta(lon1, lon2)*std::cos((lat1 + lat2)*0.5f*DEG_TO_RAD_F);
+	const float y = lat2 - lat1;
+
+	return (float)(EARTH_RADIUS)*DEG_TO_RAD_F*std::sqrt(x*x + y*y);
+}
+
+float Geodesy::haversine(float lat1, float lon1, float lat2, float lon2)
+{
+	const float phi1	= lat1*DEG_TO_RAD_F;
+	const float phi2	= lat2*DEG_TO_RAD_F;
+	const float sinLat	= std::sin((phi2 - phi1)*0.5f);
+	const float sinLon	= std::sin(longitudeDelta(lon1, lon2)*DEG_TO_RAD_F*0.5f);
+
+	const float a = sinLat*sinLat + std::cos(phi1)*std::cos(phi2)*sinLon*sinLon;
+
+	return 2*(float)(EARTH_RADIUS)*std::asin(std::sqrt(a < 1.f ? a : 1.f));
+}
+
+float Geodesy::distance(float lat1, float lon1, float lat2, float lon2)
+{
+	if(std::fabs(lat2 - lat1) < 0.1f && std::fabs(longitudeDelta(lon1, lon2)) < 0.1f)
+		return equirectangular(lat1, lon1, lat2, lon2);
+
+	return haversine(lat1, lon1, lat2, lon2);
+}
+
+bool Geodesy::vincenty(double lat1, double lon1, double lat2, double lon2, double& distance, double* azimuth)
+{
+	// WGS84
+	constexpr double a = 6378137.0;
+	constexpr double f = 1/298.257223563;
+	constexpr double b = a*(1 - f);
+
+	const double L	= (lon2 - lon1)*DEG_TO_RAD;
+	const double U1	= std::atan((1 - f)*std::tan(lat1*DEG_TO_RAD));
+	const double U2	= std::atan((1 - f)*std::tan(lat2*DEG_TO_RAD));
+
+	const double sinU1 = std::sin(U1), cosU1 = std::cos(U1);
+	const double sinU2 = std::sin(U2), cosU2 = std::cos(U2);
+
+	double lambda = L;
+	double sinSigma, cosSigma, sigma, cos2Alpha, cos2SigmaM, sinLambda, cosLambda;
+
+	for(uint8_t i = 0;; ++i)
+	{
+		if(i == 200)
+			return true;
+
+		sinLambda = std::sin(lambda);
+		cosLambda = std::cos(lambda);
+
+		const double x = cosU2*sinLambda;
+		const double y = cosU1*sinU2 - sinU1*cosU2*cosLambda;
+
+		sinSigma = std::sqrt(x*x + y*y);
+		if(sinSigma == 0)
+		{ // Coincident points
+			distance = 0;
+			if(azimuth)
+				*azimuth = 0;
+			return false;
+		}
+
+		cosSigma	= sinU1*sinU2 + cosU1*cosU2*cosLambda;
+		sigma		= std::atan2(sinSigma, cosSigma);
+
+		const double sinAlpha = cosU1*cosU2*sinLambda/sinSigma;
+		cos2Alpha	= 1 - sinAlpha*sinAlpha;
+		cos2SigmaM	= (cos2Alpha != 0) ? cosSigma - 2*sinU1*sinU2/cos2Alpha : 0;	// Equatorial line
+
+		const double C = f/16*cos2Alpha*(4 + f*(4 - 3*cos2Alpha));
+		const double previous = lambda;
+
+		lambda = L + (1 - C)*f*sinAlpha*(sigma + C*sinSigma*(cos2SigmaM + C*cosSigma*(2*cos2SigmaM*cos2SigmaM - 1)));
+
+		if(std::fabs(lambda - previous) < 1e-12)
+			break;
+	}
+
+	const double u2	= cos2Alpha*(a*a - b*b)/(b*b);
+	const double A	= 1 + u2/16384*(4096 + u2*(-768 + u2*(320 - 175*u2)));
+	const double B	= u2/1024*(256 + u2*(-128 + u2*(74 - 47*u2)));
+
+	const double deltaSigma = B*sinSigma*(cos2SigmaM + B/4*(cosSigma*(2*cos2SigmaM*cos2SigmaM - 1) -
+								B/6*cos2SigmaM*(4*sinSigma*sinSigma - 3)*(4*cos2SigmaM*cos2SigmaM - 3)));
+
+	distance = b*A*(sigma - deltaSigma);
+
+	if(azimuth)
+	{
+		double alpha = std::atan2(cosU2*sinLambda, cosU1*sinU2 - sinU1*cosU2*cosLambda)/DEG_TO_RAD;
+		*azimuth = (alpha < 0) ? alpha + 360 : alpha;
+	}
+
+	return false;
+}
+
+void Geodesy::scales(int32_t latitude, uint32_t& north, uint32_t& east)
+{
+	const uint32_t l		= (latitude < 0) ? -(int64_t)(latitude) : latitude;
+	const uint32_t position	= ((uint64_t)(l)*UNIT_TO_INDEX) >> 32;	// 16.16
+	const uint32_t i		= (position >> 16 < 256) ? position >> 16 : 255;
+	const uint32_t t		= (position >> 16 < 256) ? position & 0xFFFF : 0xFFFF;
+
+	const int32_t n0 = s_north[i], n1 = s_north[i + 1];
+	const int32_t e0 = s_east[i],  e1 = s_east[i + 1];
+
+	north	= NORTH_BASE + n0 + (((n1 - n0)*(int32_t)(t)) >> 16);
+	east	= ((e0 + (((e1 - e0)*(int32_t)(t)) >> 16))*EAST_EQUATOR) >> 16;
+}
+
+uint32_t Geodesy::distance(const Coordinate& a, const Coordinate& b)
+{
+	uint32_t north, east;
+	scales(((int64_t)(a.latitude) + b.latitude)/2, north, east);
+
+	uint64_t d;
+	if(squaredDistance(a, b, north, east, d))
+		return UINT32_MAX;
+
+	return isqrt(d);
+}
+
+void Geodesy::distances(const Coordinate& from, const Coordinate* points, size_t count, uint32_t* distances)
+{
+	uint32_t north, east;
+	scales(from.latitude, north, east);
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		uint64_t d;
+		distances[i] = squaredDistance(from, points[i], north, east, d) ? UINT32_MAX : isqrt(d);
+	}
+}
+
+size_t Geodesy::nearest(const Coordinate& from, const Coordinate* points, size_t count, uint32_t* distance)
+{
+	uint32_t north, east;
+	scales(from.latitude, north, east);
+
+	// Squared distances are compared: a single square root
+	size_t		best		= count;
+	uint64_t	bestSquared	= UINT64_MAX;
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		uint64_t d;
+		if(squaredDistance(from, points[i], north, east, d))
+			d = UINT64_MAX - 1;
+
+		if(d < bestSquared)
+		{
+			best		= i;
+			bestSquared	= d;
+		}
+	}
+
+	if(distance && best < count)
+		*distance = isqrt(bestSquared);
+
+	return best;
+}
+
+uint64_t Geodesy::length(const Coordinate* points, size_t count)
+{
+	uint64_t total = 0;
+
+	for(size_t i = 1; i < count; ++i)
+		total += distance(points[i - 1], points[i]);
+
+	return total;
+}
@@ -0,0 +1,116 @@
+/**
+	\file geodesy.h
+	\version 1.0
+**/
+
+#ifndef GUARD_GEODESY
+#define GUARD_GEODESY
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+	\brief Distances between geographic coordinates
+
+	Several methods are provided, from the fastest to the most accurate:
+	- equirectangular approximation: the Earth is locally flat, the fastest method (one cosine). The
+	fixed-point variants use tables of the WGS84 local scales and integer arithmetic only, for MCUs without
+	FPU (e.g. STM32F1);
+	- haversine: the Earth is a sphere (mean radius), error up to 0.5% (ellipsoid flattening);
+	- Vincenty: geodesic on the WGS84 ellipsoid, accurate to the millimeter, iterative and double precision.
+
+	Fixed-point coordinates are in 1e-7 degrees (as given by GPS receivers), distances in millimeters.
+**/
+namespace Geodesy
+{
+	constexpr double EARTH_RADIUS = 6371008.8;	///< Mean Earth radius, in meters
+
+	/**
+		\brief Fixed-point coordinate
+	**/
+	struct Coordinate
+	{
+		int32_t latitude;	///< Latitude, in 1e-7 degrees
+		int32_t longitude;	///< Longitude, in 1e-7 degrees
+	};
+
+	/**
+		\brief Equirectangular approximation, for short distances
+		\param lat1 Latitude of the first point, in degrees
+		\param lon1 Longitude of the first point, in degrees
+		\param lat2 Latitude of the second point, in degrees
+		\param lon2 Longitude of the second point, in degrees
+		\returns Distance, in meters
+	**/
+	float equirectangular(float lat1, float lon1, float lat2, float lon2);
+
+	/**
+		\brief Haversine formula (spherical Earth)
+		\returns Distance, in meters
+	**/
+	float haversine(float lat1, float lon1, float lat2, float lon2);
+
+	/**
+		\brief Great-circle distance, choosing the method: equirectangular for short distances (less than 0.1
+		degree apart, where it is more accurate than the single precision haversine), haversine otherwise
+		\returns Distance, in meters
+	**/
+	float distance(float lat1, float lon1, float lat2, float lon2);
+
+	/**
+		\brief Vincenty inverse formula on the WGS84 ellipsoid
+		\param lat1 Latitude of the first point, in degrees
+		\param lon1 Longitude of the first point, in degrees
+		\param lat2 Latitude of the second point, in degrees
+		\param lon2 Longitude of the second point, in degrees
+		\param distance Geodesic distance, in meters
+		\param azimuth Initial azimuth from the first point, in degrees p/r true North (optional)
+		\returns \c true on error (no convergence, for nearly antipodal points), \c false otherwise
+	**/
+	bool vincenty(double lat1, double lon1, double lat2, double lon2, double& distance, double* azimuth = nullptr);
+
+	/**
+		\brief Fixed-point equirectangular approximation
+		\returns Distance, in mm (UINT32_MAX if the points are more than ~2000 km apart)
+	**/
+	uint32_t distance(const Coordinate& a, const Coordinate& b);
+
+	/**
+		\brief Fixed-point equirectangular distances from one point to several points (e.g. geofence centers)
+		\param from Origin
+		\param points Points
+		\param count Number of points
+		\param distances Destination array, \c count distances in mm (UINT32_MAX beyond ~2000 km)
+
+		The cosine of the origin latitude is computed once: the points should be within ~100 km of the origin.
+	**/
+	void distances(const Coordinate& from, const Coordinate* points, size_t count, uint32_t* distances);
+
+	/**
+		\brief Find the nearest point (fixed-point equirectangular)
+		\param from Origin
+		\param points Points
+		\param count Number of points
+		\param distance Distance to the nearest point, in mm (optional)
+		\returns Index of the nearest point, \c count if \c count is 0
+	**/
+	size_t nearest(const Coordinate& from, const Coordinate* points, size_t count, uint32_t* distance = nullptr);
+
+	/**
+		\brief Length of a polyline (fixed-point equirectangular, segment by segment)
+		\param points Vertices
+		\param count Number of vertices
+		\returns Length, in mm
+	**/
+	uint64_t length(const Coordinate* points, size_t count);
+
+	/**
+		\brief Local scales of the WGS84 ellipsoid, from tables (integer arithmetic only)
+		\param latitude Latitude, in 1e-7 degrees
+		\param north Millimeters per 1e-7 degree of latitude, 16.16 fixed point
+		\param east Millimeters per 1e-7 degree of longitude, 16.16 fixed point
+	**/
+	void scales(int32_t latitude, uint32_t& north, uint32_t& east);
+}
+
+#endif
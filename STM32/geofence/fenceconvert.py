@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""
+Geofence converter, from GeoJSON to the binary fence set format (see geofence.h).
+
+    fenceconvert.py zones.geojson zones.gfn
+    fenceconvert.py zones.geojson zones.gfn --cell 0.01 --id-property zone_id
+
+Polygon and MultiPolygon features are converted (outer rings only, holes are
+ignored). The fence ID is taken from the given property, or is the index of the
+feature. The grid cell size defaults to twice the median fence extent, which keeps
+a few candidates per cell whatever the size of the set.
+
+Report mode prints the statistics of an existing fence set:
+    fenceconvert.py report zones.gfn
+"""
+
+import argparse
+import json
+import statistics
+import struct
+import sys
+
+MAGIC       = b'GFNC'
+VERSION     = 1
+HEADER      = struct.Struct('<4sHHIiiIHHIII')
+FENCE       = struct.Struct('<IiiiiIIHH')
+UNITS       = 10000000          # 1e-7 degrees
+MAX_FENCES  = 0xFFFF
+MAX_CELLS   = 0xFFFF            # Per axis
+MAX_EXTENT  = 90*UNITS          # See geofence.h
+
+
+def varint(value):
+    """Zigzag-encoded variable-length integer"""
+    value = (value << 1) ^ (value >> 31)
+    value &= 0xFFFFFFFF
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def rings(geometry):
+    if geometry['type'] == 'Polygon':
+        yield geometry['coordinates'][0]
+    elif geometry['type'] == 'MultiPolygon':
+        for polygon in geometry['coordinates']:
+            yield polygon[0]
+
+
+def load(path, id_property):
+    with open(path) as f:
+        data = json.load(f)
+
+    features = data['features'] if data.get('type') == 'FeatureCollection' else [data]
+    fences = []
+    for index, feature in enumerate(features):
+        properties = feature.get('properties') or {}
+        fid = int(properties.get(id_property, index)) if id_property else index
+        for ring in rings(feature['geometry']):
+            # GeoJSON is longitude, latitude; rings are closed
+            vertices = [(round(lat*UNITS), round(lon*UNITS)) for lon, lat, *_ in ring]
+            if len(vertices) > 1 and vertices[0] == vertices[-1]:
+                vertices.pop()
+            if len(vertices) < 3:
+                print('Feature %d: degenerate ring, skipped' % index, file=sys.stderr)
+                continue
+            fences.append((fid, vertices))
+    return fences
+
+
+def build(fences, cell=None):
+    if not fences:
+        raise ValueError('no fence')
+    if len(fences) > MAX_FENCES:
+        raise ValueError('too many fences (%d, maximum %d)' % (len(fences), MAX_FENCES))
+
+    boxes = []
+    for fid, vertices in fences:
+        lats = [v[0] for v in vertices]
+        lons = [v[1] for v in vertices]
+        box = (min(lats), min(lons), max(lats), max(lons))
+        if box[2] - box[0] >= MAX_EXTENT or box[3] - box[1] >= MAX_EXTENT:
+            raise ValueError('fence %d is too large (or crosses the antimeridian)' % fid)
+        boxes.append(box)
+
+    origin = (min(b[0] for b in boxes), min(b[1] for b in boxes))
+    extent = (max(b[2] for b in boxes) - origin[0] + 1, max(b[3] for b in boxes) - origin[1] + 1)
+
+    if cell is None:
+        cell = 2*statistics.median(max(b[2] - b[0], b[3] - b[1]) for b in boxes)
+    cell = max(int(cell), 1, -(-max(extent) // MAX_CELLS))
+    rows = -(-extent[0] // cell)
+    columns = -(-extent[1] // cell)
+
+    # Cells overlapped by each bounding box
+    cells = [[] for _ in range(rows*columns)]
+    for index, box in enumerate(boxes):
+        for row in range((box[0] - origin[0]) // cell, (box[2] - origin[0]) // cell + 1):
+            for column in range((box[1] - origin[1]) // cell, (box[3] - origin[1]) // cell + 1):
+                cells[row*columns + column].append(index)
+
+    offsets = [0]
+    candidates = bytearray()
+    for c in cells:
+        candidates += struct.pack('<%dH' % len(c), *c)
+        offsets.append(offsets[-1] + len(c))
+
+    cells_offset = HEADER.size
+    candidates_offset = cells_offset + 4*len(offsets)
+    fences_offset = candidates_offset + len(candidates)
+    vertices_offset = fences_offset + FENCE.size*len(fences)
+
+    records = bytearray()
+    vertices = bytearray()
+    for (fid, ring), box in zip(fences, boxes):
+        data = bytearray()
+        previous = (box[0], box[1])
+        for v in ring:
+            data += varint(v[0] - previous[0]) + varint(v[1] - previous[1])
+            previous = v
+        records += FENCE.pack(fid, *box, vertices_offset + len(vertices), len(data), len(ring), 0)
+        vertices += data
+
+    header = HEADER.pack(MAGIC, VERSION, 0, len(fences), origin[0], origin[1], cell, columns, rows,
+                         cells_offset, candidates_offset, fences_offset)
+
+    return header + struct.pack('<%dI' % len(offsets), *offsets) + candidates + records + vertices
+
+
+def report(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    (magic, version, _, count, lat, lon, cell, columns, rows,
+     cells_offset, candidates_offset, fences_offset) = HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError('not a fence set')
+
+    offsets = struct.unpack_from('<%dI' % (rows*columns + 1), data, cells_offset)
+    sizes = [b - a for a, b in zip(offsets, offsets[1:])]
+    vertices = sum(FENCE.unpack_from(data, fences_offset + i*FENCE.size)[7] for i in range(count))
+
+    print('%s: %d bytes, %d fences, %d vertices (%.1f bytes/vertex)' %
+          (path, len(data), count, vertices, (len(data) - fences_offset - FENCE.size*count)/max(vertices, 1)))
+    print('Grid: %d x %d cells of %.5f degrees, origin %.7f %.7f' %
+          (columns, rows, cell/UNITS, lat/UNITS, lon/UNITS))
+    print('Candidates per cell: mean %.2f, max %d, empty cells %d%%' %
+          (statistics.mean(sizes), max(sizes), 100*sizes.count(0)//len(sizes)))
+
+
+def main():
+    if len(sys.argv) > 1 and sys.argv[1] == 'report':
+        for path in sys.argv[2:]:
+            report(path)
+        return
+
+    parser = argparse.ArgumentParser(description='GeoJSON to geofence set converter')
+    parser.add_argument('input', help='GeoJSON file')
+    parser.add_argument('output', help='Fence set file')
+    parser.add_argument('--cell', type=float, help='Grid cell size, in degrees')
+    parser.add_argument('--id-property', help='Feature property holding the fence ID')
+    args = parser.parse_args()
+
+    fences = load(args.input, args.id_property)
+    data = build(fences, args.cell*UNITS if args.cell else None)
+
+    with open(args.output, 'wb') as f:
+        f.write(data)
+
+    report(args.output)
+
+
+if __name__ == '__main__':
+    main()
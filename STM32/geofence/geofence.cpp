@@ -0,0 +1,422 @@
+#include "geofence.h"
+
+namespace
+{
+	uint16_t readU16(const uint8_t* p)
+	{
+		return p[0] | ((uint16_t)(p[1]) << 8);
+	}
+
+	uint32_t readU32(const uint8_t* p)
+	{
+		return p[0] | ((uint32_t)(p[1]) << 8) | ((uint32_t)(p[2]) << 16) | ((uint32_t)(p[3]) << 24);
+	}
+
+	/**
+		\brief Buffered reader of variable-length integers
+	**/
+	class VarintReader
+	{
+		public:
+			VarintReader(Geofences::Source& source, uint32_t offset, uint32_t size):
+				m_source(source), m_offset(offset), m_remaining(size)
+			{
+			}
+
+			/**
+				\returns \c true on error (read error, truncated data), \c false otherwise
+			**/
+			bool next(int32_t& value)
+			{
+				uint32_t v		= 0;
+				uint8_t  shift	= 0;
+
+				for(;;)
+				{
+					if(m_position == m_length && refill())
+						return true;
+
+					const uint8_t c = m_buffer[m_position++];
+					v |= (uint32_t)(c & 0x7F) << shift;
+
+					if(!(c & 0x80))
+						break;
+
+					shift += 7;
+					if(shift > 28)
+						return true;
+				}
+
+				// Zigzag
+				value = (v >> 1) ^ -(int32_t)(v & 1);
+				return false;
+			}
+
+		private:
+			bool refill()
+			{
+				if(!m_remaining)
+					return true;
+
+				m_length	= (m_remaining < sizeof(m_buffer)) ? m_remaining : sizeof(m_buffer);
+				m_position	= 0;
+
+				if(m_source.read(m_offset, m_buffer, m_length))
+					return true;
+
+				m_offset	+= m_length;
+				m_remaining	-= m_length;
+				return false;
+			}
+
+			Geofences::Source&	m_source;
+			uint32_t			m_offset;
+			uint32_t			m_remaining;
+			uint8_t				m_buffer[64];
+			uint8_t				m_position	= 0;
+			uint8_t				m_length	= 0;
+	};
+
+	/**
+		\brief Squared distance from the origin to a segment, in mm^2
+	**/
+	float segmentDistance(float ax, float ay, float bx, float by)
+	{
+		const float dx		= bx - ax;
+		const float dy		= by - ay;
+		const float length	= dx*dx + dy*dy;
+
+		float t = (length > 0) ? -(ax*dx + ay*dy)/length : 0;
+		if(t < 0)
+			t = 0;
+		else if(t > 1)
+			t = 1;
+
+		const float x = ax + t*dx;
+		const float y = ay + t*dy;
+
+		return x*x + y*y;
+	}
+}
+
+Geofences::MemorySource::MemorySource(const uint8_t* data, uint32_t size):
+	m_data(data), m_size(size)
+{
+}
+
+bool Geofences::MemorySource::read(uint32_t offset, void* data, uint32_t size)
+{
+	if(offset > m_size || size > m_size - offset)
+		return true;
+
+	const uint8_t* src = m_data + offset;
+	uint8_t* dst = static_cast<uint8_t*>(data);
+
+	for(uint32_t i = 0; i < size; ++i)
+		dst[i] = src[i];
+
+	return false;
+}
+
+Geofences::Geofences(Source& source):
+	m_source(source)
+{
+}
+
+bool Geofences::open()
+{
+	m_open = false;
+	reset();
+
+	uint8_t h[HEADER_SIZE];
+	if(m_source.read(0, h, sizeof(h)))
+		return true;
+
+	if(h[0] != 'G' || h[1] != 'F' || h[2] != 'N' || h[3] != 'C' || readU16(h + 4) != 1)
+		return true;
+
+	m_count				= readU32(h + 8);
+	m_origin.latitude	= readU32(h + 12);
+	m_origin.longitude	= readU32(h + 16);
+	m_cellSize			= readU32(h + 20);
+	m_columns			= readU16(h + 24);
+	m_rows				= readU16(h + 26);
+	m_cells				= readU32(h + 28);
+	m_candidates		= readU32(h + 32);
+	m_fences			= readU32(h + 36);
+
+	if(!m_cellSize || m_count > 0xFFFF)
+		return true;
+
+	m_open = true;
+	return false;
+}
+
+uint32_t Geofences::count() const
+{
+	return m_count;
+}
+
+void Geofences::setHysteresis(uint32_t distance)
+{
+	m_hysteresis = distance;
+}
+
+void Geofences::reset()
+{
+	m_insideCount = 0;
+}
+
+uint16_t Geofences::tested() const
+{
+	return m_tested;
+}
+
+uint8_t Geofences::inside(uint32_t* ids) const
+{
+	for(uint8_t i = 0; i < m_insideCount; ++i)
+		ids[i] = m_insideIds[i];
+
+	return m_insideCount;
+}
+
+int8_t Geofences::findInside(uint16_t fence) const
+{
+	for(uint8_t i = 0; i < m_insideCount; ++i)
+		if(m_inside[i] == fence)
+			return i;
+
+	return -1;
+}
+
+bool Geofences::readFence(uint16_t index, Fence& fence)
+{
+	uint8_t r[FENCE_SIZE];
+	if(m_source.read(m_fences + (uint32_t)(index)*FENCE_SIZE, r, sizeof(r)))
+		return true;
+
+	fence.id			= readU32(r);
+	fence.min.latitude	= readU32(r + 4);
+	fence.min.longitude	= readU32(r + 8);
+	fence.max.latitude	= readU32(r + 12);
+	fence.max.longitude	= readU32(r + 16);
+	fence.vertices		= readU32(r + 20);
+	fence.size			= readU32(r + 24);
+	fence.count			= readU16(r + 28);
+	return false;
+}
+
+bool Geofences::test(uint16_t index, const Geodesy::Coordinate& p, bool& inside, uint64_t* distance)
+{
+	Fence fence;
+	if(readFence(index, fence))
+		return true;
+
+	++m_tested;
+	inside = false;
+
+	uint32_t north, east;
+	Geodesy::scales(p.latitude, north, east);
+
+	const float northScale	= north/65536.f;
+	const float eastScale	= east/65536.f;
+
+	const bool inBox =	p.latitude >= fence.min.latitude && p.latitude <= fence.max.latitude &&
+						p.longitude >= fence.min.longitude && p.longitude <= fence.max.longitude;
+
+	if(!inBox)
+	{
+		if(!distance)
+			return false;
+
+		// Far from the bounding box: no need to look at the vertices
+		int64_t dy = 0, dx = 0;
+		if(p.latitude < fence.min.latitude)
+			dy = (int64_t)(fence.min.latitude) - p.latitude;
+		else if(p.latitude > fence.max.latitude)
+			dy = (int64_t)(p.latitude) - fence.max.latitude;
+		if(p.longitude < fence.min.longitude)
+			dx = (int64_t)(fence.min.longitude) - p.longitude;
+		else if(p.longitude > fence.max.longitude)
+			dx = (int64_t)(p.longitude) - fence.max.longitude;
+
+		const float y = dy*northScale;
+		const float x = dx*eastScale;
+		const float h = m_hysteresis;
+
+		if(x*x + y*y >= h*h)
+		{
+			*distance = UINT64_MAX;
+			return false;
+		}
+	}
+
+	VarintReader reader(m_source, fence.vertices, fence.size);
+
+	// Vertices relative to p
+	int32_t vy, vx;
+	if(reader.next(vy) || reader.next(vx))
+		return true;
+
+	const int32_t y0 = fence.min.latitude  + vy - p.latitude;
+	const int32_t x0 = fence.min.longitude + vx - p.longitude;
+
+	int32_t ay = y0, ax = x0;
+	bool	crossings	= false;
+	float	best		= (float)(m_hysteresis)*m_hysteresis;
+
+	for(uint16_t i = 1; i <= fence.count; ++i)
+	{
+		int32_t by, bx;
+		if(i < fence.count)
+		{
+			if(reader.next(vy) || reader.next(vx))
+				return true;
+
+			by = ay + vy;
+			bx = ax + vx;
+		}
+		else
+		{ // Closing edge
+			by = y0;
+			bx = x0;
+		}
+
+		// Crossing number, on a ray from p towards increasing longitudes
+		if((ay > 0) != (by > 0))
+		{
+			const int64_t cross = (int64_t)(ax)*by - (int64_t)(ay)*bx;
+			if((cross > 0) == (by > ay))
+				crossings = !crossings;
+		}
+
+		if(distance)
+		{
+			const float d = segmentDistance(ax*eastScale, ay*northScale, bx*eastScale, by*northScale);
+			if(d < best)
+				best = d;
+		}
+
+		ay = by;
+		ax = bx;
+	}
+
+	inside = crossings;
+
+	if(distance)
+		*distance = (best < (float)(m_hysteresis)*m_hysteresis) ? (uint64_t)(best) : UINT64_MAX;
+
+	return false;
+}
+
+uint8_t Geofences::update(const Geodesy::Coordinate& p, Event* events, uint8_t maxEvents)
+{
+	m_tested = 0;
+
+	if(!m_open)
+		return 0;
+
+	uint8_t count			= 0;
+	bool	seen[MAX_INSIDE]	= {false};
+
+	// A state change is only accepted away from the boundary
+	auto change = [&](uint16_t fence, bool inside) -> bool
+	{
+		if(!m_hysteresis)
+			return true;
+
+		bool		confirmed;
+		uint64_t	distance;
+		if(test(fence, p, confirmed, &distance))
+			return false;
+
+		return confirmed == inside && distance == UINT64_MAX;
+	};
+
+	auto emit = [&](uint32_t id, bool entered)
+	{
+		if(count < maxEvents)
+			events[count++] = {id, entered};
+	};
+
+	// Candidates of the cell of p
+	const int64_t row		= ((int64_t)(p.latitude)  - m_origin.latitude)/m_cellSize;
+	const int64_t column	= ((int64_t)(p.longitude) - m_origin.longitude)/m_cellSize;
+
+	if(p.latitude >= m_origin.latitude && p.longitude >= m_origin.longitude && row < m_rows && column < m_columns)
+	{
+		uint8_t range[8];
+		if(m_source.read(m_cells + 4*(uint32_t)(row*m_columns + column), range, sizeof(range)))
+			return 0;
+
+		uint32_t		offset	= m_candidates + 2*readU32(range);
+		const uint32_t	end		= m_candidates + 2*readU32(range + 4);
+
+		uint8_t buffer[64];
+		while(offset < end)
+		{
+			const uint32_t size = (end - offset < sizeof(buffer)) ? end - offset : sizeof(buffer);
+			if(m_source.read(offset, buffer, size))
+				break;
+
+			offset += size;
+
+			for(uint32_t i = 0; i < size; i += 2)
+			{
+				const uint16_t fence = readU16(buffer + i);
+
+				bool inside;
+				if(test(fence, p, inside, nullptr))
+					continue;
+
+				const int8_t j = findInside(fence);
+				if(j >= 0)
+					seen[j] = true;
+
+				if(inside == (j >= 0) || !change(fence, inside))
+					continue;
+
+				if(inside)
+				{
+					Fence record;
+					if(m_insideCount >= MAX_INSIDE || readFence(fence, record))
+						continue;
+
+					seen[m_insideCount]				= true;
+					m_inside[m_insideCount]			= fence;
+					m_insideIds[m_insideCount++]	= record.id;
+					emit(record.id, true);
+				}
+				else
+				{
+					emit(m_insideIds[j], false);
+
+					// seen[] follows m_inside[]
+					--m_insideCount;
+					m_inside[j]		= m_inside[m_insideCount];
+					m_insideIds[j]	= m_insideIds[m_insideCount];
+					seen[j]			= seen[m_insideCount];
+				}
+			}
+		}
+	}
+
+	// Fences the fix was in, and whose bounding box does not overlap the cell anymore
+	for(uint8_t j = 0; j < m_insideCount;)
+	{
+		if(seen[j] || !change(m_inside[j], false))
+		{
+			++j;
+			continue;
+		}
+
+		emit(m_insideIds[j], false);
+
+		--m_insideCount;
+		m_inside[j]		= m_inside[m_insideCount];
+		m_insideIds[j]	= m_insideIds[m_insideCount];
+		seen[j]			= seen[m_insideCount];
+	}
+
+	return count;
+}
@@ -0,0 +1,186 @@
+/**
+	\file geofence.h
+	\version 1.0
+**/
+
+#ifndef GUARD_GEOFENCE
+#define GUARD_GEOFENCE
+
+#include <cstdint>
+#include <cstddef>
+
+#include "geodesy.h"
+
+/**
+	\brief Polygonal geofences, tested against GPS fixes
+
+	A fence set is a read-only file, built by fenceconvert.py, that is never loaded in RAM: it is read through
+	a Source (from flash with MemorySource, from the SD card with GeofenceFile). Only the fences whose bounding
+	box overlaps the grid cell of the fix are tested, so the cost of update() does not depend on the size of
+	the set.
+
+	File format (all fields little-endian):
+	- header (40 bytes): magic "GFNC", version (u16), reserved (u16), number of fences (u32), grid origin
+	latitude and longitude (i32, 1e-7 degrees), grid cell size (u32, 1e-7 degrees), number of columns and rows
+	(u16), offsets of the cell table, the candidate table and the fence table (u32);
+	- cell table: columns*rows + 1 offsets (u32) in the candidate table, cells in row-major order;
+	- candidate table: indices (u16) of the fences overlapping each cell;
+	- fence table: one 32-byte record per fence: ID (u32), bounding box (minimum latitude, minimum longitude,
+	maximum latitude, maximum longitude, i32), offset and size in bytes of the vertices (u32), number of vertices
+	(u16), reserved (u16);
+	- vertices: coordinates relative to the previous vertex (the minimum of the bounding box for the first one),
+	latitude then longitude, as zigzag-encoded variable-length integers (7 bits per byte, LSB first).
+
+	Point in polygon tests use 64-bit integer arithmetic on the 1e-7 degrees coordinates. Fences must not cross
+	the antimeridian, and must be less than 90 degrees wide.
+
+	A fence is entered when the fix is inside it, and left when the fix is outside, but only when the fix is at
+	least the hysteresis distance away from the boundary, so that GPS noise does not produce event bursts.
+**/
+class Geofences
+{
+	public:
+		static constexpr uint8_t MAX_INSIDE	= 16;	///< Maximum number of fences the fix can be in simultaneously
+
+		/**
+			\brief Fence set storage
+		**/
+		class Source
+		{
+			public:
+				virtual ~Source() {}
+
+				/**
+					\brief Read data
+					\param offset Offset of the data in the fence set
+					\param data Destination buffer
+					\param size Size of the data
+					\returns \c true on error, \c false otherwise
+				**/
+				virtual bool read(uint32_t offset, void* data, uint32_t size) = 0;
+		};
+
+		/**
+			\brief Fence set in memory (e.g. a constant array in flash)
+		**/
+		class MemorySource: public Source
+		{
+			public:
+				MemorySource(const uint8_t* data, uint32_t size);
+
+				bool read(uint32_t offset, void* data, uint32_t size) override;
+
+			private:
+				const uint8_t*	m_data;
+				uint32_t		m_size;
+		};
+
+		/**
+			\brief Enter or exit event
+		**/
+		struct Event
+		{
+			uint32_t	id;			///< Fence ID
+			bool		entered;	///< \c true when entering the fence, \c false when leaving it
+		};
+
+	public:
+		/**
+			\brief Constructor
+			\param source Fence set
+		**/
+		Geofences(Source& source);
+
+		/**
+			\brief Read the header of the fence set
+			\returns \c true on error (read error, invalid file), \c false otherwise
+		**/
+		bool open();
+
+		/**
+			\returns The number of fences in the set
+		**/
+		uint32_t count() const;
+
+		/**
+			\brief Set the hysteresis distance
+			\param distance Distance to the boundary, in mm, the fix must be past to enter or leave a fence
+		**/
+		void setHysteresis(uint32_t distance);
+
+		/**
+			\brief Test a fix
+			\param position Position of the fix
+			\param events Destination array for the enter and exit events
+			\param maxEvents Size of \c events (further events are dropped, but the state is updated)
+			\returns Number of events
+		**/
+		uint8_t update(const Geodesy::Coordinate& position, Event* events, uint8_t maxEvents);
+
+		/**
+			\brief Get the fences the latest fix is in
+			\param ids Destination array, MAX_INSIDE IDs
+			\returns Number of fences
+		**/
+		uint8_t inside(uint32_t* ids) const;
+
+		/**
+			\brief Forget the fences the latest fix is in (no exit event will be generated)
+		**/
+		void reset();
+
+		/**
+			\returns Number of fences tested by the latest update() (for statistics)
+		**/
+		uint16_t tested() const;
+
+	private:
+		static constexpr uint32_t HEADER_SIZE	= 40;
+		static constexpr uint32_t FENCE_SIZE	= 32;
+
+		/**
+			\brief Fence record
+		**/
+		struct Fence
+		{
+			uint32_t			id;
+			Geodesy::Coordinate	min;
+			Geodesy::Coordinate	max;
+			uint32_t			vertices;	///< Offset of the vertices
+			uint32_t			size;		///< Size of the vertices, in bytes
+			uint16_t			count;		///< Number of vertices
+		};
+
+		/**
+			\brief Point in polygon test
+			\param fence Fence index
+			\param p Point
+			\param inside Result
+			\param distance If not \c nullptr, squared distance to the boundary (in mm^2) if less than m_hysteresis^2
+			\returns \c true on error, \c false otherwise
+		**/
+		bool test(uint16_t fence, const Geodesy::Coordinate& p, bool& inside, uint64_t* distance);
+
+		bool readFence(uint16_t index, Fence& fence);
+
+		int8_t findInside(uint16_t fence) const;
+
+		Source&		m_source;
+		bool		m_open			= false;
+		uint32_t	m_count			= 0;
+		Geodesy::Coordinate	m_origin;
+		uint32_t	m_cellSize		= 0;
+		uint16_t	m_columns		= 0;
+		uint16_t	m_rows			= 0;
+		uint32_t	m_cells			= 0;	///< Offset of the cell table
+		uint32_t	m_candidates	= 0;	///< Offset of the candidate table
+		uint32_t	m_fences		= 0;	///< Offset of the fence table
+
+		uint32_t	m_hysteresis	= 0;
+		uint16_t	m_inside[MAX_INSIDE];	///< Indices of the fences the fix is in
+		uint32_t	m_insideIds[MAX_INSIDE];
+		uint8_t		m_insideCount	= 0;
+		uint16_t	m_tested		= 0;
+};
+
+#endif
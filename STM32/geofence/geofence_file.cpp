@@ -0,0 +1,18 @@
+#include "geofence_file.h"
+
+GeofenceFile::GeofenceFile(File& file):
+	m_file(file)
+{
+}
+
+bool GeofenceFile::read(uint32_t offset, void* data, uint32_t size)
+{
+	if(!m_file.isOpen())
+		return true;
+
+	// Sequential reads (vertices, candidates) do not need to seek
+	if(m_file.tell() != offset && m_file.seek(offset) != FR_OK)
+		return true;
+
+	return m_file.read(static_cast<uint8_t*>(data), size) != size;
+}
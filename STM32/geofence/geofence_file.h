@@ -0,0 +1,32 @@
+/**
+	\file geofence_file.h
+	\version 1.0
+**/
+
+#ifndef GUARD_GEOFENCE_FILE
+#define GUARD_GEOFENCE_FILE
+
+#include "geofence.h"
+#include "filesystem/file.h"
+
+/**
+	\brief Fence set in a file (e.g. on the SD card)
+
+	The file must be open, for reading, as long as the Geofences using it.
+**/
+class GeofenceFile: public Geofences::Source
+{
+	public:
+		/**
+			\brief Constructor
+			\param file Open file
+		**/
+		GeofenceFile(File& file);
+
+		bool read(uint32_t offset, void* data, uint32_t size) override;
+
+	private:
+		File& m_file;
+};
+
+#endif
@@ -1,11 +1,11 @@
 #include "gps.h"
 
-#include <algorithm>
 #include <cmath>
 #include <cstdio>
 
 #include "system.h"
 #include "datetime.h"
+#include "geodesy.h"
 
 
 GPS::GPSData::GPSData(float latitude, float longitude, float speed, float heading, float altitude,
@@ -26,43 +26,21 @@ GPS::GPSData::GPSData():GPSData(100.0, 100.0)
 bool GPS::GPSData::isValid() const
 {
 	return (this->latitude<=90.0 && this->latitude>=-90.0 &&
-			this->longitude<=90.0 && this->longitude>=-90.0 &&
+			this->longitude<=180.0 && this->longitude>=-180.0 &&
 			this->horizontalAccuracy >= 0.0);
 }
 
 float GPS::GPSData::distanceTo(const GPSData& other) const
 {
-	/*
-	Using 'Haversine' formula
-	Note: Cortex M4 series (used in STM32F4xxx) only have a single-precision
-	FPU. It means double support is software only.
-	A quick benchmark showed that using double precision was 4 to 5 times slower
-	and added no accuracy to the result.
-	See:
-	http://www.movable-type.co.uk/scripts/latlong.html
-	*/
 	if(!isValid() || !other.isValid())
 		return -1.f;
-	
-	constexpr double pi = 3.14159265359;
-	constexpr double r = 6371.f; // Earth mean radius in km
-	
-	float lat1 = latitude*pi/180.f;
-	float lon1 = longitude*pi/180.f;
-	float lat2 = other.latitude*pi/180.f;
-	float lon2 = other.longitude*pi/180.f;
-	
-	float a = std::pow(std::sin((lat2-lat1)/2),2) +
-			std::cos(lat1)*std::cos(lat2)*
-			std::pow(std::sin((lon2-lon1)/2),2);
-	float c = 2*std::atan2(std::sqrt(a), std::sqrt(1-a));
-	
-	return r*c*1000;
+
+	return Geodesy::distance(latitude, longitude, other.latitude, other.longitude);
 }
 
 
 GPS::GPS(Serial& serial, Pin resetPin, Pin powerPin):
-	m_serial(serial), m_resetPin(resetPin)
+	m_serial(serial), m_resetPin(resetPin), m_history(HISTORY_SIZE)
 {}
 
 bool GPS::init()
@@ -86,310 +64,371 @@ bool GPS::update()
 
 bool GPS::updateRx()
 {
-	if(!m_serial.dataAvailable())
-		return false;
-	
-	m_serial.readAppend(m_buffer);
-	
+	bool updated = false;
+
+	uint8_t data[64];
+	size_t size;
+
+	while((size = m_serial.read(data, sizeof(data))) > 0)
+		updated |= process(data, size);
+
+	return updated;
+}
+
+bool GPS::process(const uint8_t* data, size_t size)
+{
 	uint32_t t = m_currentFix.timestamp;
-		
-	while(true)
+	m_newSolution = false;
+
+	for(size_t i=0;i<size;++i)
 	{
-		size_t idx = m_buffer.find('\n');
-	
-		if(idx == m_buffer.size())
-			return m_currentFix.timestamp != t;
-		
-		ByteArray line = m_buffer.reverseSplit(idx+1);
-
-        line.append(0);
-					
-		if(line.startsWith("$GPGGA"))
-			processGPGGA(line);
-		else if(line.startsWith("$GPRMC"))
-        {
-        //    printf("%s", line.internalBuffer());
-			processGPRMC(line);
-        }
-		else if(line.startsWith("$GPVTG"))
-			processGPVTG(line);
+		// NMEA sentences are only looked for between UBX frames (binary payloads may contain '$')
+		if(m_ubx.parse(data[i]))
+			processMessage();
+		else if(!m_ubx.busy() && m_parser.parse(data[i]))
+			processSentence();
 	}
-		
-	return m_currentFix.timestamp != t;
+
+	return m_currentFix.timestamp != t || m_newSolution;
 }
 
-void GPS::processGPGGA(ByteArray& d)
+const GPS::SentenceHandler GPS::s_handlers[] =
 {
-	uint32_t pos = 0;
-	
-	CardinalPoint latCard = CardinalPoint::N;
-	CardinalPoint lonCard = CardinalPoint::E;
-		
-	for(uint32_t pos=0;pos<14;++pos)
+	{ NMEAParser::sentenceType("GGA"), &GPS::processGGA },
+	{ NMEAParser::sentenceType("RMC"), &GPS::processRMC },
+	{ NMEAParser::sentenceType("VTG"), &GPS::processVTG },
+	{ NMEAParser::sentenceType("GSA"), &GPS::processGSA },
+	{ NMEAParser::sentenceType("GSV"), &GPS::processGSV }
+};
+
+void GPS::processSentence()
+{
+	Constellation constellation;
+
+	// Known talkers only (proprietary sentences have no talker)
+	if( m_parser.talker() != NMEAParser::talkerId("GN") &&
+		SatelliteStatus::constellationFromTalker(m_parser.talker(), constellation))
+		return;
+
+	const uint32_t type = m_parser.type();
+
+	for(const SentenceHandler& handler: s_handlers)
 	{
-		size_t idx = d.find(',');
-		if(idx == d.size())
-			break;
-		
-		ByteArray field = d.reverseSplit(idx+1);
-		field[field.size()-1] = '\0';
-		
-		
-		switch(pos)
+		if(handler.type == type)
 		{
-			case 1:
-			// Time
-			break;
-			case 2:
-			// Latitude num
-			{
-				float b;
-				sscanf((const char*)field.internalBuffer(), "%f", &b);
-				int deg = (int)(b/100.f);
-				float mins = b - (float)(deg*100);
-				m_currentFix.latitude = (float)deg + mins/60.f;
-				
-				if(lonCard == CardinalPoint::S)
-					m_currentFix.latitude *= -1;
-			}
-			break;
-			case 3:
-				// Latitude N/S
-				if(field[0] == 'N')
-					latCard = CardinalPoint::N;
-				else if(field[0] == 'S')
-					latCard = CardinalPoint::S;
-				
-				m_currentFix.latitude = ((latCard == CardinalPoint::S)?-1:1)*std::fabs(m_currentFix.latitude);
-			break;
-			case 4:
-			// Longitude num
-			{
-				float b;
-				sscanf((const char*)field.internalBuffer(), "%f", &b);
-				int deg = (int)(b/100.f);
-				float mins = b - (float)(deg*100);
-				m_currentFix.longitude = (float)deg + mins/60.f;
-				
-				if(lonCard == CardinalPoint::W)
-					m_currentFix.longitude *= -1;
-			}
-			break;
-			case 5:
-				// Longitude W/E
-				if(field[0] == 'E')
-					lonCard = CardinalPoint::E;
-				else if(field[0] == 'W')
-					lonCard = CardinalPoint::W;
-			
-				m_currentFix.longitude = ((lonCard == CardinalPoint::W)?-1:1)*std::fabs(m_currentFix.longitude);
-			break;
-			case 6:
-			if(field[0] == 0)
-				return;
-			break;
-			case 7:
-			// Sats in view
-			break;
-			case 8:
-			// Horizontal accuracy
-			sscanf((const char*)field.internalBuffer(), "%f", &m_currentFix.horizontalAccuracy);
-			break;
-			case 9:
-			// Altitude
-			sscanf((const char*)field.internalBuffer(), "%f", &m_currentFix.altitude);
-			break;
-			default:
-			// Useless crap & checksum
-			break;
+			(this->*handler.process)();
+			return;
 		}
 	}
 }
 
-void GPS::processGPRMC(ByteArray& d)
+void GPS::processGGA()
 {
-	uint32_t pos = 0;
+	// GGA,hhmmss.ss,ddmm.mm,N,dddmm.mm,E,quality,satellites,HDOP,altitude,M,...
+	uint32_t ms;
+	if(NMEAParser::parseTime(m_parser.field(1), ms))
+		return;
 
-    DateTime::Date date;
-    DateTime::Time time;
-	bool gotDate=false;
-	bool gotTime=false;
-	
-	CardinalPoint latCard = CardinalPoint::N;
-	CardinalPoint lonCard = CardinalPoint::E;
-				
-	for(uint32_t pos=0;pos<15;++pos)
+	beginEpoch(ms);
+	m_epochState |= EPOCH_GGA;
+
+	const char* quality = m_parser.field(6);
+	if(quality[0] == '\0' || quality[0] == '0')
+		return;
+
+	int32_t latitude, longitude;
+	if( NMEAParser::parseCoordinate(m_parser.field(2), m_parser.field(3), latitude) ||
+		NMEAParser::parseCoordinate(m_parser.field(4), m_parser.field(5), longitude))
+		return;
+
+	m_currentFix.latitude	= latitude*1e-7f;
+	m_currentFix.longitude	= longitude*1e-7f;
+	m_epoch.latitude		= latitude;
+	m_epoch.longitude		= longitude;
+	m_epochState			|= EPOCH_POSITION;
+
+	int32_t v;
+	if(!NMEAParser::parseDecimal(m_parser.field(7), 0, v))
+		m_status.quality().satellites = v;
+
+	if(!NMEAParser::parseDecimal(m_parser.field(8), 2, v))
 	{
-		size_t idx = d.find(',');
-		if(idx == d.size())
-			break;
-		
-		ByteArray field = d.reverseSplit(idx+1);
-		field[field.size()-1] = '\0';
-		
-		switch(pos)
-		{
-			case 1:
-			// Time
-			{
-				uint32_t t = 0;
-				if(sscanf((const char*)field.internalBuffer(), "%lu", &t) == 1)
-				{
-					gotTime = true;
-					time.h = t/10000;
-					time.m = t/100 - time.h*100;
-					time.s = t - time.m * 100 - time.h*10000;
-				}
-			}
-			break;
-			case 2:
-			if(field[0] != 'A')
-				return;
-			break;
-			case 3:
-			// Latitude num
-			{
-				float b;
-				if(sscanf((const char*)field.internalBuffer(), "%f", &b) == 1)
-				{
-					int deg = (int)(b/100.f);
-					float mins = b - (float)(deg*100);
-					m_currentFix.latitude = (float)deg + mins/60.f;
-				
-					if(lonCard == CardinalPoint::S)
-						m_currentFix.latitude *= -1;
-				}
-			}
-			break;
-			case 4:
-				// Latitude N/S
-				if(field[0] == 'N')
-					latCard = CardinalPoint::N;
-				else if(field[0] == 'S')
-					latCard = CardinalPoint::S;
-				
-				m_currentFix.latitude = ((latCard == CardinalPoint::S)?-1:1)*std::fabs(m_currentFix.latitude);
-			break;
-			case 5:
-				// Longitude num
-				{
-					float b;
-					if(sscanf((const char*)field.internalBuffer(), "%f", &b) == 1)
-					{
-						int deg = (int)(b/100.f);
-						float mins = b - (float)(deg*100);
-						m_currentFix.longitude = (float)deg + mins/60.f;
-				
-						if(lonCard == CardinalPoint::W)
-							m_currentFix.longitude *= -1;
-					}
-				}
-				break;
-			case 6:
-				// Longitude W/E
-				if(field[0] == 'E')
-					lonCard = CardinalPoint::E;
-				else if(field[0] == 'W')
-					lonCard = CardinalPoint::W;
-			
-				m_currentFix.longitude = ((lonCard == CardinalPoint::W)?-1:1)*std::fabs(m_currentFix.longitude);
-			case 7:
-			// Speed in knots
-			{
-				float f;
-				if(sscanf((const char*)field.internalBuffer(), "%f", &f) == 1)
-					m_currentFix.speed = f*1.852;
-			}
-			break;
-			case 8:
-			// Heading
-			{
-				float f;
-				if(sscanf((const char*)field.internalBuffer(), "%f", &f) == 1)
-					m_currentFix.heading = f;
-			}
-			break;
-			case 9:
-			// Date
-			{
-				uint32_t t = 0;
-				if(sscanf((const char*)field.internalBuffer(), "%lu", &t) == 1)
-				{
-					gotDate = true;
-					date.d = t/10000;
-					date.m = t/100 - date.d*100;
-					date.y = t - time.m * 100 - date.d*10000;
-				}
-			}
-			break;
-			default:
-			// Useless crap & checksum
-			break;
-		}
+		m_status.quality().hdop = v;
+		m_currentFix.horizontalAccuracy = v*0.01f;
 	}
-	
-	uint32_t epoch = DateTime::computeEpochFromDateTime(date, time);
-	if(epoch && gotDate && gotTime)
-	{	
-		m_currentFix.timestamp = epoch;
 
-        printf("Got datetime! %d/%d/%d %d:%d:%d\n",
-                date.d, date.m, date.y,
-                time.h, time.m, time.s);
+	if(!NMEAParser::parseDecimal(m_parser.field(9), 3, v))
+	{
+		m_currentFix.altitude	= v*1e-3f;
+		m_epoch.altitude		= v;
+		m_epoch.flags			|= FixHistory::HAS_ALTITUDE;
+	}
+
+	if(m_epochState & EPOCH_RMC)
+		commitEpoch();
+}
+
+void GPS::processRMC()
+{
+	// RMC,hhmmss.ss,status,ddmm.mm,N,dddmm.mm,E,speed (knots),heading,ddmmyy,...
+	uint32_t		ms;
+	DateTime::Date	date;
+	if(NMEAParser::parseTime(m_parser.field(1), ms))
+		return;
+
+	beginEpoch(ms);
+	m_epochState |= EPOCH_RMC;
+
+	if(!NMEAParser::parseDate(m_parser.field(9), date))
+		m_date = DateTime::computeEpochFromDateTime(date);
+
+	if(m_parser.field(2)[0] != 'A')
+		return;
+
+	int32_t latitude, longitude;
+	if( NMEAParser::parseCoordinate(m_parser.field(3), m_parser.field(4), latitude) ||
+		NMEAParser::parseCoordinate(m_parser.field(5), m_parser.field(6), longitude))
+		return;
+
+	m_currentFix.latitude	= latitude*1e-7f;
+	m_currentFix.longitude	= longitude*1e-7f;
+	m_epoch.latitude		= latitude;
+	m_epoch.longitude		= longitude;
+	m_epochState			|= EPOCH_POSITION;
+
+	int32_t speed, heading = 0;
+	if(!NMEAParser::parseDecimal(m_parser.field(8), 2, heading))
+		m_currentFix.heading = heading*0.01f;
+
+	if(!NMEAParser::parseDecimal(m_parser.field(7), 3, speed))
+	{
+		m_currentFix.speed = speed*1.852e-3f;
+
+		// Knots x1000 to mm/s, course to north and east components
+		const float v = speed*0.514444f;
+		const float a = heading*1.74532925e-4f;
+
+		m_epoch.velocityNorth	= std::lround(v*std::cos(a));
+		m_epoch.velocityEast	= std::lround(v*std::sin(a));
+		m_epoch.flags			|= FixHistory::HAS_VELOCITY;
+	}
+
+	if(m_date)
+	{
+		const uint32_t seconds = ms/1000;
+		m_currentFix.timestamp = m_date + seconds;
+	}
+
+	if(m_epochState & EPOCH_GGA)
+		commitEpoch();
+}
+
+void GPS::processVTG()
+{
+	// VTG,heading,T,magnetic heading,M,speed,N,speed,K
+	int32_t v;
+	if(!NMEAParser::parseDecimal(m_parser.field(1), 2, v))
+		m_currentFix.heading = v*0.01f;
+
+	if(!NMEAParser::parseDecimal(m_parser.field(7), 2, v))
+		m_currentFix.speed = v*0.01f;
+}
+
+void GPS::processGSA()
+{
+	m_status.processGSA(m_parser);
+}
+
+void GPS::processGSV()
+{
+	m_status.processGSV(m_parser);
+}
+
+const GPS::MessageHandler GPS::s_messageHandlers[] =
+{
+	{ UBXParser::NAV_PVT, &GPS::processNavPVT },
+	{ UBXParser::NAV_SAT, &GPS::processNavSAT },
+	{ UBXParser::ACK_ACK, &GPS::processAck },
+	{ UBXParser::ACK_NAK, &GPS::processAck }
+};
+
+void GPS::processMessage()
+{
+	const uint16_t message = m_ubx.message();
 
-		/*if(std::max(clock.secondsSinceEpoch(), epoch) - std::min(clock.secondsSinceEpoch(), epoch) > 5)
+	for(const MessageHandler& handler: s_messageHandlers)
+	{
+		if(handler.message == message)
 		{
-			debugln("Updating RTC with GPS time");
-			debug(epoch);
-			debug(" ");
-			debugln(clock.secondsSinceEpoch());
-			clock.setSecondsSinceEpoch(epoch);
-			serialProtocol.sendRTCTime();
-			
-			debug(time.Day);
-			debug("/");
-			debug(time.Month);
-			debug("/");
-			debug(time.Year);
-			debug(" ");
-			debug(time.Hours);
-			debug(":");
-			debug(time.Minutes);
-			debug(":");
-			debugln(time.Seconds);
-		}*/
+			(this->*handler.process)();
+			return;
+		}
 	}
 }
 
-void GPS::processGPVTG(ByteArray& d)
+void GPS::processNavPVT()
 {
-	uint32_t pos = 0;
-		
-	for(uint32_t pos=0;pos<15;++pos)
+	// iTOW, year, month, day, hour, min, sec, valid, tAcc, nano, fixType, flags, flags2, numSV, lon, lat,
+	// height, hMSL, hAcc, vAcc, velN, velE, velD, gSpeed, headMot, sAcc, headAcc, pDOP, ...
+	if(m_ubx.length() < 92)
+		return;
+
+	const uint8_t* p = m_ubx.payload();
+
+	// Fix types: 0 no fix, 1 dead reckoning only, 2 2D, 3 3D, 4 GNSS + dead reckoning, 5 time only
+	FixQuality& quality = m_status.quality();
+
+	const bool fixOk = p[21] & 0x01;
+	if(!fixOk)
+		quality.fixType = 1;
+	else if(p[20] == 2)
+		quality.fixType = 2;
+	else if(p[20] == 3 || p[20] == 4)
+		quality.fixType = 3;
+	else
+		quality.fixType = 1;
+
+	quality.satellites	= p[23];
+	quality.pdop		= UBXParser::readU16(p + 76);
+
+	if(quality.fixType < 2)
+		return;
+
+	m_currentFix.longitude			= UBXParser::readI32(p + 24)*1e-7f;
+	m_currentFix.latitude			= UBXParser::readI32(p + 28)*1e-7f;
+	m_currentFix.altitude			= UBXParser::readI32(p + 36)*1e-3f;
+	m_currentFix.horizontalAccuracy	= UBXParser::readU32(p + 40)*1e-3f;
+	m_currentFix.speed				= UBXParser::readI32(p + 60)*3.6e-3f;
+	m_currentFix.heading			= UBXParser::readI32(p + 64)*1e-5f;
+	m_newSolution					= true;
+
+	FixHistory::Epoch epoch;
+	epoch.tick			= System::millis();
+	epoch.flags			= FixHistory::HAS_VELOCITY | FixHistory::HAS_ALTITUDE;
+	epoch.longitude		= UBXParser::readI32(p + 24);
+	epoch.latitude		= UBXParser::readI32(p + 28);
+	epoch.altitude		= UBXParser::readI32(p + 36);
+	epoch.accuracy		= UBXParser::readU32(p + 40);
+	epoch.velocityNorth	= UBXParser::readI32(p + 48);
+	epoch.velocityEast	= UBXParser::readI32(p + 52);
+
+	// Valid date and time of day
+	if((p[11] & 0x03) == 0x03)
 	{
-		size_t idx = d.find(',');
-		if(idx == d.size())
-			break;
-		
-		ByteArray field = d.reverseSplit(idx+1);
-		field[field.size()-1] = '\0';
-		
-		
-		switch(pos)
+		DateTime::Date date(p[7], p[6], UBXParser::readU16(p + 4));
+		DateTime::Time time(p[8], p[9], p[10]);
+
+		uint32_t seconds = DateTime::computeEpochFromDateTime(date, time);
+		if(seconds)
 		{
-			case 1:
-			// Heading
-			sscanf((const char*)field.internalBuffer(), "%f", &m_currentFix.heading);
-			break;
-			case 7:
-			// Speed in km/h
-			sscanf((const char*)field.internalBuffer(), "%f", &m_currentFix.speed);
-			break;
-			default:
-			// Useless crap & checksum
-			break;
+			m_currentFix.timestamp = seconds;
+
+			// The fraction of second may be negative (rounded time)
+			int32_t ms = UBXParser::readI32(p + 16)/1000000;
+			if(ms < 0)
+			{
+				ms += 1000;
+				--seconds;
+			}
+
+			epoch.time			= seconds;
+			epoch.milliseconds	= ms;
+			epoch.flags			|= FixHistory::HAS_TIME;
 		}
 	}
+
+	m_history.push(epoch);
+}
+
+void GPS::processNavSAT()
+{
+	m_status.processNavSAT(m_ubx.payload(), m_ubx.length());
+}
+
+void GPS::processAck()
+{
+	// Class and ID of the acknowledged message
+	if(m_ubx.length() < 2)
+		return;
+
+	m_ackMessage	= UBXParser::messageId(m_ubx.payload()[0], m_ubx.payload()[1]);
+	m_ack			= (m_ubx.message() == UBXParser::ACK_ACK) ? Ack::ACK : Ack::NAK;
+}
+
+bool GPS::sendUBX(uint16_t message, const uint8_t* payload, uint16_t length, uint32_t timeout)
+{
+	uint8_t header[UBXParser::HEADER] = {	UBXParser::SYNC_1, UBXParser::SYNC_2,
+											static_cast<uint8_t>(message >> 8), static_cast<uint8_t>(message & 0xFF),
+											static_cast<uint8_t>(length & 0xFF), static_cast<uint8_t>(length >> 8) };
+	uint8_t checksum[2] = {0, 0};
+
+	UBXParser::checksum(header + 2, sizeof(header) - 2, checksum[0], checksum[1]);
+	UBXParser::checksum(payload, length, checksum[0], checksum[1]);
+
+	m_ack = Ack::NONE;
+
+	if( m_serial.write(header, sizeof(header)) ||
+		(length && m_serial.write(payload, length)) ||
+		m_serial.write(checksum, sizeof(checksum)))
+		return true;
+
+	if(!timeout)
+		return false;
+
+	const uint32_t start = System::millis();
+	while(System::millis() - start < timeout)
+	{
+		updateRx();
+
+		if(m_ack != Ack::NONE && m_ackMessage == message)
+			return m_ack == Ack::NAK;
+	}
+
+	return true;
+}
+
+bool GPS::setBinaryOutput(uint32_t baudrate, uint16_t period, uint8_t satelliteRate)
+{
+	// CFG-RATE: measurement period (ms), one navigation solution per measurement, aligned to GPS time
+	uint8_t rate[6];
+	UBXParser::writeU16(rate,		period);
+	UBXParser::writeU16(rate + 2,	1);
+	UBXParser::writeU16(rate + 4,	1);
+
+	if(sendUBX(UBXParser::CFG_RATE, rate, sizeof(rate), ACK_TIMEOUT))
+		return true;
+
+	// CFG-MSG: class, ID and rate (in navigation solutions) on the current port
+	const uint8_t pvt[] = { 0x01, 0x07, 1 };				// NAV-PVT
+	const uint8_t sat[] = { 0x01, 0x35, satelliteRate };	// NAV-SAT
+
+	if( sendUBX(UBXParser::CFG_MSG, pvt, sizeof(pvt), ACK_TIMEOUT) ||
+		sendUBX(UBXParser::CFG_MSG, sat, sizeof(sat), ACK_TIMEOUT))
+		return true;
+
+	// CFG-PRT: UART1, 8N1, UBX and NMEA input, UBX output only
+	uint8_t port[20] = {0};
+	port[0] = 1;
+	UBXParser::writeU32(port + 4,	0x000008C0);
+	UBXParser::writeU32(port + 8,	baudrate);
+	UBXParser::writeU16(port + 12,	0x0003);
+	UBXParser::writeU16(port + 14,	0x0001);
+
+	// The acknowledgement may be sent at either baudrate: do not wait for it
+	if(sendUBX(UBXParser::CFG_PRT, port, sizeof(port)))
+		return true;
+
+	HAL_Delay(100);
+
+	if(m_serial.setBaudrate(baudrate))
+		return true;
+
+	m_serial.clear();
+	m_ubx.reset();
+	m_parser.reset();
+
+	// Check the link by polling the configuration of UART1
+	return sendUBX(UBXParser::CFG_PRT, port, 1, ACK_TIMEOUT);
 }
 
 bool GPS::reset()
@@ -412,7 +451,69 @@ bool GPS::hasFix() const
 
 void GPS::clearFix()
 {
-	m_currentFix = GPSData();
+	m_currentFix	= GPSData();
+	m_status.quality()	= FixQuality();
+	m_epochTime		= UINT32_MAX;
+	m_epochState	= 0;
+	m_history.clear();
+}
+
+const FixHistory& GPS::history() const
+{
+	return m_history;
+}
+
+FixHistory& GPS::history()
+{
+	return m_history;
+}
+
+void GPS::beginEpoch(uint32_t timeOfDay)
+{
+	if(timeOfDay == m_epochTime)
+		return;
+
+	commitEpoch();
+
+	// Midnight, without RMC sentence to update the date
+	if(m_date && m_epochTime != UINT32_MAX && timeOfDay + DAY/2 < m_epochTime)
+		m_date += DAY/1000;
+
+	m_epoch			= FixHistory::Epoch();
+	m_epoch.tick	= System::millis();
+	m_epochTime		= timeOfDay;
+	m_epochState	= 0;
+}
+
+void GPS::commitEpoch()
+{
+	if((m_epochState & (EPOCH_POSITION | EPOCH_DONE)) != EPOCH_POSITION)
+		return;
+
+	if(m_date)
+	{
+		m_epoch.time			= m_date + m_epochTime/1000;
+		m_epoch.milliseconds	= m_epochTime%1000;
+		m_epoch.flags			|= FixHistory::HAS_TIME;
+	}
+
+	m_history.push(m_epoch);
+	m_epochState |= EPOCH_DONE;
+}
+
+GPS::FixQuality GPS::getFixQuality() const
+{
+	return m_status.quality();
+}
+
+uint8_t GPS::getSatellites(Satellite* satellites, uint8_t maxCount) const
+{
+	return m_status.getSatellites(satellites, maxCount);
+}
+
+uint8_t GPS::satellitesUsed(Constellation constellation) const
+{
+	return m_status.satellitesUsed(constellation);
 }
 
 GPS::GPSData GPS::getFix() const
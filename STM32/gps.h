@@ -8,6 +8,10 @@
 
 #include "uart.h"
 #include "pin.h"
+#include "nmea.h"
+#include "ubx.h"
+#include "fix_history.h"
+#include "satellite_status.h"
 
 /**
 \brief NMEA0183-based GPS handler
@@ -15,6 +19,18 @@
 This class handles a NMEAA0183-based GPS, using an UART port.
 It provides an easy-to-use interface for a subset of the features provided by the protocol, focusing on
 the most pertinent data (i.e. position, speed, bearing, horizontal accuracy, time, etc.)
+
+Single (GP) and multi-constellation (GN, GL, GA, GB/BD, GQ/QZ talkers) receivers are supported. Sentences
+are dispatched on their packed talker ID and type, through a table of handlers (GGA, RMC, VTG, GSA, GSV).
+Satellites in view and DOP are kept by a SatelliteStatus, which has no hardware dependency.
+
+u-blox receivers may also be switched to the UBX binary protocol (setBinaryOutput()): the navigation solution
+(NAV-PVT) is then received as a single ~100 bytes message instead of several NMEA sentences, allowing higher
+update rates on the same UART. NMEA and UBX messages are both decoded from the same stream.
+
+Besides the latest composite fix (getFix()), coherent navigation epochs are kept in a FixHistory: NMEA
+sentences are grouped by their UTC time, and each NAV-PVT message is an epoch. Use history() to get positions
+at sensor sample times (interpolation), velocity estimates, and accelerometer-aided dead reckoning.
 **/
 class GPS
 {
@@ -30,6 +46,10 @@ class GPS
 			W  ///< West
 		};
 		
+		using Constellation	= SatelliteStatus::Constellation;	///< Satellite navigation systems
+		using Satellite		= SatelliteStatus::Satellite;		///< Satellite in view
+		using FixQuality	= SatelliteStatus::FixQuality;		///< Fix quality metrics
+
 		/**
 			\brief Data structure for a GPS fix
 		
@@ -63,12 +83,11 @@ class GPS
 			/**
 				\brief Compute the geodesic (i.e. 'as the crow flies') distance between two points
 				\param other Other GPS point
-				\returns Geodesic distance between \c this and \c other, in meters
-			
-				This method computes the geodesic distance between two sets of GPS coordinaters: \c this
-				and \c other. The distance is computed in meters using the Haversine formula.
-				It uses several trigonometric functions and single-precision floats operations. Consequently,
-				special care should be taken on embeded devices with no FPU and/or little computationnal overhead.
+				\returns Geodesic distance between \c this and \c other, in meters, or -1 if a point is invalid
+
+				The distance is computed on a spherical Earth by Geodesy::distance(): equirectangular approximation
+				for close points, Haversine formula otherwise. See Geodesy for faster fixed-point variants, and for
+				an ellipsoidal (accurate) formula.
 			**/
 			float distanceTo(const GPSData& other) const;
 			
@@ -81,6 +100,9 @@ class GPS
 			float			altitude;				///< Altitude (m)
 		};
 	
+	public:
+		static constexpr uint8_t HISTORY_SIZE = 16;	///< Number of epochs kept in history()
+
 	public:
 		/**
 			\brief Constructor.
@@ -103,6 +125,14 @@ class GPS
 			data on the UART port, so data may be lost if the delay between two calls to update() is too great.
 		**/
 		bool update();
+
+		/**
+			\brief Process data received by other means than the UART (e.g. replayed from a log file)
+			\param data NMEA and/or UBX data, may contain partial messages
+			\param size Size of the data
+			\returns \c true if the GPS just got a fix, \c false otherwise
+		**/
+		bool process(const uint8_t* data, size_t size);
 				
 		/**
 			\returns \c true if the object received at least one valid GPS fix from the module, \c false otherwise
@@ -124,9 +154,39 @@ class GPS
 		GPSData getFix() const;
 	
 		/**
-			\brief Clear the latest fix from memory.
+			\brief Clear the latest fix and the history from memory.
 		**/
 		void clearFix();
+
+		/**
+			\returns The history of the latest navigation epochs, timestamped with System::millis() at reception
+		**/
+		const FixHistory& history() const;
+
+		/**
+			\returns The history of the latest navigation epochs (e.g. to add accelerometer samples)
+		**/
+		FixHistory& history();
+
+		/**
+			\returns Quality metrics of the latest fix (DOP, number of satellites used, 2D/3D fix)
+		**/
+		FixQuality getFixQuality() const;
+
+		/**
+			\brief Get the satellites in view
+			\param satellites Destination array
+			\param maxCount Size of the destination array
+			\returns Number of satellites copied
+			\remark The list of a constellation is refreshed at each GSV cycle (usually once per second).
+		**/
+		uint8_t getSatellites(Satellite* satellites, uint8_t maxCount) const;
+
+		/**
+			\param constellation Constellation
+			\returns Number of satellites of \c constellation used in the fix (from GSA sentences)
+		**/
+		uint8_t satellitesUsed(Constellation constellation) const;
 	
 		/**
 			\brief Send an NMEA message to the GPS module
@@ -135,6 +195,33 @@ class GPS
 			Send a NMEA message to the GPS module, adding the heading '$' and the trailing checksum.
 		**/
 		void send(const ByteArray& data);
+
+		/**
+			\brief Send a UBX message to the GPS module
+			\param message Message class and ID, packed by UBXParser::messageId()
+			\param payload Payload (may be \c nullptr if \c length is 0)
+			\param length Payload length
+			\param timeout Time to wait for the acknowledgement, in milliseconds (0: do not wait)
+			\returns \c true on error (message not acknowledged in time, or rejected), \c false otherwise
+
+			Configuration (CFG) messages are acknowledged by the receiver. While waiting for the acknowledgement,
+			incoming data is processed as by update().
+		**/
+		bool sendUBX(uint16_t message, const uint8_t* payload = nullptr, uint16_t length = 0, uint32_t timeout = 0);
+
+		/**
+			\brief Switch a u-blox receiver to binary (UBX) output
+			\param baudrate UART baudrate to use from now on (the Serial port follows)
+			\param period Navigation period, in milliseconds (e.g. 100 for 10 Hz, 200 for 5 Hz)
+			\param satelliteRate NAV-SAT (satellites in view) is sent once every \c satelliteRate solutions (0: never)
+			\returns \c true on error, \c false otherwise
+
+			The receiver is configured to output NAV-PVT at each navigation solution, NAV-SAT, and no NMEA sentence
+			on its UART1. The configuration is not saved to the receiver non-volatile memory.
+			\remark A NAV-PVT message is 100 bytes: at 10 Hz, use at least 38400 bauds, and call update() often enough
+			for the Serial RX buffer.
+		**/
+		bool setBinaryOutput(uint32_t baudrate, uint16_t period = 200, uint8_t satelliteRate = 5);
 	
 		
 		/**
@@ -147,29 +234,122 @@ class GPS
 		bool reset();
 			
 	private:
+		static constexpr uint32_t ACK_TIMEOUT		= 1000;	///< UBX acknowledgement timeout, in milliseconds
+		static constexpr uint32_t DAY				= 86400000;	///< Milliseconds per day
+
+		/**
+			\brief State of the NMEA epoch being assembled
+		**/
+		enum EpochState: uint8_t
+		{
+			EPOCH_GGA		= 0x01,	///< GGA received
+			EPOCH_RMC		= 0x02,	///< RMC received
+			EPOCH_POSITION	= 0x04,	///< Valid position received
+			EPOCH_DONE		= 0x08	///< Added to the history
+		};
+
+		enum class Ack: uint8_t
+		{
+			NONE,	///< No acknowledgement received yet
+			ACK,	///< ACK-ACK
+			NAK		///< ACK-NAK
+		};
+
+		struct SentenceHandler
+		{
+			uint32_t	type;				///< NMEAParser::sentenceType()
+			void		(GPS::*process)();
+		};
+
+		static const SentenceHandler s_handlers[];
+
+		struct MessageHandler
+		{
+			uint16_t	message;			///< UBXParser::messageId()
+			void		(GPS::*process)();
+		};
+
+		static const MessageHandler s_messageHandlers[];
+
 		Serial&		m_serial;
-		ByteArray	m_buffer;
+		NMEAParser	m_parser;
+		UBXParser	m_ubx;
 		GPSData		m_currentFix;
 		Pin			m_resetPin;
+		FixHistory	m_history;
+
+		FixHistory::Epoch	m_epoch;						///< NMEA epoch being assembled
+		uint32_t			m_epochTime		= UINT32_MAX;	///< UTC time of day of m_epoch, in ms
+		uint8_t				m_epochState	= 0;			///< Combination of EpochState
+		uint32_t			m_date			= 0;			///< UTC date of the latest epochs, in seconds since Epoch
+
+		SatelliteStatus	m_status;	///< Satellites in view, fix quality
+
+		uint16_t	m_ackMessage						= 0;	///< Message of the latest UBX acknowledgement
+		Ack			m_ack								= Ack::NONE;
+		bool		m_newSolution						= false;	///< NAV-PVT received during process()
+
+		/**
+			\brief Process the sentence just received by m_parser
+		**/
+		void processSentence();
 
 		/**
-			\brief Process NMEA GPGGA message
-			\param d Raw ASCII NMEA message
+			\brief Start a new NMEA epoch if \c timeOfDay differs from the current one
+			\param timeOfDay UTC time of the sentence, in ms since midnight
 		**/
-		void processGPGGA(ByteArray& d);
+		void beginEpoch(uint32_t timeOfDay);
+
+		/**
+			\brief Add the current NMEA epoch to the history, if it has a position
+		**/
+		void commitEpoch();
+
+		/**
+			\brief Process NMEA GGA message (fix data)
+		**/
+		void processGGA();
 	
 		/**
-			\brief Process NMEA GPRMC message
-			\param d Raw ASCII NMEA message
+			\brief Process NMEA RMC message (recommended minimum data)
 		**/
-		void processGPRMC(ByteArray& d);
+		void processRMC();
 	
 		/**
-			\brief Process NMEA GPVTG message
-			\param d Raw ASCII NMEA message
+			\brief Process NMEA VTG message (course and speed)
+		**/
+		void processVTG();
+
+		/**
+			\brief Process NMEA GSA message (DOP and active satellites)
 		**/
-		void processGPVTG(ByteArray& d);
+		void processGSA();
+
+		/**
+			\brief Process NMEA GSV message (satellites in view)
+		**/
+		void processGSV();
 	
+		/**
+			\brief Process the UBX message just received by m_ubx
+		**/
+		void processMessage();
+
+		/**
+			\brief Process UBX NAV-PVT message (navigation solution)
+		**/
+		void processNavPVT();
+
+		/**
+			\brief Process UBX NAV-SAT message (satellites in view)
+		**/
+		void processNavSAT();
+
+		/**
+			\brief Process UBX ACK-ACK and ACK-NAK messages
+		**/
+		void processAck();
+
 		/**
 			\brief Update submethod. Handle UART RX processing. 
 		**/
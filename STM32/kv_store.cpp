@@ -0,0 +1,818 @@
+#include "kv_store.h"
+
+#include <algorithm>
+#include <cstring>
+
+constexpr uint32_t KVStore::MAX_KEY_SIZE;
+constexpr uint32_t KVStore::MAX_VALUE_SIZE;
+constexpr uint32_t KVStore::SECTOR_HEADER_SIZE;
+constexpr uint32_t KVStore::RECORD_HEADER_SIZE;
+
+namespace
+{
+    // Sector header fields
+    constexpr uint32_t ERASE_COUNT      = 4;
+    constexpr uint32_t HEADER_CRC       = 8;
+    constexpr uint32_t SEQUENCE         = 12;
+    constexpr uint32_t SEQUENCE_CHECK   = 16;
+
+    // Record header fields
+    constexpr uint32_t KEY_SIZE         = 0;
+    constexpr uint32_t TYPE             = 1;
+    constexpr uint32_t VALUE_SIZE       = 2;
+    constexpr uint32_t RECORD_CRC       = 4;
+
+    constexpr uint8_t TYPE_VALUE        = 'V';
+    constexpr uint8_t TYPE_DELETE       = 'D';
+
+    const uint8_t MAGIC[4]              = {'K', 'V', 'S', '1'};
+    const uint8_t RETIRED[4]            = {0, 0, 0, 0};     ///< Magic of a sector being erased
+
+    constexpr uint32_t EMPTY            = 0xFFFFFFFF;
+
+    // Sector states
+    constexpr uint8_t FREE              = 0;    ///< Erased, header with the erase count
+    constexpr uint8_t DIRTY             = 1;    ///< To be erased before use
+    constexpr uint8_t DATA              = 2;    ///< Part of the log
+
+    constexpr uint32_t RESERVE_SECTORS  = 1;    ///< Free sectors kept for compaction
+
+    constexpr uint32_t COPY_CHUNK       = 64;
+
+    uint16_t readU16(const uint8_t* p)
+    {
+        return p[0] | ((uint16_t)(p[1]) << 8);
+    }
+
+    uint32_t readU32(const uint8_t* p)
+    {
+        return p[0] | ((uint32_t)(p[1]) << 8) | ((uint32_t)(p[2]) << 16) | ((uint32_t)(p[3]) << 24);
+    }
+
+    void writeU16(uint8_t* p, uint16_t v)
+    {
+        p[0] = v;
+        p[1] = v >> 8;
+    }
+
+    void writeU32(uint8_t* p, uint32_t v)
+    {
+        writeU16(p, v);
+        writeU16(p + 2, v >> 16);
+    }
+
+    /**
+        \brief CRC-32 (IEEE 802.3), 4 bits at a time
+        \param crc CRC of the previous data, to chain calls
+    **/
+    uint32_t crc32(const uint8_t* data, uint32_t size, uint32_t crc = 0)
+    {
+        static const uint32_t table[16] =
+        {
+            0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+            0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+        };
+
+        crc = ~crc;
+        for(uint32_t i = 0; i < size; ++i)
+        {
+            crc = table[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+            crc = table[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+        }
+        return ~crc;
+    }
+
+    /**
+        \brief FNV-1a hash of a key
+    **/
+    uint32_t hashKey(const char* key, uint32_t size)
+    {
+        uint32_t h = 2166136261UL;
+
+        for(uint32_t i = 0; i < size; ++i)
+            h = (h ^ (uint8_t)(key[i])) * 16777619UL;
+
+        return h;
+    }
+
+    uint32_t keyLength(const char* key)
+    {
+        uint32_t size = 0;
+
+        while(key[size] && size <= KVStore::MAX_KEY_SIZE)
+            size++;
+
+        return size;
+    }
+
+    /**
+        \returns Size of a record, 0 if its header is blank or invalid
+    **/
+    uint32_t recordSize(const uint8_t* header)
+    {
+        const uint8_t keySize   = header[KEY_SIZE];
+        const uint16_t valueSize = readU16(header + VALUE_SIZE);
+
+        if(keySize == 0 || keySize > KVStore::MAX_KEY_SIZE || valueSize > KVStore::MAX_VALUE_SIZE)
+            return 0;
+
+        if(header[TYPE] != TYPE_VALUE && !(header[TYPE] == TYPE_DELETE && valueSize == 0))
+            return 0;
+
+        return KVStore::RECORD_HEADER_SIZE + keySize + valueSize;
+    }
+}
+
+KVStore::KVStore(Flash& flash, uint32_t maxKeys, uint32_t start, uint32_t size):
+    m_flash(flash), m_start(start), m_size(size), m_maxKeys(maxKeys)
+{
+    uint32_t slots = 1;
+
+    // At least one slot always empty: the probe sequences end
+    while(slots <= maxKeys + maxKeys / 2)
+        slots <<= 1;
+
+    m_slots     = new Slot[slots];
+    m_slotMask  = slots - 1;
+}
+
+KVStore::~KVStore()
+{
+    delete[] m_slots;
+    delete[] m_sectors;
+}
+
+bool KVStore::mount()
+{
+    m_mounted       = false;
+    m_head          = -1;
+    m_sequence      = 0;
+    m_count         = 0;
+    m_liveBytes     = 0;
+    m_stats         = Stats();
+
+    for(uint32_t i = 0; i <= m_slotMask; ++i)
+        m_slots[i].address = EMPTY;
+
+    m_sectorSize = m_flash.sectorSize();
+
+    if(!m_size && m_start < m_flash.size())
+        m_size = m_flash.size() - m_start;
+
+    if(m_start % m_sectorSize || m_start > m_flash.size() || m_size > m_flash.size() - m_start)
+        return true;
+
+    // Largest record, with the sector header
+    if(m_sectorSize < SECTOR_HEADER_SIZE + RECORD_HEADER_SIZE + MAX_KEY_SIZE + MAX_VALUE_SIZE)
+        return true;
+
+    if(m_sectorCount != m_size / m_sectorSize)
+    {
+        delete[] m_sectors;
+        m_sectorCount   = m_size / m_sectorSize;
+        m_sectors       = new Sector[m_sectorCount];
+    }
+
+    if(m_sectorCount < 3)
+        return true;
+
+    uint32_t maxErase = 0;
+    uint32_t dataSectors = 0;
+
+    for(uint32_t s = 0; s < m_sectorCount; ++s)
+    {
+        if(loadSector(s))
+            return true;
+
+        if(m_sectors[s].eraseCount != EMPTY)
+            maxErase = std::max(maxErase, m_sectors[s].eraseCount);
+
+        if(m_sectors[s].state == DATA)
+            dataSectors++;
+    }
+
+    // Erase count lost (blank or foreign sector): assume the worst
+    for(uint32_t s = 0; s < m_sectorCount; ++s)
+        if(m_sectors[s].eraseCount == EMPTY)
+            m_sectors[s].eraseCount = maxErase;
+
+    // No free sector: a compaction was interrupted after taking the reserve, before erasing the oldest sector. The
+    // newest sector only holds copies of records still in the oldest one: dropping it restores the reserve
+    if(dataSectors == m_sectorCount)
+    {
+        uint32_t newest = 0;
+
+        for(uint32_t s = 1; s < m_sectorCount; ++s)
+            if(m_sectors[s].sequence > m_sectors[newest].sequence)
+                newest = s;
+
+        if(eraseSector(newest))
+            return true;
+
+        dataSectors--;
+    }
+
+    // Replay the log in sequence order, newer records replace older ones
+    uint32_t last = 0;
+
+    for(uint32_t n = 0; n < dataSectors; ++n)
+    {
+        int32_t next = -1;
+
+        for(uint32_t s = 0; s < m_sectorCount; ++s)
+        {
+            if(m_sectors[s].state == DATA && (!n || m_sectors[s].sequence > last) &&
+               (next < 0 || m_sectors[s].sequence < m_sectors[next].sequence))
+                next = s;
+        }
+
+        if(scanSector(next))
+            return true;
+
+        last    = m_sectors[next].sequence;
+        m_head  = next;
+    }
+
+    m_sequence  = last;
+    m_mounted   = true;
+
+    return false;
+}
+
+bool KVStore::format()
+{
+    if(!m_sectors && mount())
+        return true;
+
+    for(uint32_t s = 0; s < m_sectorCount; ++s)
+    {
+        if(m_sectors[s].state != FREE && eraseSector(s))
+            return true;
+    }
+
+    return mount();
+}
+
+bool KVStore::get(const char* key, void* value, uint16_t maxSize, uint16_t& size) const
+{
+    size = 0;
+
+    const uint32_t keySize = keyLength(key);
+
+    if(!m_mounted || keySize == 0 || keySize > MAX_KEY_SIZE)
+        return true;
+
+    uint8_t header[RECORD_HEADER_SIZE];
+    const int32_t slot = find(key, keySize, hashKey(key, keySize), header);
+
+    if(slot < 0)
+        return true;
+
+    const uint32_t record = m_slots[slot].address;
+
+    size = readU16(header + VALUE_SIZE);
+
+    if(size > maxSize)
+        return true;
+
+    return m_flash.read(record + RECORD_HEADER_SIZE + keySize, value, size);
+}
+
+bool KVStore::set(const char* key, const void* value, uint16_t size)
+{
+    const uint32_t keySize = keyLength(key);
+
+    if(!m_mounted || keySize == 0 || keySize > MAX_KEY_SIZE || size > MAX_VALUE_SIZE || (size && !value))
+        return true;
+
+    const uint32_t hash = hashKey(key, keySize);
+    uint8_t header[RECORD_HEADER_SIZE];
+    const int32_t slot = find(key, keySize, hash, header);
+    uint32_t oldSize = 0;
+
+    if(slot >= 0)
+    {
+        // Same value: nothing to write, saves the flash from repeated saves
+        const uint32_t record = m_slots[slot].address;
+
+        oldSize = recordSize(header);
+
+        if(readU16(header + VALUE_SIZE) == size)
+        {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(value);
+            uint8_t chunk[COPY_CHUNK];
+            uint32_t i = 0;
+
+            while(i < size)
+            {
+                const uint32_t n = std::min(size - i, COPY_CHUNK);
+
+                if(m_flash.read(record + RECORD_HEADER_SIZE + keySize + i, chunk, n))
+                    return true;
+
+                if(std::memcmp(chunk, p + i, n))
+                    break;
+
+                i += n;
+            }
+
+            if(i == size)
+                return false;
+        }
+    }
+    else if(m_count == m_maxKeys)
+        return true;
+
+    const uint32_t newSize = RECORD_HEADER_SIZE + keySize + size;
+
+    // Current records must fit in the sectors left once the reserve is set aside
+    if(m_liveBytes - oldSize + newSize > (m_sectorCount - RESERVE_SECTORS - 1) * (m_sectorSize - SECTOR_HEADER_SIZE))
+        return true;
+
+    m_stats.userBytes += newSize;
+
+    if(append(TYPE_VALUE, key, keySize, value, size))
+        return true;
+
+    m_liveBytes += newSize - oldSize;
+    return index(key, keySize, hash, address(m_head) + m_sectors[m_head].used - newSize);
+}
+
+bool KVStore::remove(const char* key)
+{
+    const uint32_t keySize = keyLength(key);
+
+    if(!m_mounted || keySize == 0 || keySize > MAX_KEY_SIZE)
+        return true;
+
+    const uint32_t hash = hashKey(key, keySize);
+    uint8_t header[RECORD_HEADER_SIZE];
+    const int32_t slot = find(key, keySize, hash, header);
+
+    if(slot < 0)
+        return false;
+
+    m_stats.userBytes += RECORD_HEADER_SIZE + keySize;
+
+    if(append(TYPE_DELETE, key, keySize, nullptr, 0))
+        return true;
+
+    m_liveBytes -= recordSize(header);
+    removeSlot(slot);
+    m_count--;
+
+    return false;
+}
+
+bool KVStore::contains(const char* key) const
+{
+    const uint32_t keySize = keyLength(key);
+
+    if(!m_mounted || keySize == 0 || keySize > MAX_KEY_SIZE)
+        return false;
+
+    return find(key, keySize, hashKey(key, keySize)) >= 0;
+}
+
+void KVStore::resetStats()
+{
+    m_stats = Stats();
+}
+
+void KVStore::eraseCounts(uint32_t& min, uint32_t& max) const
+{
+    min = EMPTY;
+    max = 0;
+
+    for(uint32_t s = 0; s < m_sectorCount; ++s)
+    {
+        min = std::min(min, m_sectors[s].eraseCount);
+        max = std::max(max, m_sectors[s].eraseCount);
+    }
+
+    if(!m_sectorCount)
+        min = 0;
+}
+
+int32_t KVStore::find(const char* key, uint32_t keySize, uint32_t hash, uint8_t* header) const
+{
+    uint8_t record[RECORD_HEADER_SIZE + MAX_KEY_SIZE];
+    uint32_t i = hash & m_slotMask;
+
+    for(uint32_t probes = 0; probes <= m_slotMask && m_slots[i].address != EMPTY; ++probes, i = (i + 1) & m_slotMask)
+    {
+        if(m_slots[i].hash != hash)
+            continue;
+
+        // Hash match: compare the key stored in the record
+        if(m_flash.read(m_slots[i].address, record, RECORD_HEADER_SIZE + keySize))
+            return -1;
+
+        if(record[KEY_SIZE] == keySize && !std::memcmp(record + RECORD_HEADER_SIZE, key, keySize))
+        {
+            if(header)
+                std::memcpy(header, record, RECORD_HEADER_SIZE);
+
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+int32_t KVStore::slotOf(uint32_t hash, uint32_t address) const
+{
+    uint32_t i = hash & m_slotMask;
+
+    for(uint32_t probes = 0; probes <= m_slotMask && m_slots[i].address != EMPTY; ++probes, i = (i + 1) & m_slotMask)
+    {
+        if(m_slots[i].address == address)
+            return i;
+    }
+
+    return -1;
+}
+
+bool KVStore::index(const char* key, uint32_t keySize, uint32_t hash, uint32_t address)
+{
+    const int32_t slot = find(key, keySize, hash);
+
+    if(address == EMPTY)
+    {
+        if(slot >= 0)
+        {
+            removeSlot(slot);
+            m_count--;
+        }
+        return false;
+    }
+
+    if(slot >= 0)
+    {
+        m_slots[slot].address = address;
+        return false;
+    }
+
+    if(m_count == m_maxKeys)
+        return true;
+
+    uint32_t i = hash & m_slotMask;
+
+    while(m_slots[i].address != EMPTY)
+        i = (i + 1) & m_slotMask;
+
+    m_slots[i].hash     = hash;
+    m_slots[i].address  = address;
+    m_count++;
+
+    return false;
+}
+
+void KVStore::removeSlot(uint32_t slot)
+{
+    // Linear probing: move back the entries of the probe sequence that the hole would hide
+    uint32_t i = slot;
+    uint32_t j = slot;
+
+    while(true)
+    {
+        j = (j + 1) & m_slotMask;
+
+        if(m_slots[j].address == EMPTY)
+            break;
+
+        const uint32_t home = m_slots[j].hash & m_slotMask;
+
+        if(((j - home) & m_slotMask) >= ((j - i) & m_slotMask))
+        {
+            m_slots[i] = m_slots[j];
+            i = j;
+        }
+    }
+
+    m_slots[i].address = EMPTY;
+}
+
+bool KVStore::loadSector(uint32_t sector)
+{
+    uint8_t header[SECTOR_HEADER_SIZE];
+    Sector& s = m_sectors[sector];
+
+    if(m_flash.read(address(sector), header, sizeof(header)))
+        return true;
+
+    s.sequence      = 0;
+    s.eraseCount    = EMPTY;
+    s.used          = m_sectorSize;
+    s.state         = DIRTY;
+
+    // Magic cleared: sector being erased, the erase count is still valid
+    const bool retired = !std::memcmp(header, RETIRED, sizeof(RETIRED));
+
+    if((!std::memcmp(header, MAGIC, sizeof(MAGIC)) || retired) &&
+       crc32(header + ERASE_COUNT, 4, crc32(MAGIC, sizeof(MAGIC))) == readU32(header + HEADER_CRC))
+        s.eraseCount = readU32(header + ERASE_COUNT);
+
+    // Blank, foreign or retired sector: erased before use
+    if(retired || s.eraseCount == EMPTY)
+        return false;
+
+    const uint32_t sequence = readU32(header + SEQUENCE);
+    const uint32_t check    = readU32(header + SEQUENCE_CHECK);
+
+    if(sequence == EMPTY && check == EMPTY)
+    {
+        s.state = FREE;
+        s.used  = SECTOR_HEADER_SIZE;
+    }
+    else if(sequence == ~check)
+    {
+        s.state     = DATA;
+        s.sequence  = sequence;
+    }
+
+    return false;
+}
+
+bool KVStore::scanSector(uint32_t sector)
+{
+    Sector& s = m_sectors[sector];
+    uint32_t offset = SECTOR_HEADER_SIZE;
+
+    while(offset + RECORD_HEADER_SIZE <= m_sectorSize)
+    {
+        uint8_t record[RECORD_HEADER_SIZE + MAX_KEY_SIZE];
+        const uint32_t base = address(sector) + offset;
+
+        if(m_flash.read(base, record, RECORD_HEADER_SIZE))
+            return true;
+
+        // Free space
+        if(record[KEY_SIZE] == 0xFF)
+            break;
+
+        const uint32_t size = recordSize(record);
+
+        if(!size || offset + size > m_sectorSize)
+        {
+            // Torn record: nothing can be appended after it
+            s.used = m_sectorSize;
+            return false;
+        }
+
+        const uint8_t keySize = record[KEY_SIZE];
+        const uint16_t valueSize = readU16(record + VALUE_SIZE);
+
+        if(m_flash.read(base + RECORD_HEADER_SIZE, record + RECORD_HEADER_SIZE, keySize))
+            return true;
+
+        uint32_t crc = crc32(record, RECORD_CRC);
+        crc = crc32(record + RECORD_HEADER_SIZE, keySize, crc);
+
+        for(uint32_t i = 0; i < valueSize; i += COPY_CHUNK)
+        {
+            uint8_t chunk[COPY_CHUNK];
+            const uint32_t n = std::min(valueSize - i, COPY_CHUNK);
+
+            if(m_flash.read(base + RECORD_HEADER_SIZE + keySize + i, chunk, n))
+                return true;
+
+            crc = crc32(chunk, n, crc);
+        }
+
+        if(crc != readU32(record + RECORD_CRC))
+        {
+            s.used = m_sectorSize;
+            return false;
+        }
+
+        const char* key = reinterpret_cast<const char*>(record + RECORD_HEADER_SIZE);
+        const uint32_t hash = hashKey(key, keySize);
+        uint8_t old[RECORD_HEADER_SIZE];
+
+        if(find(key, keySize, hash, old) >= 0)
+            m_liveBytes -= recordSize(old);
+
+        if(record[TYPE] == TYPE_VALUE)
+            m_liveBytes += size;
+
+        if(index(key, keySize, hash, record[TYPE] == TYPE_VALUE ? base : EMPTY))
+            return true;
+
+        offset += size;
+    }
+
+    s.used = offset;
+    return false;
+}
+
+bool KVStore::append(uint8_t type, const char* key, uint32_t keySize, const void* value, uint32_t valueSize)
+{
+    const uint32_t size = RECORD_HEADER_SIZE + keySize + valueSize;
+
+    if(makeRoom(size))
+        return true;
+
+    uint8_t record[RECORD_HEADER_SIZE + MAX_KEY_SIZE];
+
+    record[KEY_SIZE]    = keySize;
+    record[TYPE]        = type;
+    writeU16(record + VALUE_SIZE, valueSize);
+    std::memcpy(record + RECORD_HEADER_SIZE, key, keySize);
+
+    uint32_t crc = crc32(record, RECORD_CRC);
+    crc = crc32(record + RECORD_HEADER_SIZE, keySize, crc);
+    crc = crc32(reinterpret_cast<const uint8_t*>(value), valueSize, crc);
+    writeU32(record + RECORD_CRC, crc);
+
+    Sector& s = m_sectors[m_head];
+    const uint32_t base = address(m_head) + s.used;
+
+    // A failed write may leave a torn record: the sector takes no more records
+    s.used += size;
+    m_stats.flashBytes += size;
+
+    if(m_flash.program(base, record, RECORD_HEADER_SIZE + keySize) ||
+       (valueSize && m_flash.program(base + RECORD_HEADER_SIZE + keySize, value, valueSize)))
+    {
+        s.used = m_sectorSize;
+        return true;
+    }
+
+    return false;
+}
+
+bool KVStore::makeRoom(uint32_t size)
+{
+    // Each compaction frees a sector: the log is compacted at most once per sector
+    for(uint32_t n = 0; n <= m_sectorCount; ++n)
+    {
+        if(m_head >= 0 && m_sectors[m_head].used + size <= m_sectorSize)
+            return false;
+
+        if(freeSectors() > RESERVE_SECTORS)
+            return openSector();
+
+        if(compact())
+            return true;
+    }
+
+    return true;
+}
+
+bool KVStore::openSector()
+{
+    // Dynamic wear leveling: least erased sector
+    int32_t sector = -1;
+
+    for(uint32_t s = 0; s < m_sectorCount; ++s)
+    {
+        if(m_sectors[s].state != DATA &&
+           (sector < 0 || m_sectors[s].eraseCount < m_sectors[sector].eraseCount))
+            sector = s;
+    }
+
+    if(sector < 0)
+        return true;
+
+    if(m_sectors[sector].state == DIRTY && eraseSector(sector))
+        return true;
+
+    Sector& s = m_sectors[sector];
+    uint8_t header[SECTOR_HEADER_SIZE];
+
+    std::memcpy(header, MAGIC, sizeof(MAGIC));
+    writeU32(header + ERASE_COUNT, s.eraseCount);
+    writeU32(header + HEADER_CRC, crc32(header, HEADER_CRC));
+    writeU32(header + SEQUENCE, m_sequence + 1);
+    writeU32(header + SEQUENCE_CHECK, ~(m_sequence + 1));
+
+    // Programming the magic and erase count again is harmless: same bits
+    m_stats.flashBytes += sizeof(header);
+
+    if(m_flash.program(address(sector), header, sizeof(header)))
+    {
+        s.state = DIRTY;
+        return true;
+    }
+
+    m_sequence  = m_sequence + 1;
+    s.sequence  = m_sequence;
+    s.state     = DATA;
+    s.used      = SECTOR_HEADER_SIZE;
+    m_head      = sector;
+
+    return false;
+}
+
+bool KVStore::compact()
+{
+    int32_t victim = -1;
+
+    for(uint32_t s = 0; s < m_sectorCount; ++s)
+    {
+        if(m_sectors[s].state == DATA && (int32_t)(s) != m_head &&
+           (victim < 0 || m_sectors[s].sequence < m_sectors[victim].sequence))
+            victim = s;
+    }
+
+    if(victim < 0)
+        return true;
+
+    m_stats.compactions++;
+
+    const uint32_t end = m_sectors[victim].used;
+    uint32_t offset = SECTOR_HEADER_SIZE;
+
+    while(offset + RECORD_HEADER_SIZE <= end)
+    {
+        uint8_t record[RECORD_HEADER_SIZE + MAX_KEY_SIZE];
+        const uint32_t base = address(victim) + offset;
+
+        if(m_flash.read(base, record, RECORD_HEADER_SIZE))
+            return true;
+
+        const uint32_t size = recordSize(record);
+
+        if(record[KEY_SIZE] == 0xFF || !size || offset + size > end)
+            break;
+
+        offset += size;
+
+        if(m_flash.read(base + RECORD_HEADER_SIZE, record + RECORD_HEADER_SIZE, record[KEY_SIZE]))
+            return true;
+
+        // Deletions are dropped: the older records of their key were in this sector or older ones, already compacted
+        const int32_t slot = slotOf(hashKey(reinterpret_cast<const char*>(record + RECORD_HEADER_SIZE), record[KEY_SIZE]), base);
+
+        if(slot < 0)
+            continue;
+
+        if(m_sectors[m_head].used + size > m_sectorSize && openSector())
+            return true;
+
+        const uint32_t target = address(m_head) + m_sectors[m_head].used;
+
+        m_sectors[m_head].used += size;
+        m_stats.flashBytes  += size;
+        m_stats.copiedBytes += size;
+
+        for(uint32_t i = 0; i < size; i += COPY_CHUNK)
+        {
+            uint8_t chunk[COPY_CHUNK];
+            const uint32_t n = std::min(size - i, COPY_CHUNK);
+
+            if(m_flash.read(base + i, chunk, n) || m_flash.program(target + i, chunk, n))
+            {
+                m_sectors[m_head].used = m_sectorSize;
+                return true;
+            }
+        }
+
+        m_slots[slot].address = target;
+    }
+
+    return eraseSector(victim);
+}
+
+bool KVStore::eraseSector(uint32_t sector)
+{
+    Sector& s = m_sectors[sector];
+    uint8_t header[HEADER_CRC + 4];
+
+    // Clear the magic first: a partial erase must not leave a valid header over old records
+    s.state = DIRTY;
+    s.used  = m_sectorSize;
+
+    if(m_flash.program(address(sector), RETIRED, sizeof(RETIRED)) || m_flash.erase(address(sector)))
+        return true;
+
+    s.eraseCount++;
+    m_stats.erases++;
+
+    // Keep the erase count across power cycles, until the sector is used
+    std::memcpy(header, MAGIC, sizeof(MAGIC));
+    writeU32(header + ERASE_COUNT, s.eraseCount);
+    writeU32(header + HEADER_CRC, crc32(header, HEADER_CRC));
+    m_stats.flashBytes += sizeof(header);
+
+    if(m_flash.program(address(sector), header, sizeof(header)))
+        return true;
+
+    s.state = FREE;
+    s.used  = SECTOR_HEADER_SIZE;
+    return false;
+}
+
+uint32_t KVStore::freeSectors() const
+{
+    uint32_t count = 0;
+
+    for(uint32_t s = 0; s < m_sectorCount; ++s)
+    {
+        if(m_sectors[s].state != DATA)
+            count++;
+    }
+
+    return count;
+}
@@ -0,0 +1,234 @@
+/**
+    \file kv_store.h
+    \version 1.0
+**/
+#ifndef GUARD_KV_STORE
+#define GUARD_KV_STORE
+
+#include "flash.h"
+
+/**
+    \brief Persistent key/value store on NOR flash (configuration, calibration, session keys...)
+
+    The store is a log: set() and remove() append a record to the current sector, and never modify the flash in
+    place. Each sector starts with a header (all fields little-endian): magic "KVS1", erase count (u32), CRC-32 of
+    both (u32), sequence number (u32, order of the sectors in the log) and its complement (u32). Records follow:
+    key size (u8), type (u8, value or deletion), value size (u16), CRC-32 of the record (u32), key, value.
+
+    When no free sector is left besides a reserve, the oldest sector of the log is compacted: the records still
+    current are copied to the head of the log and the sector is erased. Compacting in log order wears all the
+    sectors evenly, including those holding data that never changes, and new sectors are taken among the free ones
+    with the lowest erase count.
+
+    A power loss at any point leaves the store valid: records are checked by their CRC when the store is mounted, a
+    torn record ends its sector, and a sector is invalidated before being erased, so that a partial erase can not
+    bring back old records. A compaction interrupted after taking the last free sector is rolled back by mount().
+
+    mount() scans the log and builds a hash table in RAM (8 bytes per slot, the power of 2 above maxKeys * 3/2): lookups read a single record from the flash.
+**/
+class KVStore
+{
+    public:
+        static constexpr uint32_t MAX_KEY_SIZE          = 64;   ///< Maximum key length, in characters
+        static constexpr uint32_t MAX_VALUE_SIZE        = 1024; ///< Maximum value size, in bytes
+        static constexpr uint32_t SECTOR_HEADER_SIZE    = 20;
+        static constexpr uint32_t RECORD_HEADER_SIZE    = 8;
+
+        /**
+            \brief Store counters, since mount() or resetStats(). Write amplification: flashBytes / userBytes
+        **/
+        struct Stats
+        {
+            uint32_t    userBytes       = 0;    ///< Size of the records written by set() and remove()
+            uint32_t    flashBytes      = 0;    ///< Bytes programmed, including headers and compaction copies
+            uint32_t    copiedBytes     = 0;    ///< Bytes copied by compactions
+            uint32_t    compactions     = 0;
+            uint32_t    erases          = 0;
+        };
+
+    public:
+        /**
+            \brief Constructor
+            \param flash Flash memory
+            \param maxKeys Maximum number of keys
+            \param start Start of the store in the memory, aligned on a sector
+            \param size Size of the store, in bytes, at least 3 sectors (0: up to the end of the memory)
+        **/
+        KVStore(Flash& flash, uint32_t maxKeys, uint32_t start = 0, uint32_t size = 0);
+
+        /**
+            No copy.
+        **/
+        KVStore(const KVStore&) = delete;
+
+        ~KVStore();
+
+        /**
+            \brief Scan the store and build the index. A blank or foreign memory is an empty store: its sectors are
+            erased when they are needed
+            \returns \c true on error (invalid geometry, read error, more keys than maxKeys), \c false otherwise
+        **/
+        bool mount();
+
+        /**
+            \brief Erase all the keys
+            \returns \c true on error, \c false otherwise
+        **/
+        bool format();
+
+        /**
+            \brief Read a value
+            \param key Key
+            \param value Destination buffer
+            \param maxSize Size of the buffer
+            \param size Size of the value
+            \returns \c true on error (key not found, value larger than maxSize, read error), \c false otherwise
+        **/
+        bool get(const char* key, void* value, uint16_t maxSize, uint16_t& size) const;
+
+        /**
+            \brief Read a value of a given type (e.g. a calibration structure)
+            \returns \c true on error (key not found, size mismatch, read error), \c false otherwise
+        **/
+        template<typename T>
+        bool get(const char* key, T& value) const
+        {
+            uint16_t size = 0;
+            return get(key, &value, sizeof(T), size) || size != sizeof(T);
+        }
+
+        /**
+            \brief Write a value. Nothing is written if the key already has this value
+            \param key Key, 1 to MAX_KEY_SIZE characters
+            \param value Value
+            \param size Size of the value, up to MAX_VALUE_SIZE
+            \returns \c true on error (invalid parameter, store full, write error), \c false otherwise
+        **/
+        bool set(const char* key, const void* value, uint16_t size);
+
+        template<typename T>
+        bool set(const char* key, const T& value)
+        {
+            return set(key, &value, sizeof(T));
+        }
+
+        /**
+            \brief Remove a key
+            \returns \c true on error (invalid key, store full, write error), \c false otherwise (also when the key
+            does not exist)
+        **/
+        bool remove(const char* key);
+
+        bool contains(const char* key) const;
+
+        /**
+            \returns Number of keys
+        **/
+        uint32_t count() const { return m_count; }
+
+        const Stats& stats() const { return m_stats; }
+
+        void resetStats();
+
+        /**
+            \brief Get the wear of the store
+            \param min Lowest erase count of the sectors
+            \param max Highest erase count of the sectors
+        **/
+        void eraseCounts(uint32_t& min, uint32_t& max) const;
+
+    private:
+        struct Sector
+        {
+            uint32_t    sequence;
+            uint32_t    eraseCount;
+            uint32_t    used;       ///< Offset of the free space (sector size once sealed)
+            uint8_t     state;
+        };
+
+        struct Slot
+        {
+            uint32_t    hash;
+            uint32_t    address;    ///< Address of the record, EMPTY if unused
+        };
+
+        /**
+            \brief Find the slot of a key
+            \param header Header of the record, if not null
+            \returns Slot index, -1 if the key is not in the store
+        **/
+        int32_t find(const char* key, uint32_t keySize, uint32_t hash, uint8_t* header = nullptr) const;
+
+        /**
+            \returns Index of the slot pointing to a record, -1 if the record is not current
+        **/
+        int32_t slotOf(uint32_t hash, uint32_t address) const;
+
+        /**
+            \brief Point a key to a record, or remove it from the index (address EMPTY)
+            \returns \c true if the index is full, \c false otherwise
+        **/
+        bool index(const char* key, uint32_t keySize, uint32_t hash, uint32_t address);
+
+        void removeSlot(uint32_t slot);
+
+        /**
+            \brief Read a sector header
+        **/
+        bool loadSector(uint32_t sector);
+
+        /**
+            \brief Index the records of a sector, and find its free space
+        **/
+        bool scanSector(uint32_t sector);
+
+        /**
+            \brief Append a record to the log
+        **/
+        bool append(uint8_t type, const char* key, uint32_t keySize, const void* value, uint32_t valueSize);
+
+        /**
+            \brief Make sure the head sector can take a record, compacting the log if needed
+        **/
+        bool makeRoom(uint32_t size);
+
+        /**
+            \brief Start a new head sector
+        **/
+        bool openSector();
+
+        /**
+            \brief Copy the current records of the oldest sector to the head, and erase it
+        **/
+        bool compact();
+
+        /**
+            \brief Erase a sector, and write its header with the new erase count
+        **/
+        bool eraseSector(uint32_t sector);
+
+        uint32_t freeSectors() const;
+
+        uint32_t address(uint32_t sector) const { return m_start + sector * m_sectorSize; }
+
+        Flash&      m_flash;
+        uint32_t    m_start;
+        uint32_t    m_size;
+        uint32_t    m_sectorSize    = 0;
+        uint32_t    m_sectorCount   = 0;
+        Sector*     m_sectors       = nullptr;
+
+        Slot*       m_slots         = nullptr;
+        uint32_t    m_slotMask      = 0;
+        uint32_t    m_maxKeys;
+        uint32_t    m_count         = 0;
+
+        bool        m_mounted       = false;
+        int32_t     m_head          = -1;   ///< Sector being written
+        uint32_t    m_sequence      = 0;    ///< Sequence number of the head
+        uint32_t    m_liveBytes     = 0;    ///< Size of the current records
+
+        Stats       m_stats;
+};
+
+#endif
@@ -0,0 +1,678 @@
+/*!
+ * \file      crypto_bench.c
+ *
+ * \brief     Host benchmark of the LoRaMAC cryptography (mac/loramac_crypto.c, crypto/aes.c, crypto/aes32.c,
+ *            crypto/cmac.c)
+ *
+ * Build and run, from this directory:
+ *   gcc -O2 -D__STATIC_INLINE="static inline" -D__CLZ=__builtin_clz -DAES_BACKEND=1 -o crypto_bench crypto_bench.c \
+ *       ../mac/loramac_crypto.c ../crypto/aes.c ../crypto/aes32.c ../crypto/cmac.c ../utilities/utilities.c -lpthread
+ *   ./crypto_bench [threads]
+ *
+ * AES_BACKEND selects the AES implementation (see aes.h): 0 compact, 1 T-table,
+ * 2 AES-NI (add -maes). Without STM32xxx defined, the LoRaMAC sources build
+ * without the HAL (the CMSIS macros used by utilities.h are given on the
+ * command line).
+ * The AES is checked against the FIPS-197 and SP 800-38A vectors, and against
+ * the compact implementation on random keys and blocks; the CMAC against the
+ * RFC 4493 vectors, also fed in pieces; the payload encryption and the MIC
+ * against reference implementations (the per frame key expansion of the
+ * original LoRaMacPayloadEncrypt and LoRaMacComputeMic): the program returns 1
+ * on a mismatch.
+ * The MIC verification is also run by several threads at once (up to the
+ * given count, default 4), each verifying the frames of its own devices: a
+ * gateway. Every MIC is compared with the expected one, which checks the
+ * reentrancy as well.
+ * The AES speed is given in cycles per byte on x86 (time stamp counter), in
+ * nanoseconds per byte elsewhere.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#endif
+
+#include "../crypto/aes.h"
+#include "../crypto/cmac.h"
+#include "../mac/loramac_crypto.h"
+
+/*!
+ * Frames per measure
+ */
+#define BENCH_FRAMES                                100000
+
+/*!
+ * Blocks per AES measure (1 MB), and random blocks of the cross-check
+ */
+#define BENCH_BLOCKS                                65536
+#define CHECK_BLOCKS                                10000
+
+/*!
+ * Devices and frames per device of the gateway verification, default number of threads
+ */
+#define GATEWAY_DEVICES                             256
+#define GATEWAY_FRAMES                              64
+#define GATEWAY_THREADS                             4
+
+/*!
+ * AES implementation under test
+ */
+typedef struct sAesImplementation
+{
+    const char *Name;
+    return_type ( *SetKey )( const uint8_t key[], length_type keylen, aes_context ctx[1] );
+    return_type ( *Encrypt )( const uint8_t in[N_BLOCK], uint8_t out[N_BLOCK], const aes_context ctx[1] );
+    return_type ( *CbcEncrypt )( const uint8_t *in, uint8_t *out, int32_t n_block, uint8_t iv[N_BLOCK], const aes_context ctx[1] );
+}AesImplementation_t;
+
+static const AesImplementation_t AesImplementations[] =
+{
+#if AES_BACKEND != AES_BACKEND_COMPACT
+    { "compact", aes_compact_set_key, aes_compact_encrypt, aes_compact_cbc_encrypt },
+#endif
+#if AES_BACKEND == AES_BACKEND_COMPACT
+    { "compact", aes_set_key, aes_encrypt, aes_cbc_encrypt },
+#elif AES_BACKEND == AES_BACKEND_TTABLE
+    { "T-table", aes_set_key, aes_encrypt, aes_cbc_encrypt },
+#else
+    { "AES-NI", aes_set_key, aes_encrypt, aes_cbc_encrypt },
+#endif
+};
+
+#define AES_IMPLEMENTATIONS                         ( sizeof( AesImplementations ) / sizeof( AesImplementations[0] ) )
+
+/*!
+ * FIPS-197 appendix C: 128, 192 and 256 bit keys (000102..), same plaintext
+ */
+static const uint8_t KatPlain[16] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                                      0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF
+                                    };
+
+static const uint8_t KatCipher[3][16] =
+{
+    { 0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30, 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A },
+    { 0xDD, 0xA9, 0x7C, 0xA4, 0x86, 0x4C, 0xDF, 0xE0, 0x6E, 0xAF, 0x70, 0xA0, 0xEC, 0x0D, 0x71, 0x91 },
+    { 0x8E, 0xA2, 0xB7, 0xCA, 0x51, 0x67, 0x45, 0xBF, 0xEA, 0xFC, 0x49, 0x90, 0x4B, 0x49, 0x60, 0x89 },
+};
+
+/*!
+ * SP 800-38A F.2.1: CBC-AES128, first two blocks (key: Key below, IV 000102..)
+ */
+static const uint8_t CbcPlain[32] = { 0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E, 0x11, 0x73, 0x93, 0x17, 0x2A,
+                                      0xAE, 0x2D, 0x8A, 0x57, 0x1E, 0x03, 0xAC, 0x9C, 0x9E, 0xB7, 0x6F, 0xAC, 0x45, 0xAF, 0x8E, 0x51
+                                    };
+
+static const uint8_t CbcCipher[32] = { 0x76, 0x49, 0xAB, 0xAC, 0x81, 0x19, 0xB2, 0x46, 0xCE, 0xE9, 0x8E, 0x9B, 0x12, 0xE9, 0x19, 0x7D,
+                                       0x50, 0x86, 0xCB, 0x9B, 0x50, 0x72, 0x19, 0xEE, 0x95, 0xDB, 0x11, 0x3A, 0x91, 0x76, 0x78, 0xB2
+                                     };
+
+static const uint8_t Key[16] = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+                                 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C
+                               };
+
+static const uint16_t PayloadSizes[] = { 16, 51, 222 };
+
+/*!
+ * RFC 4493 section 4: AES-CMAC of the first 0, 16, 40 and 64 bytes of CmacMessage (key: Key)
+ */
+static const uint8_t CmacMessage[64] = { 0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E, 0x11, 0x73, 0x93, 0x17, 0x2A,
+                                         0xAE, 0x2D, 0x8A, 0x57, 0x1E, 0x03, 0xAC, 0x9C, 0x9E, 0xB7, 0x6F, 0xAC, 0x45, 0xAF, 0x8E, 0x51,
+                                         0x30, 0xC8, 0x1C, 0x46, 0xA3, 0x5C, 0xE4, 0x11, 0xE5, 0xFB, 0xC1, 0x19, 0x1A, 0x0A, 0x52, 0xEF,
+                                         0xF6, 0x9F, 0x24, 0x45, 0xDF, 0x4F, 0x9B, 0x17, 0xAD, 0x2B, 0x41, 0x7B, 0xE6, 0x6C, 0x37, 0x10
+                                       };
+
+static const uint8_t CmacSizes[4] = { 0, 16, 40, 64 };
+
+static const uint8_t CmacDigests[4][16] =
+{
+    { 0xBB, 0x1D, 0x69, 0x29, 0xE9, 0x59, 0x37, 0x28, 0x7F, 0xA3, 0x7D, 0x12, 0x9B, 0x75, 0x67, 0x46 },
+    { 0x07, 0x0A, 0x16, 0xB4, 0x6B, 0x4D, 0x41, 0x44, 0xF7, 0x9B, 0xDD, 0x9D, 0xD0, 0x4A, 0x28, 0x7C },
+    { 0xDF, 0xA6, 0x67, 0x47, 0xDE, 0x9A, 0xE6, 0x30, 0x30, 0xCA, 0x32, 0x61, 0x14, 0x97, 0xC8, 0x27 },
+    { 0x51, 0xF0, 0xBE, 0xBF, 0x7E, 0x3B, 0x9D, 0x92, 0xFC, 0x49, 0x74, 0x17, 0x79, 0x36, 0x3C, 0xFE },
+};
+
+/*!
+ * Gateway verification: frames received from a device, verified by one thread
+ */
+typedef struct sGatewayDevice
+{
+    LoRaMacCryptoKey_t NwkSKey;
+    uint32_t Address;
+    uint8_t Frames[GATEWAY_FRAMES][64];
+    uint32_t Mics[GATEWAY_FRAMES];
+}GatewayDevice_t;
+
+typedef struct sGatewayThread
+{
+    GatewayDevice_t *Devices;
+    uint32_t DeviceCount;
+    uint32_t Rounds;
+    uint32_t Errors;
+}GatewayThread_t;
+
+static double Now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#define TICKS_UNIT                                  "cycles"
+#else
+#define TICKS_UNIT                                  "ns"
+#endif
+
+static uint64_t Ticks( void )
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+    return __rdtsc( );
+#else
+    return ( uint64_t )( Now( ) * 1e9 );
+#endif
+}
+
+/*!
+ * \retval Number of failed vectors, over all the implementations
+ */
+static uint32_t CheckAesVectors( void )
+{
+    uint32_t errors = 0;
+
+    for( uint8_t i = 0; i < AES_IMPLEMENTATIONS; i++ )
+    {
+        const AesImplementation_t *aes = &AesImplementations[i];
+        aes_context ctx;
+        uint8_t key[32];
+        uint8_t block[32];
+        uint8_t iv[16];
+
+        for( uint8_t k = 0; k < 32; k++ )
+        {
+            key[k] = k;
+        }
+
+        for( uint8_t k = 0; k < 3; k++ )
+        {
+            aes->SetKey( key, 16 + 8 * k, &ctx );
+            aes->Encrypt( KatPlain, block, &ctx );
+            errors += memcmp( block, KatCipher[k], 16 ) != 0;
+
+            // In place
+            memcpy( block, KatPlain, 16 );
+            aes->Encrypt( block, block, &ctx );
+            errors += memcmp( block, KatCipher[k], 16 ) != 0;
+        }
+
+        memcpy( iv, key, 16 );
+        aes->SetKey( Key, 16, &ctx );
+        aes->CbcEncrypt( CbcPlain, block, 2, iv, &ctx );
+        errors += memcmp( block, CbcCipher, 32 ) != 0;
+
+        // Invalid key length
+        errors += aes->SetKey( key, 20, &ctx ) == 0 || aes->Encrypt( KatPlain, block, &ctx ) == 0;
+    }
+
+    return errors;
+}
+
+/*!
+ * \retval Number of blocks that differ between the implementations, random keys of all lengths
+ */
+static uint32_t CheckAesRandom( void )
+{
+    uint32_t errors = 0;
+
+    srand( 1 );
+
+    for( uint32_t n = 0; n < CHECK_BLOCKS && AES_IMPLEMENTATIONS > 1; n++ )
+    {
+        const length_type keylen = 16 + 8 * ( n % 3 );
+        uint8_t key[32];
+        uint8_t in[16];
+        uint8_t out[AES_IMPLEMENTATIONS][16];
+
+        for( uint8_t k = 0; k < 32; k++ )
+        {
+            key[k] = rand( );
+        }
+        for( uint8_t k = 0; k < 16; k++ )
+        {
+            in[k] = rand( );
+        }
+
+        for( uint8_t i = 0; i < AES_IMPLEMENTATIONS; i++ )
+        {
+            aes_context ctx;
+
+            AesImplementations[i].SetKey( key, keylen, &ctx );
+            AesImplementations[i].Encrypt( in, out[i], &ctx );
+            errors += memcmp( out[i], out[0], 16 ) != 0;
+        }
+    }
+
+    return errors;
+}
+
+static void BenchAes( void )
+{
+    static uint8_t data[BENCH_BLOCKS * 16];
+
+    printf( "AES encryption, " TICKS_UNIT "/byte (key setup: " TICKS_UNIT "/key):\n" );
+    printf( "%8s %10s %10s %10s %10s\n", "", "128 bit", "192 bit", "256 bit", "key setup" );
+
+    for( uint8_t i = 0; i < AES_IMPLEMENTATIONS; i++ )
+    {
+        const AesImplementation_t *aes = &AesImplementations[i];
+        aes_context ctx;
+        uint64_t start;
+
+        printf( "%8s", aes->Name );
+
+        for( uint8_t k = 0; k < 3; k++ )
+        {
+            aes->SetKey( data, 16 + 8 * k, &ctx );
+            start = Ticks( );
+
+            // Chained, as in CTR or CMAC: one block at a time
+            for( uint32_t b = 0; b < BENCH_BLOCKS; b++ )
+            {
+                aes->Encrypt( data + 16 * ( ( b + BENCH_BLOCKS - 1 ) % BENCH_BLOCKS ), data + 16 * b, &ctx );
+            }
+            printf( " %10.2f", ( double )( Ticks( ) - start ) / sizeof( data ) );
+        }
+
+        start = Ticks( );
+        for( uint32_t b = 0; b < BENCH_FRAMES; b++ )
+        {
+            aes->SetKey( data + ( b & 0xFF ), 16, &ctx );
+        }
+        printf( " %10.1f\n", ( double )( Ticks( ) - start ) / BENCH_FRAMES );
+    }
+}
+
+/*!
+ * Original LoRaMacPayloadEncrypt: key expansion on every frame, one block at a time
+ */
+static void ReferencePayloadEncrypt( const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *encBuffer )
+{
+    aes_context aes;
+    uint8_t aBlock[16] = { 0x01 };
+    uint8_t sBlock[16];
+    uint16_t ctr = 1;
+    uint16_t index = 0;
+
+    memset( aes.ksch, '\0', 240 );
+    aes_set_key( key, 16, &aes );
+
+    aBlock[5] = dir;
+    aBlock[6] = ( address ) & 0xFF;
+    aBlock[7] = ( address >> 8 ) & 0xFF;
+    aBlock[8] = ( address >> 16 ) & 0xFF;
+    aBlock[9] = ( address >> 24 ) & 0xFF;
+    aBlock[10] = ( sequenceCounter ) & 0xFF;
+    aBlock[11] = ( sequenceCounter >> 8 ) & 0xFF;
+    aBlock[12] = ( sequenceCounter >> 16 ) & 0xFF;
+    aBlock[13] = ( sequenceCounter >> 24 ) & 0xFF;
+
+    while( index < size )
+    {
+        aBlock[15] = ( ctr++ ) & 0xFF;
+        aes_encrypt( aBlock, sBlock, &aes );
+
+        for( uint16_t i = 0; ( i < 16 ) && ( index < size ); i++, index++ )
+        {
+            encBuffer[index] = buffer[index] ^ sBlock[i];
+        }
+    }
+}
+
+/*!
+ * \retval Number of mismatches between the implementations, over all payload sizes and alignments
+ */
+static uint32_t CheckPayloadEncrypt( void )
+{
+    uint8_t payload[300];
+    uint8_t expected[300];
+    uint8_t result[301];
+    LoRaMacCryptoKey_t cryptoKey;
+    uint32_t errors = 0;
+
+    LoRaMacCryptoSetKey( &cryptoKey, Key );
+
+    for( uint16_t i = 0; i < sizeof( payload ); i++ )
+    {
+        payload[i] = i * 7 + 3;
+    }
+
+    for( uint16_t size = 0; size <= 255; size++ )
+    {
+        ReferencePayloadEncrypt( payload, size, Key, 0x26011234, size & 1, 1000 + size, expected );
+
+        LoRaMacPayloadEncrypt( payload, size, Key, 0x26011234, size & 1, 1000 + size, result );
+        errors += memcmp( result, expected, size ) != 0;
+
+        // Unaligned output
+        LoRaMacCryptoPayloadEncrypt( &cryptoKey, payload, size, 0x26011234, size & 1, 1000 + size, result + 1 );
+        errors += memcmp( result + 1, expected, size ) != 0;
+
+        // In place, decryption
+        memcpy( result, expected, size );
+        LoRaMacPayloadDecrypt( result, size, Key, 0x26011234, size & 1, 1000 + size, result );
+        errors += memcmp( result, payload, size ) != 0;
+    }
+
+    return errors;
+}
+
+static void BenchPayloadEncrypt( void )
+{
+    uint8_t payload[256] = { 0 };
+    uint8_t encrypted[256];
+    LoRaMacCryptoKey_t cryptoKey;
+
+    LoRaMacCryptoSetKey( &cryptoKey, Key );
+
+    printf( "Payload encryption, frames/s:\n" );
+    printf( "%8s %14s %14s %14s\n", "bytes", "per frame key", "cached key", "context" );
+
+    for( uint8_t s = 0; s < sizeof( PayloadSizes ) / sizeof( PayloadSizes[0] ); s++ )
+    {
+        const uint16_t size = PayloadSizes[s];
+        double rates[3];
+
+        for( uint8_t mode = 0; mode < 3; mode++ )
+        {
+            const double start = Now( );
+
+            for( uint32_t frame = 0; frame < BENCH_FRAMES; frame++ )
+            {
+                if( mode == 0 )
+                {
+                    ReferencePayloadEncrypt( payload, size, Key, 0x26011234, 0, frame, encrypted );
+                }
+                else if( mode == 1 )
+                {
+                    LoRaMacPayloadEncrypt( payload, size, Key, 0x26011234, 0, frame, encrypted );
+                }
+                else
+                {
+                    LoRaMacCryptoPayloadEncrypt( &cryptoKey, payload, size, 0x26011234, 0, frame, encrypted );
+                }
+                payload[0] ^= encrypted[0];
+            }
+            rates[mode] = BENCH_FRAMES / ( Now( ) - start );
+        }
+
+        printf( "%8u %14.0f %14.0f %14.0f\n", size, rates[0], rates[1], rates[2] );
+    }
+}
+
+/*!
+ * Original LoRaMacComputeMic: CMAC context initialized, key schedule and subkeys derived on every frame
+ */
+static void ReferenceComputeMic( const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint32_t *mic )
+{
+    AES_CMAC_CTX cmac;
+    uint8_t micBlockB0[16] = { 0x49 };
+    uint8_t digest[16];
+
+    micBlockB0[5] = dir;
+    micBlockB0[6] = ( address ) & 0xFF;
+    micBlockB0[7] = ( address >> 8 ) & 0xFF;
+    micBlockB0[8] = ( address >> 16 ) & 0xFF;
+    micBlockB0[9] = ( address >> 24 ) & 0xFF;
+    micBlockB0[10] = ( sequenceCounter ) & 0xFF;
+    micBlockB0[11] = ( sequenceCounter >> 8 ) & 0xFF;
+    micBlockB0[12] = ( sequenceCounter >> 16 ) & 0xFF;
+    micBlockB0[13] = ( sequenceCounter >> 24 ) & 0xFF;
+    micBlockB0[15] = size & 0xFF;
+
+    AES_CMAC_Init( &cmac );
+    AES_CMAC_SetKey( &cmac, key );
+    AES_CMAC_Update( &cmac, micBlockB0, 16 );
+    AES_CMAC_Update( &cmac, buffer, size & 0xFF );
+    AES_CMAC_Final( digest, &cmac );
+
+    *mic = ( uint32_t )digest[3] << 24 | ( uint32_t )digest[2] << 16 | ( uint32_t )digest[1] << 8 | ( uint32_t )digest[0];
+}
+
+/*!
+ * \retval Number of wrong digests: RFC 4493 vectors, one call and in pieces of every size
+ */
+static uint32_t CheckCmac( void )
+{
+    AES_CMAC_CTX ctx;
+    AES_CMAC_KEY key;
+    AES_CMAC_STATE state;
+    uint8_t digest[16];
+    uint32_t errors = 0;
+
+    AES_CMAC_KeyInit( &key, Key );
+
+    for( uint8_t v = 0; v < 4; v++ )
+    {
+        const uint8_t size = CmacSizes[v];
+
+        AES_CMAC_Init( &ctx );
+        AES_CMAC_SetKey( &ctx, Key );
+        AES_CMAC_Update( &ctx, CmacMessage, size );
+        AES_CMAC_Final( digest, &ctx );
+        errors += memcmp( digest, CmacDigests[v], 16 ) != 0;
+
+        for( uint8_t piece = 1; piece <= 17; piece++ )
+        {
+            AES_CMAC_Start( &state, &key );
+            for( uint8_t done = 0; done < size; done += piece )
+            {
+                AES_CMAC_StateUpdate( &state, CmacMessage + done, ( size - done < piece ) ? size - done : piece );
+            }
+            AES_CMAC_StateFinal( digest, &state );
+            errors += memcmp( digest, CmacDigests[v], 16 ) != 0;
+        }
+
+        // The state is ready for the next message after the final
+        AES_CMAC_StateUpdate( &state, CmacMessage, size );
+        AES_CMAC_StateFinal( digest, &state );
+        errors += memcmp( digest, CmacDigests[v], 16 ) != 0;
+    }
+
+    return errors;
+}
+
+/*!
+ * \retval Number of MIC mismatches with the reference, over all frame sizes
+ */
+static uint32_t CheckComputeMic( void )
+{
+    uint8_t frame[256];
+    LoRaMacCryptoKey_t cryptoKey;
+    uint32_t errors = 0;
+
+    LoRaMacCryptoSetKey( &cryptoKey, Key );
+
+    for( uint16_t i = 0; i < sizeof( frame ); i++ )
+    {
+        frame[i] = i * 13 + 5;
+    }
+
+    for( uint16_t size = 0; size <= 255; size++ )
+    {
+        uint32_t expected, mic;
+
+        ReferenceComputeMic( frame, size, Key, 0x26011234, size & 1, 1000 + size, &expected );
+
+        LoRaMacComputeMic( frame, size, Key, 0x26011234, size & 1, 1000 + size, &mic );
+        errors += mic != expected;
+
+        // Unaligned frame
+        memmove( frame + 1, frame, size );
+        LoRaMacCryptoComputeMic( &cryptoKey, frame + 1, size, 0x26011234, size & 1, 1000 + size, &mic );
+        memmove( frame, frame + 1, size );
+        errors += mic != expected;
+    }
+
+    return errors;
+}
+
+static void BenchComputeMic( void )
+{
+    uint8_t frame[256] = { 0 };
+    LoRaMacCryptoKey_t cryptoKey;
+    uint32_t mic = 0;
+
+    LoRaMacCryptoSetKey( &cryptoKey, Key );
+
+    printf( "MIC computation, frames/s:\n" );
+    printf( "%8s %14s %14s %14s\n", "bytes", "per frame key", "cached key", "context" );
+
+    for( uint8_t s = 0; s < sizeof( PayloadSizes ) / sizeof( PayloadSizes[0] ); s++ )
+    {
+        const uint16_t size = PayloadSizes[s];
+        double rates[3];
+
+        for( uint8_t mode = 0; mode < 3; mode++ )
+        {
+            const double start = Now( );
+
+            for( uint32_t n = 0; n < BENCH_FRAMES; n++ )
+            {
+                if( mode == 0 )
+                {
+                    ReferenceComputeMic( frame, size, Key, 0x26011234, 0, n, &mic );
+                }
+                else if( mode == 1 )
+                {
+                    LoRaMacComputeMic( frame, size, Key, 0x26011234, 0, n, &mic );
+                }
+                else
+                {
+                    LoRaMacCryptoComputeMic( &cryptoKey, frame, size, 0x26011234, 0, n, &mic );
+                }
+                frame[0] ^= mic;
+            }
+            rates[mode] = BENCH_FRAMES / ( Now( ) - start );
+        }
+
+        printf( "%8u %14.0f %14.0f %14.0f\n", size, rates[0], rates[1], rates[2] );
+    }
+}
+
+static void *GatewayVerify( void *arg )
+{
+    GatewayThread_t *thread = ( GatewayThread_t * )arg;
+
+    for( uint32_t round = 0; round < thread->Rounds; round++ )
+    {
+        for( uint32_t d = 0; d < thread->DeviceCount; d++ )
+        {
+            const GatewayDevice_t *device = &thread->Devices[d];
+
+            for( uint32_t f = 0; f < GATEWAY_FRAMES; f++ )
+            {
+                uint32_t mic;
+
+                LoRaMacCryptoComputeMic( &device->NwkSKey, device->Frames[f], sizeof( device->Frames[f] ), device->Address, 0, f, &mic );
+                thread->Errors += mic != device->Mics[f];
+            }
+        }
+    }
+    return NULL;
+}
+
+/*!
+ * \retval Number of MIC mismatches of the gateway verification
+ */
+static uint32_t BenchGateway( uint32_t maxThreads )
+{
+    static GatewayDevice_t devices[GATEWAY_DEVICES];
+    const uint32_t rounds = 16;
+    uint32_t errors = 0;
+
+    // Devices: own key, address and frames, with the MICs of the reference implementation
+    for( uint32_t d = 0; d < GATEWAY_DEVICES; d++ )
+    {
+        uint8_t key[16];
+
+        for( uint8_t k = 0; k < 16; k++ )
+        {
+            key[k] = Key[k] ^ ( d * 31 + k );
+        }
+        LoRaMacCryptoSetKey( &devices[d].NwkSKey, key );
+        devices[d].Address = 0x26000000 + d;
+
+        for( uint32_t f = 0; f < GATEWAY_FRAMES; f++ )
+        {
+            for( uint8_t i = 0; i < sizeof( devices[d].Frames[f] ); i++ )
+            {
+                devices[d].Frames[f][i] = d + f * 7 + i;
+            }
+            ReferenceComputeMic( devices[d].Frames[f], sizeof( devices[d].Frames[f] ), key, devices[d].Address, 0, f, &devices[d].Mics[f] );
+        }
+    }
+
+    printf( "Gateway MIC verification, %u devices, %u byte frames:\n", GATEWAY_DEVICES, ( unsigned )sizeof( devices[0].Frames[0] ) );
+    printf( "%8s %14s\n", "threads", "frames/s" );
+
+    for( uint32_t threads = 1; threads <= maxThreads; threads *= 2 )
+    {
+        pthread_t ids[64];
+        GatewayThread_t contexts[64];
+        const uint32_t perThread = GATEWAY_DEVICES / threads;
+        const double start = Now( );
+
+        for( uint32_t t = 0; t < threads; t++ )
+        {
+            contexts[t] = ( GatewayThread_t ){ devices + t * perThread, perThread, rounds, 0 };
+            pthread_create( &ids[t], NULL, GatewayVerify, &contexts[t] );
+        }
+        for( uint32_t t = 0; t < threads; t++ )
+        {
+            pthread_join( ids[t], NULL );
+            errors += contexts[t].Errors;
+        }
+
+        printf( "%8u %14.0f\n", threads, ( double )perThread * threads * GATEWAY_FRAMES * rounds / ( Now( ) - start ) );
+    }
+
+    return errors;
+}
+
+int main( int argc, char **argv )
+{
+    const uint32_t vectorErrors = CheckAesVectors( );
+    const uint32_t randomErrors = CheckAesRandom( );
+    const uint32_t cmacErrors = CheckCmac( );
+    const uint32_t errors = CheckPayloadEncrypt( );
+    const uint32_t micErrors = CheckComputeMic( );
+    uint32_t threads = ( argc > 1 ) ? strtoul( argv[1], NULL, 0 ) : GATEWAY_THREADS;
+
+    printf( "AES vectors check: %s\n", vectorErrors ? "FAILED" : "ok" );
+    printf( "AES cross-check (%u implementations): %s\n", ( unsigned )AES_IMPLEMENTATIONS, randomErrors ? "FAILED" : "ok" );
+    printf( "CMAC vectors check: %s\n", cmacErrors ? "FAILED" : "ok" );
+    printf( "Payload encryption check: %s\n", errors ? "FAILED" : "ok" );
+    printf( "MIC check: %s\n", micErrors ? "FAILED" : "ok" );
+
+    if( ( vectorErrors != 0 ) || ( randomErrors != 0 ) || ( cmacErrors != 0 ) || ( errors != 0 ) || ( micErrors != 0 ) )
+    {
+        return 1;
+    }
+
+    BenchAes( );
+    BenchPayloadEncrypt( );
+    BenchComputeMic( );
+
+    threads = ( threads < 1 ) ? 1 : ( ( threads > 64 ) ? 64 : threads );
+    if( BenchGateway( threads ) != 0 )
+    {
+        printf( "Gateway MIC verification: FAILED\n" );
+        return 1;
+    }
+    return 0;
+}
@@ -64,6 +64,15 @@
 
 #include "aes.h"
 
+/*  Other backends (aes32.c): the encryption of this file is kept, under
+    another name
+*/
+#if AES_BACKEND != AES_BACKEND_COMPACT
+#  define aes_set_key       aes_compact_set_key
+#  define aes_encrypt       aes_compact_encrypt
+#  define aes_cbc_encrypt   aes_compact_cbc_encrypt
+#endif
+
 //#if defined( HAVE_UINT_32T )
 //  typedef unsigned long uint32_t;
 //#endif
@@ -50,6 +50,39 @@
 #  define AES_DEC_256_OTFK  /* AES decryption with 'on the fly' 256 bit keying */
 #endif
 
+/*  Implementation of the encryption with a precomputed key schedule
+    (aes_set_key, aes_encrypt, aes_cbc_encrypt), AES_BACKEND:
+
+    AES_BACKEND_COMPACT: byte oriented (aes.c), 8-bit operations and
+        small tables (1.5 KB): the smallest, for the STM32F1.
+    AES_BACKEND_TTABLE: 32-bit words and a 1 KB T-table combining
+        SubBytes, ShiftRows and MixColumns (aes32.c): several times
+        faster on 32-bit CPUs (Cortex-M3/M4, hosts).
+    AES_BACKEND_AESNI: x86 AES instructions (aes32.c, built with -maes),
+        for host builds (gateway simulation, benchmarks).
+
+    The default is the compact version on the STM32F1, AES-NI when the
+    compiler targets it, and the T-table otherwise; define AES_BACKEND
+    on the command line to override it. All backends store the same
+    key schedule: the contexts are interchangeable, and the decryption
+    functions of aes.c work with any of them. Other than compact, the
+    aes.c encryption is still built, as aes_compact_* (reference).
+*/
+
+#define AES_BACKEND_COMPACT     0
+#define AES_BACKEND_TTABLE      1
+#define AES_BACKEND_AESNI       2
+
+#if !defined( AES_BACKEND )
+#  if defined( STM32F1xx )
+#    define AES_BACKEND   AES_BACKEND_COMPACT
+#  elif defined( __AES__ )
+#    define AES_BACKEND   AES_BACKEND_AESNI
+#  else
+#    define AES_BACKEND   AES_BACKEND_TTABLE
+#  endif
+#endif
+
 #define N_ROW                   4
 #define N_COL                   4
 #define N_BLOCK   (N_ROW * N_COL)
@@ -94,6 +127,23 @@ return_type aes_cbc_encrypt( const uint8_t *in,
                          int32_t n_block,
                          uint8_t iv[N_BLOCK],
                          const aes_context ctx[1] );
+
+#if AES_BACKEND != AES_BACKEND_COMPACT
+
+return_type aes_compact_set_key( const uint8_t key[],
+                         length_type keylen,
+                         aes_context ctx[1] );
+
+return_type aes_compact_encrypt( const uint8_t in[N_BLOCK],
+                         uint8_t out[N_BLOCK],
+                         const aes_context ctx[1] );
+
+return_type aes_compact_cbc_encrypt( const uint8_t *in,
+                         uint8_t *out,
+                         int32_t n_block,
+                         uint8_t iv[N_BLOCK],
+                         const aes_context ctx[1] );
+#endif
 #endif
 
 #if defined( AES_DEC_PREKEYED )
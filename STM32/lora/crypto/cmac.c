@@ -54,100 +54,91 @@ DEALINGS WITH THE SOFTWARE
         }                          \
     } while (0) \
 
+/* doubling in GF(2^128): subkey derivation */
+#define DOUBLE(v, r) do {                                       \
+    const uint8_t msb = (v)[0] & 0x80;                          \
+    LSHIFT(v, r);                                               \
+    if (msb)                                                    \
+        (r)[15] ^= 0x87;                                        \
+} while (0)
+
+void AES_CMAC_KeyInit(AES_CMAC_KEY *key, const uint8_t k[AES_CMAC_KEY_LENGTH])
+{
+    aes_set_key(k, AES_CMAC_KEY_LENGTH, &key->rijndael);
+
+    /* K1 = 2.E(0), K2 = 4.E(0) */
+    memset1(key->K1, 0, sizeof key->K1);
+    aes_encrypt(key->K1, key->K1, &key->rijndael);
+    DOUBLE(key->K1, key->K1);
+    DOUBLE(key->K1, key->K2);
+}
+
+void AES_CMAC_Start(AES_CMAC_STATE *state, const AES_CMAC_KEY *key)
+{
+    memset1(state->X, 0, sizeof state->X);
+    state->M_n = 0;
+    state->key = key;
+}
+
+void AES_CMAC_StateUpdate(AES_CMAC_STATE *state, const uint8_t *data, uint32_t len)
+{
+    uint32_t mlen;
+
+    while (len > 0) {
+        /* a full pending block is not the last one: encrypt it */
+        if (state->M_n == 16) {
+            aes_encrypt(state->X, state->X, &state->key->rijndael);
+            state->M_n = 0;
+        }
+
+        if (state->M_n == 0 && len >= 16) {
+            /* whole block, read in place */
+            XOR(data, state->X);
+            mlen = 16;
+        } else {
+            mlen = MIN(16 - state->M_n, len);
+            for (uint32_t i = 0; i < mlen; i++)
+                state->X[state->M_n + i] ^= data[i];
+        }
+
+        state->M_n += mlen;
+        data += mlen;
+        len -= mlen;
+    }
+}
+
+void AES_CMAC_StateFinal(uint8_t digest[AES_CMAC_DIGEST_LENGTH], AES_CMAC_STATE *state)
+{
+    if (state->M_n == 16) {
+        /* last block was a complete block */
+        XOR(state->key->K1, state->X);
+    } else {
+        /* padding(M_last) */
+        state->X[state->M_n] ^= 0x80;
+        XOR(state->key->K2, state->X);
+    }
+
+    aes_encrypt(state->X, digest, &state->key->rijndael);
+    AES_CMAC_Start(state, state->key);
+}
 
 void AES_CMAC_Init(AES_CMAC_CTX *ctx)
 {
-            memset1(ctx->X, 0, sizeof ctx->X);
-            ctx->M_n = 0;
-        memset1(ctx->rijndael.ksch, '\0', 240);
+    memset1(ctx->key.rijndael.ksch, '\0', 240);
+    AES_CMAC_Start(&ctx->state, &ctx->key);
 }
     
 void AES_CMAC_SetKey(AES_CMAC_CTX *ctx, const uint8_t key[AES_CMAC_KEY_LENGTH])
 {
-           //rijndael_set_key_enc_only(&ctx->rijndael, key, 128);
-       aes_set_key( key, AES_CMAC_KEY_LENGTH, &ctx->rijndael);
+    AES_CMAC_KeyInit(&ctx->key, key);
 }
     
 void AES_CMAC_Update(AES_CMAC_CTX *ctx, const uint8_t *data, uint32_t len)
 {
-            uint32_t mlen;
-        uint8_t in[16];
-    
-            if (ctx->M_n > 0) {
-                  mlen = MIN(16 - ctx->M_n, len);
-                    memcpy1(ctx->M_last + ctx->M_n, data, mlen);
-                    ctx->M_n += mlen;
-                    if (ctx->M_n < 16 || len == mlen)
-                            return;
-                   XOR(ctx->M_last, ctx->X);
-                    //rijndael_encrypt(&ctx->rijndael, ctx->X, ctx->X);
-            aes_encrypt( ctx->X, ctx->X, &ctx->rijndael);
-                    data += mlen;
-                    len -= mlen;
-            }
-            while (len > 16) {      /* not last block */
-
-                    XOR(data, ctx->X);
-                    //rijndael_encrypt(&ctx->rijndael, ctx->X, ctx->X);
-
-                    memcpy1(in, &ctx->X[0], 16); //Bestela ez du ondo iten
-            aes_encrypt( in, in, &ctx->rijndael);
-                    memcpy1(&ctx->X[0], in, 16);
-
-                    data += 16;
-                    len -= 16;
-            }
-            /* potential last block, save it */
-            memcpy1(ctx->M_last, data, len);
-            ctx->M_n = len;
+    AES_CMAC_StateUpdate(&ctx->state, data, len);
 }
    
 void AES_CMAC_Final(uint8_t digest[AES_CMAC_DIGEST_LENGTH], AES_CMAC_CTX *ctx)
 {
-            uint8_t K[16];
-        uint8_t in[16];
-            /* generate subkey K1 */
-            memset1(K, '\0', 16);
-
-            //rijndael_encrypt(&ctx->rijndael, K, K);
-
-            aes_encrypt( K, K, &ctx->rijndael);
-
-            if (K[0] & 0x80) {
-                    LSHIFT(K, K);
-                   K[15] ^= 0x87;
-            } else
-                    LSHIFT(K, K);
-
-
-            if (ctx->M_n == 16) {
-                    /* last block was a complete block */
-                    XOR(K, ctx->M_last);
-
-           } else {
-                   /* generate subkey K2 */
-                  if (K[0] & 0x80) {
-                          LSHIFT(K, K);
-                          K[15] ^= 0x87;
-                  } else
-                           LSHIFT(K, K);
-
-                   /* padding(M_last) */
-                   ctx->M_last[ctx->M_n] = 0x80;
-                   while (++ctx->M_n < 16)
-                         ctx->M_last[ctx->M_n] = 0;
-   
-                  XOR(K, ctx->M_last);
-
-
-           }
-           XOR(ctx->M_last, ctx->X);
-
-           //rijndael_encrypt(&ctx->rijndael, ctx->X, digest);
-
-       memcpy1(in, &ctx->X[0], 16); //Bestela ez du ondo iten
-       aes_encrypt(in, digest, &ctx->rijndael);
-           memset1(K, 0, sizeof K);
-
+    AES_CMAC_StateFinal(digest, &ctx->state);
 }
-
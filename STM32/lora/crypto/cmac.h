@@ -40,17 +40,45 @@ DEALINGS WITH THE SOFTWARE
   
 #define AES_CMAC_KEY_LENGTH     16
 #define AES_CMAC_DIGEST_LENGTH  16
- 
+
+/*
+ * Expanded key: AES key schedule and subkeys K1, K2, computed once per key
+ * (AES_CMAC_KeyInit), then only read: shared by any number of messages
+ * and threads.
+ */
+typedef struct _AES_CMAC_KEY {
+    aes_context    rijndael;
+    uint8_t        K1[16];
+    uint8_t        K2[16];
+} AES_CMAC_KEY;
+
+/*
+ * State of a message: X holds the chaining value XORed with the M_n bytes
+ * of the pending block (its encryption waits for more data, the last block
+ * is XORed with K1 or K2 first). Owned by the caller, no global state.
+ */
+typedef struct _AES_CMAC_STATE {
+    const AES_CMAC_KEY *key;
+    uint32_t       M_n;
+    uint8_t        X[16];
+} AES_CMAC_STATE;
+
+/*
+ * Context of the original interface: key and state in one structure.
+ */
 typedef struct _AES_CMAC_CTX {
-  uint32_t       M_n;
-  uint8_t        X[16];
-  uint8_t        M_last[16];
-   aes_context    rijndael;
-    } AES_CMAC_CTX;
+    AES_CMAC_KEY   key;
+    AES_CMAC_STATE state;
+} AES_CMAC_CTX;
    
 //#include <sys/cdefs.h>
     
 //__BEGIN_DECLS
+void     AES_CMAC_KeyInit(AES_CMAC_KEY * key, const uint8_t k[AES_CMAC_KEY_LENGTH]);
+void     AES_CMAC_Start(AES_CMAC_STATE * state, const AES_CMAC_KEY * key);
+void     AES_CMAC_StateUpdate(AES_CMAC_STATE * state, const uint8_t * data, uint32_t len);
+void     AES_CMAC_StateFinal(uint8_t digest[AES_CMAC_DIGEST_LENGTH], AES_CMAC_STATE * state);
+
 void     AES_CMAC_Init(AES_CMAC_CTX * ctx);
 void     AES_CMAC_SetKey(AES_CMAC_CTX * ctx, const uint8_t key[AES_CMAC_KEY_LENGTH]);
 void     AES_CMAC_Update(AES_CMAC_CTX * ctx, const uint8_t * data, uint32_t len);
@@ -60,4 +88,3 @@ void     AES_CMAC_Final(uint8_t digest[AES_CMAC_DIGEST_LENGTH], AES_CMAC_CTX  *
 //__END_DECLS
 
 #endif /* _CMAC_H_ */
-
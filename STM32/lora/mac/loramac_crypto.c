@@ -19,6 +19,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 */
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include "../utilities/utilities.h"
 
 #include "../crypto/aes.h"
@@ -32,28 +33,20 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define LORAMAC_MIC_BLOCK_B0_SIZE                   16
 
 /*!
- * MIC field computation initial data
+ * Number of session keys whose schedule is kept by LoRaMacPayloadEncrypt and
+ * LoRaMacComputeMic: NwkSKey, AppSKey and the keys of a multicast group
  */
-static uint8_t MicBlockB0[] = { 0x49, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-                                0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-                              };
+#define LORAMAC_CRYPTO_KEY_CACHE_SIZE               4
 
 /*!
- * Contains the computed MIC field.
- *
- * \remark Only the 4 first bytes are used
+ * Expanded keys of LoRaMacPayloadEncrypt and LoRaMacComputeMic, found by key value
  */
-static uint8_t Mic[16];
+static LoRaMacCryptoKey_t KeyCache[LORAMAC_CRYPTO_KEY_CACHE_SIZE];
 
 /*!
- * Encryption aBlock and sBlock
+ * Next key cache entry to replace
  */
-static uint8_t aBlock[] = { 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-                            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-                          };
-static uint8_t sBlock[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-                            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-                          };
+static uint8_t KeyCacheNext = 0;
 
 /*!
  * AES computation context variable
@@ -61,9 +54,61 @@ static uint8_t sBlock[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 static aes_context AesContext;
 
 /*!
- * CMAC computation context variable
+ * \brief Finds a key in the cache, or expands it in place of the oldest entry
+ *
+ * \param [IN]  key             AES key
+ * \retval Session key context
  */
-static AES_CMAC_CTX AesCmacCtx[1];
+static const LoRaMacCryptoKey_t *LoRaMacCryptoGetKey( const uint8_t *key )
+{
+    LoRaMacCryptoKey_t *cryptoKey;
+
+    // A 16 bytes comparison instead of a key expansion on every frame
+    for( uint8_t i = 0; i < LORAMAC_CRYPTO_KEY_CACHE_SIZE; i++ )
+    {
+        if( ( KeyCache[i].Cmac.rijndael.rnd != 0 ) && ( memcmp( KeyCache[i].Key, key, 16 ) == 0 ) )
+        {
+            return &KeyCache[i];
+        }
+    }
+
+    cryptoKey = &KeyCache[KeyCacheNext];
+    KeyCacheNext = ( KeyCacheNext + 1 ) % LORAMAC_CRYPTO_KEY_CACHE_SIZE;
+    LoRaMacCryptoSetKey( cryptoKey, key );
+    return cryptoKey;
+}
+
+/*!
+ * \brief Reads the MIC field from a CMAC digest
+ *
+ * \remark Only the 4 first bytes are used
+ */
+static uint32_t LoRaMacCryptoMic( const uint8_t *digest )
+{
+    return ( uint32_t )( ( uint32_t )digest[3] << 24 | ( uint32_t )digest[2] << 16 | ( uint32_t )digest[1] << 8 | ( uint32_t )digest[0] );
+}
+
+void LoRaMacCryptoComputeMic( const LoRaMacCryptoKey_t *cryptoKey, const uint8_t *buffer, uint16_t size, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint32_t *mic )
+{
+    const uint8_t micBlockB0[LORAMAC_MIC_BLOCK_B0_SIZE] = { 0x49, 0x00, 0x00, 0x00, 0x00, dir,
+                                                            ( address ) & 0xFF, ( address >> 8 ) & 0xFF, ( address >> 16 ) & 0xFF, ( address >> 24 ) & 0xFF,
+                                                            ( sequenceCounter ) & 0xFF, ( sequenceCounter >> 8 ) & 0xFF,
+                                                            ( sequenceCounter >> 16 ) & 0xFF, ( sequenceCounter >> 24 ) & 0xFF,
+                                                            0x00, size & 0xFF
+                                                          };
+    AES_CMAC_STATE cmac;
+    uint8_t digest[AES_CMAC_DIGEST_LENGTH];
+
+    AES_CMAC_Start( &cmac, &cryptoKey->Cmac );
+
+    AES_CMAC_StateUpdate( &cmac, micBlockB0, LORAMAC_MIC_BLOCK_B0_SIZE );
+
+    AES_CMAC_StateUpdate( &cmac, buffer, size & 0xFF );
+
+    AES_CMAC_StateFinal( digest, &cmac );
+
+    *mic = LoRaMacCryptoMic( digest );
+}
 
 /*!
  * \brief Computes the LoRaMAC frame MIC field  
@@ -78,78 +123,82 @@ static AES_CMAC_CTX AesCmacCtx[1];
  */
 void LoRaMacComputeMic( const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint32_t *mic )
 {
-    MicBlockB0[5] = dir;
-    
-    MicBlockB0[6] = ( address ) & 0xFF;
-    MicBlockB0[7] = ( address >> 8 ) & 0xFF;
-    MicBlockB0[8] = ( address >> 16 ) & 0xFF;
-    MicBlockB0[9] = ( address >> 24 ) & 0xFF;
-
-    MicBlockB0[10] = ( sequenceCounter ) & 0xFF;
-    MicBlockB0[11] = ( sequenceCounter >> 8 ) & 0xFF;
-    MicBlockB0[12] = ( sequenceCounter >> 16 ) & 0xFF;
-    MicBlockB0[13] = ( sequenceCounter >> 24 ) & 0xFF;
-
-    MicBlockB0[15] = size & 0xFF;
-
-    AES_CMAC_Init( AesCmacCtx );
-
-    AES_CMAC_SetKey( AesCmacCtx, key );
-
-    AES_CMAC_Update( AesCmacCtx, MicBlockB0, LORAMAC_MIC_BLOCK_B0_SIZE );
-    
-    AES_CMAC_Update( AesCmacCtx, buffer, size & 0xFF );
-    
-    AES_CMAC_Final( Mic, AesCmacCtx );
-    
-    *mic = ( uint32_t )( ( uint32_t )Mic[3] << 24 | ( uint32_t )Mic[2] << 16 | ( uint32_t )Mic[1] << 8 | ( uint32_t )Mic[0] );
+    LoRaMacCryptoComputeMic( LoRaMacCryptoGetKey( key ), buffer, size, address, dir, sequenceCounter, mic );
 }
 
-void LoRaMacPayloadEncrypt( const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *encBuffer )
+void LoRaMacCryptoSetKey( LoRaMacCryptoKey_t *cryptoKey, const uint8_t *key )
 {
-    uint16_t i;
-    uint8_t bufferIndex = 0;
-    uint16_t ctr = 1;
-
-    memset1( AesContext.ksch, '\0', 240 );
-    aes_set_key( key, 16, &AesContext );
+    memcpy1( cryptoKey->Key, key, 16 );
+    AES_CMAC_KeyInit( &cryptoKey->Cmac, key );
+}
 
-    aBlock[5] = dir;
+/*!
+ * \brief XORs data with a keystream, a word at a time
+ *
+ * \param [OUT] out             Result (may be in)
+ * \param [IN]  in              Data
+ * \param [IN]  keyStream       Keystream, word aligned
+ * \param [IN]  size            Data size
+ */
+static void XorKeyStream( uint8_t *out, const uint8_t *in, const uint32_t *keyStream, uint16_t size )
+{
+    uint32_t word;
 
-    aBlock[6] = ( address ) & 0xFF;
-    aBlock[7] = ( address >> 8 ) & 0xFF;
-    aBlock[8] = ( address >> 16 ) & 0xFF;
-    aBlock[9] = ( address >> 24 ) & 0xFF;
+    // Frame buffers are not aligned: memcpy compiles to unaligned word accesses on Cortex-M3/M4
+    for( ; size >= 4; size -= 4 )
+    {
+        memcpy( &word, in, 4 );
+        word ^= *keyStream++;
+        memcpy( out, &word, 4 );
+        in += 4;
+        out += 4;
+    }
 
-    aBlock[10] = ( sequenceCounter ) & 0xFF;
-    aBlock[11] = ( sequenceCounter >> 8 ) & 0xFF;
-    aBlock[12] = ( sequenceCounter >> 16 ) & 0xFF;
-    aBlock[13] = ( sequenceCounter >> 24 ) & 0xFF;
+    const uint8_t *tail = ( const uint8_t * )keyStream;
 
-    while( size >= 16 )
+    while( size-- > 0 )
     {
-        aBlock[15] = ( ( ctr ) & 0xFF );
-        ctr++;
-        aes_encrypt( aBlock, sBlock, &AesContext );
-        for( i = 0; i < 16; i++ )
-        {
-            encBuffer[bufferIndex + i] = buffer[bufferIndex + i] ^ sBlock[i];
-        }
-        size -= 16;
-        bufferIndex += 16;
+        *out++ = *in++ ^ *tail++;
     }
+}
 
-    if( size > 0 )
+void LoRaMacCryptoPayloadEncrypt( const LoRaMacCryptoKey_t *cryptoKey, const uint8_t *buffer, uint16_t size, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *encBuffer )
+{
+    uint32_t keyStream[LORAMAC_CRYPTO_MAX_BLOCKS * 4];
+    uint8_t aBlock[16] = { 0x01, 0x00, 0x00, 0x00, 0x00, dir,
+                           ( address ) & 0xFF, ( address >> 8 ) & 0xFF, ( address >> 16 ) & 0xFF, ( address >> 24 ) & 0xFF,
+                           ( sequenceCounter ) & 0xFF, ( sequenceCounter >> 8 ) & 0xFF,
+                           ( sequenceCounter >> 16 ) & 0xFF, ( sequenceCounter >> 24 ) & 0xFF,
+                           0x00, 0x00
+                         };
+    uint8_t ctr = 1;
+
+    while( size > 0 )
     {
-        aBlock[15] = ( ( ctr ) & 0xFF );
-        aes_encrypt( aBlock, sBlock, &AesContext );
-        for( i = 0; i < size; i++ )
+        const uint16_t chunk = ( size < LORAMAC_CRYPTO_MAX_BLOCKS * 16 ) ? size : LORAMAC_CRYPTO_MAX_BLOCKS * 16;
+        uint8_t *block = ( uint8_t * )keyStream;
+
+        // Keystream of all the blocks of the chunk, then a single XOR pass
+        for( uint16_t i = 0; i < chunk; i += 16 )
         {
-            encBuffer[bufferIndex + i] = buffer[bufferIndex + i] ^ sBlock[i];
+            aBlock[15] = ctr++;
+            aes_encrypt( aBlock, block, &cryptoKey->Cmac.rijndael );
+            block += 16;
         }
+
+        XorKeyStream( encBuffer, buffer, keyStream, chunk );
+
+        buffer += chunk;
+        encBuffer += chunk;
+        size -= chunk;
     }
 }
 
+void LoRaMacPayloadEncrypt( const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *encBuffer )
+{
+    LoRaMacCryptoPayloadEncrypt( LoRaMacCryptoGetKey( key ), buffer, size, address, dir, sequenceCounter, encBuffer );
+}
+
 void LoRaMacPayloadDecrypt( const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *decBuffer )
 {
     LoRaMacPayloadEncrypt( buffer, size, key, address, dir, sequenceCounter, decBuffer );
@@ -157,15 +206,16 @@ void LoRaMacPayloadDecrypt( const uint8_t *buffer, uint16_t size, const uint8_t
 
 void LoRaMacJoinComputeMic( const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t *mic )
 {
-    AES_CMAC_Init( AesCmacCtx );
+    AES_CMAC_STATE cmac;
+    uint8_t digest[AES_CMAC_DIGEST_LENGTH];
 
-    AES_CMAC_SetKey( AesCmacCtx, key );
+    AES_CMAC_Start( &cmac, &LoRaMacCryptoGetKey( key )->Cmac );
 
-    AES_CMAC_Update( AesCmacCtx, buffer, size & 0xFF );
+    AES_CMAC_StateUpdate( &cmac, buffer, size & 0xFF );
 
-    AES_CMAC_Final( Mic, AesCmacCtx );
+    AES_CMAC_StateFinal( digest, &cmac );
 
-    *mic = ( uint32_t )( ( uint32_t )Mic[3] << 24 | ( uint32_t )Mic[2] << 16 | ( uint32_t )Mic[1] << 8 | ( uint32_t )Mic[0] );
+    *mic = LoRaMacCryptoMic( digest );
 }
 
 void LoRaMacJoinDecrypt( const uint8_t *buffer, uint16_t size, const uint8_t *key, uint8_t *decBuffer )
@@ -36,9 +36,80 @@
 #ifndef __LORAMAC_CRYPTO_H__
 #define __LORAMAC_CRYPTO_H__
 
+#include <stdint.h>
+#include "../crypto/aes.h"
+#include "../crypto/cmac.h"
+
+/*!
+ * Maximum number of AES blocks of keystream generated in one pass
+ * (a LoRaWAN payload is at most 16 blocks)
+ */
+#define LORAMAC_CRYPTO_MAX_BLOCKS                   16
+
+/*!
+ * Session key with its expanded AES key schedule and CMAC subkeys, computed
+ * once by LoRaMacCryptoSetKey instead of on every frame
+ *
+ * \remark Owned by the caller: functions using it keep no global state,
+ *         several contexts (devices, threads) can be used in parallel
+ */
+typedef struct sLoRaMacCryptoKey
+{
+    /*!
+     * AES key schedule (also used by the payload encryption) and CMAC subkeys
+     */
+    AES_CMAC_KEY Cmac;
+    /*!
+     * Key the schedule was computed for
+     */
+    uint8_t Key[16];
+}LoRaMacCryptoKey_t;
+
+/*!
+ * Expands a session key (NwkSKey, AppSKey)
+ *
+ * \param [OUT] cryptoKey       - Session key context
+ * \param [IN]  key             - AES key
+ */
+void LoRaMacCryptoSetKey( LoRaMacCryptoKey_t *cryptoKey, const uint8_t *key );
+
+/*!
+ * Computes the LoRaMAC payload encryption (or decryption) with an expanded
+ * session key: the keystream of all the blocks is generated in one pass, then
+ * XORed with the payload a word at a time
+ *
+ * \param [IN]  cryptoKey       - Session key context
+ * \param [IN]  buffer          - Data buffer
+ * \param [IN]  size            - Data buffer size
+ * \param [IN]  address         - Frame address
+ * \param [IN]  dir             - Frame direction [0: uplink, 1: downlink]
+ * \param [IN]  sequenceCounter - Frame sequence counter
+ * \param [OUT] encBuffer       - Encrypted buffer (may be buffer)
+ */
+void LoRaMacCryptoPayloadEncrypt( const LoRaMacCryptoKey_t *cryptoKey, const uint8_t *buffer, uint16_t size, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *encBuffer );
+
+/*!
+ * Computes the LoRaMAC frame MIC field with an expanded session key: the
+ * B0 block and the frame are fed to the CMAC in place, no key derivation
+ *
+ * \remark Reentrant: MICs of several devices can be verified in parallel
+ *
+ * \param [IN]  cryptoKey       - Session key context (NwkSKey)
+ * \param [IN]  buffer          - Data buffer
+ * \param [IN]  size            - Data buffer size
+ * \param [IN]  address         - Frame address
+ * \param [IN]  dir             - Frame direction [0: uplink, 1: downlink]
+ * \param [IN]  sequenceCounter - Frame sequence counter
+ * \param [OUT] mic             - Computed MIC field
+ */
+void LoRaMacCryptoComputeMic( const LoRaMacCryptoKey_t *cryptoKey, const uint8_t *buffer, uint16_t size, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint32_t *mic );
+
 /*!
  * Computes the LoRaMAC frame MIC field
  *
+ * \remark The key is found in the cache of LoRaMacPayloadEncrypt (not
+ *         reentrant): see LoRaMacCryptoComputeMic for a reentrant version
+ *
  * \param [IN]  buffer          - Data buffer
  * \param [IN]  size            - Data buffer size
  * \param [IN]  key             - AES key to be used
@@ -52,6 +123,10 @@ void LoRaMacComputeMic( const uint8_t *buffer, uint16_t size, const uint8_t *key
 /*!
  * Computes the LoRaMAC payload encryption
  *
+ * \remark The key schedules of the latest keys are cached (MAC layer context,
+ *         not reentrant, shared with the MIC computations): see
+ *         LoRaMacCryptoPayloadEncrypt for a reentrant version
+ *
  * \param [IN]  buffer          - Data buffer
  * \param [IN]  size            - Data buffer size
  * \param [IN]  key             - AES key to be used
@@ -0,0 +1,308 @@
+#include "nmea.h"
+
+#include <climits>
+
+NMEAParser::NMEAParser()
+{
+}
+
+bool NMEAParser::parse(uint8_t c)
+{
+	if(c == '$')
+	{ // Start of a sentence, even in the middle of another one (lost bytes)
+		if(m_state != State::IDLE)
+			++m_errors;
+
+		m_state			= State::DATA;
+		m_length		= 0;
+		m_fieldCount	= 1;
+		m_fields[0]		= 0;
+		m_checksum		= 0;
+		return false;
+	}
+
+	switch(m_state)
+	{
+		case State::IDLE:
+			return false;
+
+		case State::DATA:
+			if(c == '*')
+			{
+				m_buffer[m_length++] = '\0';
+				m_state = State::CHECKSUM_HIGH;
+				return false;
+			}
+
+			// Room for the terminating '\0', '$', "*hh" and "\r\n" are not stored
+			if(c < 0x20 || m_length >= MAX_LENGTH - 6)
+				break;
+
+			m_checksum ^= c;
+
+			if(c == ',')
+			{
+				if(m_fieldCount >= MAX_FIELDS)
+					break;
+
+				m_buffer[m_length++]		= '\0';
+				m_fields[m_fieldCount++]	= m_length;
+			}
+			else
+				m_buffer[m_length++] = c;
+			return false;
+
+		case State::CHECKSUM_HIGH:
+		{
+			const int8_t v = hexValue(c);
+			if(v < 0)
+				break;
+
+			m_received	= v << 4;
+			m_state		= State::CHECKSUM_LOW;
+			return false;
+		}
+
+		case State::CHECKSUM_LOW:
+		{
+			const int8_t v = hexValue(c);
+			if(v < 0 || (m_received | v) != m_checksum)
+				break;
+
+			m_state = State::IDLE;
+
+			// Standard address field: 2 characters talker ID, 3 characters sentence type
+			const uint8_t addressLength = ((m_fieldCount > 1) ? m_fields[1] : m_length) - 1;
+
+			if(addressLength == 5 && m_buffer[0] != 'P')
+			{
+				m_talker	= talkerId(m_buffer);
+				m_type		= sentenceType(m_buffer + 2);
+			}
+			else
+			{
+				m_talker	= 0;
+				m_type		= 0;
+			}
+			return true;
+		}
+	}
+
+	// Invalid sentence
+	++m_errors;
+	m_state = State::IDLE;
+	return false;
+}
+
+void NMEAParser::reset()
+{
+	m_state = State::IDLE;
+}
+
+uint16_t NMEAParser::talker() const
+{
+	return m_talker;
+}
+
+uint32_t NMEAParser::type() const
+{
+	return m_type;
+}
+
+uint8_t NMEAParser::fieldCount() const
+{
+	return m_fieldCount;
+}
+
+const char* NMEAParser::field(uint8_t i) const
+{
+	if(i >= m_fieldCount)
+		return "";
+
+	return m_buffer + m_fields[i];
+}
+
+uint32_t NMEAParser::errors() const
+{
+	return m_errors;
+}
+
+int8_t NMEAParser::hexValue(uint8_t c)
+{
+	if(c >= '0' && c <= '9')
+		return c - '0';
+	if(c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	if(c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+
+	return -1;
+}
+
+bool NMEAParser::parseDecimal(const char* s, uint8_t decimals, int32_t& value)
+{
+	bool negative = false;
+	if(*s == '-' || *s == '+')
+		negative = (*(s++) == '-');
+
+	int32_t v		= 0;
+	bool	digits	= false;
+	bool	point	= false;
+
+	for(; *s; ++s)
+	{
+		if(*s == '.' && !point)
+		{
+			point = true;
+			continue;
+		}
+
+		if(*s < '0' || *s > '9')
+			return true;
+
+		digits = true;
+
+		if(point)
+		{
+			if(!decimals)
+				continue;	// Truncated
+			--decimals;
+		}
+
+		if(v > (INT32_MAX - 9)/10)
+			return true;
+
+		v = v*10 + (*s - '0');
+	}
+
+	if(!digits)
+		return true;
+
+	for(; decimals; --decimals)
+	{
+		if(v > INT32_MAX/10)
+			return true;
+
+		v *= 10;
+	}
+
+	value = negative ? -v : v;
+	return false;
+}
+
+bool NMEAParser::parseCoordinate(const char* s, const char* hemisphere, int32_t& value)
+{
+	// (d)ddmm, then up to 6 decimals of minutes
+	uint32_t integer	= 0;
+	uint32_t fraction	= 0;
+	uint8_t  digits		= 0;
+	uint8_t  decimals	= 0;
+
+	for(; *s >= '0' && *s <= '9'; ++s, ++digits)
+		integer = integer*10 + (*s - '0');
+
+	if(digits < 3 || digits > 5)
+		return true;
+
+	if(*s == '.')
+		++s;
+
+	for(; *s >= '0' && *s <= '9'; ++s)
+	{
+		if(decimals < 6)
+		{
+			fraction = fraction*10 + (*s - '0');
+			++decimals;
+		}
+	}
+
+	if(*s)
+		return true;
+
+	for(; decimals < 6; ++decimals)
+		fraction *= 10;
+
+	const uint32_t degrees = integer/100;
+	const uint32_t minutes = integer%100;
+
+	if(minutes >= 60 || degrees > 180)
+		return true;
+
+	// 1e-6 minutes to 1e-7 degrees: x10/60
+	const int32_t v = degrees*10000000 + (minutes*1000000 + fraction + 3)/6;
+
+	switch(hemisphere[0])
+	{
+		case 'N':
+		case 'E':
+			value = v;
+			break;
+
+		case 'S':
+		case 'W':
+			value = -v;
+			break;
+
+		default:
+			return true;
+	}
+
+	return false;
+}
+
+bool NMEAParser::parseTime(const char* s, uint32_t& milliseconds)
+{
+	uint8_t d[6];
+	for(uint8_t i = 0; i < 6; ++i, ++s)
+	{
+		if(*s < '0' || *s > '9')
+			return true;
+
+		d[i] = *s - '0';
+	}
+
+	const uint32_t h = d[0]*10 + d[1];
+	const uint32_t m = d[2]*10 + d[3];
+	const uint32_t sec = d[4]*10 + d[5];
+
+	if(h > 23 || m > 59 || sec > 60)
+		return true;
+
+	uint32_t ms = 0;
+	if(*s == '.')
+	{
+		uint32_t scale = 100;
+		for(++s; *s >= '0' && *s <= '9'; ++s, scale /= 10)
+			ms += (*s - '0')*scale;
+	}
+
+	if(*s)
+		return true;
+
+	milliseconds = ((h*60 + m)*60 + sec)*1000 + ms;
+	return false;
+}
+
+bool NMEAParser::parseDate(const char* s, DateTime::Date& date)
+{
+	uint8_t d[6];
+	for(uint8_t i = 0; i < 6; ++i, ++s)
+	{
+		if(*s < '0' || *s > '9')
+			return true;
+
+		d[i] = *s - '0';
+	}
+
+	if(*s)
+		return true;
+
+	const uint8_t day	= d[0]*10 + d[1];
+	const uint8_t month	= d[2]*10 + d[3];
+
+	if(day < 1 || day > 31 || month < 1 || month > 12)
+		return true;
+
+	date = DateTime::Date(day, month, 2000 + d[4]*10 + d[5]);
+	return false;
+}
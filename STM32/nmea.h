@@ -0,0 +1,150 @@
+/**
+	\file nmea.h
+	\version 1.0
+**/
+
+#ifndef GUARD_NMEA
+#define GUARD_NMEA
+
+#include <cstdint>
+#include <cstddef>
+
+#include "datetime.h"
+
+/**
+	\brief Streaming NMEA 0183 sentence parser
+
+	Bytes are fed one at a time (or by blocks) as they are received. The sentence is stored in a fixed
+	buffer and tokenized in place while it is received (field separators are replaced by \c '\\0'), and
+	the checksum is computed on the fly: when the last checksum digit arrives, the sentence is ready to
+	use, with no heap allocation and no copy.
+
+	The static helpers decode the usual NMEA fields (decimal numbers, coordinates, time, date) with
+	integer arithmetic only.
+**/
+class NMEAParser
+{
+	public:
+		static constexpr uint8_t MAX_LENGTH = 82;	///< Maximum sentence length, '$' and "\r\n" included (NMEA 0183)
+		static constexpr uint8_t MAX_FIELDS = 24;	///< Maximum number of fields, address field included
+
+	public:
+		NMEAParser();
+
+		/**
+			\brief Process a received byte
+			\param c Received byte
+			\returns \c true if a complete and valid sentence was just received, \c false otherwise
+
+			When this method returns \c true, the sentence fields are available through field() until the
+			next call.
+		**/
+		bool parse(uint8_t c);
+
+		/**
+			\brief Drop the sentence being received
+		**/
+		void reset();
+
+		/**
+			\returns The talker ID of the latest sentence (e.g. talkerId("GP")), 0 for proprietary sentences
+		**/
+		uint16_t talker() const;
+
+		/**
+			\returns The type of the latest sentence (e.g. sentenceType("GGA")), 0 for proprietary sentences
+		**/
+		uint32_t type() const;
+
+		/**
+			\brief Pack a talker ID, to be compared with talker()
+			\param id Two characters talker ID, e.g. "GN"
+		**/
+		static constexpr uint16_t talkerId(const char* id)
+		{
+			return ((uint16_t)(id[0]) << 8) | (uint8_t)(id[1]);
+		}
+
+		/**
+			\brief Pack a sentence type, to be compared with type()
+			\param type Three characters sentence type, e.g. "RMC"
+		**/
+		static constexpr uint32_t sentenceType(const char* type)
+		{
+			return ((uint32_t)(type[0]) << 16) | ((uint32_t)(type[1]) << 8) | (uint8_t)(type[2]);
+		}
+
+		/**
+			\returns The number of fields of the latest sentence, address field (e.g. "GPGGA") included
+		**/
+		uint8_t fieldCount() const;
+
+		/**
+			\param i Index of the field, 0 being the address field (e.g. "GPGGA")
+			\returns The field, as a null-terminated string (empty if the field is empty or does not exist)
+		**/
+		const char* field(uint8_t i) const;
+
+		/**
+			\returns The number of sentences dropped so far (bad checksum, too long, too many fields)
+		**/
+		uint32_t errors() const;
+
+		/**
+			\brief Parse a decimal number as a fixed-point integer
+			\param s Null-terminated string, e.g. "-12.345"
+			\param decimals Number of decimals of the result: "-12.345" gives -1234 with 2 decimals
+			\param value Result. Extra decimals are truncated
+			\returns \c true on error (empty or invalid field, overflow), \c false otherwise
+		**/
+		static bool parseDecimal(const char* s, uint8_t decimals, int32_t& value);
+
+		/**
+			\brief Parse a coordinate
+			\param s Null-terminated string, formatted as (d)ddmm.mmmm
+			\param hemisphere Null-terminated string, "N", "S", "E" or "W"
+			\param value Result, in 1e-7 degrees (negative in the southern and western hemispheres)
+			\returns \c true on error, \c false otherwise
+		**/
+		static bool parseCoordinate(const char* s, const char* hemisphere, int32_t& value);
+
+		/**
+			\brief Parse a time of day
+			\param s Null-terminated string, formatted as hhmmss(.sss)
+			\param milliseconds Result, in milliseconds since midnight
+			\returns \c true on error, \c false otherwise
+		**/
+		static bool parseTime(const char* s, uint32_t& milliseconds);
+
+		/**
+			\brief Parse a date
+			\param s Null-terminated string, formatted as ddmmyy
+			\param date Result (years 2000 to 2099)
+			\returns \c true on error, \c false otherwise
+		**/
+		static bool parseDate(const char* s, DateTime::Date& date);
+
+	private:
+		enum class State: uint8_t
+		{
+			IDLE,			///< Waiting for '$'
+			DATA,			///< Receiving the sentence
+			CHECKSUM_HIGH,	///< Waiting for the first checksum digit
+			CHECKSUM_LOW	///< Waiting for the second checksum digit
+		};
+
+		static int8_t hexValue(uint8_t c);
+
+		char		m_buffer[MAX_LENGTH];
+		uint8_t		m_length		= 0;
+		uint8_t		m_fields[MAX_FIELDS];	///< Offsets of the fields in m_buffer
+		uint8_t		m_fieldCount	= 0;
+		uint16_t	m_talker		= 0;
+		uint32_t	m_type			= 0;
+		uint8_t		m_checksum		= 0;
+		uint8_t		m_received		= 0;	///< Received checksum
+		State		m_state			= State::IDLE;
+		uint32_t	m_errors		= 0;
+};
+
+#endif
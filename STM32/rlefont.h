@@ -0,0 +1,46 @@
+// Compressed font structures, generated by fonts/fontconvert.py.
+// Pass the address of the RLEFont struct to Display::setCompressedFont().
+//
+// Unlike GFXfont, code points are sparse (any set of Unicode code points,
+// e.g. ASCII + Latin-1), pixels may be anti-aliased (1, 2 or 4 bits per
+// pixel), and glyph bitmaps are run-length encoded.
+//
+// A glyph bitmap is its width*height pixels, row by row without padding,
+// encoded as a stream of one-byte ops:
+//   00nnnnnn : n+1 transparent pixels
+//   01nnnnnn : n+1 opaque pixels
+//   10nnnnnn : n+1 literal pixels follow, packed 'bpp' bits each (MSB first),
+//              padded to the next byte
+// Runs may span several rows.
+
+#ifndef GUARD_RLEFONT
+#define GUARD_RLEFONT
+
+#include <cstdint>
+
+typedef struct
+{ // Data stored PER GLYPH
+	uint16_t bitmapOffset;     // Offset of the encoded bitmap in RLEFont->bitmap
+	uint8_t  width, height;    // Bitmap dimensions in pixels
+	uint8_t  xAdvance;         // Distance to advance cursor (x axis)
+	int8_t   xOffset, yOffset; // Dist from cursor pos to UL corner
+} RLEGlyph;
+
+typedef struct
+{ // Run of consecutive code points
+	uint32_t first;            // First code point
+	uint16_t count;            // Number of code points
+	uint16_t glyph;            // Index of the glyph of 'first' in RLEFont->glyph
+} RLERange;
+
+typedef struct
+{ // Data stored for FONT AS A WHOLE:
+	const uint8_t  *bitmap;    // Encoded glyph bitmaps, concatenated
+	const RLEGlyph *glyph;     // Glyph array
+	const RLERange *range;     // Code point ranges, sorted
+	uint16_t        rangeCount;
+	uint8_t         yAdvance;  // Newline distance (y axis)
+	uint8_t         bpp;       // Bits per pixel: 1, 2 or 4
+} RLEFont;
+
+#endif // GUARD_RLEFONT
@@ -56,15 +56,17 @@ bool RealTimeClock::init(bool useExternalOscillator)
     m_rtc.Init.OutPutPolarity   = RTC_OUTPUT_POLARITY_HIGH;
     m_rtc.Init.OutPutType       = RTC_OUTPUT_TYPE_OPENDRAIN;
 
+    /* The prescalers divide by value + 1. A small asynchronous prescaler gives a finer subsecond
+       resolution (1/1024 s with LSE), at the cost of a slightly higher consumption. */
     if(useExternalOscillator)
     {
-        m_rtc.Init.AsynchPrediv = 128;
-        m_rtc.Init.SynchPrediv  = 256;
+        m_rtc.Init.AsynchPrediv = 31;
+        m_rtc.Init.SynchPrediv  = 1023;
     }
     else
     {
-        m_rtc.Init.AsynchPrediv = LSI_FREQUENCY/254 + 1;
-        m_rtc.Init.SynchPrediv  = 50*LSI_FREQUENCY/(m_rtc.Init.AsynchPrediv) - 1;
+        m_rtc.Init.AsynchPrediv = 127;
+        m_rtc.Init.SynchPrediv  = LSI_FREQUENCY/128 - 1;
     }
 #else
     m_rtc.Init.AsynchPrediv = RTC_AUTO_1_SECOND;
@@ -155,6 +157,48 @@ DateTime RealTimeClock::getDateTime()
     return DateTime(date, time);
 }
 
+bool RealTimeClock::getDateTime(DateTime& dt, uint32_t& microseconds)
+{
+#if defined(STM32F1xx)
+    /* The prescaler divider counts down from PRL to 0: read it around the counter, until it did not reload */
+    uint32_t before, after;
+    do
+    {
+        before  = ((RTC->DIVH & RTC_DIVH_RTC_DIV) << 16) | RTC->DIVL;
+        dt      = getDateTime();
+        after   = ((RTC->DIVH & RTC_DIVH_RTC_DIV) << 16) | RTC->DIVL;
+    } while(after > before);
+
+    const uint32_t prescaler = ((RTC->PRLH & RTC_PRLH_PRL) << 16) | RTC->PRLL;
+    microseconds = (uint64_t)(prescaler - after)*1000000/(prescaler + 1);
+#else
+    RTC_DateTypeDef d = {};
+    RTC_TimeTypeDef t = {};
+
+    /* Reading the time locks the date shadow register until it is read */
+    if( HAL_RTC_GetTime(&m_rtc, &t, RTC_FORMAT_BIN) != HAL_OK ||
+        HAL_RTC_GetDate(&m_rtc, &d, RTC_FORMAT_BIN) != HAL_OK)
+        return true;
+
+    const uint32_t prescaler = m_rtc.Init.SynchPrediv;
+
+    /* After a shift, the subsecond counter may be above the prescaler: the fraction is negative */
+    int32_t fraction = (int32_t)(prescaler) - (int32_t)(t.SubSeconds);
+
+    dt = DateTime(DateTime::Date(d.Date, d.Month, 2000+d.Year), DateTime::Time(t.Hours, t.Minutes, t.Seconds));
+
+    if(fraction < 0)
+    {
+        dt = DateTime(dt.getEpoch() - 1);
+        fraction += prescaler + 1;
+    }
+
+    microseconds = (uint64_t)(fraction)*1000000/(prescaler + 1);
+#endif
+
+    return !dt.getEpoch();
+}
+
 bool RealTimeClock::setDateTime(const DateTime& dt)
 {
     DateTime::Date date = dt.getDate();
@@ -162,7 +206,7 @@ bool RealTimeClock::setDateTime(const DateTime& dt)
     d.Date  = date.d;
     d.Month = date.m;
     d.Year  = date.y - 2000;
-    d.WeekDay = 0;
+    d.WeekDay = dt.getDayOfWeek();
 
     DateTime::Time time = dt.getTime();
     RTC_TimeTypeDef t = {};
@@ -187,6 +231,78 @@ bool RealTimeClock::setDateTime(const DateTime& dt)
     return false;
 }
 
+bool RealTimeClock::setDateTime(const DateTime& dt, uint32_t microseconds)
+{
+    if(microseconds >= 1000000)
+        return true;
+
+#if defined(STM32F1xx)
+    /* The prescaler cannot be shifted: only the start of a second can be set */
+    if(microseconds)
+        return true;
+
+    return setDateTime(dt);
+#else
+    /* Setting the time resets the prescaler: shift it forward by the fraction of second. Shifts add one second
+       and subtract (1 - fraction) */
+    if(setDateTime(dt))
+        return true;
+
+    if(!microseconds)
+        return false;
+
+    const uint32_t prescaler = m_rtc.Init.SynchPrediv + 1;
+    const uint32_t subtract = (uint64_t)(1000000 - microseconds)*prescaler/1000000;
+
+    return HAL_RTCEx_SetSynchroShift(&m_rtc, RTC_SHIFTADD1S_SET, subtract) != HAL_OK;
+#endif
+}
+
+bool RealTimeClock::setCalibration(int32_t ppb)
+{
+    /* The calibration masks (or adds) pulses in a 2^20 RTCCLK cycles window: 0.954 ppm per pulse */
+    constexpr int32_t PULSE = 954;
+
+    bool clamped = false;
+
+#if defined(STM32F1xx)
+    int32_t pulses = (-ppb + PULSE/2)/PULSE;
+    if(pulses < 0 || pulses > 0x7F)
+    {
+        pulses = (pulses < 0) ? 0 : 0x7F;
+        clamped = true;
+    }
+
+    if(HAL_RTCEx_SetSmoothCalib(&m_rtc, 0, 0, pulses) != HAL_OK)
+        return true;
+
+    m_calibration = -pulses*PULSE;
+#else
+    /* CALP adds 512 pulses (+488.5 ppm), CALM masks 0 to 511 pulses */
+    const bool plus = (ppb > 0);
+    int32_t pulses = ((plus ? 512*PULSE : 0) - ppb + PULSE/2)/PULSE;
+    if(pulses < 0 || pulses > 0x1FF)
+    {
+        pulses = (pulses < 0) ? 0 : 0x1FF;
+        clamped = true;
+    }
+
+    if(HAL_RTCEx_SetSmoothCalib(&m_rtc, RTC_SMOOTHCALIB_PERIOD_32SEC,
+                                plus ? RTC_SMOOTHCALIB_PLUSPULSES_SET : RTC_SMOOTHCALIB_PLUSPULSES_RESET,
+                                pulses) != HAL_OK)
+        return true;
+
+    m_calibration = ((plus ? 512 : 0) - pulses)*PULSE;
+#endif
+
+    return clamped;
+}
+
+int32_t RealTimeClock::calibration() const
+{
+    return m_calibration;
+}
+
 bool RealTimeClock::setAlarm(const DateTime::Time& when)
 {
     HAL_RTC_DeactivateAlarm(&m_rtc, RTC_ALARM_A);
@@ -43,6 +43,15 @@ class RealTimeClock
         **/
         DateTime getDateTime();
 
+        /**
+            \brief Read the RTC date & time, with the fraction of second
+            \param dt Date and time
+            \param microseconds Fraction of second, in us (resolution: 1/1024 s with LSE on STM32F4, 1/32768 s on
+            STM32F1)
+            \returns \c true on error, \c false otherwise
+        **/
+        bool getDateTime(DateTime& dt, uint32_t& microseconds);
+
         /**
             \brief Set the RTC date and time
             \param dt New date and time
@@ -50,6 +59,32 @@ class RealTimeClock
         **/
         bool setDateTime(const DateTime& dt);
 
+        /**
+            \brief Set the RTC date and time, with the fraction of second
+            \param dt New date and time
+            \param microseconds Fraction of second, in us
+            \returns \c true on error, \c false otherwise
+
+            \remark On STM32F4, the fraction is set by shifting the RTC (no wait). On STM32F1, the RTC cannot be
+            shifted: \c microseconds must be 0, the caller sets the time when a second starts (see DisciplinedClock).
+        **/
+        bool setDateTime(const DateTime& dt, uint32_t microseconds);
+
+        /**
+            \brief Correct the frequency of the RTC (smooth digital calibration)
+            \param ppb Correction, in ppb: positive to speed the RTC up, negative to slow it down
+            \returns \c true on error (correction clamped to the available range), \c false otherwise
+
+            \remark The resolution is 0.954 ppm. The range is -487 to +488 ppm on STM32F4, -121 to 0 ppm on STM32F1
+            (the RTC can only be slowed down).
+        **/
+        bool setCalibration(int32_t ppb);
+
+        /**
+            \returns The correction applied by setCalibration(), in ppb (after rounding and clamping)
+        **/
+        int32_t calibration() const;
+
         /**
             \brief Set the RTC alarm
             \todo WIP
@@ -72,6 +107,7 @@ class RealTimeClock
 
     private:
         RTC_HandleTypeDef m_rtc = {};
+        int32_t m_calibration = 0;
 
         void wakeupHandler();
 
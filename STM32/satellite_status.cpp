@@ -0,0 +1,288 @@
+#include "satellite_status.h"
+
+#include <algorithm>
+
+#include "ubx.h"
+
+bool SatelliteStatus::constellationFromTalker(uint16_t talker, Constellation& constellation)
+{
+	switch(talker)
+	{
+		case NMEAParser::talkerId("GP"):
+			constellation = Constellation::GPS;
+			return false;
+
+		case NMEAParser::talkerId("GL"):
+			constellation = Constellation::GLONASS;
+			return false;
+
+		case NMEAParser::talkerId("GA"):
+			constellation = Constellation::GALILEO;
+			return false;
+
+		case NMEAParser::talkerId("GB"):
+		case NMEAParser::talkerId("BD"):
+			constellation = Constellation::BEIDOU;
+			return false;
+
+		case NMEAParser::talkerId("GQ"):
+		case NMEAParser::talkerId("QZ"):
+			constellation = Constellation::QZSS;
+			return false;
+
+		default:
+			return true;
+	}
+}
+
+SatelliteStatus::Constellation SatelliteStatus::constellationFromId(uint16_t id)
+{
+	// NMEA 4.0 IDs, with the extended ranges used by u-blox and MediaTek receivers
+	if(id >= 65 && id <= 96)
+		return Constellation::GLONASS;
+	if(id >= 193 && id <= 202)
+		return Constellation::QZSS;
+	if((id >= 201 && id <= 237) || (id >= 401 && id <= 437))
+		return Constellation::BEIDOU;
+	if(id >= 301 && id <= 336)
+		return Constellation::GALILEO;
+
+	return Constellation::GPS;
+}
+
+bool SatelliteStatus::isUsed(Constellation constellation, uint16_t id) const
+{
+	const uint8_t c = static_cast<uint8_t>(constellation);
+
+	for(uint8_t i = 0; i < m_usedCount[c]; ++i)
+		if(m_usedIds[c][i] == id)
+			return true;
+
+	return false;
+}
+
+void SatelliteStatus::processGSA(const NMEAParser& parser)
+{
+	// GSA,mode,fix type,12 x satellite ID,PDOP,HDOP,VDOP(,system ID)
+	int32_t v;
+	if(!NMEAParser::parseDecimal(parser.field(2), 0, v))
+		m_quality.fixType = v;
+
+	if(!NMEAParser::parseDecimal(parser.field(15), 2, v))
+		m_quality.pdop = v;
+
+	if(!NMEAParser::parseDecimal(parser.field(16), 2, v))
+		m_quality.hdop = v;
+
+	if(!NMEAParser::parseDecimal(parser.field(17), 2, v))
+		m_quality.vdop = v;
+
+	uint16_t ids[MAX_USED_IDS];
+	uint8_t  count = 0;
+
+	for(uint8_t i = 3; i < 3 + MAX_USED_IDS; ++i)
+		if(!NMEAParser::parseDecimal(parser.field(i), 0, v) && v > 0)
+			ids[count++] = v;
+
+	// GN receivers send one GSA per constellation, identified by the system ID (NMEA 4.10)
+	// or by the satellite IDs
+	Constellation constellation;
+	if(!NMEAParser::parseDecimal(parser.field(18), 0, v) && v >= 1 && v <= CONSTELLATIONS)
+		constellation = static_cast<Constellation>(v - 1);
+	else if(constellationFromTalker(parser.talker(), constellation))
+	{
+		if(!count)
+			return;
+
+		constellation = constellationFromId(ids[0]);
+	}
+
+	const uint8_t c = static_cast<uint8_t>(constellation);
+
+	for(uint8_t i = 0; i < count; ++i)
+		m_usedIds[c][i] = ids[i];
+
+	m_usedCount[c] = count;
+
+	for(uint8_t i = 0; i < m_satelliteCount; ++i)
+		if(m_satellites[i].constellation == constellation)
+			m_satellites[i].used = isUsed(constellation, m_satellites[i].id);
+}
+
+void SatelliteStatus::processGSV(const NMEAParser& parser)
+{
+	// GSV,messages,message number,satellites in view,{ID,elevation,azimuth,SNR} x 1 to 4(,signal ID)
+	const uint8_t fields = parser.fieldCount();
+
+	int32_t number;
+	if(fields < 4 || NMEAParser::parseDecimal(parser.field(2), 0, number))
+		return;
+
+	int32_t signal = 0;
+	if((fields - 4) % 4 == 1 && NMEAParser::parseDecimal(parser.field(fields - 1), 0, signal))
+		signal = 0;
+
+	Constellation constellation;
+	const bool mixed = constellationFromTalker(parser.talker(), constellation);
+
+	// When several signals are listed (NMEA 4.10), the first one gives the list of satellites,
+	// the others only update the SNR
+	bool primary = true;
+	if(!mixed && signal)
+	{
+		uint8_t& current = m_signalId[static_cast<uint8_t>(constellation)];
+		if(!current)
+			current = signal;
+
+		primary = (signal == current);
+	}
+
+	// First message of the cycle: forget the previous list
+	if(number == 1 && primary)
+	{
+		uint8_t kept = 0;
+		for(uint8_t i = 0; i < m_satelliteCount; ++i)
+			if(!mixed && m_satellites[i].constellation != constellation)
+				m_satellites[kept++] = m_satellites[i];
+
+		m_satelliteCount = kept;
+	}
+
+	for(uint8_t f = 4; f + 3 < fields; f += 4)
+	{
+		int32_t id, elevation, azimuth, snr;
+		if(NMEAParser::parseDecimal(parser.field(f), 0, id) || id <= 0)
+			continue;
+
+		if(NMEAParser::parseDecimal(parser.field(f+1), 0, elevation))
+			elevation = 0;
+		if(NMEAParser::parseDecimal(parser.field(f+2), 0, azimuth))
+			azimuth = 0;
+		if(NMEAParser::parseDecimal(parser.field(f+3), 0, snr))
+			snr = 0;	// Not tracked
+
+		const Constellation c = mixed ? constellationFromId(id) : constellation;
+
+		Satellite* satellite = nullptr;
+		for(uint8_t i = 0; i < m_satelliteCount && !satellite; ++i)
+			if(m_satellites[i].constellation == c && m_satellites[i].id == id)
+				satellite = m_satellites + i;
+
+		if(!primary)
+		{
+			if(satellite && snr > satellite->snr)
+				satellite->snr = snr;
+			continue;
+		}
+
+		if(!satellite)
+		{
+			if(m_satelliteCount >= MAX_SATELLITES)
+				continue;
+
+			satellite = m_satellites + m_satelliteCount++;
+		}
+
+		satellite->constellation	= c;
+		satellite->id				= id;
+		satellite->elevation		= elevation;
+		satellite->azimuth			= azimuth;
+		satellite->snr				= snr;
+		satellite->used				= isUsed(c, id);
+	}
+}
+
+void SatelliteStatus::processNavSAT(const uint8_t* payload, uint16_t length)
+{
+	// iTOW, version, numSvs, reserved, then 12 bytes per satellite: gnssId, svId, cno, elev, azim, prRes, flags
+	if(length < 8)
+		return;
+
+	const uint8_t* p = payload;
+	const uint16_t count = std::min<uint16_t>(p[5], (length - 8)/12);
+
+	m_satelliteCount = 0;
+	for(uint8_t c = 0; c < CONSTELLATIONS; ++c)
+		m_usedCount[c] = 0;
+
+	for(uint16_t i = 0; i < count; ++i)
+	{
+		const uint8_t* q = p + 8 + 12*i;
+
+		// Satellite IDs are converted to their NMEA numbering
+		Constellation constellation;
+		uint16_t id = q[1];
+		switch(q[0])
+		{
+			case 0:	// GPS
+			case 1:	// SBAS
+				constellation = Constellation::GPS;
+				break;
+
+			case 2:
+				constellation = Constellation::GALILEO;
+				break;
+
+			case 3:
+				constellation = Constellation::BEIDOU;
+				break;
+
+			case 5:
+				constellation = Constellation::QZSS;
+				id += 192;
+				break;
+
+			case 6:
+				if(id == 255)	// Unknown slot number
+					continue;
+				constellation = Constellation::GLONASS;
+				id += 64;
+				break;
+
+			default:
+				continue;
+		}
+
+		const uint8_t c		= static_cast<uint8_t>(constellation);
+		const bool    used	= UBXParser::readU32(q + 8) & 0x08;
+
+		if(used && m_usedCount[c] < MAX_USED_IDS)
+			m_usedIds[c][m_usedCount[c]++] = id;
+
+		if(m_satelliteCount >= MAX_SATELLITES)
+			continue;
+
+		Satellite& satellite	= m_satellites[m_satelliteCount++];
+		satellite.constellation	= constellation;
+		satellite.id			= id;
+		satellite.snr			= q[2];
+		satellite.elevation		= static_cast<int8_t>(q[3]);
+		satellite.azimuth		= UBXParser::readU16(q + 4);
+		satellite.used			= used;
+	}
+}
+
+const SatelliteStatus::FixQuality& SatelliteStatus::quality() const
+{
+	return m_quality;
+}
+
+SatelliteStatus::FixQuality& SatelliteStatus::quality()
+{
+	return m_quality;
+}
+
+uint8_t SatelliteStatus::getSatellites(Satellite* satellites, uint8_t maxCount) const
+{
+	const uint8_t count = std::min(maxCount, m_satelliteCount);
+
+	for(uint8_t i = 0; i < count; ++i)
+		satellites[i] = m_satellites[i];
+
+	return count;
+}
+
+uint8_t SatelliteStatus::satellitesUsed(Constellation constellation) const
+{
+	return m_usedCount[static_cast<uint8_t>(constellation)];
+}
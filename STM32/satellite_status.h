@@ -0,0 +1,138 @@
+/**
+	\file satellite_status.h
+	\version 1.0
+**/
+
+#ifndef GUARD_SATELLITE_STATUS
+#define GUARD_SATELLITE_STATUS
+
+#include <cstdint>
+
+#include "nmea.h"
+
+/**
+	\brief Satellites in view and fix quality of a GNSS receiver
+
+	Keeps the satellite table (elevation, azimuth, SNR, used in the fix) and the fix quality metrics (fix type,
+	DOP) from NMEA GSA and GSV sentences, or from UBX NAV-SAT messages. It has no hardware dependency: GPS feeds
+	it with the sentences and messages it receives.
+
+	Single (GP, GL, GA, GB/BD, GQ/QZ talkers) and multi-constellation (GN talker) sentences are supported. A GN
+	GSA sentence is attributed to a constellation by its system ID (NMEA 4.10) when present, otherwise by the
+	range of its satellite IDs. When a GSV cycle lists several signals of the same satellites (NMEA 4.10), the
+	first signal gives the satellite list and the others only raise the SNR.
+**/
+class SatelliteStatus
+{
+	public:
+		/**
+			\brief Satellite navigation systems
+		**/
+		enum class Constellation: uint8_t
+		{
+			GPS,		///< GPS (talker ID GP), SBAS included
+			GLONASS,	///< GLONASS (talker ID GL)
+			GALILEO,	///< Galileo (talker ID GA)
+			BEIDOU,		///< BeiDou (talker ID GB or BD)
+			QZSS,		///< QZSS (talker ID GQ or QZ)
+			COUNT
+		};
+
+		/**
+			\brief Satellite in view, from GSV and GSA sentences
+		**/
+		struct Satellite
+		{
+			Constellation	constellation;
+			uint16_t		id;			///< Satellite ID (PRN)
+			int8_t			elevation;	///< Elevation, in degrees
+			uint16_t		azimuth;	///< Azimuth p/r true North, in degrees
+			uint8_t			snr;		///< Signal to noise ratio, in dB-Hz (0 if not tracked)
+			bool			used;		///< Used in the navigation solution
+		};
+
+		/**
+			\brief Fix quality metrics, from GGA and GSA sentences
+		**/
+		struct FixQuality
+		{
+			uint8_t		fixType		= 0;	///< 0 or 1: no fix, 2: 2D fix, 3: 3D fix
+			uint8_t		satellites	= 0;	///< Number of satellites used in the fix
+			uint16_t	pdop		= 0;	///< Position dilution of precision, x100
+			uint16_t	hdop		= 0;	///< Horizontal dilution of precision, x100
+			uint16_t	vdop		= 0;	///< Vertical dilution of precision, x100
+		};
+
+		static constexpr uint8_t MAX_SATELLITES	= 40;	///< Satellites in view, all constellations
+		static constexpr uint8_t MAX_USED_IDS	= 12;	///< Satellite IDs in a GSA sentence
+
+	public:
+		/**
+			\brief Process a GSA sentence (DOP and active satellites)
+			\param parser Parser that just received the sentence
+		**/
+		void processGSA(const NMEAParser& parser);
+
+		/**
+			\brief Process a GSV sentence (satellites in view)
+			\param parser Parser that just received the sentence
+		**/
+		void processGSV(const NMEAParser& parser);
+
+		/**
+			\brief Process a UBX NAV-SAT message (satellites in view), which replaces the whole table
+			\param payload Message payload
+			\param length Payload length
+		**/
+		void processNavSAT(const uint8_t* payload, uint16_t length);
+
+		/**
+			\returns Quality metrics of the latest fix (DOP, number of satellites used, 2D/3D fix)
+		**/
+		const FixQuality& quality() const;
+
+		/**
+			\returns Quality metrics of the latest fix, to be updated from the other sentences (e.g. GGA)
+		**/
+		FixQuality& quality();
+
+		/**
+			\brief Get the satellites in view
+			\param satellites Destination array
+			\param maxCount Size of the destination array
+			\returns Number of satellites copied
+			\remark The list of a constellation is refreshed at each GSV cycle (usually once per second).
+		**/
+		uint8_t getSatellites(Satellite* satellites, uint8_t maxCount) const;
+
+		/**
+			\param constellation Constellation
+			\returns Number of satellites of \c constellation used in the fix (from GSA sentences)
+		**/
+		uint8_t satellitesUsed(Constellation constellation) const;
+
+		/**
+			\brief Constellation of a talker ID
+			\returns \c true if the talker is not a single constellation (e.g. GN), \c false otherwise
+		**/
+		static bool constellationFromTalker(uint16_t talker, Constellation& constellation);
+
+		/**
+			\brief Constellation of a satellite ID, for GN (multi-constellation) sentences
+		**/
+		static Constellation constellationFromId(uint16_t id);
+
+	private:
+		static constexpr uint8_t CONSTELLATIONS = static_cast<uint8_t>(Constellation::COUNT);
+
+		bool isUsed(Constellation constellation, uint16_t id) const;
+
+		FixQuality	m_quality;
+		Satellite	m_satellites[MAX_SATELLITES];
+		uint8_t		m_satelliteCount					= 0;
+		uint16_t	m_usedIds[CONSTELLATIONS][MAX_USED_IDS];	///< From GSA sentences
+		uint8_t		m_usedCount[CONSTELLATIONS]			= {0};
+		uint8_t		m_signalId[CONSTELLATIONS]			= {0};	///< GSV signal ID listing the satellites (NMEA 4.10)
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include "simulated_flash.h"
+
+#include <algorithm>
+#include <cstring>
+
+constexpr uint32_t SimulatedFlash::DEFAULT_SECTOR_SIZE;
+
+SimulatedFlash::SimulatedFlash(uint32_t size, uint32_t sectorSize):
+    m_size(size), m_sectorSize(sectorSize)
+{
+    m_data          = new uint8_t[m_size];
+    m_eraseCounts   = new uint32_t[m_size / m_sectorSize]();
+
+    std::memset(m_data, 0xFF, m_size);
+}
+
+SimulatedFlash::~SimulatedFlash()
+{
+    delete[] m_data;
+    delete[] m_eraseCounts;
+}
+
+uint32_t SimulatedFlash::size() const
+{
+    return m_size;
+}
+
+uint32_t SimulatedFlash::sectorSize() const
+{
+    return m_sectorSize;
+}
+
+bool SimulatedFlash::read(uint32_t address, void* data, uint32_t size)
+{
+    if(m_failed || address > m_size || size > m_size - address)
+        return true;
+
+    std::memcpy(data, m_data + address, size);
+
+    m_stats.reads++;
+    m_stats.bytesRead += size;
+    return false;
+}
+
+bool SimulatedFlash::program(uint32_t address, const void* data, uint32_t size)
+{
+    if(m_failed || address > m_size || size > m_size - address)
+        return true;
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    const uint32_t done = consume(size);
+
+    for(uint32_t i = 0; i < done; ++i)
+    {
+        if(p[i] & ~m_data[address + i])
+            m_stats.violations++;
+
+        m_data[address + i] &= p[i];
+    }
+
+    m_stats.programs++;
+    m_stats.bytesProgrammed += done;
+    return done < size;
+}
+
+bool SimulatedFlash::erase(uint32_t address)
+{
+    if(m_failed || address >= m_size)
+        return true;
+
+    const uint32_t sector = address / m_sectorSize;
+    const uint32_t done = consume(m_sectorSize);
+
+    // An interrupted erase leaves the sector partially erased
+    std::memset(m_data + sector * m_sectorSize, 0xFF, done);
+
+    m_eraseCounts[sector]++;
+    m_stats.erases++;
+    return done < m_sectorSize;
+}
+
+void SimulatedFlash::failAfter(uint32_t bytes)
+{
+    m_failing   = true;
+    m_remaining = bytes;
+}
+
+void SimulatedFlash::powerCycle()
+{
+    m_failing   = false;
+    m_failed    = false;
+}
+
+uint32_t SimulatedFlash::eraseCount(uint32_t sector) const
+{
+    return sector < m_size / m_sectorSize ? m_eraseCounts[sector] : 0;
+}
+
+void SimulatedFlash::resetStats()
+{
+    m_stats = Stats();
+}
+
+uint32_t SimulatedFlash::consume(uint32_t size)
+{
+    if(!m_failing)
+        return size;
+
+    const uint32_t done = std::min(size, m_remaining);
+    m_remaining -= done;
+
+    if(done < size)
+        m_failed = true;
+
+    return done;
+}
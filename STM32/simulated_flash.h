@@ -0,0 +1,110 @@
+/**
+    \file simulated_flash.h
+    \version 1.0
+**/
+#ifndef GUARD_SIMULATED_FLASH
+#define GUARD_SIMULATED_FLASH
+
+#include "flash.h"
+
+/**
+    \brief NOR flash simulated in RAM, with power loss injection and wear counters
+
+    Stands in for a SPI flash (see SPIFlash) to test flash users on a host, or on the target without the chip:
+    - operations follow NOR semantics (see Flash), programming a 0 bit back to 1 is counted as a violation;
+    - failAfter() simulates a power loss in the middle of an operation: after the given number of bytes programmed
+    or erased, the operation stops (torn page, partially erased sector) and all the operations fail until
+    powerCycle();
+    - the statistics give the bytes programmed and the erase count of each sector, to compute the write
+    amplification and the wear of a flash user.
+**/
+class SimulatedFlash: public Flash
+{
+    public:
+        static constexpr uint32_t DEFAULT_SECTOR_SIZE   = 4096;
+
+        /**
+            \brief Operation counters, since construction or resetStats()
+        **/
+        struct Stats
+        {
+            uint32_t    reads           = 0;
+            uint32_t    bytesRead       = 0;
+            uint32_t    programs        = 0;
+            uint32_t    bytesProgrammed = 0;
+            uint32_t    erases          = 0;
+            uint32_t    violations      = 0;    ///< Bytes programmed over bits not erased (0 -> 1 requested)
+        };
+
+    public:
+        /**
+            \brief Constructor, the memory is erased
+            \param size Size of the memory, in bytes (multiple of sectorSize)
+            \param sectorSize Size of the erase unit, in bytes
+        **/
+        SimulatedFlash(uint32_t size, uint32_t sectorSize = DEFAULT_SECTOR_SIZE);
+
+        /**
+            No copy.
+        **/
+        SimulatedFlash(const SimulatedFlash&) = delete;
+
+        ~SimulatedFlash();
+
+        virtual uint32_t size() const;
+        virtual uint32_t sectorSize() const;
+        virtual bool read(uint32_t address, void* data, uint32_t size);
+        virtual bool program(uint32_t address, const void* data, uint32_t size);
+        virtual bool erase(uint32_t address);
+
+        /**
+            \brief Simulate a power loss
+            \param bytes Bytes programmed or erased before the loss, from now (0: the next operation fails)
+        **/
+        void failAfter(uint32_t bytes);
+
+        /**
+            \brief Restore the power: operations succeed again, and no power loss is scheduled
+        **/
+        void powerCycle();
+
+        /**
+            \returns \c true if a power loss happened, until powerCycle()
+        **/
+        bool failed() const { return m_failed; }
+
+        /**
+            \returns Number of erases of a sector
+        **/
+        uint32_t eraseCount(uint32_t sector) const;
+
+        const Stats& stats() const { return m_stats; }
+
+        void resetStats();
+
+        /**
+            \returns Content of the memory
+        **/
+        uint8_t* data() { return m_data; }
+
+    private:
+        /**
+            \brief Count down the bytes before the power loss
+            \param size Bytes of the operation
+            \returns Number of bytes done before the loss (\c size if there is none)
+        **/
+        uint32_t consume(uint32_t size);
+
+        uint32_t    m_size;
+        uint32_t    m_sectorSize;
+        uint8_t*    m_data          = nullptr;
+        uint32_t*   m_eraseCounts   = nullptr;
+
+        bool        m_failing       = false;    ///< Power loss scheduled
+        uint32_t    m_remaining     = 0;        ///< Bytes before the power loss
+        bool        m_failed        = false;
+
+        Stats       m_stats;
+};
+
+#endif
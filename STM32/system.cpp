@@ -23,6 +23,33 @@
     constexpr size_t numPorts = 5;
 #endif
 
+namespace
+{
+    volatile uint32_t   s_cyclesHigh        = 0;    ///< Number of overflows of DWT->CYCCNT
+    volatile uint32_t   s_cyclesLast        = 0;    ///< DWT->CYCCNT at the latest SysTick interrupt
+    uint32_t            s_cyclesPerMicro    = 0;    ///< Core clock frequency, in MHz
+
+    /**
+        \brief Count the overflows of the cycle counter (called by the SysTick interrupt)
+    **/
+    void updateCycles()
+    {
+        const uint32_t c = DWT->CYCCNT;
+        if(c < s_cyclesLast)
+            ++s_cyclesHigh;
+
+        s_cyclesLast = c;
+    }
+
+    uint32_t cyclesPerMicro()
+    {
+        if(!s_cyclesPerMicro)
+            s_cyclesPerMicro = System::hClkFrequency()/1000000;
+
+        return s_cyclesPerMicro;
+    }
+}
+
 bool System::init()
 {
 	HAL_Init();
@@ -99,13 +126,19 @@ bool System::initMainClock()
 	clkInit.APB2CLKDivider = System::APB2_PRESCALER;
     
     /* Enable DWT for sub-ms delays and measurements */
-    CoreDebug->DEMCR    |= CoreDebug_DEMCR_TRCENA_Msk;
-    DWT->CYCCNT          = 0;
-    DWT->CTRL           |= DWT_CTRL_CYCCNTENA_Msk;
+    /* It is only reset once, so that cycles() stays monotonic when the clock is restored after stop() */
+    if(!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk))
+    {
+        CoreDebug->DEMCR    |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT          = 0;
+        DWT->CTRL           |= DWT_CTRL_CYCCNTENA_Msk;
+    }
     
     if(HAL_RCC_ClockConfig(&clkInit, System::FLASH_LATENCY) != HAL_OK)
         return true;
 
+    s_cyclesPerMicro = hClkFrequency()/1000000;
+
     HAL_NVIC_SetPriority(SysTick_IRQn, 0, 0);
 
 	return HAL_SYSTICK_Config(hClkFrequency()/1000) != 0;
@@ -165,12 +198,49 @@ void System::setAllGPIOPortClockEnabled(bool enabled)
         setGPIOPortClockEnabled(ports[i], enabled);
 }
 
+uint64_t System::cycles()
+{
+    uint32_t high, last, low;
+    do
+    {
+        high    = s_cyclesHigh;
+        last    = s_cyclesLast;
+        low     = DWT->CYCCNT;
+    } while(high != s_cyclesHigh);
+
+    /* Overflow since the latest SysTick interrupt, not counted yet */
+    if(low < last)
+        ++high;
+
+    return (static_cast<uint64_t>(high) << 32) | low;
+}
+
+uint64_t System::nanos()
+{
+    return cyclesToNanos(cycles());
+}
+
 uint64_t System::micros()
 {
-    uint64_t c = DWT->CYCCNT*1000L;
-    uint64_t f = static_cast<uint64_t>(System::hClkFrequency())/1000L;
-    
-    return c/f;
+    return cyclesToMicros(cycles());
+}
+
+uint64_t System::millis64()
+{
+    return cyclesToMicros(cycles())/1000;
+}
+
+uint64_t System::cyclesToNanos(uint64_t cycles)
+{
+    const uint32_t f = cyclesPerMicro();
+
+    /* Split, so that cycles*1000 does not overflow */
+    return (cycles/f)*1000 + static_cast<uint32_t>(cycles%f)*1000/f;
+}
+
+uint64_t System::cyclesToMicros(uint64_t cycles)
+{
+    return cycles/cyclesPerMicro();
 }
 
 uint32_t System::millis()
@@ -295,6 +365,7 @@ void System::enableStopUnderDebug(bool enabled)
 extern "C" void SysTick_Handler(void)
 {
 	HAL_IncTick();
+	updateCycles();
 	HAL_SYSTICK_IRQHandler();
 }
 
@@ -74,17 +74,47 @@ namespace System
         void setAllGPIOPortClockEnabled(bool enabled);
     
         /**
-            \brief Microsecond-resolution clock, for benchmarking purposes
-            \todo Fix it...
+            \brief Core clock cycle counter, extended to 64 bits
+            \remark The DWT cycle counter is 32-bit: its overflows (every 25 s at 168 MHz, 59 s at 72 MHz)
+            are counted by the SysTick interrupt. SysTick must not be suspended, nor interrupts disabled, for a
+            whole overflow period. The counter does not count while the MCU is stopped.
+        **/
+        uint64_t cycles();
+
+        /**
+            \brief Nanosecond-resolution monotonic clock (resolution: one core clock cycle)
+            \remark Same time base as cycles(), micros() and millis64()
+        **/
+        uint64_t nanos();
+
+        /**
+            \brief Microsecond-resolution monotonic clock
+            \remark Same time base as cycles(), nanos() and millis64()
         **/
         uint64_t micros();
 
         /**
-            \brief Millisecond-resolution clock
+            \brief Millisecond-resolution monotonic clock, that does not overflow
+            \remark Same time base as cycles(), nanos() and micros()
+        **/
+        uint64_t millis64();
+
+        /**
+            \brief Millisecond-resolution clock (SysTick)
             \remark Will overflow after 49 days
         **/
         uint32_t millis();
 
+        /**
+            \brief Convert a number of core clock cycles (e.g. the difference of two cycles()) to nanoseconds
+        **/
+        uint64_t cyclesToNanos(uint64_t cycles);
+
+        /**
+            \brief Convert a number of core clock cycles to microseconds
+        **/
+        uint64_t cyclesToMicros(uint64_t cycles);
+
         /**
             \brief Active pause (ms resolution)
             \param duration Pause duration (in ms)
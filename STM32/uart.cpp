@@ -70,6 +70,17 @@ bool Serial::init(uint32_t baudrate, bool useAF)
 	return false;
 }
 
+bool Serial::setBaudrate(uint32_t baudrate)
+{
+	m_handle.Init.BaudRate = baudrate;
+
+	if(HAL_UART_Init(&m_handle) != HAL_OK)
+		return true;
+
+	m_handle.Instance->CR1 |= USART_CR1_RXNEIE;
+	return false;
+}
+
 #if defined(STM32F1xx)
     #define REMAP_COND_ENABLE(a, x) { if(a == x) __HAL_AFIO_REMAP_##x##_ENABLE(); }
     #define GPIO_SET_ALTERNATE(g, a) while(0);
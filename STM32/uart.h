@@ -49,6 +49,13 @@ class Serial
         \returns \c true on error, \c false otherwise
         **/
 		bool init(uint32_t baudrate, bool useAF = false);
+
+        /**
+        \brief Change the baudrate of an initialized UART, keeping the pin mapping
+        \param baudrate Baudrate to be used
+        \returns \c true on error, \c false otherwise
+        **/
+        bool setBaudrate(uint32_t baudrate);
 		
         /**
         \brief Clear the RX buffer
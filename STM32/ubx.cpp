@@ -0,0 +1,164 @@
+#include "ubx.h"
+
+UBXParser::UBXParser()
+{
+}
+
+bool UBXParser::parse(uint8_t c)
+{
+	switch(m_state)
+	{
+		case State::SYNC_1:
+			if(c == SYNC_1)
+				m_state = State::SYNC_2;
+			return false;
+
+		case State::SYNC_2:
+			if(c == SYNC_2)
+			{
+				m_state	= State::CLASS;
+				m_a		= 0;
+				m_b		= 0;
+			}
+			else if(c != SYNC_1)
+				m_state = State::SYNC_1;
+			return false;
+
+		case State::CLASS:
+			m_message	= (uint16_t)(c) << 8;
+			m_state		= State::ID;
+			break;
+
+		case State::ID:
+			m_message	|= c;
+			m_state		= State::LENGTH_LOW;
+			break;
+
+		case State::LENGTH_LOW:
+			m_length	= c;
+			m_state		= State::LENGTH_HIGH;
+			break;
+
+		case State::LENGTH_HIGH:
+			m_length	|= (uint16_t)(c) << 8;
+			m_received	= 0;
+
+			if(m_length > MAX_LENGTH)
+			{ // Most likely a false sync
+				++m_errors;
+				m_state = State::SYNC_1;
+				return false;
+			}
+
+			m_state = m_length ? State::PAYLOAD : State::CHECKSUM_A;
+			break;
+
+		case State::PAYLOAD:
+			if(m_received < MAX_PAYLOAD)
+				m_payload[m_received] = c;
+
+			if(++m_received == m_length)
+				m_state = State::CHECKSUM_A;
+			break;
+
+		case State::CHECKSUM_A:
+			if(c == m_a)
+			{
+				m_state = State::CHECKSUM_B;
+				return false;
+			}
+
+			++m_errors;
+			m_state = (c == SYNC_1) ? State::SYNC_2 : State::SYNC_1;
+			return false;
+
+		case State::CHECKSUM_B:
+			if(c == m_b)
+			{
+				m_state = State::SYNC_1;
+				return true;
+			}
+
+			++m_errors;
+			m_state = (c == SYNC_1) ? State::SYNC_2 : State::SYNC_1;
+			return false;
+	}
+
+	// Class, ID, length and payload are checksummed
+	m_a += c;
+	m_b += m_a;
+	return false;
+}
+
+void UBXParser::reset()
+{
+	m_state = State::SYNC_1;
+}
+
+bool UBXParser::busy() const
+{
+	return m_state != State::SYNC_1;
+}
+
+uint16_t UBXParser::message() const
+{
+	return m_message;
+}
+
+const uint8_t* UBXParser::payload() const
+{
+	return m_payload;
+}
+
+uint16_t UBXParser::length() const
+{
+	return (m_length < MAX_PAYLOAD) ? m_length : MAX_PAYLOAD;
+}
+
+bool UBXParser::truncated() const
+{
+	return m_length > MAX_PAYLOAD;
+}
+
+uint32_t UBXParser::errors() const
+{
+	return m_errors;
+}
+
+void UBXParser::checksum(const uint8_t* data, size_t size, uint8_t& a, uint8_t& b)
+{
+	for(size_t i = 0; i < size; ++i)
+	{
+		a += data[i];
+		b += a;
+	}
+}
+
+uint16_t UBXParser::readU16(const uint8_t* p)
+{
+	return p[0] | ((uint16_t)(p[1]) << 8);
+}
+
+uint32_t UBXParser::readU32(const uint8_t* p)
+{
+	return p[0] | ((uint32_t)(p[1]) << 8) | ((uint32_t)(p[2]) << 16) | ((uint32_t)(p[3]) << 24);
+}
+
+int32_t UBXParser::readI32(const uint8_t* p)
+{
+	return (int32_t)(readU32(p));
+}
+
+void UBXParser::writeU16(uint8_t* p, uint16_t v)
+{
+	p[0] = v & 0xFF;
+	p[1] = v >> 8;
+}
+
+void UBXParser::writeU32(uint8_t* p, uint32_t v)
+{
+	p[0] = v & 0xFF;
+	p[1] = (v >> 8) & 0xFF;
+	p[2] = (v >> 16) & 0xFF;
+	p[3] = v >> 24;
+}
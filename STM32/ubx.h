@@ -0,0 +1,139 @@
+/**
+	\file ubx.h
+	\version 1.0
+**/
+
+#ifndef GUARD_UBX
+#define GUARD_UBX
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+	\brief Streaming u-blox UBX binary protocol parser
+
+	A UBX frame is made of two sync characters (0xB5 0x62), the message class and ID, a 16-bit little-endian
+	payload length, the payload and a 2-byte Fletcher checksum computed over class, ID, length and payload.
+
+	Like NMEAParser, bytes are fed one at a time as they are received: the payload is stored in a fixed buffer
+	and the checksum is computed on the fly, so that the message is ready to use as soon as its last byte is
+	received, with no heap allocation. Payloads longer than MAX_PAYLOAD are checked but truncated.
+
+	The static helpers compute the checksum of frames to be sent to the receiver, and read or write little-endian
+	payload fields.
+**/
+class UBXParser
+{
+	public:
+		static constexpr uint16_t MAX_PAYLOAD = 8 + 12*40;	///< Largest stored payload: NAV-SAT with 40 satellites
+		static constexpr uint16_t MAX_LENGTH  = 2048;		///< Longer frames are considered corrupted (resynchronization)
+		static constexpr uint8_t  HEADER      = 6;			///< Sync characters, class, ID and length
+
+		static constexpr uint8_t SYNC_1 = 0xB5;
+		static constexpr uint8_t SYNC_2 = 0x62;
+
+		/**
+			\brief Pack a message class and ID, to be compared with message() (e.g. NAV_PVT is 0x0107)
+		**/
+		static constexpr uint16_t messageId(uint8_t messageClass, uint8_t id)
+		{
+			return ((uint16_t)(messageClass) << 8) | id;
+		}
+
+		static constexpr uint16_t NAV_PVT	= 0x0107;	///< Navigation position velocity time solution
+		static constexpr uint16_t NAV_SAT	= 0x0135;	///< Satellite information
+		static constexpr uint16_t ACK_NAK	= 0x0500;	///< Message not acknowledged
+		static constexpr uint16_t ACK_ACK	= 0x0501;	///< Message acknowledged
+		static constexpr uint16_t CFG_PRT	= 0x0600;	///< Port configuration
+		static constexpr uint16_t CFG_MSG	= 0x0601;	///< Message rate configuration
+		static constexpr uint16_t CFG_RATE	= 0x0608;	///< Navigation and measurement rate configuration
+		static constexpr uint16_t CFG_CFG	= 0x0609;	///< Save, load or clear the configuration
+
+	public:
+		UBXParser();
+
+		/**
+			\brief Process a received byte
+			\param c Received byte
+			\returns \c true if a complete and valid message was just received, \c false otherwise
+
+			When this method returns \c true, the message is available through message() and payload() until
+			the next call.
+		**/
+		bool parse(uint8_t c);
+
+		/**
+			\brief Drop the message being received
+		**/
+		void reset();
+
+		/**
+			\returns \c true while a frame is being received (sync characters found), \c false otherwise
+		**/
+		bool busy() const;
+
+		/**
+			\returns The class and ID of the latest message, packed by messageId()
+		**/
+		uint16_t message() const;
+
+		/**
+			\returns The payload of the latest message
+		**/
+		const uint8_t* payload() const;
+
+		/**
+			\returns The stored payload length of the latest message (at most MAX_PAYLOAD)
+		**/
+		uint16_t length() const;
+
+		/**
+			\returns \c true if the payload of the latest message was longer than MAX_PAYLOAD, \c false otherwise
+		**/
+		bool truncated() const;
+
+		/**
+			\returns The number of frames dropped so far (bad checksum, invalid length)
+		**/
+		uint32_t errors() const;
+
+		/**
+			\brief Compute the 8-bit Fletcher checksum used by UBX
+			\param data Data (class, ID, length and payload)
+			\param size Data size
+			\param a First checksum byte, to be initialized to 0 (or to the checksum of the previous data)
+			\param b Second checksum byte, likewise
+		**/
+		static void checksum(const uint8_t* data, size_t size, uint8_t& a, uint8_t& b);
+
+		static uint16_t readU16(const uint8_t* p);	///< Read a little-endian unsigned 16-bit field
+		static uint32_t readU32(const uint8_t* p);	///< Read a little-endian unsigned 32-bit field
+		static int32_t  readI32(const uint8_t* p);	///< Read a little-endian signed 32-bit field
+		static void     writeU16(uint8_t* p, uint16_t v);	///< Write a little-endian 16-bit field
+		static void     writeU32(uint8_t* p, uint32_t v);	///< Write a little-endian 32-bit field
+
+	private:
+		enum class State: uint8_t
+		{
+			SYNC_1,			///< Waiting for the first sync character
+			SYNC_2,			///< Waiting for the second sync character
+			CLASS,			///< Waiting for the message class
+			ID,				///< Waiting for the message ID
+			LENGTH_LOW,		///< Waiting for the payload length, LSB
+			LENGTH_HIGH,	///< Waiting for the payload length, MSB
+			PAYLOAD,		///< Receiving the payload
+			CHECKSUM_A,		///< Waiting for the first checksum byte
+			CHECKSUM_B		///< Waiting for the second checksum byte
+		};
+
+		uint8_t		m_payload[MAX_PAYLOAD];
+		uint16_t	m_message		= 0;
+		uint16_t	m_length		= 0;	///< Declared payload length
+		uint16_t	m_received		= 0;	///< Payload bytes received
+		uint8_t		m_a				= 0;
+		uint8_t		m_b				= 0;
+		State		m_state			= State::SYNC_1;
+		uint32_t	m_errors		= 0;
+};
+
+#endif
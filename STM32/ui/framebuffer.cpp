@@ -0,0 +1,73 @@
+#include "framebuffer.h"
+
+FrameBuffer::FrameBuffer(int16_t w, int16_t h, uint16_t* buffer):
+    Display(w, h), m_buffer(buffer)
+{
+}
+
+bool FrameBuffer::init(Orientation)
+{
+    return false;
+}
+
+void FrameBuffer::writePixel(int16_t x, int16_t y, uint16_t color)
+{
+    if(x < 0 || x >= WIDTH ||
+       y < 0 || y >= HEIGHT)
+        return;
+
+    m_buffer[y*WIDTH + x] = color;
+}
+
+void FrameBuffer::writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+    /* Clip to the buffer */
+    int32_t x1 = (x < 0) ? 0 : x;
+    int32_t y1 = (y < 0) ? 0 : y;
+    int32_t x2 = (x + w > WIDTH)  ? WIDTH  : x + w;
+    int32_t y2 = (y + h > HEIGHT) ? HEIGHT : y + h;
+
+    for(int32_t j = y1; j < y2; ++j)
+    {
+        uint16_t* row = m_buffer + j*WIDTH;
+
+        for(int32_t i = x1; i < x2; ++i)
+            row[i] = color;
+    }
+}
+
+void FrameBuffer::writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+{
+    writeFillRect(x, y, w, 1, color);
+}
+
+void FrameBuffer::fillScreen(uint16_t color)
+{
+    for(uint32_t i = 0, n = (uint32_t)(WIDTH)*(uint32_t)(HEIGHT); i < n; ++i)
+        m_buffer[i] = color;
+}
+
+void FrameBuffer::setOrientation(Orientation orientation)
+{
+    /* The buffer layout never changes */
+    m_orientation = orientation;
+}
+
+uint16_t FrameBuffer::pixel(int16_t x, int16_t y) const
+{
+    if(x < 0 || x >= WIDTH ||
+       y < 0 || y >= HEIGHT)
+        return 0;
+
+    return m_buffer[y*WIDTH + x];
+}
+
+uint16_t* FrameBuffer::buffer()
+{
+    return m_buffer;
+}
+
+const uint16_t* FrameBuffer::buffer() const
+{
+    return m_buffer;
+}
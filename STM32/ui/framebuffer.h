@@ -0,0 +1,64 @@
+/**
+    \file framebuffer.h
+    \version 1.0
+**/
+#ifndef GUARD_FRAMEBUFFER
+#define GUARD_FRAMEBUFFER
+
+#include "display.h"
+
+/**
+    \brief Display rendering into a RGB565 buffer in RAM
+
+    Off-screen display: every drawing primitive of Display writes into a caller-provided
+    array of width*height pixels, stored row by row. Useful to compose an image before pushing
+    it to a panel (see SSD2119::drawImageAsync() or ILI9xxx::drawImage()), or to check the
+    output of the drawing code without any hardware.
+
+    \remark The buffer is not owned by the instance, and orientation is ignored.
+**/
+class FrameBuffer: public Display
+{
+    public:
+        /**
+            \brief Constructor
+            \param w Width, in pixels
+            \param h Height, in pixels
+            \param buffer Pixel buffer, at least w*h elements
+        **/
+        FrameBuffer(int16_t w, int16_t h, uint16_t* buffer);
+
+        /**
+            \brief Does nothing, the buffer is ready to use
+            \returns \c false
+        **/
+        virtual bool init(Orientation orientation = Orientation::PORTRAIT_1);
+
+        virtual void writePixel(int16_t x, int16_t y, uint16_t color);
+        virtual void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+        virtual void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+
+        virtual void fillScreen(uint16_t color);
+
+        virtual void setOrientation(Orientation orientation);
+
+        /**
+            \returns Color of the pixel at (x, y), or 0 if outside the buffer
+        **/
+        uint16_t pixel(int16_t x, int16_t y) const;
+
+        /**
+            \returns Pixel buffer
+        **/
+        uint16_t* buffer();
+
+        /**
+            \returns Pixel buffer
+        **/
+        const uint16_t* buffer() const;
+
+    private:
+        uint16_t* const m_buffer;
+};
+
+#endif
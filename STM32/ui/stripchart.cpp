@@ -0,0 +1,184 @@
+#include "stripchart.h"
+
+StripChart::StripChart(const Rect& bounds, int32_t min, int32_t max, uint16_t color, uint16_t samplesPerColumn):
+    Widget(bounds),
+    m_width(bounds.w > 0 ? bounds.w : 0),
+    m_columns(new Column[m_width > 0 ? m_width : 1]),
+    m_min(min), m_max(max), m_color(color),
+    m_samplesPerColumn(samplesPerColumn ? samplesPerColumn : 1)
+{
+}
+
+StripChart::~StripChart()
+{
+    delete[] m_columns;
+}
+
+void StripChart::addSample(int32_t value)
+{
+    if(value < m_min)
+        value = m_min;
+    else if(value > m_max)
+        value = m_max;
+
+    if(m_samples == 0)
+    {
+        /* Start from the previous sample, so that the trace is continuous */
+        m_low = m_high = m_hasLast ? m_last : value;
+    }
+
+    if(value < m_low)
+        m_low = value;
+    if(value > m_high)
+        m_high = value;
+
+    m_last      = value;
+    m_hasLast   = true;
+
+    if(++m_samples >= m_samplesPerColumn)
+        pushColumn();
+}
+
+void StripChart::addSamples(const int32_t* values, uint32_t count)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        addSample(values[i]);
+}
+
+void StripChart::clear()
+{
+    for(int16_t i = 0; i < m_width; ++i)
+        m_columns[i] = Column();
+
+    m_samples   = 0;
+    m_hasLast   = false;
+    m_cursor    = 0;
+    m_pending   = 0;
+
+    invalidate();
+}
+
+void StripChart::setHardwareScroll(bool enabled)
+{
+    if(enabled == m_hardwareScroll)
+        return;
+
+    m_hardwareScroll = enabled;
+    invalidate();
+}
+
+void StripChart::setSamplesPerColumn(uint16_t samplesPerColumn)
+{
+    m_samplesPerColumn  = samplesPerColumn ? samplesPerColumn : 1;
+    m_samples           = 0;
+}
+
+int16_t StripChart::toOffset(int32_t value) const
+{
+    if(m_max <= m_min || m_bounds.h <= 1)
+        return 0;
+
+    return (int64_t)(m_max - value)*(m_bounds.h - 1) / (m_max - m_min);
+}
+
+void StripChart::pushColumn()
+{
+    m_samples = 0;
+
+    if(m_width <= 0)
+        return;
+
+    Column& c = m_columns[m_cursor];
+    c.top       = toOffset(m_high);
+    c.bottom    = toOffset(m_low);
+
+    if(++m_cursor >= m_width)
+        m_cursor = 0;
+
+    if(m_pending < m_width)
+        ++m_pending;
+
+    invalidateContent();
+}
+
+bool StripChart::useHardwareScroll(Display& display) const
+{
+    return m_hardwareScroll &&
+           m_bounds.x == 0  &&
+           m_width == display.width();
+}
+
+void StripChart::drawColumn(Display& display, int16_t position)
+{
+    const Column& c = m_columns[position];
+
+    if(c.top < 0)
+        return;
+
+    display.drawFastVLine(m_bounds.x + position, m_bounds.y + c.top, c.bottom - c.top + 1, m_color);
+}
+
+void StripChart::draw(Display& display, bool full)
+{
+    if(m_width <= 0)
+        return;
+
+    const bool hardwareScroll = useHardwareScroll(display);
+
+    /* Leaving hardware scroll mode: put the screen back in place */
+    if(!hardwareScroll && m_scroll != 0)
+    {
+        display.setHorizontalScroll(0);
+        m_scroll = 0;
+        full = true;
+    }
+
+    if(full || m_pending >= m_width)
+    {
+        display.fillRect(m_bounds.x, m_bounds.y, m_width, m_bounds.h, m_background);
+
+        for(int16_t i = 0; i < m_width; ++i)
+        {
+            /* Keep the sweep gap blank */
+            if(!hardwareScroll && (i - m_cursor + m_width) % m_width < SWEEP_GAP)
+                continue;
+
+            drawColumn(display, i);
+        }
+    }
+    else
+    {
+        for(int16_t i = m_pending; i > 0; --i)
+        {
+            const int16_t position = (m_cursor - i + m_width) % m_width;
+
+            if(hardwareScroll)
+            {
+                /* Overwrite the column that just scrolled out */
+                display.drawFastVLine(m_bounds.x + position, m_bounds.y, m_bounds.h, m_background);
+            }
+            else
+            {
+                /* Blank the column ahead, the current one was blanked SWEEP_GAP columns ago */
+                const int16_t ahead = (position + SWEEP_GAP) % m_width;
+                display.drawFastVLine(m_bounds.x + ahead, m_bounds.y, m_bounds.h, m_background);
+            }
+
+            drawColumn(display, position);
+        }
+    }
+
+    m_pending = 0;
+
+    if(hardwareScroll)
+    {
+        /* Newest column on the right edge */
+        if(display.setHorizontalScroll(m_cursor))
+        {
+            m_hardwareScroll = false;
+            invalidate();
+        }
+        else
+            m_scroll = m_cursor;
+    }
+}
@@ -0,0 +1,116 @@
+/**
+    \file stripchart.h
+    \version 1.0
+**/
+#ifndef GUARD_STRIPCHART
+#define GUARD_STRIPCHART
+
+#include "widget.h"
+
+/**
+    \brief Real-time strip chart (oscilloscope-like trace)
+
+    Samples are decimated into pixel columns: each column keeps the min/max of the samples it
+    covers, so that spikes between two columns are never lost. Adding a sample is O(1) (a couple
+    of comparisons, plus two divisions when a column is complete), and rendering only draws the
+    columns completed since the last render: the cost per sample is bounded whatever the chart size.
+
+    Two update modes:
+    - sweep (default): the trace is written left to right then wraps around, with a small
+      blank gap ahead of the write position, like a sweeping oscilloscope.
+    - hardware scroll: the screen is scrolled by the display controller and only the newest
+      column is drawn. Requires Display::setHorizontalScroll() support (e.g. ILI9341 in landscape)
+      and a chart spanning the whole width. The whole screen scrolls: the chart should own the
+      display. Falls back to sweep mode when not supported.
+
+    \remark addSample() and render must be called from the same context. To feed the chart from
+    an interrupt, buffer the samples and add them from the main loop.
+    \remark Column storage (4 bytes per column) is allocated on the heap at construction.
+**/
+class StripChart: public Widget
+{
+    public:
+        static constexpr int16_t SWEEP_GAP = 4; ///< Blank columns ahead of the sweep position
+
+    public:
+        /**
+            \brief Constructor
+            \param bounds Area of the chart
+            \param min Value at the bottom edge
+            \param max Value at the top edge
+            \param color Trace color
+            \param samplesPerColumn Number of samples decimated into a pixel column
+        **/
+        StripChart(const Rect& bounds, int32_t min, int32_t max, uint16_t color, uint16_t samplesPerColumn = 1);
+
+        ~StripChart();
+
+        /**
+            \brief Add a sample
+            \param value Sample value, clamped to [min, max]
+        **/
+        void addSample(int32_t value);
+
+        /**
+            \brief Add several samples
+            \param values Samples
+            \param count Number of samples
+        **/
+        void addSamples(const int32_t* values, uint32_t count);
+
+        /**
+            \brief Erase the trace
+        **/
+        void clear();
+
+        /**
+            \brief Enable or disable hardware scrolling
+            \param enabled \c true to use hardware scrolling when possible
+        **/
+        void setHardwareScroll(bool enabled);
+
+        /**
+            \brief Change the number of samples per pixel column
+            \param samplesPerColumn New decimation factor
+        **/
+        void setSamplesPerColumn(uint16_t samplesPerColumn);
+
+    protected:
+        virtual void draw(Display& display, bool full);
+
+    private:
+        struct Column
+        {
+            int16_t top     = -1;   ///< Offset from the top of the chart, -1 for an empty column
+            int16_t bottom  = -1;
+        };
+
+        int16_t toOffset(int32_t value) const;
+        void    drawColumn(Display& display, int16_t position);
+        void    pushColumn();
+
+        bool    useHardwareScroll(Display& display) const;
+
+        const int16_t   m_width;
+        Column*         m_columns;
+
+        int32_t         m_min;
+        int32_t         m_max;
+        uint16_t        m_color;
+        uint16_t        m_samplesPerColumn;
+
+        /* Column being accumulated */
+        int32_t         m_low;
+        int32_t         m_high;
+        int32_t         m_last;
+        uint16_t        m_samples       = 0;
+        bool            m_hasLast       = false;
+
+        int16_t         m_cursor        = 0;    ///< Position of the next column
+        int16_t         m_pending       = 0;    ///< Columns completed since the last render
+
+        bool            m_hardwareScroll = false;
+        int16_t         m_scroll         = 0;
+};
+
+#endif
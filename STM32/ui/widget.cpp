@@ -0,0 +1,287 @@
+#include "widget.h"
+
+bool Rect::contains(const Point2D& p) const
+{
+    return p.x() >= x && p.x() < x + w &&
+           p.y() >= y && p.y() < y + h;
+}
+
+bool Rect::intersects(const Rect& other) const
+{
+    return x < other.x + other.w && other.x < x + w &&
+           y < other.y + other.h && other.y < y + h;
+}
+
+bool Rect::isEmpty() const
+{
+    return w <= 0 || h <= 0;
+}
+
+Widget::Widget(const Rect& bounds):
+    m_bounds(bounds)
+{
+}
+
+Widget::~Widget()
+{
+    if(m_parent)
+        m_parent->removeChild(this);
+
+    /* Orphan the children */
+    while(m_firstChild)
+        removeChild(m_firstChild);
+}
+
+void Widget::addChild(Widget* child)
+{
+    if(!child || child->m_parent)
+        return;
+
+    child->m_parent         = this;
+    child->m_nextSibling    = nullptr;
+    child->m_invalidation   = Invalidation::FULL;
+
+    if(!m_firstChild)
+    {
+        m_firstChild = child;
+        return;
+    }
+
+    Widget* last = m_firstChild;
+    while(last->m_nextSibling)
+        last = last->m_nextSibling;
+
+    last->m_nextSibling = child;
+}
+
+void Widget::removeChild(Widget* child)
+{
+    if(!child || child->m_parent != this)
+        return;
+
+    if(m_firstChild == child)
+        m_firstChild = child->m_nextSibling;
+    else
+    {
+        Widget* previous = m_firstChild;
+        while(previous->m_nextSibling != child)
+            previous = previous->m_nextSibling;
+
+        previous->m_nextSibling = child->m_nextSibling;
+    }
+
+    /* The release must not reach a widget out of the tree, possibly destroyed */
+    if(Screen* root = screen())
+        root->release(child);
+
+    child->m_parent      = nullptr;
+    child->m_nextSibling = nullptr;
+
+    /* Erase it */
+    if(child->m_visible)
+        invalidate();
+}
+
+const Rect& Widget::bounds() const
+{
+    return m_bounds;
+}
+
+void Widget::setBounds(const Rect& bounds)
+{
+    if( bounds.x == m_bounds.x && bounds.y == m_bounds.y &&
+        bounds.w == m_bounds.w && bounds.h == m_bounds.h)
+        return;
+
+    m_bounds = bounds;
+
+    if(m_parent && m_visible)
+        m_parent->invalidate();
+    else
+        invalidate();
+}
+
+bool Widget::isVisible() const
+{
+    return m_visible;
+}
+
+void Widget::setVisible(bool visible)
+{
+    if(visible == m_visible)
+        return;
+
+    m_visible = visible;
+
+    if(!visible && m_parent)
+        m_parent->invalidate();
+    else
+        invalidate();
+}
+
+uint16_t Widget::background() const
+{
+    return m_background;
+}
+
+void Widget::setBackground(uint16_t color)
+{
+    if(color == m_background)
+        return;
+
+    m_background = color;
+    invalidate();
+}
+
+void Widget::invalidate()
+{
+    m_invalidation = Invalidation::FULL;
+}
+
+void Widget::invalidateContent()
+{
+    if(m_invalidation == Invalidation::NONE)
+        m_invalidation = Invalidation::CONTENT;
+}
+
+bool Widget::isInvalid() const
+{
+    return m_invalidation != Invalidation::NONE;
+}
+
+Widget* Widget::hitTest(const Point2D& p)
+{
+    if(!m_visible || !m_bounds.contains(p))
+        return nullptr;
+
+    /* Last children are on top */
+    Widget* hit = nullptr;
+    for(Widget* child = m_firstChild; child; child = child->m_nextSibling)
+    {
+        Widget* h = child->hitTest(p);
+        if(h)
+            hit = h;
+    }
+
+    return hit ? hit : this;
+}
+
+Widget* Widget::parent() const
+{
+    return m_parent;
+}
+
+bool Widget::touchEvent(const Point2D&, bool)
+{
+    return false;
+}
+
+Screen* Widget::screen()
+{
+    return m_parent ? m_parent->screen() : nullptr;
+}
+
+Screen::Screen(Display& display):
+    Widget(Rect(0, 0, display.width(), display.height())), m_display(display)
+{
+}
+
+uint32_t Screen::render()
+{
+    /* The display may have been rotated */
+    if(m_bounds.w != m_display.width() || m_bounds.h != m_display.height())
+    {
+        m_bounds = Rect(0, 0, m_display.width(), m_display.height());
+        invalidate();
+    }
+
+    m_display.startWrite();
+    uint32_t drawn = render(this, false);
+    m_display.endWrite();
+
+    return drawn;
+}
+
+uint32_t Screen::render(Widget* widget, bool forced)
+{
+    if(!widget->m_visible)
+    {
+        widget->m_invalidation = Invalidation::NONE;
+        return 0;
+    }
+
+    uint32_t drawn = 0;
+
+    const bool full  = forced || widget->m_invalidation == Invalidation::FULL;
+    const bool dirty = full   || widget->m_invalidation == Invalidation::CONTENT;
+
+    /* Cleared before drawing, so that draw() may schedule another update */
+    widget->m_invalidation = Invalidation::NONE;
+
+    if(dirty)
+    {
+        widget->draw(m_display, full);
+        ++drawn;
+    }
+
+    /* A full redraw of the parent paints over its children */
+    for(Widget* child = widget->m_firstChild; child; child = child->m_nextSibling)
+        drawn += render(child, full);
+
+    return drawn;
+}
+
+void Screen::processTouch(const std::pair<bool, Point2D>& state)
+{
+    const bool      pressed = state.first;
+    const Point2D&  p       = state.second;
+
+    if(pressed)
+    {
+        /* Only the first press is dispatched, until the release */
+        if(m_grab)
+            return;
+
+        for(Widget* w = hitTest(p); w; w = w->m_parent)
+        {
+            if(w->touchEvent(p, true))
+            {
+                m_grab = w;
+                break;
+            }
+        }
+    }
+    else if(m_grab)
+    {
+        m_grab->touchEvent(p, false);
+        m_grab = nullptr;
+    }
+}
+
+Screen* Screen::screen()
+{
+    return this;
+}
+
+void Screen::release(Widget* subtree)
+{
+    for(Widget* w = m_grab; w; w = w->m_parent)
+    {
+        if(w == subtree)
+        {
+            m_grab = nullptr;
+            return;
+        }
+    }
+}
+
+Display& Screen::display()
+{
+    return m_display;
+}
+
+void Screen::draw(Display& display, bool full)
+{
+    if(full)
+        display.fillRect(m_bounds.x, m_bounds.y, m_bounds.w, m_bounds.h, m_background);
+}
@@ -0,0 +1,273 @@
+/**
+    \file widget.h
+    \version 1.0
+**/
+#ifndef GUARD_WIDGET
+#define GUARD_WIDGET
+
+#include "display.h"
+#include "touchscreen.h"
+
+#include <cstdint>
+#include <utility>
+
+/**
+    \brief Axis-aligned rectangle, in screen coordinates
+**/
+struct Rect
+{
+    int16_t x = 0;  ///< Left
+    int16_t y = 0;  ///< Top
+    int16_t w = 0;  ///< Width
+    int16_t h = 0;  ///< Height
+
+    Rect() = default;
+    Rect(int16_t x, int16_t y, int16_t w, int16_t h): x(x), y(y), w(w), h(h) {}
+
+    /**
+        \returns \c true if \c p lies within the rectangle
+    **/
+    bool contains(const Point2D& p) const;
+
+    /**
+        \returns \c true if both rectangles overlap
+    **/
+    bool intersects(const Rect& other) const;
+
+    /**
+        \returns \c true if the rectangle has no area
+    **/
+    bool isEmpty() const;
+};
+
+class Screen;
+
+/**
+    \brief Base class for retained-mode UI elements
+
+    Widgets form a tree (intrusive lists, no dynamic allocation) rooted in a Screen. Instead of
+    drawing directly, application code changes the state of the widgets, which flag themselves as
+    invalid; Screen::render() then redraws only the invalid widgets.
+
+    There are two levels of invalidation:
+    - invalidate() schedules a full redraw: the widget repaints its whole area, and so do its children.
+    - invalidateContent() schedules an incremental update: the widget only repaints what changed
+      (e.g. the moving part of a gauge), which avoids erasing then redrawing, and thus flickering.
+
+    Sibling widgets are expected not to overlap. Children are drawn after (on top of) their parent.
+**/
+class Widget
+{
+    public:
+        /**
+            \brief Constructor
+            \param bounds Area covered by the widget, in screen coordinates
+        **/
+        Widget(const Rect& bounds);
+
+        virtual ~Widget();
+
+        Widget(const Widget&) = delete;
+        Widget& operator=(const Widget&) = delete;
+
+        /**
+            \brief Append a child widget
+            \param child Widget to add. Must outlive this instance, or be removed before.
+            \remark The child is drawn on top of the already present children
+        **/
+        void addChild(Widget* child);
+
+        /**
+            \brief Remove a child widget
+            \param child Widget to remove
+            \remark If the child, or one of its descendants, is pressed, it will not receive the release
+        **/
+        void removeChild(Widget* child);
+
+        /**
+            \returns Area covered by the widget
+        **/
+        const Rect& bounds() const;
+
+        /**
+            \brief Move and/or resize the widget
+            \param bounds New area
+            \remark The parent is fully redrawn to erase the previous area
+        **/
+        void setBounds(const Rect& bounds);
+
+        /**
+            \returns \c true if the widget is visible
+        **/
+        bool isVisible() const;
+
+        /**
+            \brief Show or hide the widget
+            \param visible \c true to show, \c false to hide
+            \remark Hiding a widget fully redraws the parent, to erase it
+        **/
+        void setVisible(bool visible);
+
+        /**
+            \returns Background color
+        **/
+        uint16_t background() const;
+
+        /**
+            \brief Set the background color
+            \param color New background color
+        **/
+        void setBackground(uint16_t color);
+
+        /**
+            \brief Schedule a full redraw of the widget (and its children)
+        **/
+        void invalidate();
+
+        /**
+            \brief Schedule an incremental update of the widget
+        **/
+        void invalidateContent();
+
+        /**
+            \returns \c true if the widget needs to be redrawn
+        **/
+        bool isInvalid() const;
+
+        /**
+            \brief Find the top-most visible widget under a point
+            \param p Point, in screen coordinates
+            \returns Deepest widget under \c p, or \c nullptr
+        **/
+        Widget* hitTest(const Point2D& p);
+
+        /**
+            \returns Parent widget, or \c nullptr
+        **/
+        Widget* parent() const;
+
+    protected:
+        /**
+            \brief Draw the widget
+            \param display Display to draw on
+            \param full \c true to repaint the whole area, \c false to only update the content
+            since the last call
+        **/
+        virtual void draw(Display& display, bool full) = 0;
+
+        /**
+            \brief Called on touch events
+            \param p Touch coordinates
+            \param pressed \c true on press, \c false on release
+            \returns \c true if the event was handled, \c false to forward it to the parent
+            \remark Releases are sent to the widget that received the press, even when the
+            release point lies outside the widget, unless it was removed from the screen in between.
+        **/
+        virtual bool touchEvent(const Point2D& p, bool pressed);
+
+        Rect        m_bounds;
+        uint16_t    m_background = 0x0000;
+
+    private:
+        /**
+            \returns Screen at the root of the tree, or \c nullptr if the widget is not on a screen
+        **/
+        virtual Screen* screen();
+
+        enum class Invalidation: uint8_t
+        {
+            NONE,
+            CONTENT,
+            FULL
+        };
+
+        Widget*         m_parent        = nullptr;
+        Widget*         m_firstChild    = nullptr;
+        Widget*         m_nextSibling   = nullptr;
+
+        Invalidation    m_invalidation  = Invalidation::FULL;
+        bool            m_visible       = true;
+
+        friend class Screen;
+};
+
+/**
+    \brief Root of a widget tree, bound to a Display
+
+    Typical use, from the main loop:
+    \code
+    Screen screen(display);
+    Label  label(Rect(10, 10, 100, 8));
+    screen.addChild(&label);
+
+    while(true)
+    {
+        label.setText(...);
+        screen.processTouch(touchScreen);
+        screen.render();
+    }
+    \endcode
+**/
+class Screen: public Widget
+{
+    public:
+        /**
+            \brief Constructor
+            \param display Display to render to. The screen covers the whole display.
+        **/
+        Screen(Display& display);
+
+        /**
+            \brief Redraw the invalid widgets
+            \returns Number of widgets drawn
+        **/
+        uint32_t render();
+
+        /**
+            \brief Dispatch a touch state to the widgets
+            \param state Pair (pressed, point), as returned by Touch::update()
+        **/
+        void processTouch(const std::pair<bool, Point2D>& state);
+
+        /**
+            \brief Poll the touch driver and dispatch its state to the widgets
+            \param touchScreen Touch screen to poll
+        **/
+        void processTouch(TouchScreen& touchScreen);
+
+        /**
+            \returns Display the screen renders to
+        **/
+        Display& display();
+
+    protected:
+        virtual void draw(Display& display, bool full);
+
+    private:
+        virtual Screen* screen();
+
+        uint32_t render(Widget* widget, bool forced);
+
+        /**
+            \brief Forget the pressed widget if it lies in a subtree being removed from the screen
+            \param subtree Root of the subtree
+        **/
+        void release(Widget* subtree);
+
+        Display&    m_display;
+        Widget*     m_grab      = nullptr; ///< Widget that received the last press
+
+        friend class Widget;
+};
+
+/*
+    Defined here rather than in widget.cpp: the widget layer then links without the touch screen
+    code, which needs the HAL (host builds, see bench/ui_bench.cpp).
+*/
+inline void Screen::processTouch(TouchScreen& touchScreen)
+{
+    if(touchScreen.touch())
+        processTouch(touchScreen.touch()->update());
+}
+
+#endif
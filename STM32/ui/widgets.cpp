@@ -0,0 +1,298 @@
+#include "widgets.h"
+
+#include <cmath>
+#include <cstring>
+
+/* Built-in font glyph cell */
+static constexpr int16_t CHAR_WIDTH  = 6;
+static constexpr int16_t CHAR_HEIGHT = 8;
+
+static void copyText(char* dst, const char* src, uint32_t maxLength)
+{
+    if(!src)
+        src = "";
+
+    strncpy(dst, src, maxLength);
+    dst[maxLength] = '\0';
+}
+
+static int32_t clamp(int32_t v, int32_t min, int32_t max)
+{
+    return (v < min) ? min : ((v > max) ? max : v);
+}
+
+/* ------------------------------------------------------------------------- */
+
+Label::Label(const Rect& bounds, const char* text, uint16_t color, uint8_t size):
+    Widget(bounds), m_color(color), m_size(size ? size : 1)
+{
+    copyText(m_text, text, MAX_LENGTH);
+}
+
+void Label::setText(const char* text)
+{
+    char t[MAX_LENGTH+1];
+    copyText(t, text, MAX_LENGTH);
+
+    if(strcmp(t, m_text) == 0)
+        return;
+
+    strcpy(m_text, t);
+    invalidateContent();
+}
+
+const char* Label::text() const
+{
+    return m_text;
+}
+
+void Label::setColor(uint16_t color)
+{
+    if(color == m_color)
+        return;
+
+    m_color = color;
+    invalidate();
+}
+
+void Label::draw(Display& display, bool full)
+{
+    const int16_t cw = CHAR_WIDTH*m_size;
+    const int16_t ch = CHAR_HEIGHT*m_size;
+
+    /* Characters that fit in the label */
+    uint32_t capacity = (m_bounds.w > 0) ? m_bounds.w / cw : 0;
+    if(capacity > MAX_LENGTH)
+        capacity = MAX_LENGTH;
+
+    const uint32_t length = strlen(m_text);
+    const uint32_t drawnLength = full ? 0 : strlen(m_drawn);
+
+    for(uint32_t i = 0; i < capacity; ++i)
+    {
+        char c = (i < length) ? m_text[i] : ' ';
+        char d = (i < drawnLength) ? m_drawn[i] : ' ';
+
+        if(!full && c == d)
+            continue;
+
+        const int16_t x = m_bounds.x + i*cw;
+
+        if(c == ' ')
+            display.fillRect(x, m_bounds.y, cw, ch, m_background);
+        else
+            display.drawChar(x, m_bounds.y, c, m_color, m_background, m_size);
+    }
+
+    if(full)
+    {
+        /* Area not covered by character cells */
+        const int16_t tw = capacity*cw;
+
+        if(m_bounds.w > tw)
+            display.fillRect(m_bounds.x + tw, m_bounds.y, m_bounds.w - tw, m_bounds.h, m_background);
+
+        if(m_bounds.h > ch)
+            display.fillRect(m_bounds.x, m_bounds.y + ch, tw, m_bounds.h - ch, m_background);
+    }
+
+    strcpy(m_drawn, m_text);
+}
+
+/* ------------------------------------------------------------------------- */
+
+BarGraph::BarGraph(const Rect& bounds, int32_t min, int32_t max, uint16_t color, bool vertical):
+    Widget(bounds), m_min(min), m_max(max), m_value(min), m_color(color), m_vertical(vertical)
+{
+}
+
+void BarGraph::setValue(int32_t value)
+{
+    value = clamp(value, m_min, m_max);
+
+    if(value == m_value)
+        return;
+
+    m_value = value;
+
+    if(length() != m_drawnLength)
+        invalidateContent();
+}
+
+int32_t BarGraph::value() const
+{
+    return m_value;
+}
+
+int16_t BarGraph::length() const
+{
+    const int32_t full = m_vertical ? m_bounds.h : m_bounds.w;
+
+    if(m_max <= m_min)
+        return 0;
+
+    return (int64_t)(m_value - m_min)*full / (m_max - m_min);
+}
+
+void BarGraph::fillSpan(Display& display, int16_t from, int16_t to, uint16_t color)
+{
+    if(to <= from)
+        return;
+
+    if(m_vertical)
+        display.fillRect(m_bounds.x, m_bounds.y + m_bounds.h - to, m_bounds.w, to - from, color);
+    else
+        display.fillRect(m_bounds.x + from, m_bounds.y, to - from, m_bounds.h, color);
+}
+
+void BarGraph::draw(Display& display, bool full)
+{
+    const int16_t l = length();
+
+    if(full)
+    {
+        fillSpan(display, 0, l, m_color);
+        fillSpan(display, l, m_vertical ? m_bounds.h : m_bounds.w, m_background);
+    }
+    else if(l > m_drawnLength)
+        fillSpan(display, m_drawnLength, l, m_color);
+    else
+        fillSpan(display, l, m_drawnLength, m_background);
+
+    m_drawnLength = l;
+}
+
+/* ------------------------------------------------------------------------- */
+
+Gauge::Gauge(const Rect& bounds, int32_t min, int32_t max, uint16_t color):
+    Widget(bounds), m_min(min), m_max(max), m_value(min), m_color(color)
+{
+}
+
+void Gauge::setValue(int32_t value)
+{
+    value = clamp(value, m_min, m_max);
+
+    if(value == m_value)
+        return;
+
+    m_value = value;
+
+    if(needleEnd() != m_drawnNeedle)
+        invalidateContent();
+}
+
+int32_t Gauge::value() const
+{
+    return m_value;
+}
+
+Point2D Gauge::center() const
+{
+    return Point2D(m_bounds.x + m_bounds.w/2, m_bounds.y + m_bounds.h - 1);
+}
+
+int16_t Gauge::radius() const
+{
+    int16_t r = (m_bounds.w/2 < m_bounds.h) ? m_bounds.w/2 : m_bounds.h;
+    return r - 1;
+}
+
+Point2D Gauge::needleEnd() const
+{
+    /* Needle stays clear of the dial, so that erasing it leaves the dial intact */
+    const float length = radius() - 3;
+    const float ratio  = (m_max > m_min) ? (float)(m_value - m_min)/(float)(m_max - m_min) : 0.f;
+    const float angle  = M_PI*(1.f - ratio);
+
+    Point2D c = center();
+
+    return Point2D(c.x() + std::lround(length*std::cos(angle)),
+                   c.y() - std::lround(length*std::sin(angle)));
+}
+
+void Gauge::draw(Display& display, bool full)
+{
+    const Point2D c   = center();
+    const int16_t r   = radius();
+    const Point2D end = needleEnd();
+
+    if(full)
+    {
+        display.fillRect(m_bounds.x, m_bounds.y, m_bounds.w, m_bounds.h, m_background);
+
+        display.startWrite();
+        display.drawCircleHelper(c.x(), c.y(), r, 0x3, m_color);
+        display.endWrite();
+
+        display.drawPixel(c.x(), c.y() - r, m_color);
+        display.drawFastHLine(c.x() - r, c.y(), 2*r+1, m_color);
+    }
+    else
+    {
+        display.drawLine(c.x(), c.y(), m_drawnNeedle.x(), m_drawnNeedle.y(), m_background);
+        display.drawFastHLine(c.x() - r, c.y(), 2*r+1, m_color);
+    }
+
+    display.drawLine(c.x(), c.y(), end.x(), end.y(), m_color);
+
+    m_drawnNeedle = end;
+}
+
+/* ------------------------------------------------------------------------- */
+
+Button::Button(const Rect& bounds, const char* text, uint16_t color, void (*callback)(void)):
+    Widget(bounds), m_color(color), m_callback(callback)
+{
+    copyText(m_text, text, MAX_LENGTH);
+}
+
+void Button::setText(const char* text)
+{
+    copyText(m_text, text, MAX_LENGTH);
+    invalidate();
+}
+
+void Button::setCallback(void (*callback)(void))
+{
+    m_callback = callback;
+}
+
+bool Button::isPressed() const
+{
+    return m_pressed;
+}
+
+bool Button::touchEvent(const Point2D& p, bool pressed)
+{
+    m_pressed = pressed;
+    invalidate();
+
+    /* A release outside the button cancels the click */
+    if(!pressed && m_callback && m_bounds.contains(p))
+        m_callback();
+
+    return true;
+}
+
+void Button::draw(Display& display, bool)
+{
+    const uint16_t fg = m_pressed ? m_background : m_color;
+    const uint16_t bg = m_pressed ? m_color : m_background;
+
+    const int16_t r = (m_bounds.h < m_bounds.w ? m_bounds.h : m_bounds.w) / 4;
+
+    display.fillRoundRect(m_bounds.x, m_bounds.y, m_bounds.w, m_bounds.h, r, bg);
+    display.drawRoundRect(m_bounds.x, m_bounds.y, m_bounds.w, m_bounds.h, r, m_color);
+
+    /* Centered text */
+    int16_t length = strlen(m_text);
+    if(length*CHAR_WIDTH > m_bounds.w - 2*r)
+        length = (m_bounds.w - 2*r)/CHAR_WIDTH;
+
+    int16_t x = m_bounds.x + (m_bounds.w - length*CHAR_WIDTH)/2;
+    int16_t y = m_bounds.y + (m_bounds.h - CHAR_HEIGHT)/2;
+
+    for(int16_t i = 0; i < length; ++i, x += CHAR_WIDTH)
+        display.drawChar(x, y, m_text[i], fg, bg, 1);
+}
@@ -0,0 +1,200 @@
+/**
+    \file widgets.h
+    \version 1.0
+**/
+#ifndef GUARD_WIDGETS
+#define GUARD_WIDGETS
+
+#include "widget.h"
+
+/*
+    Labels and buttons are drawn with the built-in 6x8 font: no custom font (Display::setFont())
+    must be set on the display while rendering.
+*/
+
+/**
+    \brief Single line of text
+
+    Only the characters that changed since the last update are redrawn, each one over its own
+    background: updating a label never blinks.
+**/
+class Label: public Widget
+{
+    public:
+        static constexpr uint8_t MAX_LENGTH = 40; ///< Longer texts are truncated
+
+    public:
+        /**
+            \brief Constructor
+            \param bounds Area of the label. Text exceeding the width is clipped.
+            \param text Initial text
+            \param color Text color
+            \param size Text scale factor
+        **/
+        Label(const Rect& bounds, const char* text = "", uint16_t color = 0xFFFF, uint8_t size = 1);
+
+        /**
+            \brief Change the text
+            \param text New text (copied)
+        **/
+        void setText(const char* text);
+
+        /**
+            \returns Current text
+        **/
+        const char* text() const;
+
+        /**
+            \brief Change the text color
+            \param color New color
+        **/
+        void setColor(uint16_t color);
+
+    protected:
+        virtual void draw(Display& display, bool full);
+
+    private:
+        char        m_text[MAX_LENGTH+1]    = {0};
+        char        m_drawn[MAX_LENGTH+1]   = {0}; ///< Text currently on screen
+        uint16_t    m_color;
+        uint8_t     m_size;
+};
+
+/**
+    \brief Horizontal or vertical bar graph
+
+    Updates only repaint the difference between the previous and the new bar length.
+**/
+class BarGraph: public Widget
+{
+    public:
+        /**
+            \brief Constructor
+            \param bounds Area of the bar graph
+            \param min Value of an empty bar
+            \param max Value of a full bar
+            \param color Bar color
+            \param vertical \c true for a bar growing from bottom to top, \c false for left to right
+        **/
+        BarGraph(const Rect& bounds, int32_t min, int32_t max, uint16_t color, bool vertical = false);
+
+        /**
+            \brief Set the value
+            \param value New value, clamped to [min, max]
+        **/
+        void setValue(int32_t value);
+
+        /**
+            \returns Current value
+        **/
+        int32_t value() const;
+
+    protected:
+        virtual void draw(Display& display, bool full);
+
+    private:
+        int16_t length() const;
+        void    fillSpan(Display& display, int16_t from, int16_t to, uint16_t color);
+
+        int32_t     m_min;
+        int32_t     m_max;
+        int32_t     m_value;
+        uint16_t    m_color;
+        bool        m_vertical;
+
+        int16_t     m_drawnLength = 0;
+};
+
+/**
+    \brief Half-circle dial with a needle
+
+    Updates erase the previous needle and draw the new one, leaving the dial untouched.
+**/
+class Gauge: public Widget
+{
+    public:
+        /**
+            \brief Constructor
+            \param bounds Area of the gauge. The dial is centered on the bottom edge.
+            \param min Value at the left end of the dial
+            \param max Value at the right end of the dial
+            \param color Dial and needle color
+        **/
+        Gauge(const Rect& bounds, int32_t min, int32_t max, uint16_t color);
+
+        /**
+            \brief Set the value
+            \param value New value, clamped to [min, max]
+        **/
+        void setValue(int32_t value);
+
+        /**
+            \returns Current value
+        **/
+        int32_t value() const;
+
+    protected:
+        virtual void draw(Display& display, bool full);
+
+    private:
+        Point2D center() const;
+        int16_t radius() const;
+        Point2D needleEnd() const;
+
+        int32_t     m_min;
+        int32_t     m_max;
+        int32_t     m_value;
+        uint16_t    m_color;
+
+        Point2D     m_drawnNeedle;
+};
+
+/**
+    \brief Push button with a text label
+**/
+class Button: public Widget
+{
+    public:
+        static constexpr uint8_t MAX_LENGTH = 20; ///< Longer texts are truncated
+
+    public:
+        /**
+            \brief Constructor
+            \param bounds Area of the button
+            \param text Button text
+            \param color Text and border color. Swapped with the background while pressed.
+            \param callback Function to call when the button is released within its bounds. Can be
+            \c nullptr.
+        **/
+        Button(const Rect& bounds, const char* text, uint16_t color = 0xFFFF, void (*callback)(void) = nullptr);
+
+        /**
+            \brief Change the text
+            \param text New text (copied)
+        **/
+        void setText(const char* text);
+
+        /**
+            \brief Set the function called when the button is released
+            \param callback Callback, or \c nullptr
+        **/
+        void setCallback(void (*callback)(void));
+
+        /**
+            \returns \c true while the button is being pressed
+        **/
+        bool isPressed() const;
+
+    protected:
+        virtual void draw(Display& display, bool full);
+        virtual bool touchEvent(const Point2D& p, bool pressed);
+
+    private:
+        char        m_text[MAX_LENGTH+1] = {0};
+        uint16_t    m_color;
+        bool        m_pressed = false;
+
+        void (*m_callback)(void);
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "wall_clock.h"
+
+#include "system.h"
+
+#if defined(HAL_RTC_MODULE_ENABLED)
+	#include "rtc.h"
+#endif
+
+void WallClock::synchronize(uint64_t local, int64_t utc, Source source)
+{
+	if(m_source == NONE)
+	{
+		m_driftLocal	= local;
+		m_driftUtc		= utc;
+	}
+	else
+	{
+		if(source < m_source && local - m_local < DRIFT_INTERVAL)
+			return;
+
+		int64_t predicted;
+		toUTC(local, predicted);
+
+		const int64_t error = utc - predicted;
+		if(error > MAX_ERROR || error < -MAX_ERROR || local < m_local)
+		{ // Step: restart the drift measurement
+			m_driftLocal	= local;
+			m_driftUtc		= utc;
+		}
+		else if(local - m_driftLocal >= DRIFT_INTERVAL)
+		{
+			const int64_t elapsed	= utc - m_driftUtc;
+			const int64_t measured	= ((int64_t)(local - m_driftLocal) - elapsed)*1000000000LL/elapsed;
+
+			if(m_driftCount < DRIFT_FILTER)
+				++m_driftCount;
+
+			// Average of the first measurements, then exponential filter
+			m_drift += (measured - m_drift)/m_driftCount;
+
+			m_driftLocal	= local;
+			m_driftUtc		= utc;
+		}
+	}
+
+	m_local		= local;
+	m_utc		= utc;
+	m_source	= source;
+}
+
+#if defined(HAL_RTC_MODULE_ENABLED)
+bool WallClock::synchronizeRTC()
+{
+	if(!rtc.isInitialized())
+		return true;
+
+	DateTime	dt;
+	uint32_t	microseconds;
+
+	const uint64_t before = System::micros();
+	if(rtc.getDateTime(dt, microseconds))
+		return true;
+
+	const uint64_t after = System::micros();
+
+	synchronize(before + (after - before)/2, (int64_t)(dt.getEpoch())*1000000 + microseconds, RTC);
+	return false;
+}
+#endif
+
+void WallClock::reset()
+{
+	m_source		= NONE;
+	m_drift			= 0;
+	m_driftCount	= 0;
+}
+
+bool WallClock::now(int64_t& utc) const
+{
+	return toUTC(System::micros(), utc);
+}
+
+bool WallClock::toUTC(uint64_t local, int64_t& utc) const
+{
+	if(m_source == NONE)
+		return true;
+
+	const int64_t delta = local - m_local;
+	utc = m_utc + delta - delta*m_drift/1000000000LL;
+	return false;
+}
+
+bool WallClock::toLocal(int64_t utc, uint64_t& local) const
+{
+	if(m_source == NONE)
+		return true;
+
+	const int64_t delta = utc - m_utc;
+	const int64_t l = (int64_t)(m_local) + delta + delta*m_drift/1000000000LL;
+	if(l < 0)
+		return true;
+
+	local = l;
+	return false;
+}
+
+int32_t WallClock::drift() const
+{
+	return m_drift;
+}
+
+WallClock::Source WallClock::source() const
+{
+	return m_source;
+}
+
+uint64_t WallClock::lastSynchronization() const
+{
+	return m_local;
+}
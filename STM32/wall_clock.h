@@ -0,0 +1,112 @@
+/**
+	\file wall_clock.h
+	\version 1.0
+**/
+
+#ifndef GUARD_WALL_CLOCK
+#define GUARD_WALL_CLOCK
+
+#include "hal.h"
+
+/**
+	\brief UTC time from the local monotonic clock (System::micros())
+
+	The wall clock is synchronized by pairs of simultaneous local and UTC times, given by a reference (RTC, GPS,
+	...). Between synchronizations, the UTC time is extrapolated from the latest one, corrected by the estimated
+	drift of the local clock: local timestamps taken with System::micros() can be converted to UTC afterwards.
+
+	The drift is measured over at least DRIFT_INTERVAL, and low-pass filtered. A synchronization too far from the
+	extrapolated time (more than MAX_ERROR, e.g. when the reference is set) steps the clock without changing the
+	drift.
+**/
+class WallClock
+{
+	public:
+		static constexpr uint64_t	DRIFT_INTERVAL	= 60000000;	///< Minimum drift measurement interval, in us
+		static constexpr int64_t	MAX_ERROR		= 1000000;	///< Maximum error before stepping the clock, in us
+
+		/**
+			\brief Time references, from the least to the most accurate
+		**/
+		enum Source: uint8_t
+		{
+			NONE,	///< Not synchronized
+			RTC,	///< Real time clock
+			GPS,	///< GPS navigation solution (reception time)
+			PPS		///< GPS time pulse
+		};
+
+	public:
+		/**
+			\brief Synchronize the clock
+			\param local Local time (System::micros()), in us
+			\param utc UTC time at \c local, in us since epoch
+			\param source Reference
+
+			The synchronization is ignored if a more accurate reference was used in the last DRIFT_INTERVAL.
+		**/
+		void synchronize(uint64_t local, int64_t utc, Source source);
+
+	#if defined(HAL_RTC_MODULE_ENABLED)
+		/**
+			\brief Synchronize the clock on the RTC (with its fraction of second)
+			\returns \c true on error (RTC not initialized), \c false otherwise
+		**/
+		bool synchronizeRTC();
+	#endif
+
+		/**
+			\brief Forget the synchronization and the drift
+		**/
+		void reset();
+
+		/**
+			\param utc Current UTC time, in us since epoch
+			\returns \c true on error (not synchronized), \c false otherwise
+		**/
+		bool now(int64_t& utc) const;
+
+		/**
+			\brief Convert a local time to UTC
+			\param local Local time (System::micros()), in us
+			\param utc UTC time, in us since epoch
+			\returns \c true on error (not synchronized), \c false otherwise
+		**/
+		bool toUTC(uint64_t local, int64_t& utc) const;
+
+		/**
+			\brief Convert a UTC time to local time (e.g. to schedule an event)
+			\param utc UTC time, in us since epoch
+			\param local Local time (System::micros()), in us
+			\returns \c true on error (not synchronized, or before the local time origin), \c false otherwise
+		**/
+		bool toLocal(int64_t utc, uint64_t& local) const;
+
+		/**
+			\returns Estimated frequency error of the local clock, in ppb (positive if it is fast)
+		**/
+		int32_t drift() const;
+
+		/**
+			\returns The reference of the latest synchronization
+		**/
+		Source source() const;
+
+		/**
+			\returns Local time of the latest synchronization (System::micros()), in us
+		**/
+		uint64_t lastSynchronization() const;
+
+	private:
+		Source		m_source		= NONE;
+		uint64_t	m_local			= 0;	///< Latest synchronization, local time
+		int64_t		m_utc			= 0;	///< Latest synchronization, UTC time
+		uint64_t	m_driftLocal	= 0;	///< Start of the drift measurement, local time
+		int64_t		m_driftUtc		= 0;	///< Start of the drift measurement, UTC time
+		int32_t		m_drift			= 0;	///< In ppb
+		uint8_t		m_driftCount	= 0;	///< Number of drift measurements, up to DRIFT_FILTER
+
+		static constexpr uint8_t DRIFT_FILTER = 8;	///< Drift filter weight
+};
+
+#endif